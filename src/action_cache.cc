@@ -0,0 +1,446 @@
+#include "action_cache.h"
+
+#include <cinttypes>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "platform/file_system.h"
+#include "remote_cache.h"
+#include "sha256.h"
+#include "stdext/file_system.h"
+
+namespace respire {
+
+namespace {
+const char kIndexHeader[] = "# respire action cache index v1";
+const char kEntryHeader[] = "# respire action cache entry v2";
+
+// The number of results kept for each action, e.g. one for each branch that
+// it's built on.
+const size_t kMaxResultsPerAction = 8;
+
+// Don't bother compacting small indices, or indices that are mostly still
+// current.
+const size_t kMinLinesForCompaction = 1000;
+const size_t kMaxLinesPerItem = 3;
+
+// Cache files are spread over subdirectories named by their first few
+// characters, so that no one directory grows too large.
+std::string NameOf(const char* kind, const std::string& key) {
+  return std::string(kind) + "/" + key.substr(0, 2) + "/" + key;
+}
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::ostringstream stream;
+  stream << in.rdbuf();
+  *contents = stream.str();
+  return true;
+}
+
+// Parses the results of an action's entry, returning false if the entry is
+// malformed.
+bool ParseEntry(const std::string& contents,
+                std::vector<ActionCache::Result>* results) {
+  std::istringstream in(contents);
+  std::string line;
+  if (!std::getline(in, line) || line != kEntryHeader) {
+    return false;
+  }
+  while (std::getline(in, line)) {
+    if (line == "result") {
+      results->emplace_back();
+      continue;
+    }
+    size_t first_tab = line.find('\t');
+    size_t second_tab = line.find('\t', first_tab + 1);
+    if (results->empty() || first_tab == std::string::npos ||
+        second_tab == std::string::npos || second_tab + 1 == line.size()) {
+      return false;
+    }
+    std::string kind = line.substr(0, first_tab);
+    std::string value = line.substr(first_tab + 1, second_tab - first_tab - 1);
+    // The path is last, so that it may contain anything but a newline.
+    std::string path = line.substr(second_tab + 1);
+    if (kind == "dep") {
+      results->back().dependencies.push_back({path, value});
+    } else if (kind == "out") {
+      results->back().outputs.push_back({path, value});
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string FormatEntry(const std::vector<ActionCache::Result>& results) {
+  std::ostringstream out;
+  out << kEntryHeader << "\n";
+  for (const auto& result : results) {
+    out << "result\n";
+    for (const auto& dependency : result.dependencies) {
+      out << "dep\t" << dependency.digest << "\t" << dependency.path << "\n";
+    }
+    for (const auto& output : result.outputs) {
+      out << "out\t" << output.digest << "\t" << output.path << "\n";
+    }
+  }
+  return out.str();
+}
+
+bool SameDependencies(const ActionCache::Result& a,
+                      const ActionCache::Result& b) {
+  if (a.dependencies.size() != b.dependencies.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.dependencies.size(); ++i) {
+    if (a.dependencies[i].path != b.dependencies[i].path ||
+        a.dependencies[i].digest != b.dependencies[i].digest) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MakeParentDirectories(const std::string& path) {
+  stdext::file_system::Path parent = stdext::file_system::Path(path).pop();
+  return parent.str().empty() || parent.str() == path ||
+         platform::MakeDirectories(parent.c_str());
+}
+
+bool RenameFile(const std::string& from, const std::string& to) {
+#if defined(_WIN32)
+  // Windows won't rename over an existing file.
+  std::remove(to.c_str());
+#endif
+  if (std::rename(from.c_str(), to.c_str()) != 0) {
+    std::remove(from.c_str());
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+ActionCache::ActionCache(const std::string& directory, uint64_t max_size)
+    : directory_(directory),
+      index_path_(stdext::file_system::Join(
+          stdext::file_system::PathStrRef(directory.c_str()),
+          stdext::file_system::PathStrRef("index.log")).str()),
+      max_size_(max_size),
+      temporary_suffix_(std::to_string(std::random_device()())),
+      size_(0), num_index_lines_(0), num_temporary_files_(0),
+      index_file_(nullptr) {}
+
+ActionCache::~ActionCache() {
+  if (index_file_) {
+    std::fclose(index_file_);
+  }
+}
+
+std::unique_ptr<ActionCache> ActionCache::Open(const std::string& directory,
+                                               uint64_t max_size) {
+  if (!platform::MakeDirectories(directory.c_str())) {
+    return nullptr;
+  }
+  std::unique_ptr<ActionCache> cache(new ActionCache(directory, max_size));
+  if (!cache->Load() || cache->NeedsCompaction()) {
+    if (!cache->WriteCompacted()) {
+      return nullptr;
+    }
+  }
+
+  cache->index_file_ = std::fopen(cache->index_path_.c_str(), "ab");
+  if (!cache->index_file_) {
+    return nullptr;
+  }
+  return cache;
+}
+
+std::vector<ActionCache::Result> ActionCache::Lookup(const std::string& key,
+                                                    RemoteCache* remote) {
+  std::string name = NameOf("ac", key);
+  std::string contents;
+  std::vector<Result> results;
+  if (ReadFile(PathOf(name), &contents) && ParseEntry(contents, &results)) {
+    Use(name, contents.size());
+    return results;
+  }
+
+  results.clear();
+  stdext::optional<std::string> remote_contents;
+  if (remote) {
+    remote_contents = remote->GetActionResult(key);
+  }
+  if (!remote_contents || !ParseEntry(*remote_contents, &results)) {
+    return std::vector<Result>();
+  }
+  // Keep it, so that later builds needn't ask the remote cache again.
+  WriteEntry(name, results);
+  return results;
+}
+
+bool ActionCache::Restore(const Result& result, RemoteCache* remote) {
+  for (const auto& output : result.outputs) {
+    std::string name = NameOf("cas", output.digest);
+    std::string path = PathOf(name);
+    stdext::optional<platform::FileStatus> status =
+        platform::GetFileStatus(path.c_str());
+    if (!status && remote && DownloadBlob(output.digest, remote)) {
+      status = platform::GetFileStatus(path.c_str());
+    }
+    if (!status || !MakeParentDirectories(output.path) ||
+        !platform::CopyRegularFile(path.c_str(), output.path.c_str())) {
+      return false;
+    }
+    Use(name, status->size);
+  }
+  return true;
+}
+
+bool ActionCache::Store(const std::string& key,
+                        const std::vector<Dependency>& dependencies,
+                        const std::vector<std::string>& output_paths,
+                        RemoteCache* remote) {
+  Result result;
+  result.dependencies = dependencies;
+  for (const auto& output_path : output_paths) {
+    stdext::optional<std::string> digest = Sha256::HashFile(output_path);
+    if (!digest || !AddFile(NameOf("cas", *digest), output_path)) {
+      return false;
+    }
+    result.outputs.push_back({output_path, *digest});
+  }
+
+  // Keep the other results for the action, other than any that this one
+  // replaces.
+  std::string name = NameOf("ac", key);
+  std::string contents;
+  std::vector<Result> previous_results;
+  if (ReadFile(PathOf(name), &contents) &&
+      !ParseEntry(contents, &previous_results)) {
+    previous_results.clear();
+  }
+  std::vector<Result> results(1, result);
+  for (auto& previous_result : previous_results) {
+    if (results.size() < kMaxResultsPerAction &&
+        !SameDependencies(previous_result, result)) {
+      results.push_back(std::move(previous_result));
+    }
+  }
+  if (!WriteEntry(name, results)) {
+    return false;
+  }
+
+  if (remote) {
+    std::vector<RemoteCache::Blob> blobs;
+    for (const auto& output : result.outputs) {
+      blobs.push_back({output.digest, PathOf(NameOf("cas", output.digest))});
+    }
+    remote->PutActionResult(key, FormatEntry(results), blobs);
+  }
+  return true;
+}
+
+uint64_t ActionCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+bool ActionCache::Load() {
+  std::ifstream in(index_path_.c_str());
+  std::string line;
+  if (!in || !std::getline(in, line) || line != kIndexHeader) {
+    return false;
+  }
+
+  while (std::getline(in, line)) {
+    ++num_index_lines_;
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || tab == 0 || tab + 1 == line.size()) {
+      // Most likely the last line was cut short by an interrupted build.
+      continue;
+    }
+    std::string name = line.substr(tab + 1);
+    if (line[0] == '-') {
+      ForgetLocked(name);
+      continue;
+    }
+    char* end;
+    uint64_t size = std::strtoull(line.c_str(), &end, 10);
+    if (end != line.c_str() + tab) {
+      continue;
+    }
+    UseLocked(name, size);
+  }
+  return true;
+}
+
+bool ActionCache::NeedsCompaction() const {
+  return num_index_lines_ >= kMinLinesForCompaction &&
+         num_index_lines_ > kMaxLinesPerItem * items_.size();
+}
+
+bool ActionCache::WriteCompacted() {
+  std::string temp_path = index_path_ + ".tmp";
+  FILE* file = std::fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  std::fprintf(file, "%s\n", kIndexHeader);
+  // Oldest first, so that reading the index back gives the same order.
+  for (auto name = lru_.rbegin(); name != lru_.rend(); ++name) {
+    std::fprintf(file, "%" PRIu64 "\t%s\n", items_[*name].size,
+                 name->c_str());
+  }
+  if (std::fclose(file) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  if (!RenameFile(temp_path, index_path_)) {
+    return false;
+  }
+  num_index_lines_ = items_.size();
+  return true;
+}
+
+std::string ActionCache::PathOf(const std::string& name) const {
+  std::string path = directory_ + platform::kPathSeparator + name;
+  if (platform::kPathSeparator[0] != '/') {
+    for (char& c : path) {
+      if (c == '/') {
+        c = platform::kPathSeparator[0];
+      }
+    }
+  }
+  return path;
+}
+
+std::string ActionCache::TemporaryPathFor(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return path + ".tmp" + temporary_suffix_ + "_" +
+         std::to_string(num_temporary_files_++);
+}
+
+bool ActionCache::AddFile(const std::string& name, const std::string& source) {
+  std::string path = PathOf(name);
+  stdext::optional<platform::FileStatus> status =
+      platform::GetFileStatus(path.c_str());
+  if (!status) {
+    // Copy to a temporary file first, so that nobody restores a partial copy.
+    std::string temp_path = TemporaryPathFor(path);
+    if (!MakeParentDirectories(path) ||
+        !platform::CopyRegularFile(source.c_str(), temp_path.c_str())) {
+      std::remove(temp_path.c_str());
+      return false;
+    }
+    if (!RenameFile(temp_path, path)) {
+      return false;
+    }
+    status = platform::GetFileStatus(path.c_str());
+    if (!status) {
+      return false;
+    }
+  }
+  Use(name, status->size);
+  return true;
+}
+
+bool ActionCache::DownloadBlob(const std::string& digest,
+                               RemoteCache* remote) {
+  std::string name = NameOf("cas", digest);
+  std::string path = PathOf(name);
+  // As in AddFile(), nobody may restore a partial download.
+  std::string temp_path = TemporaryPathFor(path);
+  if (!MakeParentDirectories(path) || !remote->GetBlob(digest, temp_path)) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  if (!RenameFile(temp_path, path)) {
+    return false;
+  }
+  stdext::optional<platform::FileStatus> status =
+      platform::GetFileStatus(path.c_str());
+  if (!status) {
+    return false;
+  }
+  Use(name, status->size);
+  return true;
+}
+
+bool ActionCache::WriteEntry(const std::string& name,
+                             const std::vector<Result>& results) {
+  std::string path = PathOf(name);
+  std::string contents = FormatEntry(results);
+  std::string temp_path = TemporaryPathFor(path);
+  if (!MakeParentDirectories(path)) {
+    return false;
+  }
+  {
+    std::ofstream out(temp_path.c_str(), std::ios::out | std::ios::binary);
+    out << contents;
+    if (!out.flush()) {
+      out.close();
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  if (!RenameFile(temp_path, path)) {
+    return false;
+  }
+  Use(name, contents.size());
+  return true;
+}
+
+void ActionCache::Use(const std::string& name, uint64_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  UseLocked(name, size);
+  if (index_file_) {
+    std::fprintf(index_file_, "%" PRIu64 "\t%s\n", size, name.c_str());
+    ++num_index_lines_;
+  }
+  EvictLocked();
+  if (index_file_) {
+    std::fflush(index_file_);
+  }
+}
+
+void ActionCache::UseLocked(const std::string& name, uint64_t size) {
+  auto found = items_.find(name);
+  if (found != items_.end()) {
+    size_ -= found->second.size;
+    lru_.erase(found->second.position);
+  }
+  lru_.push_front(name);
+  size_ += size;
+  items_[name] = Item{size, lru_.begin()};
+}
+
+void ActionCache::ForgetLocked(const std::string& name) {
+  auto found = items_.find(name);
+  if (found == items_.end()) {
+    return;
+  }
+  size_ -= found->second.size;
+  lru_.erase(found->second.position);
+  items_.erase(found);
+}
+
+void ActionCache::EvictLocked() {
+  // The most recently used file is always kept, since it's in use.
+  while (size_ > max_size_ && lru_.size() > 1) {
+    std::string name = lru_.back();
+    std::remove(PathOf(name).c_str());
+    ForgetLocked(name);
+    if (index_file_) {
+      std::fprintf(index_file_, "-\t%s\n", name.c_str());
+      ++num_index_lines_;
+    }
+  }
+}
+
+}  // namespace respire
@@ -0,0 +1,136 @@
+#ifndef __RESPIRE_ACTION_CACHE_H__
+#define __RESPIRE_ACTION_CACHE_H__
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stdext/optional.h"
+
+namespace respire {
+
+class RemoteCache;
+
+// A persistent cache, kept across builds and shared between output
+// directories, of the outputs that commands produced from given inputs.  An
+// action, i.e. a command along with the contents of its declared inputs and
+// the paths of its outputs, is identified by a |key| that the caller computes.
+// When an action that was run before is to be run again, e.g. after switching
+// branches and back, its outputs are copied out of the cache instead.
+//
+// Actions may also depend on files that are only discovered by running them,
+// e.g. the headers listed in a C++ compiler's deps file.  Each action's entry
+// therefore holds a few results, each with the SHA-256 digests of the files
+// that it depended on, and only a result whose dependencies are unchanged may
+// be used.
+//
+// The cache directory holds:
+//
+//   ac/[key prefix]/[key]:  The results of each action, most recent first.
+//   cas/[digest prefix]/[digest]:  The content of each output file, named by
+//       its SHA-256 digest.
+//   index.log:  The size of each of the above, in order of use.
+//
+// The index is appended to whenever a file in the cache is used, and once the
+// cache grows beyond its maximum size, the least recently used files are
+// removed until it fits again.
+//
+// Each operation may be given a RemoteCache shared with other machines, which
+// is consulted on a local miss, and which whatever is stored is also uploaded
+// to.  Anything downloaded from it is kept locally for later builds.
+class ActionCache {
+ public:
+  struct Dependency {
+    std::string path;
+    // The SHA-256 digest of the file's contents.
+    std::string digest;
+  };
+  struct Output {
+    std::string path;
+    std::string digest;
+  };
+  struct Result {
+    std::vector<Dependency> dependencies;
+    std::vector<Output> outputs;
+  };
+
+  // Opens the cache in |directory|, creating it if it doesn't exist yet.
+  // Returns null if the cache can't be written to.
+  static std::unique_ptr<ActionCache> Open(const std::string& directory,
+                                           uint64_t max_size);
+  ~ActionCache();
+
+  // Returns the results recorded for the action with |key|, most recent
+  // first.
+  std::vector<Result> Lookup(const std::string& key,
+                             RemoteCache* remote = nullptr);
+  // Copies each of |result|'s outputs out of the cache to its path, returning
+  // false if any of them are no longer cached.
+  bool Restore(const Result& result, RemoteCache* remote = nullptr);
+  // Copies the files at |output_paths| into the cache, and records them as
+  // the result of the action with |key| given |dependencies|.  Returns false
+  // if any of the outputs couldn't be read.
+  bool Store(const std::string& key,
+             const std::vector<Dependency>& dependencies,
+             const std::vector<std::string>& output_paths,
+             RemoteCache* remote = nullptr);
+
+  // The total size of the files in the cache.
+  uint64_t size() const;
+
+ private:
+  struct Item {
+    uint64_t size;
+    // This item's position in |lru_|.
+    std::list<std::string>::iterator position;
+  };
+
+  ActionCache(const std::string& directory, uint64_t max_size);
+
+  bool Load();
+  bool NeedsCompaction() const;
+  bool WriteCompacted();
+
+  // Returns the path of the cache file with |name|, e.g. "cas/ab/abcd...".
+  std::string PathOf(const std::string& name) const;
+  // Returns a path that no other writer is using, for writing out |path|
+  // before renaming it into place.
+  std::string TemporaryPathFor(const std::string& path);
+  // Copies |source| into the cache as |name|, unless it's already there.
+  bool AddFile(const std::string& name, const std::string& source);
+  // Downloads the blob with |digest| from |remote| into the cache.
+  bool DownloadBlob(const std::string& digest, RemoteCache* remote);
+  bool WriteEntry(const std::string& name, const std::vector<Result>& results);
+
+  // Records that the cache file |name|, with |size|, was just used, and
+  // removes the least recently used files if the cache has grown too big.
+  void Use(const std::string& name, uint64_t size);
+  void UseLocked(const std::string& name, uint64_t size);
+  void ForgetLocked(const std::string& name);
+  void EvictLocked();
+
+  const std::string directory_;
+  const std::string index_path_;
+  const uint64_t max_size_;
+  // Distinguishes our temporary files from those of other builds.
+  const std::string temporary_suffix_;
+
+  mutable std::mutex mutex_;
+  // The names of the files in the cache, most recently used first.
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, Item> items_;
+  uint64_t size_;
+  size_t num_index_lines_;
+  uint64_t num_temporary_files_;
+  FILE* index_file_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_ACTION_CACHE_H__
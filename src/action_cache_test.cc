@@ -0,0 +1,168 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "action_cache.h"
+#include "stdext/file_system.h"
+
+using respire::ActionCache;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+namespace {
+const uint64_t kMaxSize = 1024 * 1024;
+
+void WriteToFile(const Path& path, const std::string& contents) {
+  std::ofstream out(path.c_str(), std::ios::binary);
+  ASSERT_TRUE(out);
+  out << contents;
+}
+
+std::string ReadFileContents(const Path& path) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+std::string Key(int i) {
+  std::string key = std::to_string(i);
+  return std::string(64 - key.size(), '0') + key;
+}
+
+// Digests, like keys, are 64 hex digits.
+std::string Digest(int i) {
+  return Key(i);
+}
+}  // namespace
+
+TEST(ActionCacheTest, RestoresStoredOutputs) {
+  TemporaryDirectory temp_dir;
+  Path cache_dir = Join(temp_dir.path(), PathStrRef("cache"));
+  Path foo = Join(temp_dir.path(), PathStrRef("foo.o"));
+  Path bar = Join(temp_dir.path(), PathStrRef("bar.o"));
+  WriteToFile(foo, "foo contents");
+  WriteToFile(bar, "bar contents");
+
+  std::vector<ActionCache::Dependency> dependencies = {{"foo.h", Digest(42)}};
+  {
+    std::unique_ptr<ActionCache> cache =
+        ActionCache::Open(cache_dir.str(), kMaxSize);
+    ASSERT_NE(nullptr, cache);
+    EXPECT_TRUE(cache->Lookup(Key(1)).empty());
+    EXPECT_TRUE(cache->Store(Key(1), dependencies, {foo.str(), bar.str()}));
+  }
+  std::remove(foo.c_str());
+  WriteToFile(bar, "something else");
+
+  // The cache is found again by later builds.
+  std::unique_ptr<ActionCache> cache =
+      ActionCache::Open(cache_dir.str(), kMaxSize);
+  ASSERT_NE(nullptr, cache);
+  EXPECT_LT(0, cache->size());
+  std::vector<ActionCache::Result> results = cache->Lookup(Key(1));
+  ASSERT_EQ(1, results.size());
+  ASSERT_EQ(1, results[0].dependencies.size());
+  EXPECT_EQ("foo.h", results[0].dependencies[0].path);
+  EXPECT_EQ(Digest(42), results[0].dependencies[0].digest);
+  ASSERT_EQ(2, results[0].outputs.size());
+  EXPECT_EQ(foo.str(), results[0].outputs[0].path);
+
+  EXPECT_TRUE(cache->Restore(results[0]));
+  EXPECT_EQ("foo contents", ReadFileContents(foo));
+  EXPECT_EQ("bar contents", ReadFileContents(bar));
+  EXPECT_TRUE(cache->Lookup(Key(2)).empty());
+}
+
+TEST(ActionCacheTest, KeepsResultsForDifferentDependencies) {
+  TemporaryDirectory temp_dir;
+  Path cache_dir = Join(temp_dir.path(), PathStrRef("cache"));
+  Path foo = Join(temp_dir.path(), PathStrRef("foo.o"));
+  std::unique_ptr<ActionCache> cache =
+      ActionCache::Open(cache_dir.str(), kMaxSize);
+  ASSERT_NE(nullptr, cache);
+
+  WriteToFile(foo, "with old header");
+  EXPECT_TRUE(cache->Store(Key(1), {{"foo.h", Digest(1)}}, {foo.str()}));
+  WriteToFile(foo, "with new header");
+  EXPECT_TRUE(cache->Store(Key(1), {{"foo.h", Digest(2)}}, {foo.str()}));
+  // Storing the same dependencies again replaces their result.
+  WriteToFile(foo, "with newest header");
+  EXPECT_TRUE(cache->Store(Key(1), {{"foo.h", Digest(2)}}, {foo.str()}));
+
+  std::vector<ActionCache::Result> results = cache->Lookup(Key(1));
+  ASSERT_EQ(2, results.size());
+  EXPECT_EQ(Digest(2), results[0].dependencies[0].digest);
+  EXPECT_EQ(Digest(1), results[1].dependencies[0].digest);
+
+  EXPECT_TRUE(cache->Restore(results[1]));
+  EXPECT_EQ("with old header", ReadFileContents(foo));
+  EXPECT_TRUE(cache->Restore(results[0]));
+  EXPECT_EQ("with newest header", ReadFileContents(foo));
+}
+
+TEST(ActionCacheTest, LeastRecentlyUsedFilesAreEvicted) {
+  TemporaryDirectory temp_dir;
+  Path cache_dir = Join(temp_dir.path(), PathStrRef("cache"));
+  Path output = Join(temp_dir.path(), PathStrRef("out.o"));
+  const std::string contents(1000, 'x');
+  // Room for the entries and blobs of about three actions.
+  const uint64_t max_size = 3500;
+
+  std::vector<ActionCache::Result> first_results;
+  {
+    std::unique_ptr<ActionCache> cache =
+        ActionCache::Open(cache_dir.str(), max_size);
+    ASSERT_NE(nullptr, cache);
+    for (int i = 0; i < 3; ++i) {
+      WriteToFile(output, contents + std::to_string(i));
+      EXPECT_TRUE(cache->Store(Key(i), {}, {output.str()}));
+    }
+    // Using the first action makes the second the least recently used.
+    first_results = cache->Lookup(Key(0));
+    ASSERT_EQ(1, first_results.size());
+    EXPECT_TRUE(cache->Restore(first_results[0]));
+  }
+
+  // The order of use is remembered by later builds.
+  std::unique_ptr<ActionCache> cache =
+      ActionCache::Open(cache_dir.str(), max_size);
+  ASSERT_NE(nullptr, cache);
+  WriteToFile(output, contents + "3");
+  EXPECT_TRUE(cache->Store(Key(3), {}, {output.str()}));
+  EXPECT_GE(max_size, cache->size());
+
+  std::vector<ActionCache::Result> results = cache->Lookup(Key(0));
+  ASSERT_EQ(1, results.size());
+  EXPECT_TRUE(cache->Restore(results[0]));
+  EXPECT_EQ(contents + "0", ReadFileContents(output));
+  EXPECT_TRUE(cache->Lookup(Key(1)).empty());
+  EXPECT_EQ(1, cache->Lookup(Key(3)).size());
+}
+
+TEST(ActionCacheTest, EvictedOutputsAreNotRestored) {
+  TemporaryDirectory temp_dir;
+  Path cache_dir = Join(temp_dir.path(), PathStrRef("cache"));
+  Path output = Join(temp_dir.path(), PathStrRef("out.o"));
+  std::unique_ptr<ActionCache> cache =
+      ActionCache::Open(cache_dir.str(), kMaxSize);
+  ASSERT_NE(nullptr, cache);
+
+  WriteToFile(output, "contents");
+  EXPECT_TRUE(cache->Store(Key(1), {}, {output.str()}));
+  std::vector<ActionCache::Result> results = cache->Lookup(Key(1));
+  ASSERT_EQ(1, results.size());
+
+  // As if another build sharing the cache evicted the output.
+  const std::string& digest = results[0].outputs[0].digest;
+  Path blob = Join(
+      Join(Join(cache_dir, PathStrRef("cas")),
+           PathStrRef(digest.substr(0, 2).c_str())),
+      PathStrRef(digest.c_str()));
+  ASSERT_EQ(0, std::remove(blob.c_str()));
+  EXPECT_FALSE(cache->Restore(results[0]));
+}
@@ -28,6 +28,9 @@ std::string ToJSON(const std::string& input) {
   for (const auto& c : input) {
     // TODO: This is sorrowly incomplete.
     switch (c) {
+      case '\t': {
+        oss << "\\t";
+      } break;
       case '"': {
         oss << "\\\"";
       } break;
@@ -41,7 +44,14 @@ std::string ToJSON(const std::string& input) {
         oss << "\\\\";
       } break;
       default:
-        oss << c;
+        if (static_cast<unsigned char>(c) < 0x20) {
+          // Other control characters, e.g. from colored command output, must
+          // be escaped to keep the JSON valid.
+          static const char kHexDigits[] = "0123456789abcdef";
+          oss << "\\u00" << kHexDigits[c >> 4] << kHexDigits[c & 0xf];
+        } else {
+          oss << c;
+        }
     }
   }
   return oss.str();
@@ -79,6 +89,11 @@ void MaybeOutputPath(
   }
 }
 
+void OutputCount(std::ostream* oss, const char* key, uint64_t count) {
+  OutputKey(oss, key);
+  *oss << "\"" << count << "\", ";
+}
+
 void OutputNodeFooter(std::ostream* oss) {
   // Add a dummy entry so that we never have a trailing comma.
   *oss << "\"d\":\"0\"},\n";
@@ -136,9 +151,10 @@ void ActivityLog::FileProcessNodeLog::SignalStartRunningCommand(bool dry_run) {
   std::ostringstream oss;
   activity_log_->OutputNodeHeader(&oss, node_id_, "ExecutingCommand");
   if (dry_run) {
-    // By flagging whether this is a dry run or not, and then always performing
-    // a dry run before doing a real run, we enable the log output viewer to
-    // learn how many nodes will need to be built.
+    // By flagging whether this is a dry run or not, and then always signalling
+    // a dry run as soon as a node's dependency scan finds that it needs to be
+    // built, we enable the log output viewer to learn how many nodes will need
+    // to be built.
     OutputString(&oss, "dry_run", "true");
   }
   OutputNodeFooter(&oss);
@@ -146,6 +162,22 @@ void ActivityLog::FileProcessNodeLog::SignalStartRunningCommand(bool dry_run) {
   activity_log_->Log(oss.str());
 }
 
+void ActivityLog::FileProcessNodeLog::RecordResourceUsage(
+    const stdext::optional<platform::ResourceUsage>& resource_usage,
+    std::chrono::microseconds wall_time) {
+  wall_time_ = wall_time;
+  resource_usage_ = resource_usage;
+}
+
+void ActivityLog::FileProcessNodeLog::RecordCommandOutput(
+    std::string&& stdout_output, std::string&& stderr_output) {
+  if (!activity_log_->IsEnabled()) {
+    return;
+  }
+  stdout_output_ = std::move(stdout_output);
+  stderr_output_ = std::move(stderr_output);
+}
+
 void ActivityLog::FileProcessNodeLog::SignalProcessingComplete(
     const stdext::optional<Error>& error, bool dry_run) {
   if (!running_command_ && !error && activity_log_->level_ != Level::All) {
@@ -162,6 +194,26 @@ void ActivityLog::FileProcessNodeLog::SignalProcessingComplete(
   if (error) {
     OutputRawString(&oss, "error", error->str().c_str());
   }
+  if (wall_time_) {
+    OutputCount(&oss, "wall_time_us", wall_time_->count());
+  }
+  if (resource_usage_) {
+    OutputCount(&oss, "user_time_us", resource_usage_->user_time.count());
+    OutputCount(&oss, "system_time_us", resource_usage_->system_time.count());
+    OutputCount(&oss, "max_rss_bytes", resource_usage_->max_rss_bytes);
+    OutputCount(
+        &oss, "block_input_ops", resource_usage_->block_input_operations);
+    OutputCount(
+        &oss, "block_output_ops", resource_usage_->block_output_operations);
+  }
+  if (!stdout_output_.empty()) {
+    OutputRawString(&oss, "stdout_output", stdout_output_.c_str());
+    stdout_output_.clear();
+  }
+  if (!stderr_output_.empty()) {
+    OutputRawString(&oss, "stderr_output", stderr_output_.c_str());
+    stderr_output_.clear();
+  }
   OutputNodeFooter(&oss);
 
   activity_log_->Log(oss.str());
@@ -185,6 +237,8 @@ void ActivityLog::FileProcessNodeLog::EnsureCreateSystemCommandNodeSignaled() {
   MaybeOutputPath(&oss, "stdout", params_.stdout_file);
   MaybeOutputPath(&oss, "stderr", params_.stderr_file);
   MaybeOutputPath(&oss, "stdin", params_.stdin_file);
+  MaybeOutputPath(&oss, "stdout_log", params_.stdout_log_file);
+  MaybeOutputPath(&oss, "stderr_log", params_.stderr_log_file);
 
   OutputNodeFooter(&oss);
 
@@ -9,6 +9,7 @@
 #include "file_info_node.h"
 #include "registry_parser.h"
 #include "lib/json_string_view.h"
+#include "platform/subprocess.h"
 #include "stdext/file_system.h"
 #include "stdext/optional.h"
 #include "system_command_node_params.h"
@@ -46,6 +47,18 @@ class ActivityLog {
     // To be called when command execution is about to begin.
     void SignalStartRunningCommand(bool dry_run);
 
+    // To be called once the command has exited, with the resources that it
+    // consumed.  These are reported along with the ProcessingComplete event.
+    void RecordResourceUsage(
+        const stdext::optional<platform::ResourceUsage>& resource_usage,
+        std::chrono::microseconds wall_time);
+
+    // To be called once the command has exited, with any output of it that
+    // was captured.  Non-empty output is included in the ProcessingComplete
+    // event.
+    void RecordCommandOutput(std::string&& stdout_output,
+                             std::string&& stderr_output);
+
     // To be called when processing is complete.  We may jump here straight
     // from dependency scanning, if it was found that all dependencies were
     // up-to-date.
@@ -59,6 +72,11 @@ class ActivityLog {
     SystemCommandNodeParams params_;
     int node_id_ = -1;
     bool running_command_ = false;
+
+    stdext::optional<std::chrono::microseconds> wall_time_;
+    stdext::optional<platform::ResourceUsage> resource_usage_;
+    std::string stdout_output_;
+    std::string stderr_output_;
   };
 
   class RegistryNodeLog {
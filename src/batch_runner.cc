@@ -0,0 +1,205 @@
+#include "batch_runner.h"
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include "environment.h"
+#include "fiber_condition_variable.h"
+#include "piped_process_protocol.h"
+
+namespace respire {
+
+namespace {
+const char kBatchFlag[] = "--batch";
+
+// How long the first command of a batch waits for others to join it before
+// the batch is started.  This is small next to the cost of the process starts
+// that it saves.
+const std::chrono::milliseconds kCollectionWindow(5);
+}  // namespace
+
+struct BatchRunner::Item {
+  Item(ebb::ThreadPool* thread_pool, const std::vector<std::string>& inputs,
+       const std::vector<std::string>& outputs,
+       const std::vector<std::string>& arguments)
+      : inputs(inputs), outputs(outputs), arguments(arguments), done(false),
+        done_cond(thread_pool) {}
+
+  const std::vector<std::string> inputs;
+  const std::vector<std::string> outputs;
+  const std::vector<std::string> arguments;
+
+  // Guarded by BatchRunner::mutex_.
+  bool done;
+  stdext::optional<platform::SystemCommandResult> result;
+  ebb::FiberConditionVariable done_cond;
+};
+
+struct BatchRunner::Batch {
+  Batch(ebb::ThreadPool* thread_pool)
+      : closed(false), finished(false), finished_cond(thread_pool) {}
+
+  // Guarded by BatchRunner::mutex_ until |closed| is set, after which they no
+  // longer change.
+  std::vector<std::unique_ptr<Item>> items;
+  bool closed;
+  // Signalled if the batch is closed before its collection window is up.
+  std::condition_variable closed_cond;
+
+  // Guarded by BatchRunner::mutex_.  Set once the tool has exited.
+  bool finished;
+  ebb::FiberConditionVariable finished_cond;
+};
+
+BatchRunner::BatchRunner(Environment* env, int max_batch_size)
+    : env_(env), max_batch_size_(static_cast<size_t>(max_batch_size)) {}
+
+BatchRunner::~BatchRunner() {}
+
+stdext::optional<platform::SystemCommandResult> BatchRunner::Execute(
+    const std::vector<std::string>& batch_argv,
+    const std::vector<std::string>& inputs,
+    const std::vector<std::string>& outputs,
+    const std::vector<std::string>& arguments) {
+  ebb::ThreadPool* thread_pool = &env_->ebb_env()->env()->thread_pool();
+
+  std::shared_ptr<Batch> batch;
+  Item* item;
+  bool first_item = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tool* tool = &tools_[batch_argv];
+    if (tool->broken) {
+      return stdext::nullopt;
+    }
+    if (!tool->collecting) {
+      tool->collecting = std::make_shared<Batch>(thread_pool);
+      first_item = true;
+    }
+    batch = tool->collecting;
+    batch->items.emplace_back(
+        new Item(thread_pool, inputs, outputs, arguments));
+    item = batch->items.back().get();
+    if (batch->items.size() >= max_batch_size_) {
+      CloseBatch(tool, batch.get());
+    }
+  }
+
+  if (first_item) {
+    RunBatch(batch_argv, batch);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!item->done) {
+    item->done_cond.wait(lock);
+  }
+  return std::move(item->result);
+}
+
+void BatchRunner::CloseBatch(Tool* tool, Batch* batch) {
+  batch->closed = true;
+  if (tool->collecting.get() == batch) {
+    tool->collecting.reset();
+  }
+  batch->closed_cond.notify_one();
+}
+
+void BatchRunner::RunBatch(const std::vector<std::string>& batch_argv,
+                           const std::shared_ptr<Batch>& batch) {
+  // The whole batch runs as a single job.  Other items may keep joining the
+  // batch while we wait for a slot.
+  ebb::FiberSemaphore::ScopedAcquire job_slot(env_->job_semaphore());
+  ebb::lib::JobserverClient::ScopedToken jobserver_token(
+      env_->jobserver_client());
+  LaunchThrottle::ScopedLaunch launch(env_->launch_throttle());
+
+  // Collecting the batch and talking to the tool both block, so they're done
+  // on a separate thread in order to leave this one free to run other fibers.
+  std::thread batch_thread([this, &batch_argv, &batch]() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      batch->closed_cond.wait_for(lock, kCollectionWindow,
+                                  [&batch]() { return batch->closed; });
+      if (!batch->closed) {
+        CloseBatch(&tools_[batch_argv], batch.get());
+      }
+    }
+
+    bool reported_any = RunBatchProcess(batch_argv, batch.get());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!reported_any) {
+      tools_[batch_argv].broken = true;
+    }
+    // Any items that the tool didn't report on are left without a result, so
+    // that they're run on their own.
+    for (const auto& item : batch->items) {
+      if (!item->done) {
+        item->done = true;
+        item->done_cond.notify_one();
+      }
+    }
+    batch->finished = true;
+    batch->finished_cond.notify_one();
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!batch->finished) {
+      batch->finished_cond.wait(lock);
+    }
+  }
+  batch_thread.join();
+}
+
+bool BatchRunner::RunBatchProcess(const std::vector<std::string>& batch_argv,
+                                  Batch* batch) {
+  std::vector<std::string> start_argv(batch_argv);
+  start_argv.push_back(kBatchFlag);
+  std::unique_ptr<platform::PipedProcess> process =
+      platform::PipedProcess::Start(start_argv);
+  if (!process) {
+    return false;
+  }
+
+  std::string manifest;
+  AppendUint32(&manifest, static_cast<uint32_t>(batch->items.size()));
+  for (const auto& item : batch->items) {
+    AppendStringList(&manifest, item->inputs);
+    AppendStringList(&manifest, item->outputs);
+    AppendStringList(&manifest, item->arguments);
+  }
+  if (!process->Write(manifest.data(), manifest.size())) {
+    return false;
+  }
+
+  bool reported_any = false;
+  for (size_t i = 0; i < batch->items.size(); ++i) {
+    uint32_t index;
+    int32_t exit_code;
+    platform::SystemCommandResult result;
+    if (!ReadUint32(process.get(), &index) ||
+        !ReadInt32(process.get(), &exit_code) ||
+        !ReadOutput(process.get(), &result.stdout_output) ||
+        !ReadOutput(process.get(), &result.stderr_output)) {
+      break;
+    }
+    result.exit_code = exit_code;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= batch->items.size() || batch->items[index]->done) {
+      // The tool isn't making sense, so don't trust anything else it says.
+      break;
+    }
+    Item* item = batch->items[index].get();
+    item->result = std::move(result);
+    item->done = true;
+    item->done_cond.notify_one();
+    reported_any = true;
+  }
+  return reported_any;
+}
+
+}  // namespace respire
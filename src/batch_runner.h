@@ -0,0 +1,92 @@
+#ifndef __RESPIRE_BATCH_RUNNER_H__
+#define __RESPIRE_BATCH_RUNNER_H__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "platform/subprocess.h"
+#include "stdext/optional.h"
+
+namespace respire {
+
+class Environment;
+
+// Runs commands for tools that can process many items in a single invocation,
+// so that a burst of small commands for the same tool (e.g. code generators)
+// pays for one process start rather than one each.
+//
+// Commands for the same tool that are ready at around the same time are
+// collected into a batch.  The first command of a batch takes a job slot on
+// behalf of the whole batch, waits briefly for others to join it, and then
+// starts the tool with "--batch" appended to its command line.  The tool is
+// sent a manifest of the batch's items over its stdin, and reports each item's
+// result over its stdout as soon as that item is done, so that each command
+// can finish without waiting for the rest of its batch.  Messages are encoded
+// in the same way as for WorkerPool:
+//
+//   Manifest:  [uint32 item count], and then for each item:
+//              [uint32 input count][input strings]
+//              [uint32 output count][output strings]
+//              [uint32 argc][argument strings]
+//   Results:   For each item, in any order:
+//              [uint32 item index][int32 exit code][stdout output]
+//              [stderr output]
+//
+// The tool should exit once it has reported on all of its items.
+class BatchRunner {
+ public:
+  // |env| must outlive the runner.  Batches are started early once they
+  // reach |max_batch_size| items.
+  BatchRunner(Environment* env, int max_batch_size);
+  ~BatchRunner();
+
+  // Runs |arguments| as an item of a batch for the tool started with
+  // |batch_argv|.  Only the calling fiber is suspended while the batch runs.
+  // Returns a disengaged optional if the item wasn't run, e.g. because the
+  // tool doesn't speak the batch protocol or exited before reporting on the
+  // item, in which case the command should be run as an ordinary process
+  // instead.
+  stdext::optional<platform::SystemCommandResult> Execute(
+      const std::vector<std::string>& batch_argv,
+      const std::vector<std::string>& inputs,
+      const std::vector<std::string>& outputs,
+      const std::vector<std::string>& arguments);
+
+ private:
+  struct Item;
+  struct Batch;
+  struct Tool {
+    Tool() : broken(false) {}
+
+    // The batch that new items join, or null if none is being collected.
+    std::shared_ptr<Batch> collecting;
+    // Set if the tool failed to report on any of a batch's items, in which
+    // case we stop trying to batch its commands.
+    bool broken;
+  };
+
+  // Stops |batch| from taking on any more items.  Must be called with
+  // |mutex_| held.
+  void CloseBatch(Tool* tool, Batch* batch);
+  // Called on the fiber of the first item of |batch| to run the whole batch.
+  void RunBatch(const std::vector<std::string>& batch_argv,
+                const std::shared_ptr<Batch>& batch);
+  // Runs the closed |batch| in a single invocation of the tool, marking each
+  // item done as the tool reports on it.  Returns false if the tool didn't
+  // report on any items.  Blocks, so must not be called on a fiber.
+  bool RunBatchProcess(const std::vector<std::string>& batch_argv,
+                       Batch* batch);
+
+  Environment* env_;
+  const size_t max_batch_size_;
+
+  std::mutex mutex_;
+  std::map<std::vector<std::string>, Tool> tools_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_BATCH_RUNNER_H__
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <thread>
+
+#include "batch_runner.h"
+#include "environment.h"
+
+using respire::BatchRunner;
+using respire::Environment;
+
+namespace {
+#if !defined(_WIN32)
+// A batch runner that reports on its items in reverse order, replying to each
+// by echoing its inputs, outputs and arguments to stdout, reporting its pid on
+// stderr, and exiting with the number of arguments.
+const char* kEchoBatchScript = R"(
+import os, struct, sys
+if sys.argv[-1] != '--batch':
+  sys.exit(2)
+def Read(size):
+  data = b''
+  while len(data) < size:
+    chunk = sys.stdin.buffer.read(size - len(data))
+    if not chunk:
+      sys.exit(0)
+    data += chunk
+  return data
+def ReadStrings():
+  (count,) = struct.unpack('=I', Read(4))
+  return [Read(struct.unpack('=I', Read(4))[0]).decode() for _ in range(count)]
+(count,) = struct.unpack('=I', Read(4))
+items = [(ReadStrings(), ReadStrings(), ReadStrings()) for _ in range(count)]
+for index in reversed(range(count)):
+  (inputs, outputs, args) = items[index]
+  stdout = ' '.join(inputs + outputs + args).encode()
+  stderr = str(os.getpid()).encode()
+  sys.stdout.buffer.write(
+      struct.pack('=IiI', index, len(args), len(stdout)) + stdout +
+      struct.pack('=I', len(stderr)) + stderr)
+  sys.stdout.buffer.flush()
+)";
+
+std::vector<std::string> EchoBatch() {
+  return {"python3", "-c", kEchoBatchScript};
+}
+
+// Runs one item per entry of |arguments| at once, while holding |env|'s only
+// job slot for long enough that they can all join a batch.
+std::vector<stdext::optional<platform::SystemCommandResult>> ExecuteTogether(
+    Environment* env, const std::vector<std::vector<std::string>>& arguments) {
+  std::vector<stdext::optional<platform::SystemCommandResult>> results(
+      arguments.size());
+  std::vector<std::thread> threads;
+  {
+    ebb::FiberSemaphore::ScopedAcquire job_slot(env->job_semaphore());
+    for (size_t i = 0; i < arguments.size(); ++i) {
+      threads.emplace_back([env, &arguments, &results, i]() {
+        std::string index = std::to_string(i);
+        results[i] = env->batch_runner()->Execute(
+            EchoBatch(), {"in" + index}, {"out" + index}, arguments[i]);
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+Environment::Options BatchingOptions(int max_batch_size) {
+  Environment::Options options;
+  options.max_jobs = 1;
+  options.max_batch_size = max_batch_size;
+  return options;
+}
+#endif
+}  // namespace
+
+#if !defined(_WIN32)
+TEST(BatchRunnerTest, CommandsReadyTogetherShareOneProcess) {
+  Environment env(BatchingOptions(8));
+
+  auto results = ExecuteTogether(&env, {{"a"}, {"b", "c"}, {}});
+  for (const auto& result : results) {
+    ASSERT_TRUE(result);
+  }
+  EXPECT_EQ(1, results[0]->exit_code);
+  EXPECT_EQ("in0 out0 a", results[0]->stdout_output);
+  EXPECT_EQ(2, results[1]->exit_code);
+  EXPECT_EQ("in1 out1 b c", results[1]->stdout_output);
+  EXPECT_EQ(0, results[2]->exit_code);
+  EXPECT_EQ("in2 out2", results[2]->stdout_output);
+
+  EXPECT_FALSE(results[0]->stderr_output.empty());
+  EXPECT_EQ(results[0]->stderr_output, results[1]->stderr_output);
+  EXPECT_EQ(results[0]->stderr_output, results[2]->stderr_output);
+}
+
+TEST(BatchRunnerTest, BatchesAreLimitedInSize) {
+  Environment env(BatchingOptions(2));
+
+  auto results = ExecuteTogether(&env, {{"a"}, {"b"}, {"c"}});
+  std::set<std::string> pids;
+  for (const auto& result : results) {
+    ASSERT_TRUE(result);
+    EXPECT_EQ(1, result->exit_code);
+    pids.insert(result->stderr_output);
+  }
+  EXPECT_EQ(2, pids.size());
+}
+
+TEST(BatchRunnerTest, ToolsThatAreNotBatchRunnersAreGivenUpOn) {
+  Environment env(BatchingOptions(8));
+  BatchRunner* runner = env.batch_runner();
+
+  std::vector<std::string> not_a_runner = {"sh", "-c", "exit 0"};
+  EXPECT_FALSE(runner->Execute(not_a_runner, {}, {}, {"a"}));
+  EXPECT_FALSE(runner->Execute(not_a_runner, {}, {}, {"a"}));
+
+  EXPECT_FALSE(runner->Execute({"/this/program/does/not/exist"}, {}, {}, {}));
+
+  // Other tools are unaffected.
+  EXPECT_TRUE(runner->Execute(EchoBatch(), {}, {}, {"a"}));
+}
+#endif
@@ -7,8 +7,6 @@ import respire.buildlib.cc_toolchains.raspi as raspi
 import respire.buildlib.cc_toolchains.discovery as cc_discovery
 import respire.buildlib.copy_files as copy_files
 import respire.buildlib.modules as modules
-import respire.buildlib.run_with_timestamp as run_with_timestamp
-import respire.buildlib.touch as touch
 
 
 _SCRIPT_DIR = os.path.dirname(os.path.realpath(__file__))
@@ -108,10 +106,20 @@ def BuildCoreLib(registry, out_dir, configured_toolchain, ebb_module,
   return modules.StaticLibraryModule(
       'respire_lib', registry, out_dir, configured_toolchain,
       sources=[
+        'action_cache.cc',
+        'action_cache.h',
         'activity_log.cc',
         'activity_log.h',
+        'batch_runner.cc',
+        'batch_runner.h',
+        'build_log.cc',
+        'build_log.h',
         'build_targets.cc',
         'build_targets.h',
+        'dependents.cc',
+        'dependents.h',
+        'deps_log.cc',
+        'deps_log.h',
         'environment.cc',
         'environment.h',
         'error.h',
@@ -121,10 +129,14 @@ def BuildCoreLib(registry, out_dir, configured_toolchain, ebb_module,
         'file_process_node.cc',
         'file_process_node.h',
         'future.h',
+        'launch_throttle.cc',
+        'launch_throttle.h',
         'locked_node_storage.cc',
         'locked_node_storage.h',
         'parse_deps.cc',
         'parse_deps.h',
+        'piped_process_protocol.cc',
+        'piped_process_protocol.h',
         'property_tree/dictionary_node.h',
         'property_tree/node.h',
         'property_tree/string_node.h',
@@ -134,8 +146,18 @@ def BuildCoreLib(registry, out_dir, configured_toolchain, ebb_module,
         'registry_parser.h',
         'registry_processor.cc',
         'registry_processor.h',
+        'remote_cache.cc',
+        'remote_cache.h',
+        'sha256.cc',
+        'sha256.h',
+        'stat_batcher.cc',
+        'stat_batcher.h',
         'system_command_node.cc',
         'system_command_node.h',
+        'watch.cc',
+        'watch.h',
+        'worker_pool.cc',
+        'worker_pool.h',
       ],
       module_dependencies=[ebb_module, stdext_module])
 
@@ -156,11 +178,22 @@ def BuildRespireCPPTests(
   return modules.ExecutableModule(
       'respire_tests', registry, out_dir, configured_toolchain,
       sources = [
+        'action_cache_test.cc',
+        'batch_runner_test.cc',
+        'build_log_test.cc',
         'build_targets_test.cc',
+        'deps_log_test.cc',
         'file_exists_node_test.cc',
         'file_process_node_test.cc',
+        'launch_throttle_test.cc',
+        'parse_deps_test.cc',
         'registry_parser_test.cc',
+        'remote_cache_test.cc',
+        'sha256_test.cc',
+        'stat_batcher_test.cc',
         'test_system_command.cc',
+        'watch_test.cc',
+        'worker_pool_test.cc',
       ],
       module_dependencies=[
         gtest_main_module,
@@ -171,12 +204,11 @@ def BuildRespireCPPTests(
 def RunCPPTests(registry, out_dir, respire_cpp_tests):
   run_respire_tests_timestamp_file = os.path.join(
       out_dir, 'respire_tests.timestamp')
-  registry.PythonFunction(
+  registry.SystemCommand(
       inputs=[respire_cpp_tests.GetOutputFiles()[0]],
       outputs=[run_respire_tests_timestamp_file],
-      function=run_with_timestamp.RunAndTimestampOnSuccess,
-      timestamp_file=run_respire_tests_timestamp_file,
-      command=[respire_cpp_tests.GetOutputFiles()[0]])
+      command=[respire_cpp_tests.GetOutputFiles()[0]],
+      stamp_outputs=[run_respire_tests_timestamp_file])
   return run_respire_tests_timestamp_file
 
 
@@ -211,10 +243,9 @@ def PackageRespire(registry, out_dir, respire_executable, include_tests):
       inputs=respire_executable.GetOutputFiles(),
       output_dir=out_dir,
       stamp_file=respire_package_exe_token)
-  registry.PythonFunction(
+  registry.Stamp(
       inputs=[respire_package_python_token, respire_package_exe_token],
-      outputs=[respire_package_token],
-      function=touch.Touch)
+      outputs=[respire_package_token])
   return respire_package_token
 
 
@@ -238,13 +269,12 @@ def RunEndToEndTestsWithPackage(
   run_end_to_end_tests_timestamp_file = os.path.join(
       out_dir, 'end_to_end_tests.timestamp')
 
-  registry.PythonFunction(
+  registry.SystemCommand(
       inputs=[package_with_tests],
       outputs=[run_end_to_end_tests_timestamp_file],
-      function=run_with_timestamp.RunAndTimestampOnSuccess,
-      timestamp_file=run_end_to_end_tests_timestamp_file,
       command=[sys.executable, '-m', 'unittest', 'discover', '-s',
-               os.path.join(package_with_tests_dir, 'end_to_end_tests')])
+               os.path.join(package_with_tests_dir, 'end_to_end_tests')],
+      stamp_outputs=[run_end_to_end_tests_timestamp_file])
 
   return run_end_to_end_tests_timestamp_file
 
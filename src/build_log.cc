@@ -0,0 +1,357 @@
+#include "build_log.h"
+
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "sha256.h"
+
+namespace respire {
+
+namespace {
+const char kHeader[] = "# respire build log v2";
+
+// Don't bother compacting small logs, or logs that are mostly still current.
+const size_t kMinLinesForCompaction = 1000;
+const size_t kMaxLinesPerEntry = 3;
+
+// The number of hex digits in a SHA-256 digest.
+const size_t kDigestSize = 64;
+
+// Files modified this close to when they were hashed may have been modified
+// again since without their status changing.  File systems that keep
+// fractions of a second only update timestamps once per kernel clock tick,
+// which this comfortably covers.  Otherwise, this is generous, to cover e.g.
+// FAT's two seconds.
+const std::chrono::system_clock::duration kFineTimestampGranularity =
+    std::chrono::milliseconds(100);
+const std::chrono::system_clock::duration kCoarseTimestampGranularity =
+    std::chrono::seconds(2);
+
+// 64-bit FNV-1a, which continues from |hash|.
+const uint64_t kInitialHash = 14695981039346656037ULL;
+uint64_t Hash(uint64_t hash, const char* data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+long long ToNanoseconds(std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromNanoseconds(long long nanoseconds) {
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(nanoseconds)));
+}
+
+// Parses a line of the log into |output| and |entry|, returning false if the
+// line is malformed.
+bool ParseLine(const std::string& line, std::string* output,
+               BuildLog::Entry* entry) {
+  const char* start = line.c_str();
+  char* end;
+
+  long long duration = std::strtoll(start, &end, 10);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  long long mtime = std::strtoll(start, &end, 10);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  long long logical_mtime = std::strtoll(start, &end, 10);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  unsigned long long command_hash = std::strtoull(start, &end, 16);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  stdext::optional<uint64_t> content_hash;
+  if (*start == '-') {
+    ++start;
+  } else {
+    content_hash = std::strtoull(start, &end, 16);
+    if (end == start) return false;
+    start = end;
+  }
+  if (*start != '\t') return false;
+  ++start;
+
+  // The output path is last, so that it may contain anything but a newline.
+  if (*start == '\0') return false;
+  *output = start;
+  entry->command_hash = command_hash;
+  entry->mtime = FromNanoseconds(mtime);
+  entry->logical_mtime = FromNanoseconds(logical_mtime);
+  entry->content_hash = content_hash;
+  entry->duration = std::chrono::microseconds(duration);
+  return true;
+}
+
+// Parses a line describing a hashed file into |path|, |status| and |digest|,
+// returning false if the line is malformed.
+bool ParseFileDigestLine(const std::string& line, std::string* path,
+                         platform::FileStatus* status, std::string* digest) {
+  if (line.compare(0, 2, "h\t") != 0) return false;
+  const char* start = line.c_str() + 2;
+  char* end;
+
+  unsigned long long id = std::strtoull(start, &end, 10);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  unsigned long long size = std::strtoull(start, &end, 10);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  long long mtime = std::strtoll(start, &end, 10);
+  if (end == start || *end != '\t') return false;
+  start = end + 1;
+
+  const char* tab = std::strchr(start, '\t');
+  if (!tab || static_cast<size_t>(tab - start) != kDigestSize) return false;
+  std::string hex_digest(start, tab);
+  start = tab + 1;
+
+  if (*start == '\0') return false;
+  *path = start;
+  status->id = id;
+  status->size = size;
+  status->last_modification_time = FromNanoseconds(mtime);
+  *digest = std::move(hex_digest);
+  return true;
+}
+
+void WriteFileDigestLine(FILE* file, const std::string& path,
+                         const platform::FileStatus& status,
+                         const std::string& digest) {
+  std::fprintf(file, "h\t%llu\t%llu\t%lld\t%s\t%s\n",
+               static_cast<unsigned long long>(status.id),
+               static_cast<unsigned long long>(status.size),
+               ToNanoseconds(status.last_modification_time), digest.c_str(),
+               path.c_str());
+}
+
+bool SameStatus(const platform::FileStatus& a, const platform::FileStatus& b) {
+  return a.id == b.id && a.size == b.size &&
+         a.last_modification_time == b.last_modification_time;
+}
+
+// Returns true if, by |time|, the file with |status| was old enough that any
+// further modification would have changed its modification time.
+bool IsSettledAt(const platform::FileStatus& status,
+                 std::chrono::system_clock::time_point time) {
+  // A timestamp that happens to fall on a whole second is treated as coarse,
+  // which only costs an extra read of the file later.
+  bool coarse = status.last_modification_time.time_since_epoch() %
+                    std::chrono::seconds(1) ==
+                std::chrono::system_clock::duration::zero();
+  return time - status.last_modification_time >
+         (coarse ? kCoarseTimestampGranularity : kFineTimestampGranularity);
+}
+
+void WriteLine(FILE* file, const std::string& output,
+               const BuildLog::Entry& entry) {
+  char content_hash[17] = "-";
+  if (entry.content_hash) {
+    std::snprintf(content_hash, sizeof(content_hash), "%016" PRIx64,
+                  *entry.content_hash);
+  }
+  std::fprintf(file, "%lld\t%lld\t%lld\t%016" PRIx64 "\t%s\t%s\n",
+               static_cast<long long>(entry.duration.count()),
+               ToNanoseconds(entry.mtime), ToNanoseconds(entry.logical_mtime),
+               entry.command_hash, content_hash, output.c_str());
+}
+}  // namespace
+
+BuildLog::BuildLog(const std::string& path)
+    : path_(path), num_lines_(0), file_(nullptr) {}
+
+BuildLog::~BuildLog() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+std::unique_ptr<BuildLog> BuildLog::Open(const std::string& path) {
+  std::unique_ptr<BuildLog> log(new BuildLog(path));
+  if (!log->Load() || log->NeedsCompaction()) {
+    if (!log->WriteCompacted()) {
+      return nullptr;
+    }
+  }
+
+  log->file_ = std::fopen(path.c_str(), "ab");
+  if (!log->file_) {
+    return nullptr;
+  }
+  return log;
+}
+
+uint64_t BuildLog::HashCommand(const std::string& command) {
+  return Hash(kInitialHash, command.data(), command.size());
+}
+
+stdext::optional<uint64_t> BuildLog::HashFileContents(
+    const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    return stdext::nullopt;
+  }
+  uint64_t hash = kInitialHash;
+  // This is called on fibers, whose stacks are too small for the buffer.
+  std::vector<char> buffer(64 * 1024);
+  size_t size;
+  while ((size = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    hash = Hash(hash, buffer.data(), size);
+  }
+  bool failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (failed) {
+    return stdext::nullopt;
+  }
+  return hash;
+}
+
+stdext::optional<std::string> BuildLog::GetContentDigest(
+    const std::string& path) {
+  stdext::optional<platform::FileStatus> status =
+      platform::GetFileStatus(path.c_str());
+  if (!status) {
+    return stdext::nullopt;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = file_digests_.find(path);
+    if (found != file_digests_.end() &&
+        SameStatus(found->second.status, *status)) {
+      return found->second.digest;
+    }
+  }
+
+  // Taken before reading, so that the digest is only recorded if the file had
+  // already been left alone for a while.
+  std::chrono::system_clock::time_point hash_time =
+      std::chrono::system_clock::now();
+  stdext::optional<std::string> digest = Sha256::HashFile(path);
+  if (!digest || !IsSettledAt(*status, hash_time)) {
+    return digest;
+  }
+  // Don't record a digest of a file that changed while we were reading it.
+  stdext::optional<platform::FileStatus> status_after =
+      platform::GetFileStatus(path.c_str());
+  if (status_after && SameStatus(*status_after, *status)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_digests_[path] = FileDigest{*status, *digest};
+    WriteFileDigestLine(file_, path, *status, *digest);
+    std::fflush(file_);
+    ++num_lines_;
+  }
+  return digest;
+}
+
+stdext::optional<BuildLog::Entry> BuildLog::Lookup(
+    const std::string& output) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = entries_.find(output);
+  if (found == entries_.end()) {
+    return stdext::nullopt;
+  }
+  return found->second;
+}
+
+void BuildLog::Record(const std::string& output, const Entry& entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_[output] = entry;
+  WriteLine(file_, output, entry);
+  // Flush as we go, so that an interrupted build still remembers the commands
+  // that did finish.
+  std::fflush(file_);
+  ++num_lines_;
+}
+
+size_t BuildLog::num_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool BuildLog::Load() {
+  std::ifstream in(path_.c_str(), std::ios::in | std::ios::binary);
+  if (!in) {
+    return false;
+  }
+
+  std::string line;
+  if (!std::getline(in, line) || line != kHeader) {
+    return false;
+  }
+
+  std::string output;
+  Entry entry;
+  FileDigest file_digest;
+  while (std::getline(in, line)) {
+    if (in.eof()) {
+      // The last line has no newline, so it was only partially written when
+      // a build was interrupted.  Even if it parses, its path may have been
+      // cut short, and appending to it would garble the next line written.
+      return false;
+    }
+    // Skip anything else that is malformed.
+    if (ParseLine(line, &output, &entry)) {
+      entries_[output] = entry;
+      ++num_lines_;
+    } else if (ParseFileDigestLine(line, &output, &file_digest.status,
+                                   &file_digest.digest)) {
+      file_digests_[output] = file_digest;
+      ++num_lines_;
+    }
+  }
+  return true;
+}
+
+bool BuildLog::NeedsCompaction() const {
+  return num_lines_ >= kMinLinesForCompaction &&
+         num_lines_ >
+             kMaxLinesPerEntry * (entries_.size() + file_digests_.size());
+}
+
+bool BuildLog::WriteCompacted() {
+  std::string temp_path = path_ + ".tmp";
+  FILE* file = std::fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  std::fprintf(file, "%s\n", kHeader);
+  for (const auto& entry : entries_) {
+    WriteLine(file, entry.first, entry.second);
+  }
+  for (const auto& file_digest : file_digests_) {
+    WriteFileDigestLine(file, file_digest.first, file_digest.second.status,
+                        file_digest.second.digest);
+  }
+  if (std::fclose(file) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  // Windows won't rename over an existing file.
+  std::remove(path_.c_str());
+#endif
+  if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  num_lines_ = entries_.size() + file_digests_.size();
+  return true;
+}
+
+}  // namespace respire
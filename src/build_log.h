@@ -0,0 +1,115 @@
+#ifndef __RESPIRE_BUILD_LOG_H__
+#define __RESPIRE_BUILD_LOG_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "platform/file_system.h"
+#include "stdext/optional.h"
+
+namespace respire {
+
+// A persistent record, kept across builds, of the command that last produced
+// each output file, in the spirit of Ninja's ".ninja_log".  Modification times
+// alone can't tell that a command line changed (e.g. new compiler flags) since
+// its outputs were built, but comparing a hash of the command with the one
+// recorded for its outputs can.
+//
+// For commands with early cutoff enabled, it also records a hash of each
+// output's contents, so that an output that a command rewrote with the same
+// contents as before can keep the "logical" modification time that it had
+// before, and so not cause its dependents to be rebuilt.
+//
+// It also remembers the SHA-256 digests of the files that identify cached
+// actions, i.e. their inputs and additional dependencies, along with their
+// status, so that they aren't read again for as long as their status is
+// unchanged.
+//
+// The log is a text file that is only ever appended to while building, with
+// one line per output:
+//
+//   [duration in microseconds]\t[mtime in ns]\t[logical mtime in ns]\t
+//       [command hash]\t[content hash, or "-"]\t[output path]
+//
+// and one line per hashed file:
+//
+//   h\t[file ID]\t[size]\t[mtime in ns]\t[SHA-256 digest]\t[path]
+//
+// Later lines for the same output or file replace earlier ones, and the file
+// is rewritten without the replaced lines when it is opened if they have come
+// to dominate it.
+class BuildLog {
+ public:
+  struct Entry {
+    uint64_t command_hash;
+    // The output's modification time just after the command ran.
+    std::chrono::system_clock::time_point mtime;
+    // The modification time that the output is reported to have, for as long
+    // as it still has |mtime|.  This is older than |mtime| if the command
+    // last rewrote the output without changing it.
+    std::chrono::system_clock::time_point logical_mtime;
+    // Only recorded for commands with early cutoff enabled.
+    stdext::optional<uint64_t> content_hash;
+    // How long the command took to run.
+    std::chrono::microseconds duration;
+  };
+
+  // Loads the log at |path|, creating it if it doesn't exist yet.  Returns
+  // null if the log can't be opened for writing.  Unreadable logs, e.g. from
+  // an incompatible version, are started over.
+  static std::unique_ptr<BuildLog> Open(const std::string& path);
+  ~BuildLog();
+
+  // A hash of |command| that is stable across builds and platforms.
+  static uint64_t HashCommand(const std::string& command);
+  // A hash of the contents of the file at |path|, also stable, or a
+  // disengaged optional if it couldn't be read.
+  static stdext::optional<uint64_t> HashFileContents(const std::string& path);
+
+  // Returns the SHA-256 digest of the contents of the file at |path|, as
+  // Sha256::HashFile() does, but without reading the file if its status is the
+  // same as when its digest was recorded.  Digests are only recorded for files
+  // that had been left alone for long enough that any further change would
+  // also change their status.
+  stdext::optional<std::string> GetContentDigest(const std::string& path);
+
+  stdext::optional<Entry> Lookup(const std::string& output) const;
+  // Records |entry| for |output|, both in memory and on disk.
+  void Record(const std::string& output, const Entry& entry);
+
+  size_t num_entries() const;
+
+ private:
+  struct FileDigest {
+    platform::FileStatus status;
+    std::string digest;
+  };
+
+  BuildLog(const std::string& path);
+
+  // Returns false if the log must be rewritten before it can be appended to,
+  // e.g. because it doesn't exist or its last line was cut off.  Whatever
+  // entries could be read are kept either way.
+  bool Load();
+  bool NeedsCompaction() const;
+  bool WriteCompacted();
+
+  const std::string path_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::unordered_map<std::string, FileDigest> file_digests_;
+  // The number of lines on disk, including replaced ones.
+  size_t num_lines_;
+  FILE* file_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_BUILD_LOG_H__
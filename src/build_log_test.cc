@@ -0,0 +1,329 @@
+#include <ctime>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+
+#if defined(_WIN32)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include "build_log.h"
+#include "sha256.h"
+#include "stdext/file_system.h"
+
+using respire::BuildLog;
+using respire::Sha256;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+namespace {
+BuildLog::Entry MakeEntry(uint64_t command_hash, int seconds, int duration_ms) {
+  BuildLog::Entry entry;
+  entry.command_hash = command_hash;
+  entry.mtime = std::chrono::system_clock::time_point(
+      std::chrono::seconds(seconds));
+  entry.logical_mtime = entry.mtime;
+  entry.duration = std::chrono::milliseconds(duration_ms);
+  return entry;
+}
+
+void ExpectEntry(const BuildLog& log, const std::string& output,
+                 const BuildLog::Entry& expected) {
+  stdext::optional<BuildLog::Entry> entry = log.Lookup(output);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(expected.command_hash, entry->command_hash);
+  EXPECT_EQ(expected.mtime, entry->mtime);
+  EXPECT_EQ(expected.logical_mtime, entry->logical_mtime);
+  EXPECT_TRUE(expected.content_hash == entry->content_hash);
+  EXPECT_EQ(expected.duration, entry->duration);
+}
+
+void WriteFile(const Path& path, const std::string& contents) {
+  std::ofstream out(path.c_str(), std::ios::binary);
+  out << contents;
+}
+
+void SetModificationTime(const Path& path, std::time_t time) {
+#if defined(_WIN32)
+  struct _utimbuf times = {time, time};
+  ASSERT_EQ(0, _utime(path.c_str(), &times));
+#else
+  struct utimbuf times = {time, time};
+  ASSERT_EQ(0, utime(path.c_str(), &times));
+#endif
+}
+
+int CountLines(const Path& path) {
+  std::ifstream in(path.c_str());
+  std::string line;
+  int count = 0;
+  while (std::getline(in, line)) {
+    ++count;
+  }
+  return count;
+}
+}  // namespace
+
+TEST(BuildLogTest, EntriesSurviveReopening) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+
+  BuildLog::Entry foo_entry = MakeEntry(0x0123456789abcdefULL, 1000, 20);
+  BuildLog::Entry bar_entry = MakeEntry(42, 2000, 0);
+  // As recorded for an output that was rewritten with unchanged contents.
+  bar_entry.logical_mtime -= std::chrono::seconds(500);
+  bar_entry.content_hash = 0xfedcba9876543210ULL;
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    EXPECT_EQ(0, log->num_entries());
+    log->Record("foo.o", foo_entry);
+    log->Record("path with\tspaces/bar.o", bar_entry);
+  }
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(2, log->num_entries());
+  ExpectEntry(*log, "foo.o", foo_entry);
+  ExpectEntry(*log, "path with\tspaces/bar.o", bar_entry);
+  EXPECT_FALSE(log->Lookup("baz.o").has_value());
+}
+
+TEST(BuildLogTest, LaterEntriesReplaceEarlierOnes) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+
+  BuildLog::Entry new_entry = MakeEntry(2, 2000, 10);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->Record("foo.o", MakeEntry(1, 1000, 10));
+    log->Record("foo.o", new_entry);
+    ExpectEntry(*log, "foo.o", new_entry);
+  }
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(1, log->num_entries());
+  ExpectEntry(*log, "foo.o", new_entry);
+}
+
+TEST(BuildLogTest, UnrecognizedLogsAreStartedOver) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  {
+    std::ofstream out(log_path.c_str());
+    out << "# some other log\n1\t2\t3\tfoo.o\n";
+  }
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(0, log->num_entries());
+  log->Record("foo.o", MakeEntry(1, 1000, 10));
+  log.reset();
+
+  log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(1, log->num_entries());
+}
+
+TEST(BuildLogTest, TruncatedLinesAreIgnored) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+
+  BuildLog::Entry foo_entry = MakeEntry(1, 1000, 10);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->Record("foo.o", foo_entry);
+  }
+  {
+    // As if a build was interrupted while writing a line.
+    std::ofstream out(log_path.c_str(), std::ios::app);
+    out << "10\t20";
+  }
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(1, log->num_entries());
+  ExpectEntry(*log, "foo.o", foo_entry);
+}
+
+TEST(BuildLogTest, LinesTruncatedWithinThePathAreIgnored) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+
+  BuildLog::Entry foo_entry = MakeEntry(1, 1000, 10);
+  BuildLog::Entry bar_entry = MakeEntry(2, 2000, 20);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->Record("foo.o", foo_entry);
+    log->Record("bar.o", bar_entry);
+  }
+  {
+    // Cut the last line off partway through "bar.o".
+    std::ifstream in(log_path.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+    in.close();
+    contents.resize(contents.size() - 4);
+    std::ofstream out(log_path.c_str(), std::ios::binary | std::ios::trunc);
+    out << contents;
+  }
+
+  BuildLog::Entry baz_entry = MakeEntry(3, 3000, 30);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    EXPECT_EQ(1, log->num_entries());
+    ExpectEntry(*log, "foo.o", foo_entry);
+    EXPECT_FALSE(log->Lookup("b").has_value());
+    log->Record("baz.o", baz_entry);
+  }
+
+  // The entry recorded after the truncated line isn't lost.
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(2, log->num_entries());
+  ExpectEntry(*log, "foo.o", foo_entry);
+  ExpectEntry(*log, "baz.o", baz_entry);
+}
+
+TEST(BuildLogTest, LogsDominatedByReplacedEntriesAreCompacted) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+
+  BuildLog::Entry last_entry = MakeEntry(5000, 5000, 10);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    for (int i = 0; i < 5000; ++i) {
+      log->Record("foo.o", MakeEntry(i, i, 10));
+    }
+    log->Record("foo.o", last_entry);
+    log->Record("bar.o", last_entry);
+  }
+  EXPECT_EQ(5003, CountLines(log_path));
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(2, log->num_entries());
+  ExpectEntry(*log, "foo.o", last_entry);
+  ExpectEntry(*log, "bar.o", last_entry);
+  // Just the header and an entry for each output.
+  EXPECT_EQ(3, CountLines(log_path));
+}
+
+TEST(BuildLogTest, CommandHashesAreStable) {
+  // The hashes are persisted, so they mustn't depend on the platform or the
+  // standard library.
+  EXPECT_EQ(0xcbf29ce484222325ULL, BuildLog::HashCommand(""));
+  EXPECT_EQ(0xaf63df4c8601f1a5ULL, BuildLog::HashCommand("b"));
+  EXPECT_NE(BuildLog::HashCommand("gcc -O2 foo.c"),
+            BuildLog::HashCommand("gcc -O3 foo.c"));
+}
+
+TEST(BuildLogTest, FileContentsHashesDependOnlyOnContents) {
+  TemporaryDirectory temp_dir;
+  Path foo_path = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  Path bar_path = Join(temp_dir.path(), PathStrRef("bar.txt"));
+  {
+    std::ofstream foo(foo_path.c_str(), std::ios::binary);
+    foo << "b";
+    std::ofstream bar(bar_path.c_str(), std::ios::binary);
+    bar << "b";
+  }
+
+  stdext::optional<uint64_t> foo_hash =
+      BuildLog::HashFileContents(foo_path.str());
+  ASSERT_TRUE(foo_hash.has_value());
+  EXPECT_EQ(BuildLog::HashCommand("b"), *foo_hash);
+  EXPECT_TRUE(foo_hash == BuildLog::HashFileContents(bar_path.str()));
+  {
+    std::ofstream bar(bar_path.c_str(), std::ios::binary);
+    bar << "c";
+  }
+  EXPECT_FALSE(foo_hash == BuildLog::HashFileContents(bar_path.str()));
+  EXPECT_FALSE(BuildLog::HashFileContents(
+      Join(temp_dir.path(), PathStrRef("baz.txt")).str()).has_value());
+}
+
+TEST(BuildLogTest, UnchangedFilesAreNotHashedAgain) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  Path foo_path = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::time_t old_time = std::time(nullptr) - 1000;
+  WriteFile(foo_path, "foo");
+  SetModificationTime(foo_path, old_time);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    EXPECT_EQ(Sha256::Hash("foo"),
+              *log->GetContentDigest(foo_path.str()));
+  }
+
+  // Sneak a change past the log, by keeping the file's status the same.
+  WriteFile(foo_path, "bar");
+  SetModificationTime(foo_path, old_time);
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(Sha256::Hash("foo"), *log->GetContentDigest(foo_path.str()));
+
+  // But any change that is visible in the status is noticed.
+  WriteFile(foo_path, "barbar");
+  SetModificationTime(foo_path, old_time);
+  EXPECT_EQ(Sha256::Hash("barbar"),
+            *log->GetContentDigest(foo_path.str()));
+  EXPECT_FALSE(log->GetContentDigest(
+      Join(temp_dir.path(), PathStrRef("missing.txt")).str()).has_value());
+}
+
+TEST(BuildLogTest, DigestsOfRecentlyModifiedFilesAreNotRecorded) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  Path foo_path = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::time_t now = std::time(nullptr);
+  WriteFile(foo_path, "foo");
+  SetModificationTime(foo_path, now);
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(Sha256::Hash("foo"), *log->GetContentDigest(foo_path.str()));
+
+  // As if the file were modified again within the same timestamp tick.
+  WriteFile(foo_path, "bar");
+  SetModificationTime(foo_path, now);
+  EXPECT_EQ(Sha256::Hash("bar"), *log->GetContentDigest(foo_path.str()));
+}
+
+TEST(BuildLogTest, FileDigestsSurviveCompaction) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  Path foo_path = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::time_t old_time = std::time(nullptr) - 1000;
+  WriteFile(foo_path, "foo");
+  SetModificationTime(foo_path, old_time);
+  {
+    std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->GetContentDigest(foo_path.str());
+    for (int i = 0; i < 5000; ++i) {
+      log->Record("foo.o", MakeEntry(i, i, 10));
+    }
+  }
+
+  std::unique_ptr<BuildLog> log = BuildLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(2, CountLines(log_path) - 1);
+
+  // The recorded digest is still used.
+  WriteFile(foo_path, "bar");
+  SetModificationTime(foo_path, old_time);
+  EXPECT_EQ(Sha256::Hash("foo"), *log->GetContentDigest(foo_path.str()));
+}
@@ -2,10 +2,14 @@
 
 #include <stdio.h>
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
+#include <thread>
 
 #include "build_targets.h"
+#include "platform/file_system.h"
 #include "stdext/file_system.h"
 #include "test_system_command.h"
 
@@ -97,19 +101,13 @@ class SystemCommandRecorder {
   Environment::SystemCommandFunction GetRecorderFunction() {
     return Environment::SystemCommandFunction(
         std::bind(&SystemCommandRecorder::AcceptCommand, this,
-                   std::placeholders::_1, std::placeholders::_2,
-                   std::placeholders::_3, std::placeholders::_4));
+                   std::placeholders::_1));
   }
 
  private:
-  int AcceptCommand(
-      const char* command,
-      const stdext::optional<stdext::file_system::Path>& stdout_file,
-      const stdext::optional<stdext::file_system::Path>& stderr_file,
-      const stdext::optional<stdext::file_system::Path>& stdin_file) {
+  int AcceptCommand(const platform::SystemCommandParams& params) {
     std::pair<std::string, int> results(
-        command,
-        TestSystemCommand(command, stdout_file, stderr_file, stdin_file));
+        params.command, TestSystemCommand(params));
     commands_.push_back(results);
     return results.second;
   }
@@ -185,6 +183,35 @@ TEST(BuildTargetsTest, SimpleSingleSystemCommand) {
   ExpectFileHasContents("a", out_file);
 }
 
+TEST(BuildTargetsTest, SystemCommandArgvIsPassedThrough) {
+  TemporaryDirectory temp_dir;
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+
+  stdext::optional<std::vector<std::string>> received_argv;
+  respire::Environment::Options options;
+  options.system_command_function =
+      [&received_argv](const platform::SystemCommandParams& params) {
+    received_argv = params.argv;
+    return TestSystemCommand(params);
+  };
+  respire::Environment env(options);
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"argv\": [\"echo\", \"a \\\"b\\\"\"],"
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\"],"
+      "}]}]",
+      {out_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+
+  ExpectFileHasContents("a", out_file);
+  ASSERT_TRUE(received_argv.has_value());
+  EXPECT_EQ(
+      std::vector<std::string>({"echo", "a \"b\""}), *received_argv);
+}
+
 TEST(BuildTargetsTest, SingleSystemCommandAvoidsUnnecessaryRebuild) {
   TemporaryDirectory temp_dir;
   Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
@@ -759,6 +786,58 @@ TEST(BuildTargetsTest, DepsFileModificationsTriggerRebuild) {
   ExpectFileHasContents("blehgrark", out_file1);
 }
 
+TEST(BuildTargetsTest, MakeFormatDepsFileModificationsTriggerRebuild) {
+  TemporaryDirectory temp_dir;
+  Path static_file = Join(temp_dir.path(), PathStrRef("static file.h"));
+  Path deps_file = Join(temp_dir.path(), PathStrRef("out.d"));
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+
+  SystemCommandRecorder command_recorder;
+  respire::Environment::Options options;
+  options.system_command_function = command_recorder.GetRecorderFunction();
+  respire::Environment env(options);
+
+  WriteToFile(static_file, "foo");
+  {
+    std::string escaped_static_file;
+    for (char c : static_file.str()) {
+      if (c == ' ') {
+        escaped_static_file += '\\';
+      }
+      escaped_static_file += c;
+    }
+    std::ofstream out(deps_file.c_str());
+    out << out_file.c_str() << ": \\" << std::endl;
+    out << "  " << escaped_static_file << std::endl;
+  }
+
+  std::string registry_contents =
+      "["
+      "{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\"],"
+      "\"deps\": \"" + EscapeForJSON(deps_file) + "\","
+      "\"deps_format\": \"make\""
+      "}]},"
+      "]";
+
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env, registry_contents, {out_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+  EXPECT_EQ(1, command_recorder.TakeCommands().size());
+
+  maybe_error = BuildTargetRegistry(&env, registry_contents, {out_file});
+  EXPECT_FALSE(maybe_error.has_value());
+  EXPECT_EQ(0, command_recorder.TakeCommands().size());
+
+  WriteToFile(static_file, "bar");
+
+  maybe_error = BuildTargetRegistry(&env, registry_contents, {out_file});
+  EXPECT_FALSE(maybe_error.has_value());
+  EXPECT_EQ(1, command_recorder.TakeCommands().size());
+}
+
 TEST(BuildTargetsTest, StdRedirectTest) {
   TemporaryDirectory temp_dir;
   Path stdin_file = Join(temp_dir.path(), PathStrRef("stdin.txt"));
@@ -838,4 +917,312 @@ TEST(BuildTargetsTest, StdRedirectTest) {
   EXPECT_EQ(0, command_list.size());
 }
 
+TEST(BuildTargetsTest, PoolLimitsConcurrentCommands) {
+  TemporaryDirectory temp_dir;
+  const int kNumCommands = 4;
+  std::vector<Path> out_files;
+  for (int i = 0; i < kNumCommands; ++i) {
+    std::string file_name = "out" + std::to_string(i) + ".txt";
+    out_files.push_back(Join(temp_dir.path(), PathStrRef(file_name.c_str())));
+  }
+
+  std::atomic<int> running(0);
+  std::atomic<int> max_running(0);
+  respire::Environment::Options options;
+  options.num_threads = kNumCommands;
+  options.max_jobs = kNumCommands;
+  options.system_command_function =
+      [&running, &max_running](const platform::SystemCommandParams& params) {
+    int now_running = ++running;
+    int previous_max = max_running.load();
+    while (now_running > previous_max &&
+           !max_running.compare_exchange_weak(previous_max, now_running)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    --running;
+    return TestSystemCommand(params);
+  };
+  respire::Environment env(options);
+
+  std::string registry_contents =
+      "[{\"pool\": [{\"name\": \"link\", \"depth\": \"1\"}]},"
+      "{\"sc\": [";
+  for (const auto& out_file : out_files) {
+    registry_contents +=
+        "{\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+        "\"in\": [],"
+        "\"out\": [\"" + EscapeForJSON(out_file) + "\"],"
+        "\"pool\": \"link\"},";
+  }
+  registry_contents += "]}]";
+
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env, registry_contents, out_files));
+  EXPECT_FALSE(maybe_error.has_value());
+
+  for (const auto& out_file : out_files) {
+    ExpectFileHasContents("a", out_file);
+  }
+  EXPECT_EQ(1, max_running.load());
+}
+
+TEST(BuildTargetsTest, UndeclaredPoolIsAnError) {
+  TemporaryDirectory temp_dir;
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+
+  respire::Environment::Options options;
+  options.system_command_function = &TestSystemCommand;
+  respire::Environment env(options);
+
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\"],"
+      "\"pool\": \"link\""
+      "}]}]",
+      {out_file}));
+  EXPECT_TRUE(maybe_error.has_value());
+}
+
+TEST(BuildTargetsTest, TimedOutCommandIsAnError) {
+  TemporaryDirectory temp_dir;
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+
+  stdext::optional<std::chrono::milliseconds> received_timeout;
+  respire::Environment::Options options;
+  options.system_command_function =
+      [&received_timeout](const platform::SystemCommandParams& params) {
+    received_timeout = params.timeout;
+    platform::SystemCommandResult result(1);
+    result.timed_out = true;
+    return result;
+  };
+  respire::Environment env(options);
+
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\"],"
+      "\"timeout\": \"2.5\""
+      "}]}]",
+      {out_file}));
+  ASSERT_TRUE(maybe_error.has_value());
+  EXPECT_NE(std::string::npos, maybe_error->str().find("Timed out"));
+  ASSERT_TRUE(received_timeout.has_value());
+  EXPECT_EQ(std::chrono::milliseconds(2500), *received_timeout);
+}
+
+TEST(BuildTargetsTest, CapturedOutputIsOnlyLoggedWhenNonEmpty) {
+  TemporaryDirectory temp_dir;
+  Path quiet_out_file = Join(temp_dir.path(), PathStrRef("quiet.txt"));
+  Path quiet_log_file = Join(temp_dir.path(), PathStrRef("quiet_log.txt"));
+  Path noisy_out_file = Join(temp_dir.path(), PathStrRef("noisy.txt"));
+  Path noisy_log_file = Join(temp_dir.path(), PathStrRef("noisy_log.txt"));
+
+  // A log left over from a previous build should not survive a quiet run.
+  WriteToFile(quiet_log_file, "stale output");
+
+  respire::Environment::Options options;
+  options.system_command_function =
+      [](const platform::SystemCommandParams& params) {
+    EXPECT_TRUE(params.capture_stdout);
+    EXPECT_FALSE(params.stdout_file.has_value());
+    platform::SystemCommandResult result = TestSystemCommand(params);
+    if (params.command.find("noisy") != std::string::npos) {
+      result.stdout_output = "hello";
+    }
+    return result;
+  };
+  respire::Environment env(options);
+
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(quiet_out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(quiet_out_file) + "\"],"
+      "\"stdout_log\": \"" + EscapeForJSON(quiet_log_file) + "\""
+      "}, {"
+      "\"cmd\": \"echo " + EscapeForJSON(noisy_out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(noisy_out_file) + "\"],"
+      "\"stdout_log\": \"" + EscapeForJSON(noisy_log_file) + "\""
+      "}]}]",
+      {quiet_out_file, noisy_out_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+
+  ExpectFileHasContents("hello", noisy_log_file);
+  std::ifstream quiet_log(quiet_log_file.c_str());
+  EXPECT_FALSE(quiet_log.good());
+}
+
+TEST(BuildTargetsTest, NativeActionsDoNotRunCommands) {
+  TemporaryDirectory temp_dir;
+  Path in_file = Join(temp_dir.path(), PathStrRef("in.txt"));
+  Path copy_file = Join(Join(temp_dir.path(), PathStrRef("copied")),
+                        PathStrRef("in.txt"));
+  Path dir = Join(Join(temp_dir.path(), PathStrRef("a")), PathStrRef("b"));
+  Path touch_file = Join(temp_dir.path(), PathStrRef("touched.txt"));
+  Path stamp_file = Join(temp_dir.path(), PathStrRef("stamp"));
+
+  WriteToFile(in_file, "contents");
+  // Touching an existing file must leave its contents alone.
+  WriteToFile(touch_file, "touched");
+
+  std::atomic<int> num_commands(0);
+  respire::Environment::Options options;
+  options.system_command_function =
+      [&num_commands](const platform::SystemCommandParams& params) {
+    ++num_commands;
+    return TestSystemCommand(params);
+  };
+  respire::Environment env(options);
+
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"copy\": [{"
+      "\"in\": [\"" + EscapeForJSON(in_file) + "\"],"
+      "\"out\": [\"" + EscapeForJSON(copy_file) + "\"]"
+      "}]}, {\"mkdir\": [{"
+      "\"out\": [\"" + EscapeForJSON(dir) + "\"]"
+      "}]}, {\"touch\": [{"
+      "\"in\": [\"" + EscapeForJSON(copy_file) + "\"],"
+      "\"out\": [\"" + EscapeForJSON(touch_file) + "\"]"
+      "}]}, {\"stamp\": [{"
+      "\"in\": [\"" + EscapeForJSON(touch_file) + "\", \"" +
+          EscapeForJSON(dir) + "\"],"
+      "\"out\": [\"" + EscapeForJSON(stamp_file) + "\"]"
+      "}]}]",
+      {stamp_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+
+  EXPECT_EQ(0, num_commands);
+  ExpectFileHasContents("contents", copy_file);
+  ExpectFileHasContents("touched", touch_file);
+  ExpectFileHasContents("", stamp_file);
+  EXPECT_TRUE(platform::GetLastModificationTime(dir.c_str()));
+}
+
+TEST(BuildTargetsTest, StampOutputsAreWrittenOnSuccess) {
+  TemporaryDirectory temp_dir;
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+  Path stamp_file = Join(temp_dir.path(), PathStrRef("stamp"));
+  Path failed_stamp_file = Join(temp_dir.path(), PathStrRef("failed_stamp"));
+
+  respire::Environment::Options options;
+  options.system_command_function = &TestSystemCommand;
+  respire::Environment env(options);
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\", \"" +
+          EscapeForJSON(stamp_file) + "\"],"
+      "\"stamp_out\": [\"" + EscapeForJSON(stamp_file) + "\"]"
+      "}]}]",
+      {stamp_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+  ExpectFileHasContents("", stamp_file);
+
+  maybe_error = BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"fail\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(failed_stamp_file) + "\"],"
+      "\"stamp_out\": [\"" + EscapeForJSON(failed_stamp_file) + "\"]"
+      "}]}]",
+      {failed_stamp_file});
+  EXPECT_TRUE(maybe_error.has_value());
+  EXPECT_FALSE(platform::GetLastModificationTime(failed_stamp_file.c_str()));
+}
+
+
+#if !defined(_WIN32)
+TEST(BuildTargetsTest, ResponseFileIsWrittenForTheDurationOfTheCommand) {
+  TemporaryDirectory temp_dir;
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+  Path failed_out_file = Join(temp_dir.path(), PathStrRef("failed_out.txt"));
+  Path rsp_file = Join(temp_dir.path(), PathStrRef("rsp/out.rsp"));
+
+  std::vector<std::string> rsp_file_contents;
+  respire::Environment::Options options;
+  options.system_command_function =
+      [&rsp_file_contents, &rsp_file](
+          const platform::SystemCommandParams& params) {
+    std::ifstream in(rsp_file.c_str(), std::ios::in | std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    rsp_file_contents.push_back(buffer.str());
+    return TestSystemCommand(params);
+  };
+  respire::Environment env(options);
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\"],"
+      "\"rspfile\": \"" + EscapeForJSON(rsp_file) + "\","
+      "\"rspfile_content\": \"a.o \\\"b c.o\\\"\""
+      "}]}]",
+      {out_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+  ASSERT_EQ(1, rsp_file_contents.size());
+  EXPECT_EQ("a.o \"b c.o\"", rsp_file_contents[0]);
+  // The response file is cleaned up once the command succeeds.
+  EXPECT_FALSE(platform::GetLastModificationTime(rsp_file.c_str()));
+
+  maybe_error = BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"fail\","
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(failed_out_file) + "\"],"
+      "\"rspfile\": \"" + EscapeForJSON(rsp_file) + "\","
+      "\"rspfile_content\": \"d.o\""
+      "}]}]",
+      {failed_out_file});
+  EXPECT_TRUE(maybe_error.has_value());
+  // But left behind for debugging when it fails.
+  ExpectFileHasContents("d.o", rsp_file);
+}
+
+TEST(BuildTargetsTest, CommandsFallBackToProcessesIfNoWorkerIsAvailable) {
+  TemporaryDirectory temp_dir;
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+
+  std::atomic<int> num_processes(0);
+  respire::Environment::Options options;
+  options.max_workers_per_tool = 1;
+  options.system_command_function =
+      [&num_processes](const platform::SystemCommandParams& params) {
+    ++num_processes;
+    return TestSystemCommand(params);
+  };
+  respire::Environment env(options);
+
+  // "true" exits immediately instead of serving requests.
+  respire::OptionalError maybe_error(BuildTargetRegistry(
+      &env,
+      "[{\"sc\": [{"
+      "\"cmd\": \"echo " + EscapeForJSON(out_file) + ",a\","
+      "\"argv\": [\"true\", \"a\"],"
+      "\"worker\": [\"true\"],"
+      "\"in\": [],"
+      "\"out\": [\"" + EscapeForJSON(out_file) + "\"]"
+      "}]}]",
+      {out_file}));
+  EXPECT_FALSE(maybe_error.has_value());
+
+  EXPECT_EQ(1, num_processes);
+  ExpectFileHasContents("a", out_file);
+}
+#endif
+
 }  // namespace respire
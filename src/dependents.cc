@@ -0,0 +1,77 @@
+#include "dependents.h"
+
+#include <deque>
+
+namespace respire {
+
+void Dependents::Add(FileInfoNode* dependent,
+                     const std::vector<FileInfoNodeOutput>& dependencies) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& dependency : dependencies) {
+    dependents_[dependency.node].insert(dependent);
+  }
+}
+
+void Dependents::AddRegistryInput(FileInfoNode* node) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  registry_inputs_.insert(node);
+}
+
+void Dependents::AddFailure(FileInfoNode* node) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  failures_.push_back(node);
+}
+
+Dependents::Invalidation Dependents::Invalidate(
+    const std::vector<FileInfoNode*>& nodes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return InvalidateLocked(nodes);
+}
+
+Dependents::Invalidation Dependents::InvalidateFailures() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<FileInfoNode*> failures;
+  failures.swap(failures_);
+  return InvalidateLocked(failures);
+}
+
+Dependents::Invalidation Dependents::InvalidateLocked(
+    const std::vector<FileInfoNode*>& nodes) {
+  Invalidation invalidation;
+  invalidation.needs_reload = false;
+  invalidation.num_dependents = 0;
+
+  std::unordered_set<FileInfoNode*> visited(nodes.begin(), nodes.end());
+  std::deque<FileInfoNode*> queue(visited.begin(), visited.end());
+  while (!queue.empty()) {
+    FileInfoNode* node = queue.front();
+    queue.pop_front();
+
+    node->Invalidate();
+    if (registry_inputs_.count(node)) {
+      invalidation.needs_reload = true;
+    }
+
+    auto found = dependents_.find(node);
+    if (found == dependents_.end()) {
+      continue;
+    }
+    for (FileInfoNode* dependent : found->second) {
+      if (visited.insert(dependent).second) {
+        queue.push_back(dependent);
+        ++invalidation.num_dependents;
+      }
+    }
+  }
+
+  return invalidation;
+}
+
+void Dependents::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  dependents_.clear();
+  registry_inputs_.clear();
+  failures_.clear();
+}
+
+}  // namespace respire
@@ -0,0 +1,61 @@
+#ifndef __RESPIRE_DEPENDENTS_H__
+#define __RESPIRE_DEPENDENTS_H__
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "file_info_node.h"
+
+namespace respire {
+
+// Records, as nodes are evaluated, which nodes depend on which, in the
+// opposite direction to that in which the nodes themselves refer to each
+// other.  This lets the nodes affected by a change to some files be found
+// and invalidated without visiting the rest of the graph.  Since dependencies
+// are only recorded once they are discovered, e.g. headers found in a deps
+// file, only the parts of the graph that have been built are described.
+class Dependents {
+ public:
+  // Records that |dependent| depends on each of |dependencies|.
+  void Add(FileInfoNode* dependent,
+           const std::vector<FileInfoNodeOutput>& dependencies);
+  // Records that a registry was read from one of |node|'s outputs, so that
+  // the graph itself is out of date if |node| is invalidated.
+  void AddRegistryInput(FileInfoNode* node);
+  // Records that |node| failed to produce its outputs itself, as opposed to
+  // being handed an error by one of its dependencies.
+  void AddFailure(FileInfoNode* node);
+
+  struct Invalidation {
+    // True if a registry input was invalidated, in which case the graph must
+    // be discarded and loaded again.
+    bool needs_reload;
+    // The number of nodes that were invalidated because they depend on the
+    // nodes being invalidated, directly or indirectly.
+    size_t num_dependents;
+  };
+
+  // Invalidates |nodes| and everything that depends on them.
+  Invalidation Invalidate(const std::vector<FileInfoNode*>& nodes);
+  // Invalidates the nodes recorded as having failed since this was last
+  // called, and everything that depends on them, so that they are retried.
+  Invalidation InvalidateFailures();
+
+  // Forgets everything recorded so far, e.g. before the graph is discarded.
+  void Clear();
+
+ private:
+  Invalidation InvalidateLocked(const std::vector<FileInfoNode*>& nodes);
+
+  std::mutex mutex_;
+  std::unordered_map<FileInfoNode*, std::unordered_set<FileInfoNode*>>
+      dependents_;
+  std::unordered_set<FileInfoNode*> registry_inputs_;
+  std::vector<FileInfoNode*> failures_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_DEPENDENTS_H__
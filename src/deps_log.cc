@@ -0,0 +1,299 @@
+#include "deps_log.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace respire {
+
+namespace {
+const char kHeader[] = "# respire deps log v1\n";
+const size_t kHeaderSize = sizeof(kHeader) - 1;
+
+const uint32_t kDepsRecordFlag = 0x80000000u;
+// Anything bigger than this must be corrupt.
+const uint32_t kMaxRecordSize = 1u << 24;
+// The size of a deps record without its dependency path IDs.
+const uint32_t kDepsRecordFixedSize = 4 + 8 + 8 + 8;
+
+// Don't bother compacting small logs, or logs that are mostly still current.
+const size_t kMinRecordsForCompaction = 1000;
+const size_t kMaxRecordsPerEntry = 3;
+
+int64_t ToNanoseconds(std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromNanoseconds(int64_t nanoseconds) {
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(nanoseconds)));
+}
+
+bool SameStatus(const platform::FileStatus& a, const platform::FileStatus& b) {
+  return a.id == b.id && a.size == b.size &&
+         a.last_modification_time == b.last_modification_time;
+}
+
+template <typename T>
+T Read(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+template <typename T>
+void Write(FILE* file, T value) {
+  std::fwrite(&value, sizeof(value), 1, file);
+}
+
+void WritePathRecord(FILE* file, const std::string& path, uint32_t id) {
+  size_t padding = (4 - path.size() % 4) % 4;
+  Write<uint32_t>(file, static_cast<uint32_t>(path.size() + padding + 4));
+  std::fwrite(path.data(), 1, path.size(), file);
+  const char zeros[4] = {0, 0, 0, 0};
+  std::fwrite(zeros, 1, padding, file);
+  Write<uint32_t>(file, ~id);
+}
+
+void WriteDepsRecord(FILE* file, uint32_t deps_path_id,
+                     const platform::FileStatus& status,
+                     const std::vector<uint32_t>& dependency_ids) {
+  Write<uint32_t>(
+      file, static_cast<uint32_t>(kDepsRecordFixedSize +
+                                  4 * dependency_ids.size()) |
+                kDepsRecordFlag);
+  Write<uint32_t>(file, deps_path_id);
+  Write<uint64_t>(file, status.id);
+  Write<uint64_t>(file, status.size);
+  Write<int64_t>(file, ToNanoseconds(status.last_modification_time));
+  if (!dependency_ids.empty()) {
+    std::fwrite(dependency_ids.data(), 4, dependency_ids.size(), file);
+  }
+}
+}  // namespace
+
+DepsLog::DepsLog(const std::string& path)
+    : path_(path), num_records_(0), file_(nullptr) {}
+
+DepsLog::~DepsLog() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+std::unique_ptr<DepsLog> DepsLog::Open(const std::string& path) {
+  std::unique_ptr<DepsLog> log(new DepsLog(path));
+  if (!log->Load() || log->NeedsCompaction()) {
+    if (!log->WriteCompacted()) {
+      return nullptr;
+    }
+  }
+
+  log->file_ = std::fopen(path.c_str(), "ab");
+  if (!log->file_) {
+    return nullptr;
+  }
+  return log;
+}
+
+stdext::optional<std::vector<ebb::lib::JSONPathStringView>> DepsLog::Lookup(
+    const std::string& deps_path, const platform::FileStatus& status) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found_id = path_ids_.find(deps_path);
+  if (found_id == path_ids_.end()) {
+    return stdext::nullopt;
+  }
+  auto found = entries_.find(found_id->second);
+  if (found == entries_.end() || !SameStatus(found->second.status, status)) {
+    return stdext::nullopt;
+  }
+  return ToViews(found->second.dependency_ids);
+}
+
+std::vector<ebb::lib::JSONPathStringView> DepsLog::Record(
+    const std::string& deps_path, const platform::FileStatus& status,
+    const std::vector<std::string>& dependencies) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t deps_path_id = InternPath(deps_path, file_);
+  Entry entry;
+  entry.status = status;
+  entry.dependency_ids.reserve(dependencies.size());
+  for (const auto& dependency : dependencies) {
+    entry.dependency_ids.push_back(InternPath(dependency, file_));
+  }
+
+  auto found = entries_.find(deps_path_id);
+  if (found == entries_.end() || !SameStatus(found->second.status, status) ||
+      found->second.dependency_ids != entry.dependency_ids) {
+    WriteDepsRecord(file_, deps_path_id, entry.status, entry.dependency_ids);
+    ++num_records_;
+    AddEntry(deps_path_id, std::move(entry));
+  }
+  // Flush as we go, so that an interrupted build still remembers the deps
+  // files that it read.
+  std::fflush(file_);
+
+  return ToViews(entries_[deps_path_id].dependency_ids);
+}
+
+size_t DepsLog::num_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool DepsLog::Load() {
+  std::ifstream in(path_.c_str(),
+                   std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in) {
+    return false;
+  }
+  std::vector<char> contents(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+  if (!contents.empty() && !in.read(contents.data(), contents.size())) {
+    return false;
+  }
+  if (contents.size() < kHeaderSize ||
+      std::memcmp(contents.data(), kHeader, kHeaderSize) != 0) {
+    return false;
+  }
+
+  const char* data = contents.data();
+  const size_t size = contents.size();
+  size_t pos = kHeaderSize;
+  while (pos + 4 <= size) {
+    uint32_t record_header = Read<uint32_t>(data + pos);
+    bool is_deps_record = (record_header & kDepsRecordFlag) != 0;
+    uint32_t record_size = record_header & ~kDepsRecordFlag;
+    if (record_size > kMaxRecordSize || record_size % 4 != 0 ||
+        pos + 4 + record_size > size) {
+      break;
+    }
+    const char* record = data + pos + 4;
+
+    if (is_deps_record) {
+      if (record_size < kDepsRecordFixedSize) {
+        break;
+      }
+      uint32_t deps_path_id = Read<uint32_t>(record);
+      Entry entry;
+      entry.status.id = Read<uint64_t>(record + 4);
+      entry.status.size = Read<uint64_t>(record + 12);
+      entry.status.last_modification_time =
+          FromNanoseconds(Read<int64_t>(record + 20));
+      size_t num_dependencies = (record_size - kDepsRecordFixedSize) / 4;
+      entry.dependency_ids.resize(num_dependencies);
+      bool ids_valid = deps_path_id < paths_.size();
+      for (size_t i = 0; i < num_dependencies; ++i) {
+        entry.dependency_ids[i] =
+            Read<uint32_t>(record + kDepsRecordFixedSize + 4 * i);
+        ids_valid = ids_valid && entry.dependency_ids[i] < paths_.size();
+      }
+      if (!ids_valid) {
+        break;
+      }
+      AddEntry(deps_path_id, std::move(entry));
+      ++num_records_;
+    } else {
+      if (record_size < 4) {
+        break;
+      }
+      // The checksum catches path records that were only partially written,
+      // or records written out of order by concurrent builds.
+      uint32_t checksum = Read<uint32_t>(record + record_size - 4);
+      std::string path(record, strnlen(record, record_size - 4));
+      if (~checksum != paths_.size() || path.empty() ||
+          path_ids_.count(path)) {
+        break;
+      }
+      InternPath(path, nullptr);
+    }
+
+    pos += 4 + record_size;
+  }
+
+  // Anything left over can't be trusted, and mustn't be appended to, so in
+  // that case the log is rewritten without it.
+  return pos == size;
+}
+
+bool DepsLog::NeedsCompaction() const {
+  return num_records_ >= kMinRecordsForCompaction &&
+         num_records_ > kMaxRecordsPerEntry * entries_.size();
+}
+
+bool DepsLog::WriteCompacted() {
+  std::string temp_path = path_ + ".tmp";
+  FILE* file = std::fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  std::fwrite(kHeader, 1, kHeaderSize, file);
+
+  // Paths are numbered afresh as they're written, leaving out any that are no
+  // longer referred to.
+  std::vector<std::string> old_paths;
+  old_paths.swap(paths_);
+  std::unordered_map<uint32_t, Entry> old_entries;
+  old_entries.swap(entries_);
+  json_paths_.clear();
+  path_ids_.clear();
+  for (auto& old_entry : old_entries) {
+    uint32_t deps_path_id = InternPath(old_paths[old_entry.first], file);
+    Entry entry;
+    entry.status = old_entry.second.status;
+    for (uint32_t dependency_id : old_entry.second.dependency_ids) {
+      entry.dependency_ids.push_back(
+          InternPath(old_paths[dependency_id], file));
+    }
+    WriteDepsRecord(file, deps_path_id, entry.status, entry.dependency_ids);
+    AddEntry(deps_path_id, std::move(entry));
+  }
+
+  if (std::fclose(file) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  // Windows won't rename over an existing file.
+  std::remove(path_.c_str());
+#endif
+  if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  num_records_ = entries_.size();
+  return true;
+}
+
+uint32_t DepsLog::InternPath(const std::string& path, FILE* file) {
+  auto found = path_ids_.find(path);
+  if (found != path_ids_.end()) {
+    return found->second;
+  }
+  uint32_t id = static_cast<uint32_t>(paths_.size());
+  if (file) {
+    WritePathRecord(file, path, id);
+  }
+  paths_.push_back(path);
+  json_paths_.push_back(ebb::lib::ToJSON(path));
+  path_ids_.emplace(path, id);
+  return id;
+}
+
+void DepsLog::AddEntry(uint32_t deps_path_id, Entry&& entry) {
+  entries_[deps_path_id] = std::move(entry);
+}
+
+std::vector<ebb::lib::JSONPathStringView> DepsLog::ToViews(
+    const std::vector<uint32_t>& ids) const {
+  std::vector<ebb::lib::JSONPathStringView> views;
+  views.reserve(ids.size());
+  for (uint32_t id : ids) {
+    views.emplace_back(ebb::lib::JSONStringView(json_paths_[id]));
+  }
+  return views;
+}
+
+}  // namespace respire
@@ -0,0 +1,101 @@
+#ifndef __RESPIRE_DEPS_LOG_H__
+#define __RESPIRE_DEPS_LOG_H__
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/json_string_view.h"
+#include "platform/file_system.h"
+#include "stdext/optional.h"
+
+namespace respire {
+
+// A persistent record, kept across builds, of the dependencies listed in each
+// deps file, in the spirit of Ninja's ".ninja_deps".  Once a deps file has
+// been read, later builds find its dependencies here for as long as the file
+// keeps the same status (ID, size and modification time), rather than opening
+// and parsing it again.
+//
+// The log is a binary file that is only ever appended to while building.  Each
+// path is written out once, and is referred to by its ID, its index amongst
+// the paths, thereafter.  After a header, the log consists of records that
+// each start with a uint32 holding the size of the rest of the record, with
+// the top bit set for deps records:
+//
+//   Path:  [path, padded with '\0's to a multiple of 4 bytes]
+//          [uint32 bitwise complement of the path's ID]
+//   Deps:  [uint32 deps file path ID][uint64 deps file ID][uint64 size]
+//          [int64 modification time in ns][uint32 dependency path ID]...
+//
+// All integers are in the host's byte order.  Later deps records for the same
+// deps file replace earlier ones, and the log is rewritten without the
+// replaced records when it is opened if they have come to dominate it.
+class DepsLog {
+ public:
+  // Loads the log at |path|, creating it if it doesn't exist yet.  Returns
+  // null if the log can't be opened for writing.  Unreadable logs, e.g. from
+  // an incompatible version, are started over, and records that were only
+  // partially written are dropped.
+  static std::unique_ptr<DepsLog> Open(const std::string& path);
+  ~DepsLog();
+
+  // Returns the dependencies recorded for the deps file at |deps_path| if it
+  // still has |status|.  The paths are JSON-escaped, as the nodes expect, and
+  // remain valid for as long as the log.
+  stdext::optional<std::vector<ebb::lib::JSONPathStringView>> Lookup(
+      const std::string& deps_path,
+      const platform::FileStatus& status) const;
+
+  // Records, both in memory and on disk, that the deps file at |deps_path|
+  // lists |dependencies| while it has |status|, and returns them as Lookup()
+  // would.
+  std::vector<ebb::lib::JSONPathStringView> Record(
+      const std::string& deps_path, const platform::FileStatus& status,
+      const std::vector<std::string>& dependencies);
+
+  size_t num_entries() const;
+
+ private:
+  struct Entry {
+    platform::FileStatus status;
+    std::vector<uint32_t> dependency_ids;
+  };
+
+  explicit DepsLog(const std::string& path);
+
+  bool Load();
+  bool NeedsCompaction() const;
+  bool WriteCompacted();
+
+  // Returns the ID of |path|, adding it if it's new.  Paths are only written
+  // out if |file| is given.
+  uint32_t InternPath(const std::string& path, FILE* file);
+  void AddEntry(uint32_t deps_path_id, Entry&& entry);
+  std::vector<ebb::lib::JSONPathStringView> ToViews(
+      const std::vector<uint32_t>& ids) const;
+
+  const std::string path_;
+
+  mutable std::mutex mutex_;
+  // Each path, indexed by ID.
+  std::vector<std::string> paths_;
+  // The JSON-escaped form of each path, indexed by ID.  These are kept in a
+  // deque so that views of them stay valid as more are added.
+  std::deque<std::string> json_paths_;
+  std::unordered_map<std::string, uint32_t> path_ids_;
+  std::unordered_map<uint32_t, Entry> entries_;
+  // The number of deps records on disk, including replaced ones.
+  size_t num_records_;
+  FILE* file_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_DEPS_LOG_H__
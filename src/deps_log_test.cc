@@ -0,0 +1,226 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "deps_log.h"
+#include "stdext/file_system.h"
+
+using respire::DepsLog;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+namespace {
+platform::FileStatus MakeStatus(uint64_t id, uint64_t size, int seconds) {
+  platform::FileStatus status;
+  status.id = id;
+  status.size = size;
+  status.last_modification_time = std::chrono::system_clock::time_point(
+      std::chrono::seconds(seconds));
+  return status;
+}
+
+std::vector<std::string> ToStrings(
+    const std::vector<ebb::lib::JSONPathStringView>& paths) {
+  std::vector<std::string> strings;
+  for (const auto& path : paths) {
+    strings.push_back(path.AsString());
+  }
+  return strings;
+}
+
+void ExpectDeps(const DepsLog& log, const std::string& deps_path,
+                const platform::FileStatus& status,
+                const std::vector<std::string>& expected) {
+  auto dependencies = log.Lookup(deps_path, status);
+  ASSERT_TRUE(dependencies.has_value());
+  EXPECT_EQ(expected, ToStrings(*dependencies));
+}
+
+size_t FileSize(const Path& path) {
+  std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+  in.seekg(0, std::ios::end);
+  return static_cast<size_t>(in.tellg());
+}
+}  // namespace
+
+TEST(DepsLogTest, EntriesSurviveReopening) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+
+  platform::FileStatus foo_status = MakeStatus(1, 100, 1000);
+  platform::FileStatus bar_status = MakeStatus(2, 200, 2000);
+  std::vector<std::string> foo_deps = {"foo.cc", "include/common.h"};
+  std::vector<std::string> bar_deps = {
+      "bar.cc", "include/common.h", "path with \"quotes\"\tand tabs.h"};
+  {
+    std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    EXPECT_EQ(0, log->num_entries());
+    EXPECT_EQ(foo_deps, ToStrings(log->Record("foo.d", foo_status, foo_deps)));
+    EXPECT_EQ(bar_deps, ToStrings(log->Record("bar.d", bar_status, bar_deps)));
+    log->Record("empty.d", foo_status, std::vector<std::string>());
+    ExpectDeps(*log, "foo.d", foo_status, foo_deps);
+  }
+
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(3, log->num_entries());
+  ExpectDeps(*log, "foo.d", foo_status, foo_deps);
+  ExpectDeps(*log, "bar.d", bar_status, bar_deps);
+  ExpectDeps(*log, "empty.d", foo_status, std::vector<std::string>());
+  EXPECT_FALSE(log->Lookup("baz.d", foo_status).has_value());
+  // Dependencies aren't deps files themselves.
+  EXPECT_FALSE(log->Lookup("foo.cc", foo_status).has_value());
+}
+
+TEST(DepsLogTest, ChangedDepsFilesAreNotFound) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  log->Record("foo.d", MakeStatus(1, 100, 1000), {"foo.cc"});
+
+  EXPECT_TRUE(log->Lookup("foo.d", MakeStatus(1, 100, 1000)).has_value());
+  EXPECT_FALSE(log->Lookup("foo.d", MakeStatus(2, 100, 1000)).has_value());
+  EXPECT_FALSE(log->Lookup("foo.d", MakeStatus(1, 101, 1000)).has_value());
+  EXPECT_FALSE(log->Lookup("foo.d", MakeStatus(1, 100, 1001)).has_value());
+}
+
+TEST(DepsLogTest, LaterEntriesReplaceEarlierOnes) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+
+  platform::FileStatus new_status = MakeStatus(1, 200, 2000);
+  std::vector<std::string> new_deps = {"foo.cc", "include/new.h"};
+  {
+    std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->Record("foo.d", MakeStatus(1, 100, 1000),
+                {"foo.cc", "include/old.h"});
+    log->Record("foo.d", new_status, new_deps);
+    ExpectDeps(*log, "foo.d", new_status, new_deps);
+  }
+
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(1, log->num_entries());
+  ExpectDeps(*log, "foo.d", new_status, new_deps);
+  EXPECT_FALSE(log->Lookup("foo.d", MakeStatus(1, 100, 1000)).has_value());
+}
+
+TEST(DepsLogTest, UnrecognizedLogsAreStartedOver) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+  {
+    std::ofstream out(log_path.c_str(), std::ios::binary);
+    out << "# some other log\nfoo.d: foo.cc\n";
+  }
+
+  platform::FileStatus status = MakeStatus(1, 100, 1000);
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(0, log->num_entries());
+  log->Record("foo.d", status, {"foo.cc"});
+  log.reset();
+
+  log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(1, log->num_entries());
+  ExpectDeps(*log, "foo.d", status, {"foo.cc"});
+}
+
+TEST(DepsLogTest, TruncatedRecordsAreDropped) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+
+  platform::FileStatus foo_status = MakeStatus(1, 100, 1000);
+  platform::FileStatus bar_status = MakeStatus(2, 200, 2000);
+  {
+    std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->Record("foo.d", foo_status, {"foo.cc"});
+  }
+  size_t complete_size = FileSize(log_path);
+  {
+    std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    log->Record("bar.d", bar_status, {"bar.cc", "include/bar.h"});
+  }
+  {
+    // As if a build was interrupted while writing the second entry.
+    std::string contents;
+    {
+      std::ifstream in(log_path.c_str(), std::ios::in | std::ios::binary);
+      contents.assign(std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>());
+    }
+    contents.resize(FileSize(log_path) - 6);
+    std::ofstream out(log_path.c_str(), std::ios::binary);
+    out << contents;
+  }
+
+  {
+    std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    EXPECT_EQ(1, log->num_entries());
+    ExpectDeps(*log, "foo.d", foo_status, {"foo.cc"});
+    EXPECT_FALSE(log->Lookup("bar.d", bar_status).has_value());
+    // The partial record is gone, so new records can follow.
+    EXPECT_EQ(complete_size, FileSize(log_path));
+    log->Record("bar.d", bar_status, {"bar.cc"});
+  }
+
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(2, log->num_entries());
+  ExpectDeps(*log, "foo.d", foo_status, {"foo.cc"});
+  ExpectDeps(*log, "bar.d", bar_status, {"bar.cc"});
+}
+
+TEST(DepsLogTest, UnchangedEntriesAreNotWrittenAgain) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  log->Record("foo.d", MakeStatus(1, 100, 1000), {"foo.cc", "foo.h"});
+  size_t size = FileSize(log_path);
+  log->Record("foo.d", MakeStatus(1, 100, 1000), {"foo.cc", "foo.h"});
+  EXPECT_EQ(size, FileSize(log_path));
+}
+
+TEST(DepsLogTest, LogsDominatedByReplacedEntriesAreCompacted) {
+  TemporaryDirectory temp_dir;
+  Path log_path = Join(temp_dir.path(), PathStrRef("deps_log.bin"));
+
+  platform::FileStatus last_status = MakeStatus(1, 5000, 5000);
+  {
+    std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+    ASSERT_NE(nullptr, log);
+    for (int i = 0; i < 5000; ++i) {
+      log->Record("foo.d", MakeStatus(1, i, i),
+                  {"foo.cc", "include/foo" + std::to_string(i) + ".h"});
+    }
+    log->Record("foo.d", last_status, {"foo.cc"});
+    log->Record("bar.d", last_status, {"bar.cc"});
+  }
+  size_t uncompacted_size = FileSize(log_path);
+
+  std::unique_ptr<DepsLog> log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  EXPECT_EQ(2, log->num_entries());
+  ExpectDeps(*log, "foo.d", last_status, {"foo.cc"});
+  ExpectDeps(*log, "bar.d", last_status, {"bar.cc"});
+  // The replaced entries, and the paths that only they referred to, are gone.
+  EXPECT_GT(uncompacted_size / 100, FileSize(log_path));
+  log.reset();
+
+  log = DepsLog::Open(log_path.str());
+  ASSERT_NE(nullptr, log);
+  ExpectDeps(*log, "foo.d", last_status, {"foo.cc"});
+  ExpectDeps(*log, "bar.d", last_status, {"bar.cc"});
+}
@@ -5,7 +5,6 @@ import sys
 import respire.buildlib.cc as cc
 import respire.buildlib.cc_toolchains.discovery as cc_discovery
 import respire.buildlib.modules as modules
-import respire.buildlib.run_with_timestamp as run_with_timestamp
 
 def EntryPoint(registry, out_dir):
   toolchain = cc_discovery.DiscoverHostToolchain()
@@ -48,13 +47,20 @@ def Build(registry, out_dir, configured_toolchain,
         'environment.cc',
         'fiber_condition_variable.cc',
         'fiber_condition_variable.h',
+        'fiber_semaphore.cc',
+        'fiber_semaphore.h',
         'lib/file_reader.cc',
         'lib/file_reader.h',
+        'lib/jobserver_client.cc',
+        'lib/jobserver_client.h',
         'lib/json_string_view.cc',
         'lib/json_string_view.h',
         'lib/json_tokenizer.cc',
         'lib/json_tokenizer.h',
+        'lib/system_command.cc',
+        'lib/system_command.h',
         'linked_list.h',
+        'parallel_for.h',
         'queue.cc',
         'thread_pool.cc',
         'thread_pool.h',
@@ -67,10 +73,13 @@ def Build(registry, out_dir, configured_toolchain,
       sources = [
         'consumer_test.cc',
         'environment_test.cc',
+        'parallel_for_test.cc',
         'queue_test.cc',
         'push_pull_consumer_test.cc',
         'lib/json_tokenizer_test.cc',
         'lib/file_reader_test.cc',
+        'lib/jobserver_client_test.cc',
+        'lib/system_command_test.cc',
       ],
       module_dependencies=[
         ebb_lib,
@@ -78,12 +87,11 @@ def Build(registry, out_dir, configured_toolchain,
       ])
 
   run_ebb_tests_timestamp_file = os.path.join(out_dir, 'ebb_tests.timestamp')
-  registry.PythonFunction(
+  registry.SystemCommand(
       inputs=[ebb_tests.GetOutputFiles()[0]],
       outputs=[run_ebb_tests_timestamp_file],
-      function=run_with_timestamp.RunAndTimestampOnSuccess,
-      timestamp_file=run_ebb_tests_timestamp_file,
-      command=[ebb_tests.GetOutputFiles()[0]])
+      command=[ebb_tests.GetOutputFiles()[0]],
+      stamp_outputs=[run_ebb_tests_timestamp_file])
 
   return {
     'ebb_lib': ebb_lib,
@@ -27,6 +27,30 @@ void FiberConditionVariable::notify_one() {
   } 
 }
 
+void FiberConditionVariable::notify_all() {
+  // Hand all of the fibers to the thread pool in one go, rather than taking
+  // its lock once for each of them.
+  ThreadPool::ContextList contexts_to_wake;
+  bool notify_internal = false;
+  while (!wait_queue_.empty()) {
+    ThreadPool::ContextList::Node* next_context = wait_queue_.front();
+    wait_queue_.pop_front();
+
+    if (next_context->item()) {
+      contexts_to_wake.push_back(next_context);
+    } else {
+      notify_internal = true;
+    }
+  }
+
+  if (!contexts_to_wake.empty()) {
+    thread_pool_->WakeContexts(&contexts_to_wake);
+  }
+  if (notify_internal) {
+    internal_cond_->notify_all();
+  }
+}
+
 void FiberConditionVariable::wait(std::unique_lock<std::mutex>& lock) {
   assert(lock);
   std::mutex* mutex = lock.mutex();
@@ -17,6 +17,8 @@ class FiberConditionVariable {
   ~FiberConditionVariable();
 
   void notify_one();
+  // Wakes every waiter at once.
+  void notify_all();
   void wait(std::unique_lock<std::mutex>& lock);
 
  private:
@@ -0,0 +1,28 @@
+#include "fiber_semaphore.h"
+
+#include <cassert>
+
+namespace ebb {
+
+FiberSemaphore::FiberSemaphore(ThreadPool* thread_pool, int count)
+    : count_(count), available_cond_(thread_pool) {
+  assert(count_ > 0);
+}
+
+FiberSemaphore::~FiberSemaphore() {}
+
+void FiberSemaphore::Acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (count_ == 0) {
+    available_cond_.wait(lock);
+  }
+  --count_;
+}
+
+void FiberSemaphore::Release() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++count_;
+  available_cond_.notify_one();
+}
+
+}  // namespace ebb
@@ -0,0 +1,47 @@
+#ifndef __EBB_FIBER_SEMAPHORE_H__
+#define __EBB_FIBER_SEMAPHORE_H__
+
+#include <mutex>
+
+#include "fiber_condition_variable.h"
+#include "thread_pool.h"
+
+namespace ebb {
+
+// A counting semaphore which, like FiberConditionVariable, suspends only the
+// calling fiber (and not its thread) while waiting to acquire.
+class FiberSemaphore {
+ public:
+  FiberSemaphore(ThreadPool* thread_pool, int count);
+  ~FiberSemaphore();
+
+  void Acquire();
+  void Release();
+
+  // Acquires the semaphore for the lifetime of the object.  If |semaphore| is
+  // null, nothing is acquired.
+  class ScopedAcquire {
+   public:
+    ScopedAcquire(FiberSemaphore* semaphore) : semaphore_(semaphore) {
+      if (semaphore_) semaphore_->Acquire();
+    }
+    ~ScopedAcquire() {
+      if (semaphore_) semaphore_->Release();
+    }
+
+    ScopedAcquire(const ScopedAcquire&) = delete;
+    ScopedAcquire& operator=(const ScopedAcquire&) = delete;
+
+   private:
+    FiberSemaphore* semaphore_;
+  };
+
+ private:
+  std::mutex mutex_;
+  int count_;
+  FiberConditionVariable available_cond_;
+};
+
+}  // namespace ebb
+
+#endif  // __EBB_FIBER_SEMAPHORE_H__
@@ -0,0 +1,105 @@
+#include "lib/jobserver_client.h"
+
+namespace ebb {
+namespace lib {
+
+JobserverClient::JobserverClient(
+    Environment* env, platform::Jobserver* jobserver)
+    : jobserver_(jobserver), implicit_token_in_use_(false), num_waiting_(0),
+      failed_(false), quit_(false),
+      token_available_cond_(&env->env()->thread_pool()),
+      reader_thread_(&JobserverClient::ReadTokens, this) {}
+
+JobserverClient::~JobserverClient() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+    reader_cond_.notify_one();
+  }
+  jobserver_->CancelAcquire();
+  reader_thread_.join();
+
+  for (char token : available_tokens_) {
+    jobserver_->ReleaseToken(token);
+  }
+}
+
+JobserverClient::Token JobserverClient::Acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ++num_waiting_;
+  reader_cond_.notify_one();
+  while (implicit_token_in_use_ && available_tokens_.empty() && !failed_) {
+    token_available_cond_.wait(lock);
+  }
+  --num_waiting_;
+
+  // Prefer the implicit token, since using it doesn't take a token away from
+  // any other process.
+  if (!implicit_token_in_use_) {
+    implicit_token_in_use_ = true;
+    return Token(Token::kImplicit, 0);
+  } else if (!available_tokens_.empty()) {
+    char value = available_tokens_.back();
+    available_tokens_.pop_back();
+    return Token(Token::kAcquired, value);
+  } else {
+    return Token();
+  }
+}
+
+void JobserverClient::Release(const Token& token) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (token.type_) {
+    case Token::kNone: {
+      return;
+    } break;
+    case Token::kImplicit: {
+      implicit_token_in_use_ = false;
+    } break;
+    case Token::kAcquired: {
+      if (num_waiting_ == 0) {
+        jobserver_->ReleaseToken(token.value_);
+        return;
+      }
+      // Hand the token directly to a waiting fiber.
+      available_tokens_.push_back(token.value_);
+    } break;
+  }
+  token_available_cond_.notify_one();
+  // Now that there is a token available, the reader thread may have one
+  // more than it needs.
+  reader_cond_.notify_one();
+}
+
+void JobserverClient::ReadTokens() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!quit_) {
+    if (num_waiting_ > available_tokens_.size() && !failed_) {
+      lock.unlock();
+      stdext::optional<char> token = jobserver_->AcquireToken();
+      lock.lock();
+
+      if (token) {
+        available_tokens_.push_back(*token);
+        token_available_cond_.notify_one();
+      } else if (!quit_) {
+        // Don't leave anyone waiting forever on a broken jobserver.
+        failed_ = true;
+        for (size_t i = 0; i < num_waiting_; ++i) {
+          token_available_cond_.notify_one();
+        }
+      }
+    } else {
+      // Return any tokens that are no longer needed, e.g. because their
+      // waiter was given the implicit token instead.
+      while (available_tokens_.size() > num_waiting_) {
+        jobserver_->ReleaseToken(available_tokens_.back());
+        available_tokens_.pop_back();
+      }
+      reader_cond_.wait(lock);
+    }
+  }
+}
+
+}  // namespace lib
+}  // namespace ebb
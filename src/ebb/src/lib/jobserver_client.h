@@ -0,0 +1,89 @@
+#ifndef __EBB_LIB_JOBSERVER_CLIENT_H__
+#define __EBB_LIB_JOBSERVER_CLIENT_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ebbpp.h"
+#include "fiber_condition_variable.h"
+#include "platform/jobserver.h"
+
+namespace ebb {
+namespace lib {
+
+// Hands out job tokens from a platform::Jobserver to fibers.  Since reading a
+// token from the jobserver may block for a long time, tokens are read on a
+// dedicated thread so that waiting for one only suspends the calling fiber.
+class JobserverClient {
+ public:
+  class Token {
+   public:
+    Token() : type_(kNone), value_(0) {}
+
+   private:
+    friend class JobserverClient;
+    enum Type {
+      // Returned if the jobserver has failed, in which case jobs proceed
+      // without being limited by it.
+      kNone,
+      // The token that this process owns implicitly.
+      kImplicit,
+      // A token read from the jobserver.
+      kAcquired,
+    };
+    Token(Type type, char value) : type_(type), value_(value) {}
+
+    Type type_;
+    char value_;
+  };
+
+  // |jobserver| must outlive this object.
+  JobserverClient(Environment* env, platform::Jobserver* jobserver);
+  ~JobserverClient();
+
+  Token Acquire();
+  void Release(const Token& token);
+
+  // Holds a token for the lifetime of the object.  If |client| is null, no
+  // token is needed and none is held.
+  class ScopedToken {
+   public:
+    ScopedToken(JobserverClient* client)
+        : client_(client), token_(client ? client->Acquire() : Token()) {}
+    ~ScopedToken() {
+      if (client_) client_->Release(token_);
+    }
+
+    ScopedToken(const ScopedToken&) = delete;
+    ScopedToken& operator=(const ScopedToken&) = delete;
+
+   private:
+    JobserverClient* client_;
+    Token token_;
+  };
+
+ private:
+  void ReadTokens();
+
+  platform::Jobserver* jobserver_;
+
+  std::mutex mutex_;
+  bool implicit_token_in_use_;
+  // The number of fibers waiting in Acquire().
+  size_t num_waiting_;
+  // Tokens read from the jobserver that have not yet been handed out.
+  std::vector<char> available_tokens_;
+  bool failed_;
+  bool quit_;
+
+  FiberConditionVariable token_available_cond_;
+  std::condition_variable reader_cond_;
+  std::thread reader_thread_;
+};
+
+}  // namespace lib
+}  // namespace ebb
+
+#endif  // __EBB_LIB_JOBSERVER_CLIENT_H__
@@ -0,0 +1,73 @@
+#include "lib/jobserver_client.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "ebbpp.h"
+
+namespace ebb {
+namespace lib {
+
+#if !defined(_WIN32)
+
+namespace {
+const int kDefaultStackSize = 16 * 1024;
+}  // namespace
+
+TEST(JobserverClientTest, LimitsConcurrencyToTokensPlusImplicitToken) {
+  const int kNumTokens = 2;
+  auto jobserver =
+      platform::Jobserver::Create(kNumTokens, platform::Jobserver::Style::Pipe);
+  ASSERT_TRUE(jobserver);
+
+  ebb::Environment env(8, kDefaultStackSize);
+  std::atomic<int> running(0);
+  std::atomic<int> max_running(0);
+
+  {
+    JobserverClient client(&env, jobserver.get());
+    std::vector<std::unique_ptr<ebb::Consumer<int>>> consumers;
+    std::vector<std::unique_ptr<ebb::QueueWithMemory<int, 1>>> queues;
+    const int kNumJobs = 8;
+    for (int i = 0; i < kNumJobs; ++i) {
+      queues.emplace_back(new ebb::QueueWithMemory<int, 1>(&env));
+      consumers.emplace_back(new ebb::Consumer<int>(
+          &env, queues.back().get(), [&](int) {
+        JobserverClient::ScopedToken token(&client);
+        int now_running = ++running;
+        int previous_max = max_running.load();
+        while (now_running > previous_max &&
+               !max_running.compare_exchange_weak(previous_max, now_running)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        --running;
+      }));
+    }
+    for (auto& job_queue : queues) {
+      ebb::Push<int> push(job_queue.get(), 0);
+    }
+    // Destroying the consumers waits for all jobs to complete.
+    consumers.clear();
+  }
+
+  EXPECT_LE(max_running.load(), kNumTokens + 1);
+  EXPECT_GE(max_running.load(), 1);
+
+  // All tokens should have been returned to the jobserver.  The client
+  // cancels |jobserver| when it shuts down, so check through a new connection.
+  auto connection =
+      platform::Jobserver::ConnectFromMakeflags(jobserver->makeflags().c_str());
+  ASSERT_TRUE(connection);
+  for (int i = 0; i < kNumTokens; ++i) {
+    EXPECT_TRUE(connection->AcquireToken());
+  }
+}
+
+#endif  // !defined(_WIN32)
+
+}  // namespace lib
+}  // namespace ebb
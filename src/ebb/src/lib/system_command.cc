@@ -0,0 +1,42 @@
+#include "lib/system_command.h"
+
+#include <mutex>
+
+#include "fiber_condition_variable.h"
+
+namespace ebb {
+namespace lib {
+
+namespace {
+struct PendingCommand {
+  PendingCommand(ThreadPool* thread_pool)
+      : done(false), done_cond(thread_pool) {}
+
+  std::mutex mutex;
+  bool done;
+  platform::SystemCommandResult result;
+  FiberConditionVariable done_cond;
+};
+}  // namespace
+
+platform::SystemCommandResult SystemCommand(
+    Environment* env, const platform::SystemCommandParams& params) {
+  PendingCommand pending(&env->env()->thread_pool());
+
+  platform::SystemCommandAsync(
+      params, [&pending](const platform::SystemCommandResult& result) {
+    std::lock_guard<std::mutex> lock(pending.mutex);
+    pending.done = true;
+    pending.result = result;
+    pending.done_cond.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lock(pending.mutex);
+  while (!pending.done) {
+    pending.done_cond.wait(lock);
+  }
+  return pending.result;
+}
+
+}  // namespace lib
+}  // namespace ebb
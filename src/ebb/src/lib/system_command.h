@@ -0,0 +1,21 @@
+#ifndef __EBB_LIB_SYSTEM_COMMAND_H__
+#define __EBB_LIB_SYSTEM_COMMAND_H__
+
+#include "ebbpp.h"
+#include "platform/subprocess.h"
+
+namespace ebb {
+namespace lib {
+
+// Executes a system command in the same way as platform::SystemCommand(),
+// except that while the command runs only the calling fiber is suspended.
+// The thread pool thread is free to run other tasks, so the number of
+// commands that may run simultaneously is not limited by the number of
+// threads in |env|'s thread pool.
+platform::SystemCommandResult SystemCommand(
+    Environment* env, const platform::SystemCommandParams& params);
+
+}  // namespace lib
+}  // namespace ebb
+
+#endif  // __EBB_LIB_SYSTEM_COMMAND_H__
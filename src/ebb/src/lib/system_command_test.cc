@@ -0,0 +1,246 @@
+#include "lib/system_command.h"
+
+#include <chrono>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "ebbpp.h"
+#include "stdext/file_system.h"
+
+namespace ebb {
+namespace lib {
+
+using platform::SystemCommandParams;
+
+namespace {
+const int kDefaultStackSize = 16 * 1024;
+}  // namespace
+
+TEST(SystemCommandTest, ReturnsZeroOnSuccess) {
+  ebb::Environment env(1, kDefaultStackSize);
+
+  EXPECT_EQ(0, SystemCommand(&env, SystemCommandParams("exit 0")).exit_code);
+}
+
+TEST(SystemCommandTest, ReturnsNonZeroOnFailure) {
+  ebb::Environment env(1, kDefaultStackSize);
+
+  EXPECT_NE(0, SystemCommand(&env, SystemCommandParams("exit 3")).exit_code);
+}
+
+TEST(SystemCommandTest, RedirectsStdoutToFile) {
+  stdext::file_system::TemporaryDirectory temp_dir;
+  SystemCommandParams params("echo hello");
+  params.stdout_file =
+      Join(temp_dir.path(), stdext::file_system::PathStrRef("out.txt"));
+
+  ebb::Environment env(1, kDefaultStackSize);
+
+  EXPECT_EQ(0, SystemCommand(&env, params).exit_code);
+
+  std::ifstream in(params.stdout_file->str());
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ("hello", line);
+}
+
+#if !defined(_WIN32)
+TEST(SystemCommandTest, ArgvIsExecutedWithoutShell) {
+  stdext::file_system::TemporaryDirectory temp_dir;
+  // If this were interpreted by a shell, the output would be truncated at the
+  // semicolon and the repeated spaces would be collapsed.
+  const std::string kMessage("a  b;exit 1");
+  SystemCommandParams params("echo \"" + kMessage + "\"");
+  params.argv = std::vector<std::string>{"echo", kMessage};
+  params.stdout_file =
+      Join(temp_dir.path(), stdext::file_system::PathStrRef("out.txt"));
+
+  ebb::Environment env(1, kDefaultStackSize);
+
+  EXPECT_EQ(0, SystemCommand(&env, params).exit_code);
+
+  std::ifstream in(params.stdout_file->str());
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ(kMessage, line);
+}
+
+TEST(SystemCommandTest, ArgvWithMissingProgramFails) {
+  SystemCommandParams params("this_program_does_not_exist");
+  params.argv = std::vector<std::string>{"this_program_does_not_exist"};
+
+  ebb::Environment env(1, kDefaultStackSize);
+
+  EXPECT_NE(0, SystemCommand(&env, params).exit_code);
+}
+
+// Only a single thread is available, so this would deadlock if running a
+// command occupied the thread: the first command waits on a file that only the
+// second command creates.
+TEST(SystemCommandTest, CommandsDoNotOccupyThreadPoolThreads) {
+  stdext::file_system::TemporaryDirectory temp_dir;
+  stdext::file_system::Path signal_file =
+      Join(temp_dir.path(), stdext::file_system::PathStrRef("signal"));
+
+  ebb::Environment env(1, kDefaultStackSize);
+
+  SystemCommandParams wait_params(
+      "while [ ! -f " + signal_file.str() + " ]; do sleep 0.01; done");
+  SystemCommandParams signal_params("touch " + signal_file.str());
+
+  {
+    ConsumerWithQueue<void, 1> wait_consumer(&env, [&env, &wait_params]() {
+      EXPECT_EQ(0, SystemCommand(&env, wait_params).exit_code);
+    });
+    ConsumerWithQueue<void, 1> signal_consumer(&env, [&env, &signal_params]() {
+      EXPECT_EQ(0, SystemCommand(&env, signal_params).exit_code);
+    });
+
+    Push<>(wait_consumer.queue());
+    Push<>(signal_consumer.queue());
+  }  // Destructing the consumers will wait for them to finish.
+}
+#endif
+
+TEST(SystemCommandTest, CapturesOutput) {
+  ebb::Environment env(1, kDefaultStackSize);
+
+  SystemCommandParams params("echo out&& echo err 1>&2");
+  params.capture_stdout = true;
+  params.capture_stderr = true;
+
+  platform::SystemCommandResult result = SystemCommand(&env, params);
+  EXPECT_EQ(0, result.exit_code);
+  EXPECT_EQ(0u, result.stdout_output.find("out"));
+  EXPECT_EQ(0u, result.stderr_output.find("err"));
+
+  platform::SystemCommandResult sync_result = platform::SystemCommand(params);
+  EXPECT_EQ(result.stdout_output, sync_result.stdout_output);
+  EXPECT_EQ(result.stderr_output, sync_result.stderr_output);
+}
+
+#if !defined(_WIN32)
+TEST(SystemCommandTest, CapturedOutputIsBounded) {
+  ebb::Environment env(1, kDefaultStackSize);
+
+  // Much more output than fits in a pipe's buffer, which must be drained
+  // while the command runs for it to be able to finish.
+  SystemCommandParams params("head -c 3000000 /dev/zero");
+  params.capture_stdout = true;
+
+  platform::SystemCommandResult result = SystemCommand(&env, params);
+  EXPECT_EQ(0, result.exit_code);
+  EXPECT_GT(result.stdout_output.size(), platform::kMaxCapturedOutputBytes);
+  EXPECT_LT(result.stdout_output.size(),
+            platform::kMaxCapturedOutputBytes + 100);
+  EXPECT_NE(std::string::npos, result.stdout_output.find("dropped"));
+  EXPECT_TRUE(result.stderr_output.empty());
+}
+
+TEST(SystemCommandTest, ReportsResourceUsage) {
+  ebb::Environment env(1, kDefaultStackSize);
+
+  platform::SystemCommandResult result = SystemCommand(
+      &env, SystemCommandParams(
+                "i=0; while [ $i -lt 50000 ]; do i=$((i+1)); done"));
+  EXPECT_EQ(0, result.exit_code);
+  ASSERT_TRUE(result.resource_usage.has_value());
+  EXPECT_GT(result.resource_usage->user_time.count() +
+                result.resource_usage->system_time.count(), 0);
+  EXPECT_GT(result.resource_usage->max_rss_bytes, 0u);
+}
+
+TEST(SystemCommandTest, CommandsThatFinishInTimeAreNotTimedOut) {
+  ebb::Environment env(1, kDefaultStackSize);
+
+  SystemCommandParams params("exit 0");
+  params.timeout = std::chrono::seconds(30);
+  platform::SystemCommandResult result = SystemCommand(&env, params);
+  EXPECT_EQ(0, result.exit_code);
+  EXPECT_FALSE(result.timed_out);
+}
+
+TEST(SystemCommandTest, TimeoutTerminatesWholeProcessGroup) {
+  stdext::file_system::TemporaryDirectory temp_dir;
+  stdext::file_system::Path marker_file =
+      Join(temp_dir.path(), stdext::file_system::PathStrRef("marker"));
+
+  // The background job would create the marker file if it survived the
+  // timeout.
+  SystemCommandParams params(
+      "(sleep 1; touch " + marker_file.str() + ") & sleep 30");
+  params.timeout = std::chrono::milliseconds(100);
+
+  ebb::Environment env(1, kDefaultStackSize);
+
+  auto start_time = std::chrono::steady_clock::now();
+  platform::SystemCommandResult result = SystemCommand(&env, params);
+  EXPECT_LT(std::chrono::steady_clock::now() - start_time,
+            std::chrono::seconds(10));
+  EXPECT_NE(0, result.exit_code);
+  EXPECT_TRUE(result.timed_out);
+
+  // The synchronous version should behave in the same way.
+  platform::SystemCommandResult sync_result = platform::SystemCommand(params);
+  EXPECT_NE(0, sync_result.exit_code);
+  EXPECT_TRUE(sync_result.timed_out);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  std::ifstream marker(marker_file.str());
+  EXPECT_FALSE(marker.good());
+}
+#endif
+
+#if defined(__linux__)
+// Note that once started, the spawn server is used for all commands run by
+// subsequent tests too.
+TEST(SystemCommandTest, SpawnServerRunsCommands) {
+  ASSERT_TRUE(platform::StartSpawnServer());
+
+  stdext::file_system::TemporaryDirectory temp_dir;
+  ebb::Environment env(1, kDefaultStackSize);
+
+  // Exit statuses should be reported the same as they would be if the command
+  // were run directly.
+  SystemCommandParams failure_params("exit 3");
+  EXPECT_EQ(platform::SystemCommand(failure_params).exit_code,
+            SystemCommand(&env, failure_params).exit_code);
+  platform::SystemCommandResult success_result =
+      SystemCommand(&env, SystemCommandParams("exit 0"));
+  EXPECT_EQ(0, success_result.exit_code);
+  ASSERT_TRUE(success_result.resource_usage.has_value());
+  EXPECT_GT(success_result.resource_usage->max_rss_bytes, 0u);
+
+  const std::string kMessage("a  b;exit 1");
+  SystemCommandParams argv_params("echo \"" + kMessage + "\"");
+  argv_params.argv = std::vector<std::string>{"echo", kMessage};
+  argv_params.stdout_file =
+      Join(temp_dir.path(), stdext::file_system::PathStrRef("out.txt"));
+  EXPECT_EQ(0, SystemCommand(&env, argv_params).exit_code);
+
+  std::ifstream in(argv_params.stdout_file->str());
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ(kMessage, line);
+
+  SystemCommandParams missing_params("this_program_does_not_exist");
+  missing_params.argv =
+      std::vector<std::string>{"this_program_does_not_exist"};
+  EXPECT_NE(0, SystemCommand(&env, missing_params).exit_code);
+
+  SystemCommandParams capture_params("echo out; echo err 1>&2");
+  capture_params.capture_stderr = true;
+  platform::SystemCommandResult capture_result =
+      SystemCommand(&env, capture_params);
+  EXPECT_EQ("err\n", capture_result.stderr_output);
+  EXPECT_TRUE(capture_result.stdout_output.empty());
+
+  SystemCommandParams timeout_params("sleep 30");
+  timeout_params.timeout = std::chrono::milliseconds(100);
+  EXPECT_TRUE(SystemCommand(&env, timeout_params).timed_out);
+}
+#endif
+
+}  // namespace lib
+}  // namespace ebb
@@ -0,0 +1,130 @@
+#ifndef __EBB_PARALLEL_FOR_H__
+#define __EBB_PARALLEL_FOR_H__
+
+#include <algorithm>
+#include <mutex>
+
+#include "ebbpp.h"
+#include "fiber_condition_variable.h"
+#include "stdext/align.h"
+#include "stdext/span.h"
+#include "thread_pool.h"
+
+namespace ebb {
+
+// The maximum number of chunks that a single ParallelFor() call will split its
+// range in to.  All of the per-chunk bookkeeping lives on the calling fiber's
+// stack, so this is kept small enough to fit comfortably within a small fiber
+// stack.
+const size_t kMaxParallelForChunks = 8;
+
+namespace internal {
+
+struct ParallelForJoin {
+  ParallelForJoin(ThreadPool* thread_pool, size_t num_chunks)
+      : chunks_remaining(num_chunks), done_cond(thread_pool) {}
+
+  std::mutex mutex;
+  size_t chunks_remaining;
+  FiberConditionVariable done_cond;
+};
+
+template <typename T, typename F>
+struct ParallelForChunk {
+  void Run() {
+    for (size_t i = 0; i < size; ++i) {
+      (*function)(first_index + i, items[i]);
+    }
+
+    // Nothing on this chunk may be touched after the join is signaled, since
+    // the waiting fiber is then free to pop the stack frame it lives on.
+    ParallelForJoin* local_join = join;
+    std::lock_guard<std::mutex> lock(local_join->mutex);
+    --local_join->chunks_remaining;
+    if (local_join->chunks_remaining == 0) {
+      local_join->done_cond.notify_one();
+    }
+  }
+
+  ParallelForJoin* join;
+  const F* function;
+  T* items;
+  size_t first_index;
+  size_t size;
+};
+
+}  // namespace internal
+
+// Calls |function(index, item)| for each item in |items|, splitting the range
+// into contiguous chunks that are processed in parallel on |env|'s thread pool.
+// Each chunk will contain at least |grain_size| items, and there are never
+// more chunks than there are threads in the pool, so small ranges are simply
+// processed serially on the calling thread.  The calling thread processes the
+// first chunk itself and returns only after every item has been processed.
+// No heap allocations are made.
+template <typename T, typename F>
+void ParallelFor(Environment* env, stdext::span<T> items, size_t grain_size,
+                 const F& function) {
+  ThreadPool* thread_pool = &env->env()->thread_pool();
+
+  grain_size = std::max<size_t>(grain_size, 1);
+  size_t num_chunks = std::min(
+      std::min(kMaxParallelForChunks, thread_pool->num_threads()),
+      (items.size() + grain_size - 1) / grain_size);
+
+  if (num_chunks <= 1) {
+    for (size_t i = 0; i < items.size(); ++i) {
+      function(i, items[i]);
+    }
+    return;
+  }
+
+  using Chunk = internal::ParallelForChunk<T, F>;
+  internal::ParallelForJoin join(thread_pool, num_chunks);
+  Chunk chunks[kMaxParallelForChunks];
+  stdext::aligned_memory<ThreadPool::Task, kMaxParallelForChunks - 1>
+      tasks_memory;
+  ThreadPool::Task* tasks =
+      reinterpret_cast<ThreadPool::Task*>(tasks_memory.get());
+
+  // Distribute the items as evenly as possible, giving the remainder to the
+  // first few chunks.
+  size_t base_chunk_size = items.size() / num_chunks;
+  size_t remainder = items.size() % num_chunks;
+  size_t next_index = 0;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    Chunk* chunk = &chunks[i];
+    chunk->join = &join;
+    chunk->function = &function;
+    chunk->items = items.data() + next_index;
+    chunk->first_index = next_index;
+    chunk->size = base_chunk_size + (i < remainder ? 1 : 0);
+    next_index += chunk->size;
+  }
+
+  // Kick off all but the first chunk on the thread pool.  The lambdas capture
+  // only a single pointer so that std::function does not need to allocate.
+  for (size_t i = 1; i < num_chunks; ++i) {
+    Chunk* chunk = &chunks[i];
+    new (&tasks[i - 1]) ThreadPool::Task(thread_pool, [chunk]() {
+      chunk->Run();
+    });
+  }
+
+  chunks[0].Run();
+
+  {
+    std::unique_lock<std::mutex> lock(join.mutex);
+    while (join.chunks_remaining > 0) {
+      join.done_cond.wait(lock);
+    }
+  }
+
+  for (size_t i = 1; i < num_chunks; ++i) {
+    tasks[i - 1].ThreadPool::Task::~Task();
+  }
+}
+
+}  // namespace ebb
+
+#endif  // __EBB_PARALLEL_FOR_H__
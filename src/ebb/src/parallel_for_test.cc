@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "ebbpp.h"
+#include "parallel_for.h"
+
+class ParallelForTests : public ::testing::TestWithParam<int32_t> {};
+
+const size_t kFiberStackSize = 16 * 1024;
+
+TEST_P(ParallelForTests, VisitsEveryItemOnce) {
+  ebb::Environment env(GetParam(), kFiberStackSize);
+
+  const size_t kNumItems = 1000;
+  std::vector<int> items(kNumItems, 0);
+
+  ebb::ParallelFor(
+      &env, stdext::make_span(items.data(), items.size()), 1,
+      [](size_t index, int& item) {
+    item += static_cast<int>(index) + 1;
+  });
+
+  for (size_t i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(static_cast<int>(i) + 1, items[i]);
+  }
+}
+
+TEST_P(ParallelForTests, CanProcessEmptySpan) {
+  ebb::Environment env(GetParam(), kFiberStackSize);
+
+  int num_calls = 0;
+  ebb::ParallelFor(
+      &env, stdext::span<int>(nullptr, 0), 1,
+      [&num_calls](size_t, int&) { ++num_calls; });
+
+  EXPECT_EQ(0, num_calls);
+}
+
+TEST_P(ParallelForTests, SmallRangesRunOnCallingThread) {
+  ebb::Environment env(GetParam(), kFiberStackSize);
+
+  const size_t kNumItems = 10;
+  std::vector<std::thread::id> thread_ids(kNumItems);
+
+  // With a grain size larger than the range, there should only be a single
+  // chunk, which is processed on the calling thread.
+  ebb::ParallelFor(
+      &env, stdext::make_span(thread_ids.data(), thread_ids.size()),
+      kNumItems + 1, [](size_t, std::thread::id& thread_id) {
+    thread_id = std::this_thread::get_id();
+  });
+
+  for (const auto& thread_id : thread_ids) {
+    EXPECT_EQ(std::this_thread::get_id(), thread_id);
+  }
+}
+
+TEST_P(ParallelForTests, CanBeCalledFromWithinThreadPool) {
+  ebb::Environment env(GetParam(), kFiberStackSize);
+  ebb::QueueWithMemory<int, 1> queue(&env);
+
+  const size_t kNumItems = 500;
+  const int kNumPushes = 4;
+  std::atomic<int> total(0);
+
+  {
+    ebb::Consumer<int> consumer(&env, &queue, [&env, &total](int data) {
+      std::vector<int> items(kNumItems, data);
+      ebb::ParallelFor(
+          &env, stdext::make_span(items.data(), items.size()), 16,
+          [&total](size_t, int& item) { total += item; });
+    });
+
+    for (int i = 1; i <= kNumPushes; ++i) {
+      ebb::Push<int> push(&queue, i);
+    }
+  }  // Destructing the consumer should flush its queue.
+
+  EXPECT_EQ(static_cast<int>(kNumItems) * (1 + 2 + 3 + 4), total.load());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    WithDifferentThreadPoolsSizes, ParallelForTests, ::testing::Values(
+        1, 2, 8, 100));
@@ -5,7 +5,6 @@ import sys
 import respire.buildlib.cc as cc
 import respire.buildlib.cc_toolchains.discovery as cc_discovery
 import respire.buildlib.modules as modules
-import respire.buildlib.run_with_timestamp as run_with_timestamp
 
 def EntryPoint(registry, out_dir):
   toolchain = cc_discovery.DiscoverHostToolchain()
@@ -37,12 +36,24 @@ def Build(registry, out_dir, configured_toolchain, platform='host',
     platform_sources = [
       'platform/win32/context.cc',
       'platform/win32/file_system.cc',
+      'platform/win32/file_watcher.cc',
+      'platform/win32/jobserver.cc',
+      'platform/win32/piped_process.cc',
       'platform/win32/subprocess.cc',
+      'platform/win32/system_load.cc',
+      'platform/win32/tcp_connection.cc',
     ]
   elif platform == 'raspi' or 'linux' in platform or platform == 'jetson':
     platform_sources = [
       'platform/posix/context.cc',
+      'platform/posix/file_watcher.cc',
+      'platform/posix/jobserver.cc',
+      'platform/posix/piped_process.cc',
+      'platform/posix/spawn_server.cc',
+      'platform/posix/spawn_server.h',
       'platform/posix/subprocess.cc',
+      'platform/posix/system_load.cc',
+      'platform/posix/tcp_connection.cc',
       'platform/unix/file_system.cc',
     ]
 
@@ -51,7 +62,12 @@ def Build(registry, out_dir, configured_toolchain, platform='host',
       sources=[
         'platform/context.h',
         'platform/file_system.h',
+        'platform/file_watcher.h',
+        'platform/jobserver.h',
+        'platform/piped_process.h',
         'platform/subprocess.h',
+        'platform/system_load.h',
+        'platform/tcp_connection.h',
       ] + platform_sources,
       public_include_paths=['.'])
 
@@ -87,17 +103,20 @@ def Build(registry, out_dir, configured_toolchain, platform='host',
 
     run_stdext_tests_timestamp_file = os.path.join(
         out_dir, 'stdext_tests.timestamp')
-    registry.PythonFunction(
+    registry.SystemCommand(
         inputs=[stdext_tests.GetOutputFiles()[0]],
         outputs=[run_stdext_tests_timestamp_file],
-        function=run_with_timestamp.RunAndTimestampOnSuccess,
-        timestamp_file=run_stdext_tests_timestamp_file,
-        command=[stdext_tests.GetOutputFiles()[0]])
+        command=[stdext_tests.GetOutputFiles()[0]],
+        stamp_outputs=[run_stdext_tests_timestamp_file])
 
     platform_tests = modules.ExecutableModule(
         'platform_tests', registry, out_dir, configured_toolchain,
         sources = [
           'platform/context_test.cc',
+          'platform/file_operations_test.cc',
+          'platform/file_watcher_test.cc',
+          'platform/jobserver_test.cc',
+          'platform/piped_process_test.cc',
         ],
         module_dependencies=[
           platform_lib,
@@ -106,12 +125,11 @@ def Build(registry, out_dir, configured_toolchain, platform='host',
 
     run_platform_tests_timestamp_file = os.path.join(
         out_dir, 'platform_tests.timestamp')
-    registry.PythonFunction(
+    registry.SystemCommand(
         inputs=[platform_tests.GetOutputFiles()[0]],
         outputs=[run_platform_tests_timestamp_file],
-        function=run_with_timestamp.RunAndTimestampOnSuccess,
-        timestamp_file=run_platform_tests_timestamp_file,
-        command=[platform_tests.GetOutputFiles()[0]])
+        command=[platform_tests.GetOutputFiles()[0]],
+        stamp_outputs=[run_platform_tests_timestamp_file])
 
   output_modules = {'stdext_lib': stdext_lib}
   if googletest_modules:
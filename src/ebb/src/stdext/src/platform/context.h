@@ -2,6 +2,7 @@
 #define __PLATFORM_CONTEXT_H__
 
 #include <cassert>
+#include <cstddef>
 #include <functional>
 
 namespace platform {
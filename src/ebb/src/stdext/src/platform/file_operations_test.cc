@@ -0,0 +1,162 @@
+#include "platform/file_system.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+using platform::CopyRegularFile;
+using platform::FileStatus;
+using platform::GetFileStatus;
+using platform::GetLastModificationTime;
+using platform::GetLastModificationTimes;
+using platform::MakeDirectories;
+using platform::MakeTemporaryDirectory;
+using platform::RemoveDirectoryTree;
+using platform::TouchFile;
+
+namespace {
+class ScopedTemporaryDirectory {
+ public:
+  ScopedTemporaryDirectory() : path_(*MakeTemporaryDirectory()) {}
+  ~ScopedTemporaryDirectory() { RemoveDirectoryTree(path_.c_str()); }
+
+  std::string Join(const std::string& name) const {
+    return path_ + platform::kPathSeparator + name;
+  }
+
+ private:
+  std::string path_;
+};
+
+std::string ReadFile(const std::string& filepath) {
+  std::ifstream in(filepath, std::ios::binary);
+  std::ostringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+void WriteFile(const std::string& filepath, const std::string& contents) {
+  std::ofstream out(filepath, std::ios::binary);
+  out << contents;
+}
+}  // namespace
+
+TEST(FileOperationsTests, CopyRegularFileReplacesDestination) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string source = temp_dir.Join("source");
+  std::string destination = temp_dir.Join("destination");
+
+  std::string contents(200 * 1024, 'a');
+  contents += "end";
+  WriteFile(source, contents);
+  WriteFile(destination, "this will be replaced, and is longer than the source");
+
+  ASSERT_TRUE(CopyRegularFile(source.c_str(), destination.c_str()));
+  EXPECT_EQ(contents, ReadFile(destination));
+  EXPECT_EQ(contents, ReadFile(source));
+}
+
+TEST(FileOperationsTests, CopyRegularFileFailsForMissingSource) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string destination = temp_dir.Join("destination");
+
+  EXPECT_FALSE(CopyRegularFile(temp_dir.Join("missing").c_str(),
+                               destination.c_str()));
+  EXPECT_FALSE(GetLastModificationTime(destination.c_str()));
+}
+
+TEST(FileOperationsTests, TouchFileCreatesMissingFiles) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string filepath = temp_dir.Join("file");
+
+  ASSERT_TRUE(TouchFile(filepath.c_str()));
+  EXPECT_TRUE(GetLastModificationTime(filepath.c_str()));
+  EXPECT_EQ("", ReadFile(filepath));
+}
+
+TEST(FileOperationsTests, TouchFileKeepsContents) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string filepath = temp_dir.Join("file");
+  WriteFile(filepath, "contents");
+
+  ASSERT_TRUE(TouchFile(filepath.c_str()));
+  EXPECT_EQ("contents", ReadFile(filepath));
+}
+
+TEST(FileOperationsTests, MakeDirectoriesCreatesParents) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string parent = temp_dir.Join("a");
+  std::string directory =
+      parent + platform::kPathSeparator + "b" + platform::kPathSeparator + "c";
+
+  ASSERT_TRUE(MakeDirectories(directory.c_str()));
+  EXPECT_TRUE(GetLastModificationTime(directory.c_str()));
+
+  // Existing directories are fine.
+  EXPECT_TRUE(MakeDirectories(directory.c_str()));
+  EXPECT_TRUE(MakeDirectories(parent.c_str()));
+
+  // Files are not.
+  std::string filepath = temp_dir.Join("file");
+  WriteFile(filepath, "");
+  EXPECT_FALSE(MakeDirectories(filepath.c_str()));
+}
+
+TEST(FileOperationsTests, GetFileStatusDescribesFiles) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string foo = temp_dir.Join("foo");
+  std::string bar = temp_dir.Join("bar");
+  WriteFile(foo, "contents");
+  WriteFile(bar, "");
+
+  stdext::optional<FileStatus> foo_status = GetFileStatus(foo.c_str());
+  ASSERT_TRUE(foo_status);
+  EXPECT_EQ(8, foo_status->size);
+  EXPECT_EQ(*GetLastModificationTime(foo.c_str()),
+            foo_status->last_modification_time);
+
+  stdext::optional<FileStatus> bar_status = GetFileStatus(bar.c_str());
+  ASSERT_TRUE(bar_status);
+  EXPECT_EQ(0, bar_status->size);
+  EXPECT_NE(foo_status->id, bar_status->id);
+
+  EXPECT_FALSE(GetFileStatus(temp_dir.Join("missing").c_str()));
+}
+
+TEST(FileOperationsTests, GetLastModificationTimesMatchesSingleLookups) {
+  ScopedTemporaryDirectory temp_dir;
+  std::string sub_dir = temp_dir.Join("sub");
+  ASSERT_TRUE(MakeDirectories(sub_dir.c_str()));
+  std::string a = temp_dir.Join("a");
+  std::string b = temp_dir.Join("b");
+  std::string c = sub_dir + platform::kPathSeparator + "c";
+  WriteFile(a, "a");
+  WriteFile(b, "b");
+  WriteFile(c, "c");
+
+  // Runs of paths in the same directory, separated by others, along with
+  // missing files, missing directories and paths with no name part.
+  std::vector<std::string> paths = {
+      a, b, temp_dir.Join("missing"), c, sub_dir, a,
+      temp_dir.Join("missing_dir") + platform::kPathSeparator + "x",
+      temp_dir.Join("missing_dir") + platform::kPathSeparator + "y",
+      sub_dir + platform::kPathSeparator, c};
+  std::vector<const char*> filepaths;
+  for (const auto& path : paths) {
+    filepaths.push_back(path.c_str());
+  }
+  std::vector<stdext::optional<std::chrono::system_clock::time_point>> times(
+      paths.size());
+  GetLastModificationTimes(filepaths.data(), filepaths.size(), times.data());
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    EXPECT_TRUE(GetLastModificationTime(paths[i].c_str()) == times[i])
+        << paths[i];
+  }
+  EXPECT_TRUE(times[0]);
+  EXPECT_FALSE(times[2]);
+  EXPECT_FALSE(times[6]);
+  EXPECT_TRUE(times[8]);
+}
@@ -2,6 +2,7 @@
 #define __PLATFORM_FILE_SYSTEM_H__
 
 #include "stdext/optional.h"
+#include <stdint.h>
 #include <cassert>
 #include <chrono>
 #include <functional>
@@ -14,10 +15,47 @@ namespace platform {
 stdext::optional<::std::chrono::system_clock::time_point>
     GetLastModificationTime(const char* filepath);
 
+// Like GetLastModificationTime(), but for each of the |count| paths in
+// |filepaths|, storing the results in the corresponding elements of |times|.
+// Adjacent paths that share a parent directory are looked up relative to it,
+// so that the directory's own path is only resolved once for all of them.
+void GetLastModificationTimes(
+    const char* const* filepaths, size_t count,
+    stdext::optional<::std::chrono::system_clock::time_point>* times);
+
+// The parts of a file's metadata that, in practice, change whenever its
+// contents do.
+struct FileStatus {
+  // Identifies the file within its file system, e.g. its inode number.
+  uint64_t id;
+  uint64_t size;
+  ::std::chrono::system_clock::time_point last_modification_time;
+};
+
+// Returns the status of the file described in |filepath|, or nothing if it
+// does not exist.
+stdext::optional<FileStatus> GetFileStatus(const char* filepath);
+
 stdext::optional<::std::string> MakeTemporaryDirectory();
 
 bool RemoveDirectoryTree(const char* filepath);
 
+// Copies the regular file |source| to |destination|, replacing any existing
+// file there.  The copy gets |source|'s permissions, and the current time as
+// its modification time.  Where the file system allows it, the copy shares
+// its storage with |source| or is at least made without the data passing
+// through user space.
+bool CopyRegularFile(const char* source, const char* destination);
+
+// Creates an empty file at |filepath| if nothing exists there, otherwise sets
+// the modification time of the existing file or directory to the current time
+// without changing its contents.
+bool TouchFile(const char* filepath);
+
+// Creates the directory |filepath| and any of its missing parents.  Succeeds
+// if the directory already exists.
+bool MakeDirectories(const char* filepath);
+
 // Returns the path of the executable file that spawned this process.
 std::string GetThisModulePath();
 
@@ -0,0 +1,55 @@
+#ifndef __PLATFORM_FILE_WATCHER_H__
+#define __PLATFORM_FILE_WATCHER_H__
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace platform {
+
+// Watches a set of directories for changes to the files directly within them,
+// using the operating system's change notifications (e.g. inotify) rather than
+// polling.
+class FileWatcher {
+ public:
+  // Returns null if change notifications aren't supported on this platform,
+  // or if they couldn't be set up.
+  static std::unique_ptr<FileWatcher> Create();
+  ~FileWatcher();
+
+  // Starts watching the directory |path|, if it isn't already being watched.
+  // An empty |path| is the current directory.  Returns false if it couldn't be
+  // watched, e.g. because it doesn't exist.
+  bool AddDirectory(const std::string& path);
+
+  struct Changes {
+    // The paths of the files that changed, each formed by joining the path
+    // given to AddDirectory() and the file's name with a "/" (or just the
+    // file's name, for the current directory), in no particular order and
+    // possibly with duplicates.
+    std::vector<std::string> paths;
+    // True if some changes may have been missed, e.g. because too many
+    // happened at once or a watched directory was itself removed, in which
+    // case anything under watch may have changed.
+    bool overflowed;
+  };
+
+  // Blocks until at least one change is seen, then keeps collecting changes
+  // until none have been seen for |quiet_period|, so that a burst of changes
+  // (e.g. from an editor saving several files, or a version control checkout)
+  // is returned together.
+  Changes WaitForChanges(std::chrono::milliseconds quiet_period);
+
+  // Opaque platform specific state.
+  struct PlatformData;
+
+ private:
+  explicit FileWatcher(std::unique_ptr<PlatformData> platform_data);
+
+  std::unique_ptr<PlatformData> platform_data_;
+};
+
+}  // namespace platform
+
+#endif  // __PLATFORM_FILE_WATCHER_H__
@@ -0,0 +1,92 @@
+#include "platform/file_watcher.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "platform/file_system.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+using platform::FileWatcher;
+
+#if defined(__linux__)
+
+namespace {
+const std::chrono::milliseconds kQuietPeriod(50);
+
+class FileWatcherTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto temp_directory = platform::MakeTemporaryDirectory();
+    ASSERT_TRUE(temp_directory);
+    directory_ = *temp_directory;
+  }
+  void TearDown() override {
+    platform::RemoveDirectoryTree(directory_.c_str());
+  }
+
+  std::string PathTo(const std::string& name) const {
+    return directory_ + "/" + name;
+  }
+
+  void WriteFile(const std::string& name, const std::string& contents) {
+    std::ofstream out(PathTo(name).c_str());
+    out << contents;
+  }
+
+  std::string directory_;
+};
+
+bool Contains(const FileWatcher::Changes& changes, const std::string& path) {
+  return std::find(changes.paths.begin(), changes.paths.end(), path) !=
+             changes.paths.end();
+}
+}  // namespace
+
+TEST_F(FileWatcherTests, ReportsChangedFiles) {
+  WriteFile("foo.txt", "foo");
+  auto watcher = FileWatcher::Create();
+  ASSERT_TRUE(watcher);
+  ASSERT_TRUE(watcher->AddDirectory(directory_));
+
+  WriteFile("foo.txt", "bar");
+  FileWatcher::Changes changes = watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_FALSE(changes.overflowed);
+  EXPECT_TRUE(Contains(changes, PathTo("foo.txt")));
+
+  // Creations and removals are changes too, and changes made together are
+  // reported together.
+  WriteFile("bar.txt", "bar");
+  std::remove(PathTo("foo.txt").c_str());
+  changes = watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_FALSE(changes.overflowed);
+  EXPECT_TRUE(Contains(changes, PathTo("bar.txt")));
+  EXPECT_TRUE(Contains(changes, PathTo("foo.txt")));
+}
+
+TEST_F(FileWatcherTests, ReportsPathsAsTheyWereAdded) {
+  auto watcher = FileWatcher::Create();
+  ASSERT_TRUE(watcher);
+  ASSERT_TRUE(watcher->AddDirectory(directory_));
+  ASSERT_TRUE(watcher->AddDirectory(directory_ + "/."));
+  // Adding the same path again doesn't duplicate its changes.
+  ASSERT_TRUE(watcher->AddDirectory(directory_));
+
+  WriteFile("foo.txt", "foo");
+  FileWatcher::Changes changes = watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_TRUE(Contains(changes, PathTo("foo.txt")));
+  EXPECT_TRUE(Contains(changes, PathTo("./foo.txt")));
+}
+
+TEST_F(FileWatcherTests, RemovingAWatchedDirectoryOverflows) {
+  std::string subdirectory = PathTo("sub");
+  ASSERT_TRUE(platform::MakeDirectories(subdirectory.c_str()));
+  auto watcher = FileWatcher::Create();
+  ASSERT_TRUE(watcher);
+  ASSERT_TRUE(watcher->AddDirectory(subdirectory));
+  EXPECT_FALSE(watcher->AddDirectory(PathTo("missing")));
+
+  ASSERT_TRUE(platform::RemoveDirectoryTree(subdirectory.c_str()));
+  EXPECT_TRUE(watcher->WaitForChanges(kQuietPeriod).overflowed);
+}
+
+#endif  // defined(__linux__)
@@ -0,0 +1,77 @@
+#ifndef __PLATFORM_JOBSERVER_H__
+#define __PLATFORM_JOBSERVER_H__
+
+#include <memory>
+#include <string>
+
+#include "stdext/optional.h"
+
+namespace platform {
+
+// A connection to a GNU make compatible jobserver, through which cooperating
+// processes share a fixed budget of simultaneous jobs.  Each process gets one
+// job implicitly, and must acquire a token from the jobserver for each
+// additional job it wants to run at the same time, returning the token when
+// the job completes.
+class Jobserver {
+ public:
+  enum class Style {
+    // An anonymous pipe whose file descriptors are inherited by children.
+    // Understood by GNU make 4.2+ and most other jobserver clients.
+    Pipe,
+    // A named fifo that children open by path, supported by GNU make 4.4+.
+    Fifo,
+  };
+
+  // Connects to the jobserver described by the contents of the MAKEFLAGS
+  // environment variable, |makeflags|.  Returns null if there is no jobserver
+  // described, or if it is not accessible from this process.
+  static std::unique_ptr<Jobserver> ConnectFromMakeflags(
+      const char* makeflags);
+
+  // Creates a new jobserver holding |num_tokens| tokens.  Since each process
+  // has an implicit token, this should be one less than the total number of
+  // jobs that may run at once.  Returns null on failure.
+  static std::unique_ptr<Jobserver> Create(int num_tokens, Style style);
+
+  ~Jobserver();
+
+  // Blocks until a token is available and returns it, or returns a
+  // disengaged optional if the jobserver failed or CancelAcquire() was called.
+  stdext::optional<char> AcquireToken();
+
+  // Causes any current and all future calls to AcquireToken() to return
+  // immediately.  May be called from any thread.
+  void CancelAcquire();
+
+  // Returns a token previously obtained from AcquireToken().
+  void ReleaseToken(char token);
+
+  // For a jobserver connected to through MAKEFLAGS, the total number of jobs
+  // that the jobserver's owner allows at once, if it said, e.g. 16 for
+  // "make -j16".
+  const stdext::optional<int>& job_limit() const { return job_limit_; }
+
+  // The flags that should be appended to MAKEFLAGS in the environment of child
+  // processes in order for them to share this jobserver.
+  const std::string& makeflags() const { return makeflags_; }
+
+  // Appends makeflags() to the MAKEFLAGS environment variable of this
+  // process, so that all children launched afterwards share this jobserver.
+  void ExportToEnvironment() const;
+
+  // Opaque platform specific state.
+  struct PlatformData;
+
+ private:
+  Jobserver(std::unique_ptr<PlatformData> platform_data,
+            const std::string& makeflags);
+
+  std::unique_ptr<PlatformData> platform_data_;
+  std::string makeflags_;
+  stdext::optional<int> job_limit_;
+};
+
+}  // namespace platform
+
+#endif  // __PLATFORM_JOBSERVER_H__
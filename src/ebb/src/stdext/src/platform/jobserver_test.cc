@@ -0,0 +1,85 @@
+#include "platform/jobserver.h"
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+using platform::Jobserver;
+
+#if !defined(_WIN32)
+
+class JobserverTests : public ::testing::TestWithParam<Jobserver::Style> {};
+
+TEST_P(JobserverTests, CreatedJobserverHandsOutItsTokens) {
+  auto jobserver = Jobserver::Create(2, GetParam());
+  ASSERT_TRUE(jobserver);
+  EXPECT_NE(std::string::npos, jobserver->makeflags().find("-j3"));
+
+  auto first = jobserver->AcquireToken();
+  auto second = jobserver->AcquireToken();
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(second);
+
+  jobserver->ReleaseToken(*first);
+  auto third = jobserver->AcquireToken();
+  ASSERT_TRUE(third);
+  EXPECT_EQ(*first, *third);
+}
+
+TEST_P(JobserverTests, CanConnectThroughMakeflags) {
+  auto server = Jobserver::Create(1, GetParam());
+  ASSERT_TRUE(server);
+
+  std::string makeflags = "-k " + server->makeflags();
+  auto client = Jobserver::ConnectFromMakeflags(makeflags.c_str());
+  ASSERT_TRUE(client);
+  // Clients do not export a jobserver of their own.
+  EXPECT_TRUE(client->makeflags().empty());
+
+  // The single token is shared between the server and the client.
+  auto token = client->AcquireToken();
+  ASSERT_TRUE(token);
+  client->ReleaseToken(*token);
+  EXPECT_TRUE(server->AcquireToken());
+}
+
+TEST_P(JobserverTests, ConnectedJobserverReportsItsJobLimit) {
+  auto server = Jobserver::Create(2, GetParam());
+  ASSERT_TRUE(server);
+  EXPECT_FALSE(server->job_limit());
+
+  auto client = Jobserver::ConnectFromMakeflags(server->makeflags().c_str());
+  ASSERT_TRUE(client);
+  ASSERT_TRUE(client->job_limit());
+  EXPECT_EQ(3, *client->job_limit());
+
+  // Only the jobserver option is required.
+  std::string auth = server->makeflags().substr(
+      server->makeflags().find("--jobserver-auth="));
+  client = Jobserver::ConnectFromMakeflags(("-k " + auth).c_str());
+  ASSERT_TRUE(client);
+  EXPECT_FALSE(client->job_limit());
+}
+
+TEST_P(JobserverTests, CancelAcquireUnblocksAcquireToken) {
+  auto jobserver = Jobserver::Create(0, GetParam());
+  ASSERT_TRUE(jobserver);
+
+  jobserver->CancelAcquire();
+  EXPECT_FALSE(jobserver->AcquireToken());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    WithEachStyle, JobserverTests, ::testing::Values(
+        Jobserver::Style::Pipe, Jobserver::Style::Fifo));
+
+TEST(JobserverTests, NoJobserverInMakeflags) {
+  EXPECT_FALSE(Jobserver::ConnectFromMakeflags(nullptr));
+  EXPECT_FALSE(Jobserver::ConnectFromMakeflags(""));
+  EXPECT_FALSE(Jobserver::ConnectFromMakeflags("-k -j4"));
+}
+
+TEST(JobserverTests, InaccessiblePipeIsIgnored) {
+  // Descriptors that aren't open in this process can't be used.
+  EXPECT_FALSE(Jobserver::ConnectFromMakeflags("--jobserver-auth=900,901"));
+}
+
+#endif  // !defined(_WIN32)
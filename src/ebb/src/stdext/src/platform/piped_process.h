@@ -0,0 +1,43 @@
+#ifndef __PLATFORM_PIPED_PROCESS_H__
+#define __PLATFORM_PIPED_PROCESS_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace platform {
+
+// A long-lived child process that we communicate with over its stdin and
+// stdout.  The child's stderr is discarded, since anything it writes there
+// would otherwise be interleaved with our own output.
+class PipedProcess {
+ public:
+  // Starts the program |argv[0]| (searched for in the PATH) with the
+  // arguments |argv|.  Returns null if the process could not be started.
+  static std::unique_ptr<PipedProcess> Start(
+      const std::vector<std::string>& argv);
+
+  // Closes the child's stdin, which it should take as a signal to exit, and
+  // waits briefly for it to do so before killing it.
+  ~PipedProcess();
+
+  // Writes all of |data| to the child's stdin.  Returns false if the child
+  // has gone away.
+  bool Write(const char* data, size_t size);
+
+  // Blocks until exactly |size| bytes have been read from the child's stdout.
+  // Returns false if the child closes its stdout or exits first.
+  bool Read(char* data, size_t size);
+
+  // Opaque platform specific state.
+  struct PlatformData;
+
+ private:
+  PipedProcess(std::unique_ptr<PlatformData> platform_data);
+
+  std::unique_ptr<PlatformData> platform_data_;
+};
+
+}  // namespace platform
+
+#endif  // __PLATFORM_PIPED_PROCESS_H__
@@ -0,0 +1,50 @@
+#include "platform/piped_process.h"
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+using platform::PipedProcess;
+
+#if !defined(_WIN32)
+
+TEST(PipedProcessTests, CanTalkToChild) {
+  auto process = PipedProcess::Start({"cat"});
+  ASSERT_TRUE(process);
+
+  // The child stays alive across multiple exchanges.
+  for (int i = 0; i < 3; ++i) {
+    const std::string kMessage("hello");
+    ASSERT_TRUE(process->Write(kMessage.data(), kMessage.size()));
+
+    char buffer[5];
+    ASSERT_TRUE(process->Read(buffer, sizeof(buffer)));
+    EXPECT_EQ(kMessage, std::string(buffer, sizeof(buffer)));
+  }
+}
+
+TEST(PipedProcessTests, ReadFailsOnceChildExits) {
+  auto process = PipedProcess::Start({"sh", "-c", "printf ab"});
+  ASSERT_TRUE(process);
+
+  char buffer[4];
+  EXPECT_FALSE(process->Read(buffer, sizeof(buffer)));
+}
+
+TEST(PipedProcessTests, WriteFailsOnceChildExits) {
+  auto process = PipedProcess::Start({"true"});
+  ASSERT_TRUE(process);
+
+  // Wait for the child to go away.
+  char buffer[1];
+  EXPECT_FALSE(process->Read(buffer, sizeof(buffer)));
+
+  // This must fail rather than raising SIGPIPE.
+  const std::string kMessage("hello");
+  EXPECT_FALSE(process->Write(kMessage.data(), kMessage.size()));
+}
+
+TEST(PipedProcessTests, StartFailsForMissingProgram) {
+  EXPECT_FALSE(PipedProcess::Start({"/this/program/does/not/exist"}));
+  EXPECT_FALSE(PipedProcess::Start({}));
+}
+
+#endif  // !defined(_WIN32)
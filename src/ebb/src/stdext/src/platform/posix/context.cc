@@ -1,5 +1,6 @@
 #include "platform/context.h"
 
+#include <stdlib.h>
 #include <ucontext.h>
 
 namespace platform {
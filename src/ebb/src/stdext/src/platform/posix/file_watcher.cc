@@ -0,0 +1,162 @@
+#include "platform/file_watcher.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace platform {
+
+#if defined(__linux__)
+
+namespace {
+const uint32_t kWatchMask =
+    IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+// Returns true if |fd| became readable within |timeout_ms|, or immediately if
+// it is negative.
+bool WaitForReadable(int fd, int timeout_ms) {
+  struct pollfd poll_fd = {fd, POLLIN, 0};
+  while (true) {
+    int result = poll(&poll_fd, 1, timeout_ms);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    return result > 0;
+  }
+}
+}  // namespace
+
+struct FileWatcher::PlatformData {
+  explicit PlatformData(int fd) : inotify_fd(fd), buffer(64 * 1024) {}
+  ~PlatformData() { close(inotify_fd); }
+
+  // Reads all of the events that are currently queued into |changes|.
+  void ReadEvents(Changes* changes);
+
+  int inotify_fd;
+  // The paths that were given to AddDirectory() for each watch.  Different
+  // paths to the same directory share a watch.
+  std::unordered_map<int, std::vector<std::string>> directories;
+  std::vector<char> buffer;
+};
+
+void FileWatcher::PlatformData::ReadEvents(Changes* changes) {
+  while (true) {
+    ssize_t size = read(inotify_fd, buffer.data(), buffer.size());
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      // EAGAIN, since the descriptor is non-blocking and we've read
+      // everything.
+      return;
+    }
+
+    for (const char* position = buffer.data();
+         position < buffer.data() + size;) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(position);
+      position += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF |
+                         IN_IGNORED)) {
+        changes->overflowed = true;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+      auto found = directories.find(event->wd);
+      if (found == directories.end()) {
+        continue;
+      }
+      for (const std::string& directory : found->second) {
+        changes->paths.push_back(
+            directory.empty() ? std::string(event->name)
+                              : directory + "/" + event->name);
+      }
+    }
+  }
+}
+
+// static
+std::unique_ptr<FileWatcher> FileWatcher::Create() {
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  return std::unique_ptr<FileWatcher>(
+      new FileWatcher(std::unique_ptr<PlatformData>(new PlatformData(fd))));
+}
+
+bool FileWatcher::AddDirectory(const std::string& path) {
+  int wd = inotify_add_watch(platform_data_->inotify_fd,
+                             path.empty() ? "." : path.c_str(),
+                             kWatchMask | IN_ONLYDIR);
+  if (wd < 0) {
+    return false;
+  }
+  std::vector<std::string>& directories = platform_data_->directories[wd];
+  if (std::find(directories.begin(), directories.end(), path) ==
+          directories.end()) {
+    directories.push_back(path);
+  }
+  return true;
+}
+
+FileWatcher::Changes FileWatcher::WaitForChanges(
+    std::chrono::milliseconds quiet_period) {
+  Changes changes;
+  changes.overflowed = false;
+  int fd = platform_data_->inotify_fd;
+  while (changes.paths.empty() && !changes.overflowed) {
+    if (!WaitForReadable(fd, -1)) {
+      // Something is wrong with the inotify descriptor itself, so we can no
+      // longer tell what changed.
+      changes.overflowed = true;
+      return changes;
+    }
+    platform_data_->ReadEvents(&changes);
+  }
+  while (WaitForReadable(fd, static_cast<int>(quiet_period.count()))) {
+    platform_data_->ReadEvents(&changes);
+  }
+  return changes;
+}
+
+#else
+
+struct FileWatcher::PlatformData {};
+
+// static
+std::unique_ptr<FileWatcher> FileWatcher::Create() {
+  // Only inotify is supported for now.
+  return nullptr;
+}
+
+bool FileWatcher::AddDirectory(const std::string& path) {
+  return false;
+}
+
+FileWatcher::Changes FileWatcher::WaitForChanges(
+    std::chrono::milliseconds quiet_period) {
+  Changes changes;
+  changes.overflowed = true;
+  return changes;
+}
+
+#endif
+
+FileWatcher::FileWatcher(std::unique_ptr<PlatformData> platform_data)
+    : platform_data_(std::move(platform_data)) {}
+
+FileWatcher::~FileWatcher() {}
+
+}  // namespace platform
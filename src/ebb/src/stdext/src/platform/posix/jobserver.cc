@@ -0,0 +1,327 @@
+#include "platform/jobserver.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <sstream>
+
+#include "platform/file_system.h"
+
+namespace platform {
+
+struct Jobserver::PlatformData {
+  PlatformData()
+      : read_fd(-1), owns_read_fd(false), write_fd(-1), owns_write_fd(false),
+        inherited_read_fd(-1) {
+    cancel_fds[0] = -1;
+    cancel_fds[1] = -1;
+  }
+
+  ~PlatformData() {
+    if (owns_read_fd) close(read_fd);
+    if (owns_write_fd) close(write_fd);
+    if (inherited_read_fd != -1) close(inherited_read_fd);
+    if (cancel_fds[0] != -1) close(cancel_fds[0]);
+    if (cancel_fds[1] != -1) close(cancel_fds[1]);
+    if (!fifo_directory.empty()) {
+      RemoveDirectoryTree(fifo_directory.c_str());
+    }
+  }
+
+  // Tokens are read from |read_fd| and written back to |write_fd|, which may
+  // be the same descriptor.
+  int read_fd;
+  bool owns_read_fd;
+  int write_fd;
+  bool owns_write_fd;
+  // If we created a pipe, the read end that children inherit, if it is not
+  // also |read_fd|.
+  int inherited_read_fd;
+
+  // Written to in order to wake up and cancel AcquireToken().
+  int cancel_fds[2];
+
+  // If we created a fifo, the temporary directory that contains it.
+  std::string fifo_directory;
+};
+
+namespace {
+// Returns a new non-blocking file description for the pipe read end |fd|, so
+// that we can poll and read from it without risking blocking if another
+// process grabs the token first, and without changing the blocking mode of the
+// file description that is shared with other processes.  Returns -1 if this
+// isn't possible.
+int ReopenNonBlocking(int fd) {
+#if defined(__linux__)
+  std::ostringstream proc_path;
+  proc_path << "/proc/self/fd/" << fd;
+  return open(proc_path.str().c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+#else
+  return -1;
+#endif
+}
+
+bool IsValidFileDescriptor(int fd) {
+  return fd >= 0 && fcntl(fd, F_GETFD) != -1;
+}
+
+bool WriteTokens(int fd, int num_tokens) {
+  for (int i = 0; i < num_tokens; ++i) {
+    char token = '+';
+    while (write(fd, &token, 1) != 1) {
+      if (errno != EINTR) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Sets up the read side of |data| given the pipe read end |fd|, which we do not
+// own.
+void SetReadPipe(Jobserver::PlatformData* data, int fd) {
+  int reopened_fd = ReopenNonBlocking(fd);
+  if (reopened_fd != -1) {
+    data->read_fd = reopened_fd;
+    data->owns_read_fd = true;
+  } else {
+    // Fall back to blocking reads on the shared file description.
+    data->read_fd = fd;
+  }
+}
+
+bool CreateCancelPipe(Jobserver::PlatformData* data) {
+  if (pipe(data->cancel_fds) != 0) {
+    return false;
+  }
+  fcntl(data->cancel_fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(data->cancel_fds[1], F_SETFD, FD_CLOEXEC);
+  return true;
+}
+
+// Returns the value of the last jobserver option in |makeflags|, since that is
+// the one that takes effect.
+std::string FindJobserverAuth(const char* makeflags) {
+  static const char* kAuthPrefixes[] = {
+    "--jobserver-auth=",
+    // Used by versions of GNU make before 4.2.
+    "--jobserver-fds=",
+  };
+
+  std::string auth;
+  std::istringstream words(makeflags);
+  std::string word;
+  while (words >> word) {
+    for (const char* prefix : kAuthPrefixes) {
+      size_t prefix_length = strlen(prefix);
+      if (word.compare(0, prefix_length, prefix) == 0) {
+        auth = word.substr(prefix_length);
+      }
+    }
+  }
+  return auth;
+}
+
+// Returns the value of the last "-jN" option in |makeflags|, if there is one.
+stdext::optional<int> FindJobLimit(const char* makeflags) {
+  stdext::optional<int> job_limit;
+  std::istringstream words(makeflags);
+  std::string word;
+  while (words >> word) {
+    int jobs;
+    char trailing;
+    if (word.compare(0, 2, "-j") == 0 &&
+        sscanf(word.c_str() + 2, "%d%c", &jobs, &trailing) == 1 &&
+        jobs > 0) {
+      job_limit.emplace(jobs);
+    }
+  }
+  return job_limit;
+}
+}  // namespace
+
+Jobserver::Jobserver(std::unique_ptr<PlatformData> platform_data,
+                     const std::string& makeflags)
+    : platform_data_(std::move(platform_data)), makeflags_(makeflags) {}
+
+Jobserver::~Jobserver() {}
+
+// static
+std::unique_ptr<Jobserver> Jobserver::ConnectFromMakeflags(
+    const char* makeflags) {
+  if (!makeflags) {
+    return nullptr;
+  }
+
+  std::string auth = FindJobserverAuth(makeflags);
+  if (auth.empty()) {
+    return nullptr;
+  }
+
+  std::unique_ptr<PlatformData> data(new PlatformData());
+  if (!CreateCancelPipe(data.get())) {
+    return nullptr;
+  }
+
+  const std::string kFifoPrefix("fifo:");
+  if (auth.compare(0, kFifoPrefix.size(), kFifoPrefix) == 0) {
+    std::string fifo_path = auth.substr(kFifoPrefix.size());
+    int fd = open(fifo_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+      return nullptr;
+    }
+    data->read_fd = fd;
+    data->owns_read_fd = true;
+    data->write_fd = fd;
+  } else {
+    int read_fd;
+    int write_fd;
+    if (sscanf(auth.c_str(), "%d,%d", &read_fd, &write_fd) != 2) {
+      return nullptr;
+    }
+    // If our parent didn't consider us to be a sub-make, it will not have
+    // passed the pipe down to us.
+    if (!IsValidFileDescriptor(read_fd) || !IsValidFileDescriptor(write_fd)) {
+      return nullptr;
+    }
+    SetReadPipe(data.get(), read_fd);
+    data->write_fd = write_fd;
+  }
+
+  // We're not a jobserver ourselves, so children should just connect to the
+  // same one that we did, which they will find in the inherited MAKEFLAGS.
+  std::unique_ptr<Jobserver> jobserver(new Jobserver(std::move(data), ""));
+  jobserver->job_limit_ = FindJobLimit(makeflags);
+  return jobserver;
+}
+
+// static
+std::unique_ptr<Jobserver> Jobserver::Create(int num_tokens, Style style) {
+  std::unique_ptr<PlatformData> data(new PlatformData());
+  if (!CreateCancelPipe(data.get())) {
+    return nullptr;
+  }
+
+  std::ostringstream makeflags;
+  makeflags << "-j" << (num_tokens + 1) << " --jobserver-auth=";
+
+  switch (style) {
+    case Style::Pipe: {
+      // Note that the pipe is deliberately not close-on-exec, so that children
+      // inherit it.
+      int pipe_fds[2];
+      if (pipe(pipe_fds) != 0) {
+        return nullptr;
+      }
+      data->write_fd = pipe_fds[1];
+      data->owns_write_fd = true;
+      int reopened_fd = ReopenNonBlocking(pipe_fds[0]);
+      if (reopened_fd != -1) {
+        // We keep the original read end open for our children to use.
+        data->read_fd = reopened_fd;
+        data->owns_read_fd = true;
+        data->inherited_read_fd = pipe_fds[0];
+      } else {
+        data->read_fd = pipe_fds[0];
+        data->owns_read_fd = true;
+      }
+      makeflags << pipe_fds[0] << "," << pipe_fds[1];
+    } break;
+    case Style::Fifo: {
+      stdext::optional<std::string> directory = MakeTemporaryDirectory();
+      if (!directory) {
+        return nullptr;
+      }
+      data->fifo_directory = *directory;
+      std::string fifo_path = *directory + kPathSeparator + "jobserver";
+      if (mkfifo(fifo_path.c_str(), 0600) != 0) {
+        return nullptr;
+      }
+      int fd = open(fifo_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+      if (fd == -1) {
+        return nullptr;
+      }
+      data->read_fd = fd;
+      data->owns_read_fd = true;
+      data->write_fd = fd;
+      makeflags << "fifo:" << fifo_path;
+    } break;
+  }
+
+  if (!WriteTokens(data->write_fd, num_tokens)) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<Jobserver>(
+      new Jobserver(std::move(data), makeflags.str()));
+}
+
+stdext::optional<char> Jobserver::AcquireToken() {
+  while (true) {
+    struct pollfd poll_fds[2];
+    poll_fds[0].fd = platform_data_->read_fd;
+    poll_fds[0].events = POLLIN;
+    poll_fds[1].fd = platform_data_->cancel_fds[0];
+    poll_fds[1].events = POLLIN;
+    if (poll(poll_fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return stdext::nullopt;
+    }
+
+    if (poll_fds[1].revents != 0) {
+      return stdext::nullopt;
+    }
+    if (poll_fds[0].revents & (POLLERR | POLLNVAL)) {
+      return stdext::nullopt;
+    }
+
+    char token;
+    ssize_t num_read = read(platform_data_->read_fd, &token, 1);
+    if (num_read == 1) {
+      return token;
+    }
+    if (num_read == 0) {
+      // Every writer has gone away, so no token will ever arrive.
+      return stdext::nullopt;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      return stdext::nullopt;
+    }
+    // Another process must have taken the token first, try again.
+  }
+}
+
+void Jobserver::CancelAcquire() {
+  char signal = 0;
+  ssize_t written = write(platform_data_->cancel_fds[1], &signal, 1);
+  (void)written;
+}
+
+void Jobserver::ExportToEnvironment() const {
+  if (makeflags_.empty()) {
+    return;
+  }
+  const char* existing_makeflags = getenv("MAKEFLAGS");
+  std::string makeflags = existing_makeflags && *existing_makeflags ?
+      std::string(existing_makeflags) + " " + makeflags_ : makeflags_;
+  setenv("MAKEFLAGS", makeflags.c_str(), 1);
+}
+
+void Jobserver::ReleaseToken(char token) {
+  while (write(platform_data_->write_fd, &token, 1) != 1) {
+    if (errno != EINTR && errno != EAGAIN) {
+      return;
+    }
+  }
+}
+
+}  // namespace platform
@@ -0,0 +1,161 @@
+#include "platform/piped_process.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+extern char** environ;
+
+namespace platform {
+
+namespace {
+// How long a child has to exit on its own after its stdin is closed, before
+// it is killed.
+const std::chrono::seconds kExitGracePeriod(1);
+const std::chrono::milliseconds kExitPollInterval(10);
+}  // namespace
+
+struct PipedProcess::PlatformData {
+  PlatformData() : pid(-1), fd(-1) {}
+
+  ~PlatformData() {
+    if (fd != -1) {
+      close(fd);
+    }
+    if (pid == -1) {
+      return;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + kExitGracePeriod;
+    while (true) {
+      pid_t result = waitpid(pid, nullptr, WNOHANG);
+      if (result == pid || (result == -1 && errno != EINTR)) {
+        return;
+      }
+      if (std::chrono::steady_clock::now() >= deadline) {
+        break;
+      }
+      std::this_thread::sleep_for(kExitPollInterval);
+    }
+    kill(pid, SIGKILL);
+    while (waitpid(pid, nullptr, 0) == -1 && errno == EINTR) {}
+  }
+
+  pid_t pid;
+  // One end of a socket pair that serves as both the child's stdin and its
+  // stdout.  A socket is used instead of a pair of pipes so that we can write
+  // to it without risking SIGPIPE.
+  int fd;
+};
+
+PipedProcess::PipedProcess(std::unique_ptr<PlatformData> platform_data)
+    : platform_data_(std::move(platform_data)) {}
+
+PipedProcess::~PipedProcess() {}
+
+// static
+std::unique_ptr<PipedProcess> PipedProcess::Start(
+    const std::vector<std::string>& argv) {
+  if (argv.empty()) {
+    return nullptr;
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    return nullptr;
+  }
+  // Neither end should leak into other children, the child's end is dup'd
+  // onto its stdin and stdout (which clears the flag) as it is spawned.
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+  std::unique_ptr<PlatformData> data(new PlatformData());
+  data->fd = fds[0];
+
+  std::vector<const char*> spawned_args;
+  spawned_args.reserve(argv.size() + 1);
+  for (const auto& arg : argv) {
+    spawned_args.push_back(arg.c_str());
+  }
+  spawned_args.push_back(NULL);
+  char** spawned_argv = const_cast<char**>(spawned_args.data());
+
+  posix_spawn_file_actions_t child_fd_actions;
+  if (posix_spawn_file_actions_init(&child_fd_actions) != 0) {
+    close(fds[1]);
+    return nullptr;
+  }
+  posix_spawnattr_t child_attributes;
+  if (posix_spawnattr_init(&child_attributes) != 0) {
+    posix_spawn_file_actions_destroy(&child_fd_actions);
+    close(fds[1]);
+    return nullptr;
+  }
+  sigset_t empty_mask;
+  sigemptyset(&empty_mask);
+  posix_spawnattr_setsigmask(&child_attributes, &empty_mask);
+  posix_spawnattr_setflags(&child_attributes, POSIX_SPAWN_SETSIGMASK);
+
+  pid_t child_pid = -1;
+  if (posix_spawn_file_actions_adddup2(&child_fd_actions, fds[1], 0) != 0 ||
+      posix_spawn_file_actions_adddup2(&child_fd_actions, fds[1], 1) != 0 ||
+      posix_spawn_file_actions_addopen(
+          &child_fd_actions, 2, "/dev/null", O_WRONLY, 0) != 0 ||
+      posix_spawnp(&child_pid, spawned_argv[0], &child_fd_actions,
+                   &child_attributes, spawned_argv, environ) != 0) {
+    child_pid = -1;
+  }
+  close(fds[1]);
+  posix_spawnattr_destroy(&child_attributes);
+  posix_spawn_file_actions_destroy(&child_fd_actions);
+
+  if (child_pid == -1) {
+    return nullptr;
+  }
+  data->pid = child_pid;
+
+  return std::unique_ptr<PipedProcess>(new PipedProcess(std::move(data)));
+}
+
+bool PipedProcess::Write(const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = send(platform_data_->fd, data, size, MSG_NOSIGNAL);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool PipedProcess::Read(char* data, size_t size) {
+  while (size > 0) {
+    ssize_t num_read = read(platform_data_->fd, data, size);
+    if (num_read == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (num_read == 0) {
+      return false;
+    }
+    data += num_read;
+    size -= num_read;
+  }
+  return true;
+}
+
+}  // namespace platform
@@ -0,0 +1,519 @@
+#include "platform/posix/spawn_server.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/signalfd.h>
+#endif
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace platform {
+
+namespace {
+
+// Messages sent in both directions over the spawn server's socket are
+// prefixed by their size, so that they can be read back out of the stream.
+//
+// Requests:  [uint64 id][command][uint8 has_argv][uint32 argc][argv strings]
+//            [optional stdout path][optional stderr path][optional stdin path]
+//            [optional int64 timeout in milliseconds]
+//            [uint8 capture_stdout][uint8 capture_stderr]
+// Responses: [uint64 id][int32 exit status][rusage][uint8 timed_out]
+//            [stdout output][stderr output]
+//
+// Strings are encoded as a uint32 length followed by their characters, and
+// optionals as a uint8 presence flag followed by their value if present.
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    // Avoid being killed by SIGPIPE if the other end has gone away.
+    ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t num_read = read(fd, data, size);
+    if (num_read == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (num_read == 0) {
+      return false;
+    }
+    data += num_read;
+    size -= num_read;
+  }
+  return true;
+}
+
+class MessageWriter {
+ public:
+  MessageWriter() : buffer_(sizeof(uint32_t), '\0') {}
+
+  template <typename T>
+  void Write(T value) {
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void WriteString(const std::string& value) {
+    Write<uint32_t>(static_cast<uint32_t>(value.size()));
+    buffer_.append(value);
+  }
+
+  void WriteOptionalPath(
+      const stdext::optional<stdext::file_system::Path>& value) {
+    Write<uint8_t>(value ? 1 : 0);
+    if (value) {
+      WriteString(value->str());
+    }
+  }
+
+  // Returns the message, prefixed with its size.
+  const std::string& Finish() {
+    uint32_t size = static_cast<uint32_t>(buffer_.size() - sizeof(uint32_t));
+    memcpy(&buffer_[0], &size, sizeof(size));
+    return buffer_;
+  }
+
+ private:
+  std::string buffer_;
+};
+
+class MessageReader {
+ public:
+  MessageReader(const char* data, size_t size)
+      : current_(data), end_(data + size), error_(false) {}
+
+  template <typename T>
+  T Read() {
+    T value = T();
+    if (static_cast<size_t>(end_ - current_) < sizeof(value)) {
+      error_ = true;
+      return value;
+    }
+    memcpy(&value, current_, sizeof(value));
+    current_ += sizeof(value);
+    return value;
+  }
+
+  std::string ReadString() {
+    uint32_t size = Read<uint32_t>();
+    if (error_ || static_cast<size_t>(end_ - current_) < size) {
+      error_ = true;
+      return std::string();
+    }
+    std::string value(current_, size);
+    current_ += size;
+    return value;
+  }
+
+  stdext::optional<stdext::file_system::Path> ReadOptionalPath() {
+    if (!Read<uint8_t>()) {
+      return stdext::nullopt;
+    }
+    return stdext::file_system::Path(ReadString());
+  }
+
+  bool error() const { return error_; }
+
+ private:
+  const char* current_;
+  const char* end_;
+  bool error_;
+};
+
+std::string SerializeRequest(uint64_t id, const SystemCommandParams& params) {
+  MessageWriter writer;
+  writer.Write<uint64_t>(id);
+  writer.WriteString(params.command);
+  writer.Write<uint8_t>(params.argv ? 1 : 0);
+  if (params.argv) {
+    writer.Write<uint32_t>(static_cast<uint32_t>(params.argv->size()));
+    for (const auto& arg : *params.argv) {
+      writer.WriteString(arg);
+    }
+  }
+  writer.WriteOptionalPath(params.stdout_file);
+  writer.WriteOptionalPath(params.stderr_file);
+  writer.WriteOptionalPath(params.stdin_file);
+  writer.Write<uint8_t>(params.timeout ? 1 : 0);
+  if (params.timeout) {
+    writer.Write<int64_t>(params.timeout->count());
+  }
+  writer.Write<uint8_t>(params.capture_stdout ? 1 : 0);
+  writer.Write<uint8_t>(params.capture_stderr ? 1 : 0);
+  return writer.Finish();
+}
+
+bool DeserializeRequest(
+    const char* data, size_t size, uint64_t* id,
+    stdext::optional<SystemCommandParams>* params) {
+  MessageReader reader(data, size);
+  *id = reader.Read<uint64_t>();
+  params->emplace(reader.ReadString());
+  if (reader.Read<uint8_t>()) {
+    uint32_t argc = reader.Read<uint32_t>();
+    (*params)->argv.emplace();
+    for (uint32_t i = 0; i < argc && !reader.error(); ++i) {
+      (*params)->argv->push_back(reader.ReadString());
+    }
+  }
+  (*params)->stdout_file = reader.ReadOptionalPath();
+  (*params)->stderr_file = reader.ReadOptionalPath();
+  (*params)->stdin_file = reader.ReadOptionalPath();
+  if (reader.Read<uint8_t>()) {
+    (*params)->timeout = std::chrono::milliseconds(reader.Read<int64_t>());
+  }
+  (*params)->capture_stdout = reader.Read<uint8_t>() != 0;
+  (*params)->capture_stderr = reader.Read<uint8_t>() != 0;
+  return !reader.error();
+}
+
+// Since the spawn server is forked from us, the rusage struct itself has the
+// same layout on both ends of the socket.
+// |output| holds the captured output of the command, and whether it timed out.
+bool SendResponse(int socket_fd, uint64_t id, int32_t status,
+                  const struct rusage& usage,
+                  const SystemCommandResult& output) {
+  MessageWriter writer;
+  writer.Write<uint64_t>(id);
+  writer.Write<int32_t>(status);
+  writer.Write<struct rusage>(usage);
+  writer.Write<uint8_t>(output.timed_out ? 1 : 0);
+  writer.WriteString(output.stdout_output);
+  writer.WriteString(output.stderr_output);
+  const std::string& message = writer.Finish();
+  return WriteAll(socket_fd, message.data(), message.size());
+}
+
+bool SendSpawnFailedResponse(int socket_fd, uint64_t id) {
+  struct rusage usage;
+  memset(&usage, 0, sizeof(usage));
+  return SendResponse(socket_fd, id, 1, usage, SystemCommandResult());
+}
+
+#if defined(__linux__)
+// The main loop of the spawn server process.  It multiplexes between new
+// requests arriving from the parent and notifications that its children have
+// exited, and returns when the parent closes its end of the socket.
+void RunSpawnServer(int socket_fd) {
+  // Child exits are picked up through a signalfd rather than a handler.
+  sigset_t child_mask;
+  sigemptyset(&child_mask);
+  sigaddset(&child_mask, SIGCHLD);
+  if (sigprocmask(SIG_BLOCK, &child_mask, nullptr) != 0) {
+    return;
+  }
+  int signal_fd = signalfd(-1, &child_mask, SFD_CLOEXEC);
+  if (signal_fd == -1) {
+    return;
+  }
+
+  struct RunningChild {
+    uint64_t id;
+    std::unique_ptr<internal::OutputCapture> output;
+  };
+  std::unordered_map<pid_t, RunningChild> running_children;
+  internal::ChildTimeouts timeouts;
+  std::vector<char> input;
+
+  std::vector<struct pollfd> poll_fds;
+  // The children that each of the output pipes in |poll_fds| belong to.
+  std::vector<internal::OutputCapture*> poll_fd_outputs;
+  std::vector<int> output_fds;
+  while (true) {
+    poll_fds.resize(2);
+    poll_fds[0].fd = socket_fd;
+    poll_fds[0].events = POLLIN;
+    poll_fds[1].fd = signal_fd;
+    poll_fds[1].events = POLLIN;
+    poll_fd_outputs.assign(2, nullptr);
+    for (auto& entry : running_children) {
+      output_fds.clear();
+      entry.second.output->GetReadFds(&output_fds);
+      for (int fd : output_fds) {
+        struct pollfd output_poll_fd;
+        output_poll_fd.fd = fd;
+        output_poll_fd.events = POLLIN;
+        poll_fds.push_back(output_poll_fd);
+        poll_fd_outputs.push_back(entry.second.output.get());
+      }
+    }
+
+    if (poll(poll_fds.data(), poll_fds.size(), timeouts.Update()) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+
+    // Read output before reaping, since reaping a child discards its
+    // capture.
+    for (size_t i = 2; i < poll_fds.size(); ++i) {
+      if (poll_fds[i].revents != 0 &&
+          !poll_fd_outputs[i]->Read(poll_fds[i].fd)) {
+        poll_fd_outputs[i]->Close(poll_fds[i].fd);
+      }
+    }
+
+    if (poll_fds[1].revents & POLLIN) {
+      // Multiple exits may be coalesced into one signal, so reap everything
+      // that is ready.
+      struct signalfd_siginfo info;
+      ssize_t num_read = read(signal_fd, &info, sizeof(info));
+      (void)num_read;
+
+      int status;
+      struct rusage usage;
+      pid_t child_pid;
+      while ((child_pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        auto found = running_children.find(child_pid);
+        if (found == running_children.end()) {
+          continue;
+        }
+        SystemCommandResult output;
+        output.timed_out = timeouts.Remove(child_pid);
+        found->second.output->Finish(&output);
+        if (!SendResponse(
+                socket_fd, found->second.id, status, usage, output)) {
+          return;
+        }
+        running_children.erase(found);
+      }
+    }
+
+    if (poll_fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+      char buffer[16 * 1024];
+      ssize_t num_read = read(socket_fd, buffer, sizeof(buffer));
+      if (num_read == -1 && errno == EINTR) {
+        continue;
+      }
+      if (num_read <= 0) {
+        // The parent has gone away, so there is nobody left to report to.
+        return;
+      }
+      input.insert(input.end(), buffer, buffer + num_read);
+
+      // Handle every complete request that we have received.
+      size_t consumed = 0;
+      while (input.size() - consumed >= sizeof(uint32_t)) {
+        uint32_t size;
+        memcpy(&size, input.data() + consumed, sizeof(size));
+        if (input.size() - consumed - sizeof(uint32_t) < size) {
+          break;
+        }
+        const char* message = input.data() + consumed + sizeof(uint32_t);
+        consumed += sizeof(uint32_t) + size;
+
+        uint64_t id;
+        stdext::optional<SystemCommandParams> params;
+        if (!DeserializeRequest(message, size, &id, &params)) {
+          return;
+        }
+
+        std::unique_ptr<internal::OutputCapture> output(
+            new internal::OutputCapture());
+        pid_t child_pid = internal::SpawnSystemCommand(*params, output.get());
+        if (child_pid == -1) {
+          if (!SendSpawnFailedResponse(socket_fd, id)) {
+            return;
+          }
+        } else {
+          RunningChild* child = &running_children[child_pid];
+          child->id = id;
+          child->output = std::move(output);
+          if (params->timeout) {
+            timeouts.Add(child_pid, *params->timeout);
+          }
+        }
+      }
+      input.erase(input.begin(), input.begin() + consumed);
+    }
+  }
+}
+#endif
+
+// The parent's connection to the spawn server.  Requests may be sent from
+// any thread, and responses are dispatched by a dedicated reader thread.
+class SpawnServerConnection {
+ public:
+  SpawnServerConnection(pid_t server_pid, int socket_fd)
+      : server_pid_(server_pid), socket_fd_(socket_fd), next_id_(0),
+        connected_(true),
+        reader_thread_(&SpawnServerConnection::ReadResponses, this) {}
+
+  ~SpawnServerConnection() {
+    // Closing our sending side signals the server to exit, after which the
+    // reader thread will see the socket close.
+    shutdown(socket_fd_, SHUT_WR);
+    reader_thread_.join();
+    close(socket_fd_);
+    waitpid(server_pid_, nullptr, 0);
+  }
+
+  bool Spawn(const SystemCommandParams& params,
+             const SystemCommandExitFunction& on_exit) {
+    uint64_t id;
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      if (!connected_) {
+        return false;
+      }
+      id = next_id_++;
+      pending_[id] = on_exit;
+    }
+
+    std::string request = SerializeRequest(id, params);
+    bool sent;
+    {
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      sent = WriteAll(socket_fd_, request.data(), request.size());
+    }
+
+    if (!sent) {
+      // The server never received the request, so the caller should spawn
+      // the command itself.
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      return pending_.erase(id) == 0;
+    }
+    return true;
+  }
+
+ private:
+  void ReadResponses() {
+    while (true) {
+      uint32_t size;
+      if (!ReadAll(socket_fd_, reinterpret_cast<char*>(&size), sizeof(size))) {
+        break;
+      }
+      std::vector<char> message(size);
+      if (!ReadAll(socket_fd_, message.data(), size)) {
+        break;
+      }
+      MessageReader reader(message.data(), message.size());
+      uint64_t id = reader.Read<uint64_t>();
+      int32_t status = reader.Read<int32_t>();
+      struct rusage usage = reader.Read<struct rusage>();
+      bool timed_out = reader.Read<uint8_t>() != 0;
+      std::string stdout_output = reader.ReadString();
+      std::string stderr_output = reader.ReadString();
+      if (reader.error()) {
+        break;
+      }
+
+      SystemCommandExitFunction on_exit;
+      {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        auto found = pending_.find(id);
+        if (found == pending_.end()) {
+          continue;
+        }
+        on_exit = std::move(found->second);
+        pending_.erase(found);
+      }
+      SystemCommandResult result =
+          internal::MakeSystemCommandResult(status, usage);
+      result.timed_out = timed_out;
+      result.stdout_output = std::move(stdout_output);
+      result.stderr_output = std::move(stderr_output);
+      on_exit(result);
+    }
+
+    // The server has exited, so fail any commands that it was running, and
+    // have all future commands spawned directly.
+    std::unordered_map<uint64_t, SystemCommandExitFunction> abandoned;
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      connected_ = false;
+      abandoned.swap(pending_);
+    }
+    for (auto& entry : abandoned) {
+      entry.second(SystemCommandResult(1));
+    }
+  }
+
+  const pid_t server_pid_;
+  const int socket_fd_;
+
+  std::mutex write_mutex_;
+
+  std::mutex pending_mutex_;
+  uint64_t next_id_;
+  bool connected_;
+  std::unordered_map<uint64_t, SystemCommandExitFunction> pending_;
+
+  std::thread reader_thread_;
+};
+
+std::unique_ptr<SpawnServerConnection> g_spawn_server;
+
+}  // namespace
+
+namespace internal {
+
+bool SpawnWithSpawnServer(
+    const SystemCommandParams& params,
+    const SystemCommandExitFunction& on_exit) {
+  return g_spawn_server && g_spawn_server->Spawn(params, on_exit);
+}
+
+}  // namespace internal
+
+bool StartSpawnServer() {
+#if defined(__linux__)
+  if (g_spawn_server) {
+    return true;
+  }
+
+  int socket_fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, socket_fds) != 0) {
+    return false;
+  }
+
+  pid_t server_pid = fork();
+  if (server_pid == -1) {
+    close(socket_fds[0]);
+    close(socket_fds[1]);
+    return false;
+  }
+
+  if (server_pid == 0) {
+    close(socket_fds[0]);
+    RunSpawnServer(socket_fds[1]);
+    _exit(0);
+  }
+
+  close(socket_fds[1]);
+  g_spawn_server.reset(new SpawnServerConnection(server_pid, socket_fds[0]));
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace platform
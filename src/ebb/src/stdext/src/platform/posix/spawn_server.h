@@ -0,0 +1,115 @@
+#ifndef __PLATFORM_POSIX_SPAWN_SERVER_H__
+#define __PLATFORM_POSIX_SPAWN_SERVER_H__
+
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "platform/subprocess.h"
+
+namespace platform {
+namespace internal {
+
+// Captures a child's stdout and/or stderr through pipes, as requested by its
+// SystemCommandParams.  The read ends of the pipes are non-blocking.  This
+// class is not thread safe.
+class OutputCapture {
+ public:
+  OutputCapture();
+  ~OutputCapture();
+
+  OutputCapture(const OutputCapture&) = delete;
+  OutputCapture& operator=(const OutputCapture&) = delete;
+
+  // Creates the pipes for the streams that |params| asks to be captured, and
+  // adds actions to |file_actions| that connect the child to them.
+  bool Init(const SystemCommandParams& params,
+            posix_spawn_file_actions_t* file_actions);
+
+  // To be called once the child has been spawned, to close our copies of the
+  // pipes' write ends.
+  void CloseWriteEnds();
+
+  // Appends the read ends that are still open to |fds|.
+  void GetReadFds(std::vector<int>* fds) const;
+
+  // Reads whatever is available from the read end |fd|.  Returns false once
+  // the pipe has been closed by the child, after which the caller should stop
+  // watching it and call Close().
+  bool Read(int fd);
+  void Close(int fd);
+
+  // Reads whatever remains in the pipes without blocking, closes them and
+  // moves the captured output in to |result|.
+  void Finish(SystemCommandResult* result);
+
+ private:
+  struct Stream {
+    int read_fd;
+    int write_fd;
+    std::string output;
+    // The amount of output beyond kMaxCapturedOutputBytes that was dropped.
+    uint64_t dropped_bytes;
+  };
+
+  bool ReadStream(Stream* stream);
+
+  Stream streams_[2];
+};
+
+// Spawns the command from the current process and returns the child's process
+// id, or -1 if the child could not be started.  |output| is initialized to
+// capture the child's output as requested by |params|.
+pid_t SpawnSystemCommand(
+    const SystemCommandParams& params, OutputCapture* output);
+
+// Builds the result for a child that exited with the given wait status and
+// resource usage.
+SystemCommandResult MakeSystemCommandResult(
+    int status, const struct rusage& usage);
+
+// Enforces the timeouts of running children.  Once a child's timeout passes,
+// its process group is sent SIGTERM, followed by SIGKILL if it is still
+// running after a grace period.  This class is not thread safe.
+class ChildTimeouts {
+ public:
+  void Add(pid_t child_pid, std::chrono::milliseconds timeout);
+
+  // Stops enforcing the timeout of |child_pid|, and returns true if it was
+  // terminated for exceeding it.  This must be called before Update() is
+  // next called after the child has been reaped, since its process group id
+  // may then be reused.
+  bool Remove(pid_t child_pid);
+
+  // Signals every child whose deadline has passed, and returns the number of
+  // milliseconds until the next deadline, or -1 if there is none.  This is
+  // suitable for passing as a poll() timeout.
+  int Update();
+
+ private:
+  struct Child {
+    std::chrono::steady_clock::time_point deadline;
+    // The number of signals that we have sent so far.
+    int signals_sent;
+  };
+
+  std::unordered_map<pid_t, Child> children_;
+};
+
+// If a spawn server has been started with StartSpawnServer(), hands the
+// command off to it and returns true.  |on_exit| will then be called from the
+// spawn server connection's reader thread.  Returns false if there is no
+// spawn server available.
+bool SpawnWithSpawnServer(
+    const SystemCommandParams& params,
+    const SystemCommandExitFunction& on_exit);
+
+}  // namespace internal
+}  // namespace platform
+
+#endif  // __PLATFORM_POSIX_SPAWN_SERVER_H__
@@ -1,10 +1,32 @@
 #include "platform/subprocess.h"
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <spawn.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "platform/posix/spawn_server.h"
 
 extern char** environ;
 
@@ -18,53 +40,665 @@ int AddRedirect(posix_spawn_file_actions_t* child_fd_actions, int fd,
     return posix_spawn_file_actions_addopen(
                child_fd_actions, fd, file_path->c_str(), flags, file_mode);
   } else {
+    // Output to an unredirected stream is discarded, rather than failing.
     return posix_spawn_file_actions_addopen(
-               child_fd_actions, fd, "/dev/null", O_RDONLY, 0);
+               child_fd_actions, fd, "/dev/null", O_RDWR, 0);
+  }
+}
+
+// How long a timed out child has to exit after SIGTERM before it is sent
+// SIGKILL.
+const std::chrono::seconds kTimeoutGracePeriod(5);
+
+// Without a way to be notified of a child's exit, this is how often we check
+// up on children that have a timeout or whose output is being captured.
+const int kChildPollIntervalMs = 10;
+
+// The most that we will read from a pipe in one go, so that a child producing
+// endless output cannot monopolize the reading thread.
+const int kMaxReadsPerCall = 64;
+
+// Returns true once |child_pid| has exited, without reaping it.
+bool HasChildExited(pid_t child_pid) {
+  siginfo_t info;
+  info.si_pid = 0;
+  while (waitid(P_PID, child_pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+    if (errno != EINTR) {
+      return true;
+    }
+  }
+  return info.si_pid == child_pid;
+}
+
+// Waits for up to |wait_ms| for output to arrive from the child, and reads
+// it.
+void WaitForOutput(internal::OutputCapture* output, int wait_ms) {
+  std::vector<int> fds;
+  if (output) {
+    output->GetReadFds(&fds);
+  }
+  if (fds.empty()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+    return;
+  }
+
+  std::vector<struct pollfd> poll_fds(fds.size());
+  for (size_t i = 0; i < fds.size(); ++i) {
+    poll_fds[i].fd = fds[i];
+    poll_fds[i].events = POLLIN;
+  }
+  if (poll(poll_fds.data(), poll_fds.size(), wait_ms) <= 0) {
+    return;
+  }
+  for (const auto& poll_fd : poll_fds) {
+    if (poll_fd.revents != 0 && !output->Read(poll_fd.fd)) {
+      output->Close(poll_fd.fd);
+    }
+  }
+}
+
+// Waits for the child to exit and reaps it.  If |output| is not null, the
+// child's output is read while it runs, and stored in the result.
+SystemCommandResult WaitForChild(
+    pid_t child_pid,
+    const stdext::optional<std::chrono::milliseconds>& timeout,
+    internal::OutputCapture* output) {
+  bool timed_out = false;
+  std::vector<int> output_fds;
+  if (output) {
+    output->GetReadFds(&output_fds);
+  }
+  if (timeout || !output_fds.empty()) {
+    internal::ChildTimeouts timeouts;
+    if (timeout) {
+      timeouts.Add(child_pid, *timeout);
+    }
+    while (!HasChildExited(child_pid)) {
+      int wait_ms = timeouts.Update();
+      if (wait_ms < 0 || wait_ms > kChildPollIntervalMs) {
+        wait_ms = kChildPollIntervalMs;
+      }
+      WaitForOutput(output, wait_ms);
+    }
+    timed_out = timeouts.Remove(child_pid);
+  }
+
+  int status;
+  struct rusage usage;
+  while (wait4(child_pid, &status, 0, &usage) == -1) {
+    if (errno != EINTR) {
+      return 1;
+    }
+  }
+
+  SystemCommandResult result = internal::MakeSystemCommandResult(status, usage);
+  result.timed_out = timed_out;
+  if (output) {
+    output->Finish(&result);
+  }
+  return result;
+}
+
+void SignalProcessGroup(pid_t child_pid, int signal_number) {
+  // The child may have moved itself in to a different process group, in which
+  // case we can at least still signal it directly.
+  if (killpg(child_pid, signal_number) != 0) {
+    kill(child_pid, signal_number);
+  }
+}
+
+}  // namespace
+
+namespace internal {
+
+SystemCommandResult MakeSystemCommandResult(
+    int status, const struct rusage& usage) {
+  SystemCommandResult result(status);
+  result.resource_usage.emplace();
+  result.resource_usage->user_time =
+      std::chrono::seconds(usage.ru_utime.tv_sec) +
+      std::chrono::microseconds(usage.ru_utime.tv_usec);
+  result.resource_usage->system_time =
+      std::chrono::seconds(usage.ru_stime.tv_sec) +
+      std::chrono::microseconds(usage.ru_stime.tv_usec);
+#if defined(__APPLE__)
+  // macOS reports the max RSS in bytes, everyone else in kilobytes.
+  result.resource_usage->max_rss_bytes = usage.ru_maxrss;
+#else
+  result.resource_usage->max_rss_bytes =
+      static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+  result.resource_usage->block_input_operations = usage.ru_inblock;
+  result.resource_usage->block_output_operations = usage.ru_oublock;
+  return result;
+}
+
+void ChildTimeouts::Add(pid_t child_pid, std::chrono::milliseconds timeout) {
+  children_[child_pid] = Child{std::chrono::steady_clock::now() + timeout, 0};
+}
+
+bool ChildTimeouts::Remove(pid_t child_pid) {
+  auto found = children_.find(child_pid);
+  if (found == children_.end()) {
+    return false;
+  }
+  bool timed_out = found->second.signals_sent > 0;
+  children_.erase(found);
+  return timed_out;
+}
+
+int ChildTimeouts::Update() {
+  auto now = std::chrono::steady_clock::now();
+  stdext::optional<std::chrono::steady_clock::duration> next_deadline;
+  for (auto& entry : children_) {
+    Child* child = &entry.second;
+    if (child->signals_sent >= 2) {
+      // We've already sent SIGKILL, there is nothing more that we can do.
+      continue;
+    }
+    if (child->deadline <= now) {
+      if (child->signals_sent == 0) {
+        SignalProcessGroup(entry.first, SIGTERM);
+        child->deadline = now + kTimeoutGracePeriod;
+      } else {
+        SignalProcessGroup(entry.first, SIGKILL);
+      }
+      ++child->signals_sent;
+      if (child->signals_sent >= 2) {
+        continue;
+      }
+    }
+    if (!next_deadline || child->deadline - now < *next_deadline) {
+      next_deadline = child->deadline - now;
+    }
+  }
+
+  if (!next_deadline) {
+    return -1;
+  }
+  // Round up, so that we don't wake up just before the deadline.
+  return static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          *next_deadline).count()) + 1;
+}
+
+OutputCapture::OutputCapture() {
+  for (auto& stream : streams_) {
+    stream.read_fd = -1;
+    stream.write_fd = -1;
+    stream.dropped_bytes = 0;
+  }
+}
+
+OutputCapture::~OutputCapture() {
+  for (auto& stream : streams_) {
+    if (stream.read_fd != -1) close(stream.read_fd);
+    if (stream.write_fd != -1) close(stream.write_fd);
   }
 }
+
+bool OutputCapture::Init(const SystemCommandParams& params,
+                         posix_spawn_file_actions_t* file_actions) {
+  const bool capture[] = {params.capture_stdout, params.capture_stderr};
+  for (int i = 0; i < 2; ++i) {
+    if (!capture[i]) {
+      continue;
+    }
+    // The child gets its own copy of the write end through dup2(), so
+    // neither end needs to survive an exec.  Commands are spawned from many
+    // threads at once, so the pipe must be close-on-exec from the moment it
+    // exists, or another thread's child could inherit the write end and keep
+    // it open.
+    int pipe_fds[2];
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__)
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+      return false;
+    }
+#else
+    // Without pipe2() there's a short window in which the pipe can leak.
+    if (pipe(pipe_fds) != 0) {
+      return false;
+    }
+    fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    streams_[i].read_fd = pipe_fds[0];
+    streams_[i].write_fd = pipe_fds[1];
+    fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK);
+    if (posix_spawn_file_actions_adddup2(
+            file_actions, pipe_fds[1], i + 1) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void OutputCapture::CloseWriteEnds() {
+  for (auto& stream : streams_) {
+    if (stream.write_fd != -1) {
+      close(stream.write_fd);
+      stream.write_fd = -1;
+    }
+  }
+}
+
+void OutputCapture::GetReadFds(std::vector<int>* fds) const {
+  for (const auto& stream : streams_) {
+    if (stream.read_fd != -1) {
+      fds->push_back(stream.read_fd);
+    }
+  }
+}
+
+bool OutputCapture::Read(int fd) {
+  for (auto& stream : streams_) {
+    if (stream.read_fd == fd) {
+      return ReadStream(&stream);
+    }
+  }
+  return false;
 }
 
-int SystemCommand(
-    const char* command,
-    const stdext::optional<stdext::file_system::Path>& stdout_file,
-    const stdext::optional<stdext::file_system::Path>& stderr_file,
-    const stdext::optional<stdext::file_system::Path>& stdin_file) {
+void OutputCapture::Close(int fd) {
+  for (auto& stream : streams_) {
+    if (stream.read_fd == fd) {
+      close(stream.read_fd);
+      stream.read_fd = -1;
+    }
+  }
+}
+
+void OutputCapture::Finish(SystemCommandResult* result) {
+  std::string* outputs[] = {&result->stdout_output, &result->stderr_output};
+  for (int i = 0; i < 2; ++i) {
+    Stream* stream = &streams_[i];
+    if (stream->read_fd != -1) {
+      ReadStream(stream);
+      Close(stream->read_fd);
+    }
+    if (stream->dropped_bytes > 0) {
+      std::ostringstream note;
+      note << std::endl << "[" << stream->dropped_bytes
+           << " more bytes of output were dropped]" << std::endl;
+      stream->output += note.str();
+    }
+    *outputs[i] = std::move(stream->output);
+    stream->output.clear();
+    stream->dropped_bytes = 0;
+  }
+}
+
+bool OutputCapture::ReadStream(Stream* stream) {
+  char buffer[16 * 1024];
+  for (int i = 0; i < kMaxReadsPerCall; ++i) {
+    ssize_t num_read = read(stream->read_fd, buffer, sizeof(buffer));
+    if (num_read > 0) {
+      size_t kept = std::min(
+          static_cast<size_t>(num_read),
+          kMaxCapturedOutputBytes -
+              std::min(stream->output.size(), kMaxCapturedOutputBytes));
+      stream->output.append(buffer, kept);
+      stream->dropped_bytes += num_read - kept;
+    } else if (num_read == -1 && errno == EINTR) {
+      continue;
+    } else if (num_read == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+pid_t SpawnSystemCommand(
+    const SystemCommandParams& params, OutputCapture* output) {
   posix_spawn_file_actions_t child_fd_actions;
   if (posix_spawn_file_actions_init (&child_fd_actions) != 0) {
-    return 1;
+    return -1;
   }
 
-  if (AddRedirect(
-          &child_fd_actions, 1, stdout_file, O_WRONLY | O_CREAT | O_TRUNC,
-          0644) != 0) {
-    return 1;
+  // Children should never inherit a blocked signal mask, which the spawn
+  // server in particular uses.
+  posix_spawnattr_t child_attributes;
+  if (posix_spawnattr_init(&child_attributes) != 0) {
+    posix_spawn_file_actions_destroy(&child_fd_actions);
+    return -1;
+  }
+  sigset_t empty_mask;
+  sigemptyset(&empty_mask);
+  posix_spawnattr_setsigmask(&child_attributes, &empty_mask);
+  short spawn_flags = POSIX_SPAWN_SETSIGMASK;
+  if (params.timeout) {
+    // Give the child its own process group, so that if it times out we can
+    // take down everything that it started along with it.  Children without
+    // a timeout stay in our process group, so that e.g. a Ctrl+C at the
+    // terminal still reaches them.
+    posix_spawnattr_setpgroup(&child_attributes, 0);
+    spawn_flags |= POSIX_SPAWN_SETPGROUP;
   }
+  posix_spawnattr_setflags(&child_attributes, spawn_flags);
 
-  if (AddRedirect(
-          &child_fd_actions, 2, stderr_file, O_WRONLY | O_CREAT | O_TRUNC,
-          0644) != 0) {
-    return 1;
+  // Commands are run through the shell unless we're given the exact argv to
+  // execute.
+  std::vector<const char*> spawned_args;
+  if (params.argv && !params.argv->empty()) {
+    spawned_args.reserve(params.argv->size() + 1);
+    for (const auto& arg : *params.argv) {
+      spawned_args.push_back(arg.c_str());
+    }
+  } else {
+    spawned_args = {"/bin/sh", "-c", params.command.c_str()};
   }
+  spawned_args.push_back(NULL);
+  char** spawned_argv = const_cast<char**>(spawned_args.data());
 
-  if (AddRedirect(
-          &child_fd_actions, 0, stdin_file, O_RDONLY, 0) != 0) {
-    return 1;
+  pid_t child_pid = -1;
+  if ((!params.capture_stdout &&
+       AddRedirect(
+           &child_fd_actions, 1, params.stdout_file,
+           O_WRONLY | O_CREAT | O_TRUNC, 0644) != 0) ||
+      (!params.capture_stderr &&
+       AddRedirect(
+           &child_fd_actions, 2, params.stderr_file,
+           O_WRONLY | O_CREAT | O_TRUNC, 0644) != 0) ||
+      AddRedirect(
+          &child_fd_actions, 0, params.stdin_file, O_RDONLY, 0) != 0 ||
+      !output->Init(params, &child_fd_actions) ||
+      posix_spawnp(&child_pid, spawned_argv[0], &child_fd_actions,
+                   &child_attributes, spawned_argv, environ) != 0) {
+    child_pid = -1;
   }
+  output->CloseWriteEnds();
 
-  pid_t child_pid;
-  const char* spawned_args[] = {"/bin/sh", "-c", command, NULL};
+  posix_spawnattr_destroy(&child_attributes);
+  posix_spawn_file_actions_destroy(&child_fd_actions);
+  return child_pid;
+}
 
-  if (posix_spawn(&child_pid, "/bin/sh", &child_fd_actions, NULL,
-                  const_cast<char**>(spawned_args), environ) != 0) {
-    return 1;
+}  // namespace internal
+
+namespace {
+
+#if defined(__linux__) && defined(SYS_pidfd_open)
+// Watches over all asynchronously launched children from a single background
+// thread.  Each child is tracked through a pidfd registered with epoll, which
+// becomes readable when the child exits.
+class ChildProcessWatcher {
+ public:
+  // Returns nullptr if the watcher could not be set up, e.g. if the kernel
+  // is too old to support pidfds.
+  static ChildProcessWatcher* Get() {
+    static ChildProcessWatcher watcher;
+    return watcher.thread_.joinable() ? &watcher : nullptr;
   }
 
-  int status;
-  if (waitpid(child_pid, &status, 0) == -1) {
+  // Returns false if |child_pid| could not be watched, in which case the
+  // caller retains responsibility for reaping it, and for |output|.
+  // Otherwise, the watcher takes ownership of |output|.
+  bool Watch(pid_t child_pid,
+             const stdext::optional<std::chrono::milliseconds>& timeout,
+             std::unique_ptr<internal::OutputCapture>* output,
+             const SystemCommandExitFunction& on_exit) {
+    int pid_fd = static_cast<int>(syscall(SYS_pidfd_open, child_pid, 0));
+    if (pid_fd == -1) {
+      return false;
+    }
+
+    std::unique_ptr<WatchedChild> child(new WatchedChild());
+    child->pid = child_pid;
+    child->on_exit = on_exit;
+    child->fds[0] = WatchedFd{child.get(), pid_fd};
+    child->num_fds = 1;
+    std::vector<int> output_fds;
+    (*output)->GetReadFds(&output_fds);
+    for (int fd : output_fds) {
+      child->fds[child->num_fds++] = WatchedFd{child.get(), fd};
+    }
+    child->output = std::move(*output);
+
+    {
+      // Events for the child can't be handled until it is fully registered.
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (timeout) {
+        timeouts_.Add(child_pid, *timeout);
+      }
+
+      for (int i = 0; i < child->num_fds; ++i) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = &child->fds[i];
+        if (epoll_ctl(
+                epoll_fd_, EPOLL_CTL_ADD, child->fds[i].fd, &event) != 0) {
+          for (int j = 0; j < i; ++j) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, child->fds[j].fd, nullptr);
+          }
+          timeouts_.Remove(child_pid);
+          close(pid_fd);
+          *output = std::move(child->output);
+          return false;
+        }
+      }
+    }
+    child.release();
+
+    if (timeout) {
+      // Wake up the watcher thread so that it takes the new deadline into
+      // account.
+      uint64_t value = 1;
+      ssize_t written = write(wake_fd_, &value, sizeof(value));
+      (void)written;
+    }
+
+    return true;
+  }
+
+ private:
+  struct WatchedChild;
+
+  // Identifies the subject of an epoll event, which is either a child's pidfd
+  // or one of the pipes that its output is being captured through.
+  struct WatchedFd {
+    WatchedChild* child;
+    int fd;
+  };
+
+  struct WatchedChild {
+    pid_t pid;
+    // The pidfd is always first.
+    WatchedFd fds[3];
+    int num_fds;
+    std::unique_ptr<internal::OutputCapture> output;
+    SystemCommandExitFunction on_exit;
+  };
+
+  ChildProcessWatcher() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    quit_fd_ = eventfd(0, EFD_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ == -1 || quit_fd_ == -1 || wake_fd_ == -1) {
+      return;
+    }
+
+    // Make sure that pidfds are actually supported before committing to
+    // using them.
+    int self_fd = static_cast<int>(syscall(SYS_pidfd_open, getpid(), 0));
+    if (self_fd == -1) {
+      return;
+    }
+    close(self_fd);
+
+    // The quit event is identified by a null data pointer.
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, quit_fd_, &event) != 0) {
+      return;
+    }
+    // The wake event is identified by pointing at |wake_fd_|.
+    event.data.ptr = &wake_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) != 0) {
+      return;
+    }
+
+    thread_ = std::thread(&ChildProcessWatcher::Run, this);
+  }
+
+  ~ChildProcessWatcher() {
+    if (thread_.joinable()) {
+      uint64_t value = 1;
+      ssize_t written = write(quit_fd_, &value, sizeof(value));
+      (void)written;
+      thread_.join();
+    }
+    if (wake_fd_ != -1) close(wake_fd_);
+    if (quit_fd_ != -1) close(quit_fd_);
+    if (epoll_fd_ != -1) close(epoll_fd_);
+  }
+
+  // Stops watching the |index|th fd of |child|.  The fds after it are not
+  // moved, since events in the current batch may still point at them.
+  void Unwatch(WatchedChild* child, int index) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, child->fds[index].fd, nullptr);
+    child->fds[index].fd = -1;
+  }
+
+  void Run() {
+    const int kMaxEvents = 32;
+    struct epoll_event events[kMaxEvents];
+    // Children that have exited are only deleted at the end of each batch of
+    // events, since later events in the batch may still refer to them.
+    std::vector<WatchedChild*> exited_children;
+    // Exit functions are called without holding our lock, since they may well
+    // go on to start another command.
+    std::vector<std::pair<SystemCommandExitFunction, SystemCommandResult>>
+        exits;
+    while (true) {
+      int wait_ms;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wait_ms = timeouts_.Update();
+      }
+
+      int num_events = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms);
+      if (num_events == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (int i = 0; i < num_events; ++i) {
+        if (!events[i].data.ptr) {
+          return;
+        }
+        if (events[i].data.ptr == &wake_fd_) {
+          uint64_t value;
+          ssize_t num_read = read(wake_fd_, &value, sizeof(value));
+          (void)num_read;
+          continue;
+        }
+        WatchedFd* watched_fd = static_cast<WatchedFd*>(events[i].data.ptr);
+        WatchedChild* child = watched_fd->child;
+        int index = static_cast<int>(watched_fd - child->fds);
+        if (watched_fd->fd == -1) {
+          // We already stopped watching this fd earlier in the batch.
+          continue;
+        }
+
+        if (index > 0) {
+          // Output from the child.
+          int fd = watched_fd->fd;
+          if (!child->output->Read(fd)) {
+            Unwatch(child, index);
+            child->output->Close(fd);
+          }
+          continue;
+        }
+
+        int pid_fd = watched_fd->fd;
+        for (int j = 0; j < child->num_fds; ++j) {
+          if (child->fds[j].fd != -1) {
+            Unwatch(child, j);
+          }
+        }
+        close(pid_fd);
+        bool timed_out = timeouts_.Remove(child->pid);
+        // The child has exited, so this will not block.
+        SystemCommandResult result =
+            WaitForChild(child->pid, stdext::nullopt, nullptr);
+        result.timed_out = timed_out;
+        child->output->Finish(&result);
+        exits.emplace_back(std::move(child->on_exit), std::move(result));
+        exited_children.push_back(child);
+      }
+
+      for (WatchedChild* child : exited_children) {
+        delete child;
+      }
+      exited_children.clear();
+      lock.unlock();
+
+      for (auto& exit : exits) {
+        exit.first(exit.second);
+      }
+      exits.clear();
+    }
+  }
+
+  int epoll_fd_;
+  int quit_fd_;
+  int wake_fd_;
+  std::thread thread_;
+
+  // Guards |timeouts_| and the registration of new children.
+  std::mutex mutex_;
+  internal::ChildTimeouts timeouts_;
+};
+#endif
+
+}  // namespace
+
+SystemCommandResult SystemCommand(const SystemCommandParams& params) {
+  internal::OutputCapture output;
+  pid_t child_pid = internal::SpawnSystemCommand(params, &output);
+  if (child_pid == -1) {
     return 1;
   }
 
-  return status;
+  return WaitForChild(child_pid, params.timeout, &output);
+}
+
+void SystemCommandAsync(
+    const SystemCommandParams& params,
+    const SystemCommandExitFunction& on_exit) {
+  if (internal::SpawnWithSpawnServer(params, on_exit)) {
+    return;
+  }
+
+  std::unique_ptr<internal::OutputCapture> output(
+      new internal::OutputCapture());
+  pid_t child_pid = internal::SpawnSystemCommand(params, output.get());
+  if (child_pid == -1) {
+    on_exit(1);
+    return;
+  }
+
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  ChildProcessWatcher* watcher = ChildProcessWatcher::Get();
+  if (watcher && watcher->Watch(child_pid, params.timeout, &output, on_exit)) {
+    return;
+  }
+#endif
+
+  // Without pidfd support, fall back to a dedicated thread per child.  This
+  // still keeps the caller's thread free while the child runs.
+  stdext::optional<std::chrono::milliseconds> timeout = params.timeout;
+  std::shared_ptr<internal::OutputCapture> shared_output(std::move(output));
+  std::thread([child_pid, timeout, shared_output, on_exit]() {
+    on_exit(WaitForChild(child_pid, timeout, shared_output.get()));
+  }).detach();
 }
 
 }  // namespace platform
@@ -0,0 +1,122 @@
+#include "platform/system_load.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace platform {
+
+namespace {
+
+#if defined(__linux__)
+// Returns the value of |key| (e.g. "MemAvailable:") from /proc/meminfo, in
+// bytes.
+stdext::optional<uint64_t> ReadMemInfoValue(const std::string& key) {
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    uint64_t kilobytes;
+    if (fields >> name >> kilobytes && name == key) {
+      return kilobytes * 1024;
+    }
+  }
+  return stdext::nullopt;
+}
+
+stdext::optional<uint64_t> ReadUint64File(const std::string& path) {
+  std::ifstream file(path);
+  uint64_t value;
+  if (file >> value) {
+    return value;
+  }
+  // This includes the case where the file contains "max".
+  return stdext::nullopt;
+}
+
+// Returns how much more memory our cgroup may use before hitting its limit,
+// if it has one.  Both the unified (v2) and legacy (v1) memory controllers are
+// supported.
+stdext::optional<uint64_t> GetCgroupMemoryHeadroom() {
+  std::string limit_path;
+  std::string usage_path;
+
+  // Each line is formatted as "ID:CONTROLLERS:PATH", and the unified
+  // hierarchy is listed as "0::PATH".
+  std::ifstream cgroup("/proc/self/cgroup");
+  std::string line;
+  while (std::getline(cgroup, line)) {
+    size_t first_colon = line.find(':');
+    size_t second_colon = line.find(':', first_colon + 1);
+    if (first_colon == std::string::npos || second_colon == std::string::npos) {
+      continue;
+    }
+    std::string controllers =
+        line.substr(first_colon + 1, second_colon - first_colon - 1);
+    std::string path = line.substr(second_colon + 1);
+    if (controllers == "memory") {
+      limit_path = "/sys/fs/cgroup/memory" + path + "/memory.limit_in_bytes";
+      usage_path = "/sys/fs/cgroup/memory" + path + "/memory.usage_in_bytes";
+      break;
+    } else if (controllers.empty()) {
+      limit_path = "/sys/fs/cgroup" + path + "/memory.max";
+      usage_path = "/sys/fs/cgroup" + path + "/memory.current";
+    }
+  }
+  if (limit_path.empty()) {
+    return stdext::nullopt;
+  }
+
+  stdext::optional<uint64_t> limit = ReadUint64File(limit_path);
+  stdext::optional<uint64_t> usage = ReadUint64File(usage_path);
+  if (!limit || !usage) {
+    return stdext::nullopt;
+  }
+  return *limit > *usage ? *limit - *usage : 0;
+}
+
+stdext::optional<double> GetMemoryPressure() {
+  // Formatted as, e.g.:
+  //   some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  //   full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  std::ifstream pressure("/proc/pressure/memory");
+  std::string line;
+  while (std::getline(pressure, line)) {
+    const std::string kFullPrefix("full avg10=");
+    if (line.compare(0, kFullPrefix.size(), kFullPrefix) == 0) {
+      return strtod(line.c_str() + kFullPrefix.size(), nullptr);
+    }
+  }
+  return stdext::nullopt;
+}
+#endif
+
+}  // namespace
+
+SystemLoadSample SampleSystemLoad() {
+  SystemLoadSample sample;
+
+  double load_averages[1];
+  if (getloadavg(load_averages, 1) == 1) {
+    sample.load_average = load_averages[0];
+  }
+
+#if defined(__linux__)
+  sample.available_memory = ReadMemInfoValue("MemAvailable:");
+  stdext::optional<uint64_t> cgroup_headroom = GetCgroupMemoryHeadroom();
+  if (cgroup_headroom) {
+    sample.available_memory = sample.available_memory ?
+        std::min(*sample.available_memory, *cgroup_headroom) :
+        *cgroup_headroom;
+  }
+  sample.memory_pressure = GetMemoryPressure();
+#endif
+
+  return sample;
+}
+
+}  // namespace platform
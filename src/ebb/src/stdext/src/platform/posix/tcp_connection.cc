@@ -0,0 +1,142 @@
+#include "platform/tcp_connection.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace platform {
+
+namespace {
+#if defined(MSG_NOSIGNAL)
+// Report writes to closed connections as errors, rather than with SIGPIPE.
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+// Connects |fd| to |address|, waiting no longer than |timeout|.
+bool ConnectWithTimeout(int fd, const struct addrinfo* address,
+                        std::chrono::milliseconds timeout) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    return false;
+  }
+  if (connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+    if (errno != EINPROGRESS) {
+      return false;
+    }
+    struct pollfd poll_fd = {fd, POLLOUT, 0};
+    int result;
+    do {
+      result = poll(&poll_fd, 1, static_cast<int>(timeout.count()));
+    } while (result == -1 && errno == EINTR);
+    int error = 0;
+    socklen_t error_size = sizeof(error);
+    if (result != 1 ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size) != 0 ||
+        error != 0) {
+      return false;
+    }
+  }
+  return fcntl(fd, F_SETFL, flags) != -1;
+}
+}  // namespace
+
+struct TcpConnection::PlatformData {
+  PlatformData() : fd(-1) {}
+  ~PlatformData() {
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+
+  int fd;
+};
+
+TcpConnection::TcpConnection(std::unique_ptr<PlatformData> platform_data)
+    : platform_data_(std::move(platform_data)) {}
+
+TcpConnection::~TcpConnection() {}
+
+// static
+std::unique_ptr<TcpConnection> TcpConnection::Connect(
+    const std::string& host, int port, std::chrono::milliseconds timeout) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints,
+                  &addresses) != 0) {
+    return nullptr;
+  }
+
+  std::unique_ptr<PlatformData> data(new PlatformData());
+  for (struct addrinfo* address = addresses; address;
+       address = address->ai_next) {
+    int fd = socket(address->ai_family, address->ai_socktype,
+                    address->ai_protocol);
+    if (fd == -1) {
+      continue;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (ConnectWithTimeout(fd, address, timeout)) {
+      data->fd = fd;
+      break;
+    }
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+  if (data->fd == -1) {
+    return nullptr;
+  }
+
+  struct timeval timeout_value;
+  timeout_value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  timeout_value.tv_usec = static_cast<suseconds_t>(
+      (timeout.count() % 1000) * 1000);
+  setsockopt(data->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout_value,
+             sizeof(timeout_value));
+  setsockopt(data->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout_value,
+             sizeof(timeout_value));
+#if defined(SO_NOSIGPIPE)
+  int no_sigpipe = 1;
+  setsockopt(data->fd, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe,
+             sizeof(no_sigpipe));
+#endif
+
+  return std::unique_ptr<TcpConnection>(new TcpConnection(std::move(data)));
+}
+
+bool TcpConnection::Write(const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t result = send(platform_data_->fd, data, size, kSendFlags);
+    if (result == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += result;
+    size -= static_cast<size_t>(result);
+  }
+  return true;
+}
+
+int64_t TcpConnection::Read(char* data, size_t size) {
+  while (true) {
+    ssize_t result = recv(platform_data_->fd, data, size, 0);
+    if (result == -1 && errno == EINTR) {
+      continue;
+    }
+    return result;
+  }
+}
+
+}  // namespace platform
@@ -1,18 +1,111 @@
 #ifndef __PLATFORM_SUBPROCESS_H__
 #define __PLATFORM_SUBPROCESS_H__
 
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
 #include "stdext/file_system.h"
 #include "stdext/optional.h"
 
 namespace platform {
 
-// Executes the given system command, with stdout/stderr/stdin redirected to
-// or from the given files, or null if files are not provided.
-int SystemCommand(
-    const char* command,
-    const stdext::optional<stdext::file_system::Path>& stdout_file,
-    const stdext::optional<stdext::file_system::Path>& stderr_file,
-    const stdext::optional<stdext::file_system::Path>& stdin_file);
+// The most output that is kept from each captured stream of a command.
+// Anything beyond this is dropped, and a note is appended saying so.
+const size_t kMaxCapturedOutputBytes = 1024 * 1024;
+
+struct SystemCommandParams {
+  explicit SystemCommandParams(const std::string& command)
+      : command(command), capture_stdout(false), capture_stderr(false) {}
+
+  // The command line, which on POSIX systems is interpreted by /bin/sh.
+  std::string command;
+  // If set, argv[0] is searched for in the PATH and executed directly with
+  // these arguments, bypassing the shell.  |command| should then be equivalent
+  // and is only used for display purposes.  Ignored on Windows, where
+  // |command| is never interpreted by a shell in the first place.
+  stdext::optional<std::vector<std::string>> argv;
+
+  // Files that stdout/stderr/stdin are redirected to or from, or null if
+  // files are not provided.
+  stdext::optional<stdext::file_system::Path> stdout_file;
+  stdext::optional<stdext::file_system::Path> stderr_file;
+  stdext::optional<stdext::file_system::Path> stdin_file;
+
+  // If true, the stream is read through a pipe into the corresponding
+  // SystemCommandResult output string, instead of being redirected to a file.
+  // The matching |stdout_file| or |stderr_file| must not also be set.
+  bool capture_stdout;
+  bool capture_stderr;
+
+  // If set, the command is terminated if it is still running after this
+  // long.  On POSIX systems the command is run in its own process group, all
+  // of which is sent SIGTERM, followed by SIGKILL if it has still not exited
+  // after a grace period.
+  stdext::optional<std::chrono::milliseconds> timeout;
+};
+
+// The resources consumed by a command that has exited, including those of any
+// descendants that it waited for.
+struct ResourceUsage {
+  ResourceUsage()
+      : user_time(0), system_time(0), max_rss_bytes(0),
+        block_input_operations(0), block_output_operations(0) {}
+
+  std::chrono::microseconds user_time;
+  std::chrono::microseconds system_time;
+  // The peak resident set size (or peak working set size on Windows).
+  uint64_t max_rss_bytes;
+  uint64_t block_input_operations;
+  uint64_t block_output_operations;
+};
+
+struct SystemCommandResult {
+  // Implicit, so that a plain exit status can be used as a result.
+  SystemCommandResult(int exit_code = 0)
+      : exit_code(exit_code), timed_out(false) {}
+
+  // Zero if the command succeeded.
+  int exit_code;
+  // True if the command was terminated because it exceeded its timeout.
+  bool timed_out;
+  // Disengaged if the command could not be started, or if its resource usage
+  // is otherwise not available.
+  stdext::optional<ResourceUsage> resource_usage;
+  // The output of the command, if SystemCommandParams asked for it to be
+  // captured.  Only output written before the command exits is collected, so
+  // anything written afterwards by processes that it left running is lost.
+  std::string stdout_output;
+  std::string stderr_output;
+};
+
+// Executes the given system command and returns its exit status.
+SystemCommandResult SystemCommand(const SystemCommandParams& params);
+
+// Called with the same result that SystemCommand() would have returned.
+using SystemCommandExitFunction =
+    std::function<void(const SystemCommandResult&)>;
+
+// Starts the given system command and returns immediately, without waiting
+// for it to complete.  When the command exits, |on_exit| is called from a
+// background thread that is shared between all running commands.  If the
+// command could not be started, |on_exit| is called before this function
+// returns.
+void SystemCommandAsync(
+    const SystemCommandParams& params,
+    const SystemCommandExitFunction& on_exit);
+
+// Forks off a small helper process which will then perform all subsequent
+// SystemCommandAsync() spawns on behalf of this process.  The cost of
+// spawning a child grows with the size of the parent's address space, so this
+// should be called early, while this process is still small and before it
+// has started any threads.  Returns false if the spawn server could not be
+// started, or is not supported on this platform, in which case commands
+// continue to be spawned directly.
+bool StartSpawnServer();
 
 }  // namespace platform
 
@@ -0,0 +1,27 @@
+#ifndef __PLATFORM_SYSTEM_LOAD_H__
+#define __PLATFORM_SYSTEM_LOAD_H__
+
+#include <stdint.h>
+
+#include "stdext/optional.h"
+
+namespace platform {
+
+// A snapshot of how busy the machine is.  Each value is disengaged if it could
+// not be determined on this platform.
+struct SystemLoadSample {
+  // The 1 minute load average.
+  stdext::optional<double> load_average;
+  // The number of bytes of memory that can still be allocated before we start
+  // swapping or hit our cgroup's memory limit, whichever is smaller.
+  stdext::optional<uint64_t> available_memory;
+  // The percentage of time over the last 10 seconds during which all
+  // non-idle tasks were stalled waiting for memory.
+  stdext::optional<double> memory_pressure;
+};
+
+SystemLoadSample SampleSystemLoad();
+
+}  // namespace platform
+
+#endif  // __PLATFORM_SYSTEM_LOAD_H__
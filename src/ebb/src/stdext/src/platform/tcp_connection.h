@@ -0,0 +1,42 @@
+#ifndef __PLATFORM_TCP_CONNECTION_H__
+#define __PLATFORM_TCP_CONNECTION_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace platform {
+
+// A client's connection to a TCP server.  Every operation gives up after the
+// timeout given when connecting, so that an unresponsive server can't hold up
+// its caller indefinitely.
+class TcpConnection {
+ public:
+  // Connects to |port| on |host|, which may be a name or an address.  Returns
+  // null if no connection could be made within |timeout|.
+  static std::unique_ptr<TcpConnection> Connect(
+      const std::string& host, int port, std::chrono::milliseconds timeout);
+  ~TcpConnection();
+
+  // Sends all of |data|.  Returns false if the connection fails first.
+  bool Write(const char* data, size_t size);
+
+  // Receives up to |size| bytes into |data|, blocking until at least one is
+  // available.  Returns the number received, 0 once the server has closed the
+  // connection, or -1 on failure.
+  int64_t Read(char* data, size_t size);
+
+  // Opaque platform specific state.
+  struct PlatformData;
+
+ private:
+  TcpConnection(std::unique_ptr<PlatformData> platform_data);
+
+  std::unique_ptr<PlatformData> platform_data_;
+};
+
+}  // namespace platform
+
+#endif  // __PLATFORM_TCP_CONNECTION_H__
@@ -1,12 +1,23 @@
 #include "platform/file_system.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ftw.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 #include <iostream>
+#include <memory>
+#include <string>
 
 namespace platform {
 
@@ -22,6 +33,23 @@ stdext::optional<std::chrono::system_clock::time_point>
       + std::chrono::nanoseconds(buffer.st_mtim.tv_nsec);
 }
 
+stdext::optional<FileStatus> GetFileStatus(const char* filepath) {
+  struct stat buffer;
+
+  if (stat(filepath, &buffer) != 0) {
+    return stdext::nullopt;
+  }
+
+  FileStatus status;
+  status.id = static_cast<uint64_t>(buffer.st_ino);
+  status.size = static_cast<uint64_t>(buffer.st_size);
+  status.last_modification_time =
+      std::chrono::system_clock::from_time_t(buffer.st_mtim.tv_sec)
+      + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(buffer.st_mtim.tv_nsec));
+  return status;
+}
+
 const char* kPathSeparator = "/";
 
 const bool kFileModificationTimeConsistentWithSystemClock = false;
@@ -61,6 +89,247 @@ bool RemoveDirectoryTree(const char* filepath) {
   return true;
 }
 
+namespace {
+// Closes |fd| when going out of scope.
+class ScopedFd {
+ public:
+  explicit ScopedFd(int fd) : fd_(fd) {}
+  ~ScopedFd() {
+    if (fd_ != -1) close(fd_);
+  }
+  int get() const { return fd_; }
+  // Closes the file now, returning false if that fails, e.g. because of a
+  // deferred write error.
+  bool Close() {
+    int fd = fd_;
+    fd_ = -1;
+    return close(fd) == 0;
+  }
+
+ private:
+  int fd_;
+};
+
+#if defined(__linux__) && defined(SYS_copy_file_range)
+// Copies as much as possible of |in_fd| to |out_fd| within the kernel.
+// Returns false if nothing could be copied this way, in which case the caller
+// should fall back to copying through user space from the current offsets.
+bool CopyWithinKernel(int in_fd, int out_fd) {
+  const size_t kChunkSize = 1 << 30;
+  while (true) {
+    ssize_t copied = syscall(
+        SYS_copy_file_range, in_fd, nullptr, out_fd, nullptr, kChunkSize, 0);
+    if (copied == 0) {
+      return true;
+    }
+    if (copied == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // e.g. EXDEV on older kernels, or ENOSYS.  Since we don't pass offsets,
+      // whatever was copied so far is reflected in the file offsets, so the
+      // caller can pick up from there.
+      return false;
+    }
+  }
+}
+#endif
+
+bool CopyThroughUserSpace(int in_fd, int out_fd) {
+  // Kept off of the stack, since this may be called from a fiber.
+  const size_t kBufferSize = 64 * 1024;
+  std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+  while (true) {
+    ssize_t num_read = read(in_fd, buffer.get(), kBufferSize);
+    if (num_read == 0) {
+      return true;
+    }
+    if (num_read == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    const char* data = buffer.get();
+    while (num_read > 0) {
+      ssize_t written = write(out_fd, data, num_read);
+      if (written == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += written;
+      num_read -= written;
+    }
+  }
+}
+}  // namespace
+
+namespace {
+#if defined(O_PATH)
+// The directory is only used to look up the files within it.
+const int kDirectoryOpenFlags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+#else
+const int kDirectoryOpenFlags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+#endif
+
+std::chrono::system_clock::time_point ToTimePoint(
+    int64_t seconds, int64_t nanoseconds) {
+  return std::chrono::system_clock::from_time_t(static_cast<time_t>(seconds))
+      + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(nanoseconds));
+}
+
+// Returns the modification time of |name| within the directory |dir_fd|.
+stdext::optional<std::chrono::system_clock::time_point>
+    GetLastModificationTimeAt(int dir_fd, const char* name) {
+#if defined(__linux__) && defined(STATX_MTIME)
+  // Only ask for the modification time, so that file systems that have to
+  // fetch attributes remotely can skip the rest.
+  struct statx statx_buffer;
+  if (statx(dir_fd, name, 0, STATX_MTIME, &statx_buffer) == 0) {
+    if (statx_buffer.stx_mask & STATX_MTIME) {
+      return ToTimePoint(statx_buffer.stx_mtime.tv_sec,
+                         statx_buffer.stx_mtime.tv_nsec);
+    }
+  } else if (errno == ENOENT || errno == ENOTDIR) {
+    return stdext::nullopt;
+  }
+  // Otherwise statx() isn't available, e.g. on an older kernel or inside a
+  // sandbox that doesn't know about it, so fall back to fstatat().
+#endif
+  struct stat buffer;
+  if (fstatat(dir_fd, name, &buffer, 0) != 0) {
+    return stdext::nullopt;
+  }
+  return ToTimePoint(buffer.st_mtim.tv_sec, buffer.st_mtim.tv_nsec);
+}
+
+// Returns the offset of the name within |filepath|, or 0 if there's no
+// directory part to look it up relative to.
+size_t NameOffset(const char* filepath) {
+  const char* separator = strrchr(filepath, '/');
+  if (!separator || separator[1] == '\0') {
+    // Paths ending in a separator have no name to look up on its own.
+    return 0;
+  }
+  return separator - filepath + 1;
+}
+}  // namespace
+
+void GetLastModificationTimes(
+    const char* const* filepaths, size_t count,
+    stdext::optional<std::chrono::system_clock::time_point>* times) {
+  size_t begin = 0;
+  while (begin < count) {
+    size_t name_offset = NameOffset(filepaths[begin]);
+    size_t end = begin + 1;
+    if (name_offset > 0) {
+      while (end < count && NameOffset(filepaths[end]) == name_offset &&
+             strncmp(filepaths[begin], filepaths[end], name_offset) == 0) {
+        ++end;
+      }
+    }
+
+    int dir_fd = -1;
+    if (end - begin > 1) {
+      // Keep the separator for files in the root directory.
+      std::string directory(
+          filepaths[begin], name_offset == 1 ? 1 : name_offset - 1);
+      dir_fd = open(directory.c_str(), kDirectoryOpenFlags);
+    }
+    if (dir_fd == -1) {
+      // Either there's nothing to share, or the directory can't be opened,
+      // in which case stat() will report the reason for each file anyway.
+      for (size_t i = begin; i < end; ++i) {
+        times[i] = GetLastModificationTime(filepaths[i]);
+      }
+    } else {
+      ScopedFd scoped_dir_fd(dir_fd);
+      for (size_t i = begin; i < end; ++i) {
+        times[i] = GetLastModificationTimeAt(
+            dir_fd, filepaths[i] + name_offset);
+      }
+    }
+    begin = end;
+  }
+}
+
+bool CopyRegularFile(const char* source, const char* destination) {
+  ScopedFd in_fd(open(source, O_RDONLY | O_CLOEXEC));
+  if (in_fd.get() == -1) {
+    return false;
+  }
+  struct stat source_stat;
+  if (fstat(in_fd.get(), &source_stat) != 0 || !S_ISREG(source_stat.st_mode)) {
+    return false;
+  }
+
+  // Always create a new file rather than overwriting the existing one in
+  // place, both so that a reflink is possible, and so that anything else
+  // sharing the old file (e.g. a hard link, or a running executable) is left
+  // alone.
+  if (unlink(destination) != 0 && errno != ENOENT) {
+    return false;
+  }
+  ScopedFd out_fd(open(destination, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                       source_stat.st_mode & 07777));
+  if (out_fd.get() == -1) {
+    return false;
+  }
+
+  bool copied = false;
+#if defined(__linux__) && defined(FICLONE)
+  // Share the source's storage if the file system supports it (e.g. btrfs or
+  // XFS).
+  copied = ioctl(out_fd.get(), FICLONE, in_fd.get()) == 0;
+#endif
+#if defined(__linux__) && defined(SYS_copy_file_range)
+  if (!copied) {
+    copied = CopyWithinKernel(in_fd.get(), out_fd.get());
+  }
+#endif
+  if (!copied) {
+    copied = CopyThroughUserSpace(in_fd.get(), out_fd.get());
+  }
+
+  if (!out_fd.Close() || !copied) {
+    unlink(destination);
+    return false;
+  }
+  return true;
+}
+
+bool TouchFile(const char* filepath) {
+  if (utimensat(AT_FDCWD, filepath, nullptr, 0) == 0) {
+    return true;
+  }
+  if (errno != ENOENT) {
+    return false;
+  }
+  ScopedFd fd(open(filepath, O_WRONLY | O_CREAT | O_CLOEXEC, 0666));
+  return fd.get() != -1 && fd.Close();
+}
+
+bool MakeDirectories(const char* filepath) {
+  std::string path(filepath);
+  // Create each of the parents in turn, skipping over the root.
+  for (size_t separator = path.find('/', 1); separator != std::string::npos;
+       separator = path.find('/', separator + 1)) {
+    std::string parent = path.substr(0, separator);
+    if (mkdir(parent.c_str(), 0777) != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+  if (mkdir(filepath, 0777) != 0 && errno != EEXIST) {
+    return false;
+  }
+
+  struct stat buffer;
+  return stat(filepath, &buffer) == 0 && S_ISDIR(buffer.st_mode);
+}
+
 std::string GetThisModulePath() {
   const size_t kBufferSize = 512;
   char path_buffer[kBufferSize];
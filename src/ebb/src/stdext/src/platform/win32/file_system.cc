@@ -9,6 +9,19 @@
 
 namespace platform {
 
+namespace {
+std::chrono::system_clock::time_point ToTimePoint(const FILETIME& file_time) {
+  uint64_t nanoseconds100 =
+      (static_cast<uint64_t>(file_time.dwHighDateTime) << 32) +
+      file_time.dwLowDateTime;
+
+  return std::chrono::system_clock::from_time_t(0) +
+    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+      std::chrono::nanoseconds(nanoseconds100 * 100) -
+      std::chrono::seconds(11644473600LL));
+}
+}  // namespace
+
 stdext::optional<std::chrono::system_clock::time_point>
     GetLastModificationTime(const char* filepath) {
   WIN32_FILE_ATTRIBUTE_DATA file_info = {0};
@@ -17,14 +30,40 @@ stdext::optional<std::chrono::system_clock::time_point>
     return stdext::optional<std::chrono::system_clock::time_point>();
   }
 
-  uint64_t nanoseconds100 =
-      (static_cast<uint64_t>(file_info.ftLastWriteTime.dwHighDateTime) << 32) +
-      file_info.ftLastWriteTime.dwLowDateTime;
+  return ToTimePoint(file_info.ftLastWriteTime);
+}
 
-  return std::chrono::system_clock::from_time_t(0) +
-    std::chrono::duration_cast<std::chrono::system_clock::duration>(
-      std::chrono::nanoseconds(nanoseconds100 * 100) -
-      std::chrono::seconds(11644473600LL));
+void GetLastModificationTimes(
+    const char* const* filepaths, size_t count,
+    stdext::optional<std::chrono::system_clock::time_point>* times) {
+  for (size_t i = 0; i < count; ++i) {
+    times[i] = GetLastModificationTime(filepaths[i]);
+  }
+}
+
+stdext::optional<FileStatus> GetFileStatus(const char* filepath) {
+  // Only an open handle can tell us the file's index.  FILE_FLAG_BACKUP_SEMANTICS
+  // is required in order to open directories.
+  HANDLE handle = CreateFileA(
+      filepath, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return stdext::nullopt;
+  }
+  BY_HANDLE_FILE_INFORMATION file_info;
+  bool success = GetFileInformationByHandle(handle, &file_info) != 0;
+  CloseHandle(handle);
+  if (!success) {
+    return stdext::nullopt;
+  }
+
+  FileStatus status;
+  status.id = (static_cast<uint64_t>(file_info.nFileIndexHigh) << 32) +
+              file_info.nFileIndexLow;
+  status.size = (static_cast<uint64_t>(file_info.nFileSizeHigh) << 32) +
+                file_info.nFileSizeLow;
+  status.last_modification_time = ToTimePoint(file_info.ftLastWriteTime);
+  return status;
 }
 
 const char* kPathSeparator = "\\";
@@ -99,6 +138,57 @@ bool RemoveDirectoryTree(const char* filepath) {
   return result == 0;
 }
 
+bool CopyRegularFile(const char* source, const char* destination) {
+  if (!CopyFileA(source, destination, FALSE)) {
+    return false;
+  }
+  // CopyFile() preserves the source's modification time, but the copy is a
+  // new output and should look newer than its inputs.
+  return TouchFile(destination);
+}
+
+bool TouchFile(const char* filepath) {
+  // FILE_FLAG_BACKUP_SEMANTICS is required in order to open directories.
+  HANDLE handle = CreateFileA(
+      filepath, FILE_WRITE_ATTRIBUTES,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+      OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  bool success = SetFileTime(handle, NULL, &now, &now) != 0;
+  CloseHandle(handle);
+  return success;
+}
+
+bool MakeDirectories(const char* filepath) {
+  std::string path(filepath);
+  for (size_t separator = path.find_first_of("/\\", 1);
+       separator != std::string::npos;
+       separator = path.find_first_of("/\\", separator + 1)) {
+    std::string parent = path.substr(0, separator);
+    // Skip over drive letters, e.g. "C:".
+    if (!parent.empty() && parent.back() == ':') {
+      continue;
+    }
+    if (!CreateDirectoryA(parent.c_str(), NULL) &&
+        GetLastError() != ERROR_ALREADY_EXISTS) {
+      return false;
+    }
+  }
+  if (!CreateDirectoryA(filepath, NULL) &&
+      GetLastError() != ERROR_ALREADY_EXISTS) {
+    return false;
+  }
+
+  DWORD attributes = GetFileAttributesA(filepath);
+  return attributes != INVALID_FILE_ATTRIBUTES &&
+         (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
 std::string GetThisModulePath() {
   HMODULE module = GetModuleHandleW(NULL);
   char path_str[MAX_PATH];
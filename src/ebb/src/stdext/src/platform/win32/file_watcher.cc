@@ -0,0 +1,30 @@
+#include "platform/file_watcher.h"
+
+namespace platform {
+
+// Watching for changes on Windows would be based on ReadDirectoryChangesW,
+// which is not yet supported, so no watcher is ever created.
+struct FileWatcher::PlatformData {};
+
+FileWatcher::FileWatcher(std::unique_ptr<PlatformData> platform_data)
+    : platform_data_(std::move(platform_data)) {}
+
+FileWatcher::~FileWatcher() {}
+
+// static
+std::unique_ptr<FileWatcher> FileWatcher::Create() {
+  return nullptr;
+}
+
+bool FileWatcher::AddDirectory(const std::string& path) {
+  return false;
+}
+
+FileWatcher::Changes FileWatcher::WaitForChanges(
+    std::chrono::milliseconds quiet_period) {
+  Changes changes;
+  changes.overflowed = true;
+  return changes;
+}
+
+}  // namespace platform
@@ -0,0 +1,36 @@
+#include "platform/jobserver.h"
+
+namespace platform {
+
+// Jobservers on Windows are based on named semaphores, which are not yet
+// supported, so no jobserver is ever connected to or created.
+struct Jobserver::PlatformData {};
+
+Jobserver::Jobserver(std::unique_ptr<PlatformData> platform_data,
+                     const std::string& makeflags)
+    : platform_data_(std::move(platform_data)), makeflags_(makeflags) {}
+
+Jobserver::~Jobserver() {}
+
+// static
+std::unique_ptr<Jobserver> Jobserver::ConnectFromMakeflags(
+    const char* makeflags) {
+  return nullptr;
+}
+
+// static
+std::unique_ptr<Jobserver> Jobserver::Create(int num_tokens, Style style) {
+  return nullptr;
+}
+
+stdext::optional<char> Jobserver::AcquireToken() {
+  return stdext::nullopt;
+}
+
+void Jobserver::CancelAcquire() {}
+
+void Jobserver::ExportToEnvironment() const {}
+
+void Jobserver::ReleaseToken(char token) {}
+
+}  // namespace platform
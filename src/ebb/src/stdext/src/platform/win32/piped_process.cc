@@ -0,0 +1,173 @@
+#include "platform/piped_process.h"
+
+#include <windows.h>
+
+#include <memory>
+#include <string>
+
+namespace platform {
+
+namespace {
+// How long a child has to exit on its own after its stdin is closed, before
+// it is killed.
+const DWORD kExitGracePeriodMs = 1000;
+
+// Quotes |arg| so that it is parsed back out as a single argument by the
+// child's C runtime.
+std::string QuoteArgument(const std::string& arg) {
+  if (!arg.empty() && arg.find_first_of(" \t\n\v\"") == std::string::npos) {
+    return arg;
+  }
+
+  std::string quoted("\"");
+  size_t num_backslashes = 0;
+  for (char c : arg) {
+    if (c == '\\') {
+      ++num_backslashes;
+      continue;
+    }
+    if (c == '"') {
+      // Backslashes preceding a quote must be escaped, as must the quote.
+      quoted.append(num_backslashes * 2 + 1, '\\');
+    } else {
+      quoted.append(num_backslashes, '\\');
+    }
+    num_backslashes = 0;
+    quoted.push_back(c);
+  }
+  // Backslashes preceding the closing quote must also be escaped.
+  quoted.append(num_backslashes * 2, '\\');
+  quoted.push_back('"');
+  return quoted;
+}
+
+void CloseIfValid(HANDLE handle) {
+  if (handle != NULL && handle != INVALID_HANDLE_VALUE) {
+    CloseHandle(handle);
+  }
+}
+}  // namespace
+
+struct PipedProcess::PlatformData {
+  PlatformData() : process(NULL), stdin_write(NULL), stdout_read(NULL) {}
+
+  ~PlatformData() {
+    CloseIfValid(stdin_write);
+    CloseIfValid(stdout_read);
+    if (process == NULL) {
+      return;
+    }
+    if (WaitForSingleObject(process, kExitGracePeriodMs) != WAIT_OBJECT_0) {
+      TerminateProcess(process, 1);
+      WaitForSingleObject(process, INFINITE);
+    }
+    CloseHandle(process);
+  }
+
+  HANDLE process;
+  HANDLE stdin_write;
+  HANDLE stdout_read;
+};
+
+PipedProcess::PipedProcess(std::unique_ptr<PlatformData> platform_data)
+    : platform_data_(std::move(platform_data)) {}
+
+PipedProcess::~PipedProcess() {}
+
+// static
+std::unique_ptr<PipedProcess> PipedProcess::Start(
+    const std::vector<std::string>& argv) {
+  if (argv.empty()) {
+    return nullptr;
+  }
+
+  std::string command_line;
+  for (const auto& arg : argv) {
+    if (!command_line.empty()) {
+      command_line.push_back(' ');
+    }
+    command_line += QuoteArgument(arg);
+  }
+  std::unique_ptr<char[]> command_copy(new char[command_line.size() + 1]);
+  strcpy(command_copy.get(), command_line.c_str());
+
+  SECURITY_ATTRIBUTES security_attributes;
+  memset(&security_attributes, 0, sizeof(security_attributes));
+  security_attributes.nLength = sizeof(security_attributes);
+  security_attributes.bInheritHandle = TRUE;
+
+  std::unique_ptr<PlatformData> data(new PlatformData());
+  HANDLE stdin_read = NULL;
+  HANDLE stdout_write = NULL;
+  if (!CreatePipe(&stdin_read, &data->stdin_write, &security_attributes, 0)) {
+    return nullptr;
+  }
+  if (!CreatePipe(
+          &data->stdout_read, &stdout_write, &security_attributes, 0)) {
+    CloseHandle(stdin_read);
+    return nullptr;
+  }
+  // Only the child's ends of the pipes should be inherited.
+  SetHandleInformation(data->stdin_write, HANDLE_FLAG_INHERIT, 0);
+  SetHandleInformation(data->stdout_read, HANDLE_FLAG_INHERIT, 0);
+
+  HANDLE null_handle = CreateFileA(
+      "NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+      &security_attributes, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  STARTUPINFOA startup_info;
+  memset(&startup_info, 0, sizeof(startup_info));
+  startup_info.cb = sizeof(startup_info);
+  startup_info.dwFlags |= STARTF_USESTDHANDLES;
+  startup_info.hStdInput = stdin_read;
+  startup_info.hStdOutput = stdout_write;
+  startup_info.hStdError = null_handle;
+
+  PROCESS_INFORMATION process_info;
+  memset(&process_info, 0, sizeof(process_info));
+  BOOL created = CreateProcessA(
+      NULL, command_copy.get(), NULL, NULL, TRUE, 0, NULL, NULL,
+      &startup_info, &process_info);
+
+  // The child holds its own copies of these now.
+  CloseHandle(stdin_read);
+  CloseHandle(stdout_write);
+  CloseIfValid(null_handle);
+
+  if (!created) {
+    return nullptr;
+  }
+  CloseHandle(process_info.hThread);
+  data->process = process_info.hProcess;
+
+  return std::unique_ptr<PipedProcess>(new PipedProcess(std::move(data)));
+}
+
+bool PipedProcess::Write(const char* data, size_t size) {
+  while (size > 0) {
+    DWORD written = 0;
+    if (!WriteFile(platform_data_->stdin_write, data,
+                   static_cast<DWORD>(size), &written, NULL)) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool PipedProcess::Read(char* data, size_t size) {
+  while (size > 0) {
+    DWORD num_read = 0;
+    if (!ReadFile(platform_data_->stdout_read, data,
+                  static_cast<DWORD>(size), &num_read, NULL) ||
+        num_read == 0) {
+      return false;
+    }
+    data += num_read;
+    size -= num_read;
+  }
+  return true;
+}
+
+}  // namespace platform
@@ -2,8 +2,12 @@
 
 #include <stdlib.h>
 #include <windows.h>
+#include <psapi.h>
 
+#include <algorithm>
 #include <memory>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 namespace platform {
@@ -100,15 +104,133 @@ class ScopedAttributeList {
   bool updated_ = false;
 };
 
-}  // namespace
+// While output is being captured, this is how often we check for more.
+const DWORD kOutputPollIntervalMs = 10;
+
+// The read end of a pipe that a child's output is captured through.
+class CapturedOutput {
+ public:
+  CapturedOutput() : read_handle_(NULL), dropped_bytes_(0) {}
+  ~CapturedOutput() {
+    if (read_handle_ != NULL) {
+      CloseHandle(read_handle_);
+    }
+  }
+
+  CapturedOutput(const CapturedOutput&) = delete;
+  CapturedOutput& operator=(const CapturedOutput&) = delete;
+
+  // Creates the pipe, and returns its write end for the child to inherit,
+  // or NULL on failure.  The caller is responsible for closing it.
+  HANDLE Create() {
+    _SECURITY_ATTRIBUTES security_attributes;
+    memset(&security_attributes, 0, sizeof(security_attributes));
+    security_attributes.nLength = sizeof(security_attributes);
+    security_attributes.bInheritHandle = TRUE;
+
+    HANDLE write_handle;
+    if (!CreatePipe(&read_handle_, &write_handle, &security_attributes, 0)) {
+      read_handle_ = NULL;
+      return NULL;
+    }
+    SetHandleInformation(read_handle_, HANDLE_FLAG_INHERIT, 0);
+    return write_handle;
+  }
+
+  bool active() const { return read_handle_ != NULL; }
+
+  // Reads whatever output is available without blocking, up to a limit so
+  // that a child producing endless output can't keep us here forever.
+  void ReadAvailable() {
+    const int kMaxReadsPerCall = 64;
+    char buffer[16 * 1024];
+    for (int i = 0; i < kMaxReadsPerCall && read_handle_ != NULL; ++i) {
+      DWORD available = 0;
+      if (!PeekNamedPipe(read_handle_, NULL, 0, NULL, &available, NULL)) {
+        // The child has closed its end.
+        CloseHandle(read_handle_);
+        read_handle_ = NULL;
+        return;
+      }
+      if (available == 0) {
+        return;
+      }
+      DWORD num_read = 0;
+      if (!ReadFile(read_handle_, buffer,
+                    std::min<DWORD>(available, sizeof(buffer)), &num_read,
+                    NULL)) {
+        return;
+      }
+      size_t kept = std::min<size_t>(
+          num_read,
+          kMaxCapturedOutputBytes -
+              std::min(output_.size(), kMaxCapturedOutputBytes));
+      output_.append(buffer, kept);
+      dropped_bytes_ += num_read - kept;
+    }
+  }
+
+  // Reads whatever is left, closes the pipe and returns the output.
+  std::string Finish() {
+    ReadAvailable();
+    if (read_handle_ != NULL) {
+      CloseHandle(read_handle_);
+      read_handle_ = NULL;
+    }
+    if (dropped_bytes_ > 0) {
+      std::ostringstream note;
+      note << std::endl << "[" << dropped_bytes_
+           << " more bytes of output were dropped]" << std::endl;
+      output_ += note.str();
+    }
+    return std::move(output_);
+  }
+
+ private:
+  HANDLE read_handle_;
+  std::string output_;
+  uint64_t dropped_bytes_;
+};
+
+// A command that has been started.
+struct RunningCommand {
+  PROCESS_INFORMATION process_info;
+  CapturedOutput stdout_output;
+  CapturedOutput stderr_output;
+};
+
+// Closes the handles that it is given on destruction.
+class ScopedHandleList {
+ public:
+  ScopedHandleList() {}
+  ScopedHandleList(const ScopedHandleList&) = delete;
+  ScopedHandleList& operator=(const ScopedHandleList&) = delete;
+  ~ScopedHandleList() {
+    for (HANDLE handle : handles_) {
+      CloseHandle(handle);
+    }
+  }
+
+  void Add(HANDLE handle) { handles_.push_back(handle); }
+
+ private:
+  std::vector<HANDLE> handles_;
+};
 
-int SystemCommand(
-    const char* command,
-    const stdext::optional<stdext::file_system::Path>& stdout_file,
-    const stdext::optional<stdext::file_system::Path>& stderr_file,
-    const stdext::optional<stdext::file_system::Path>& stdin_file) {
-  std::unique_ptr<char[]> command_copy(new char[strlen(command) + 1]);
-  strcpy(command_copy.get(), command);
+// Starts the command, filling in |command| on success.
+bool StartSystemCommand(
+    const SystemCommandParams& params, RunningCommand* command) {
+  PROCESS_INFORMATION* process_info = &command->process_info;
+  const std::string& command = params.command;
+  const stdext::optional<stdext::file_system::Path>& stdout_file =
+      params.stdout_file;
+  const stdext::optional<stdext::file_system::Path>& stderr_file =
+      params.stderr_file;
+  const stdext::optional<stdext::file_system::Path>& stdin_file =
+      params.stdin_file;
+
+  std::unique_ptr<char[]> command_copy(new char[command.size() + 1]);
+  strcpy(command_copy.get(), command.c_str());
 
   STARTUPINFOEX startup_info;
   memset(&startup_info, 0, sizeof(startup_info));
@@ -120,20 +242,39 @@ int SystemCommand(
   stdext::optional<ScopedHandle> stdin_handle;
 
   std::vector<HANDLE> redirect_handles;
-
-  if (stdout_file) {
+  // Our copies of the pipes' write ends must be closed once the child has
+  // inherited them, so that only the child holds them open.
+  ScopedHandleList pipe_write_handles;
+
+  if (params.capture_stdout) {
+    HANDLE write_handle = command->stdout_output.Create();
+    if (write_handle == NULL) {
+      return false;
+    }
+    pipe_write_handles.Add(write_handle);
+    startup_info.StartupInfo.hStdOutput = write_handle;
+    redirect_handles.push_back(write_handle);
+  } else if (stdout_file) {
     stdout_handle.emplace(*stdout_file, kOpenForWriting);
     if (stdout_handle->handle() == INVALID_HANDLE_VALUE) {
-      return 1;
+      return false;
     }
     startup_info.StartupInfo.hStdOutput = stdout_handle->handle();
     redirect_handles.push_back(stdout_handle->handle());
   }
 
-  if (stderr_file) {
+  if (params.capture_stderr) {
+    HANDLE write_handle = command->stderr_output.Create();
+    if (write_handle == NULL) {
+      return false;
+    }
+    pipe_write_handles.Add(write_handle);
+    startup_info.StartupInfo.hStdError = write_handle;
+    redirect_handles.push_back(write_handle);
+  } else if (stderr_file) {
     stderr_handle.emplace(*stderr_file, kOpenForWriting);
     if (stderr_handle->handle() == INVALID_HANDLE_VALUE) {
-      return 1;
+      return false;
     }
     startup_info.StartupInfo.hStdError = stderr_handle->handle();
     redirect_handles.push_back(stderr_handle->handle());
@@ -142,7 +283,7 @@ int SystemCommand(
   if (stdin_file) {
     stdin_handle.emplace(*stdin_file, kOpenForReading);
     if (stdin_handle->handle() == INVALID_HANDLE_VALUE) {
-      return 1;
+      return false;
     }
     startup_info.StartupInfo.hStdInput = stdin_handle->handle();
     redirect_handles.push_back(stdin_handle->handle());
@@ -154,40 +295,146 @@ int SystemCommand(
   if (!redirect_handles.empty()) {
     attribute_list.emplace(&redirect_handles);
     if (attribute_list->error()) {
-      return 1;
+      return false;
     }
     startup_info.lpAttributeList = attribute_list->attribute_list();
   } else {
     startup_info.lpAttributeList = NULL;
   }
 
-  PROCESS_INFORMATION process_info;
-  memset(&process_info, 0, sizeof(process_info));
-
-  if (!CreateProcessA(
-          NULL, command_copy.get(), NULL, NULL,
-          /* inherit handles */ startup_info.lpAttributeList != NULL,
-          EXTENDED_STARTUPINFO_PRESENT,
-          NULL, NULL,
-          &startup_info.StartupInfo, &process_info)) {
-    return 1;
+  memset(process_info, 0, sizeof(*process_info));
+
+  return CreateProcessA(
+      NULL, command_copy.get(), NULL, NULL,
+      /* inherit handles */ startup_info.lpAttributeList != NULL,
+      EXTENDED_STARTUPINFO_PRESENT,
+      NULL, NULL,
+      &startup_info.StartupInfo, process_info) != 0;
+}
+
+std::chrono::microseconds FileTimeToDuration(const FILETIME& file_time) {
+  ULARGE_INTEGER hundreds_of_nanoseconds;
+  hundreds_of_nanoseconds.LowPart = file_time.dwLowDateTime;
+  hundreds_of_nanoseconds.HighPart = file_time.dwHighDateTime;
+  return std::chrono::microseconds(hundreds_of_nanoseconds.QuadPart / 10);
+}
+
+// Returns the resources used by the exited process |process|.  Note that
+// unlike on POSIX, this does not include the usage of its children.
+stdext::optional<ResourceUsage> GetResourceUsage(HANDLE process) {
+  FILETIME creation_time;
+  FILETIME exit_time;
+  FILETIME kernel_time;
+  FILETIME user_time;
+  if (!GetProcessTimes(
+          process, &creation_time, &exit_time, &kernel_time, &user_time)) {
+    return stdext::nullopt;
   }
 
-  DWORD wait_result = WaitForSingleObject(process_info.hProcess, INFINITE);
-  int return_code = 0;
-  if (wait_result != WAIT_OBJECT_0) {
+  ResourceUsage usage;
+  usage.user_time = FileTimeToDuration(user_time);
+  usage.system_time = FileTimeToDuration(kernel_time);
+
+  PROCESS_MEMORY_COUNTERS memory_counters;
+  if (GetProcessMemoryInfo(
+          process, &memory_counters, sizeof(memory_counters))) {
+    usage.max_rss_bytes = memory_counters.PeakWorkingSetSize;
+  }
+
+  IO_COUNTERS io_counters;
+  if (GetProcessIoCounters(process, &io_counters)) {
+    usage.block_input_operations = io_counters.ReadOperationCount;
+    usage.block_output_operations = io_counters.WriteOperationCount;
+  }
+
+  return usage;
+}
+
+// Waits for the process to exit, closes its handles and returns its result.
+// If |timeout| passes first, the process is terminated.  Note that unlike on
+// POSIX, any processes that it started are left running.
+SystemCommandResult WaitForSystemCommand(
+    RunningCommand* command,
+    const stdext::optional<std::chrono::milliseconds>& timeout) {
+  const PROCESS_INFORMATION& process_info = command->process_info;
+  bool capturing =
+      command->stdout_output.active() || command->stderr_output.active();
+  auto start_time = std::chrono::steady_clock::now();
+  DWORD wait_result;
+  while (true) {
+    DWORD wait_ms = INFINITE;
+    bool timeout_reached = false;
+    if (timeout) {
+      auto remaining = *timeout - std::chrono::duration_cast<
+          std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - start_time);
+      timeout_reached = remaining.count() <= 0;
+      wait_ms = timeout_reached ? 0 : static_cast<DWORD>(remaining.count());
+    }
+    if (capturing) {
+      wait_ms = std::min(wait_ms, kOutputPollIntervalMs);
+    }
+
+    wait_result = WaitForSingleObject(process_info.hProcess, wait_ms);
+    command->stdout_output.ReadAvailable();
+    command->stderr_output.ReadAvailable();
+    if (wait_result != WAIT_TIMEOUT || timeout_reached) {
+      break;
+    }
+  }
+
+  SystemCommandResult result(0);
+  if (wait_result == WAIT_TIMEOUT) {
+    TerminateProcess(process_info.hProcess, 1);
+    WaitForSingleObject(process_info.hProcess, INFINITE);
+    result.exit_code = 1;
+    result.timed_out = true;
+    result.resource_usage = GetResourceUsage(process_info.hProcess);
+  } else if (wait_result != WAIT_OBJECT_0) {
     TerminateProcess(process_info.hProcess, 1);
-    return_code = 1;
+    result.exit_code = 1;
   } else {
     DWORD exit_code;
     if (GetExitCodeProcess(process_info.hProcess, &exit_code)) {
-      return_code = exit_code;
-    } 
+      result.exit_code = exit_code;
+    }
+    result.resource_usage = GetResourceUsage(process_info.hProcess);
   }
 
+  result.stdout_output = command->stdout_output.Finish();
+  result.stderr_output = command->stderr_output.Finish();
+
   CloseHandle(process_info.hProcess);
   CloseHandle(process_info.hThread);
-  return return_code;
+  return result;
+}
+
+}  // namespace
+
+SystemCommandResult SystemCommand(const SystemCommandParams& params) {
+  RunningCommand command;
+  if (!StartSystemCommand(params, &command)) {
+    return 1;
+  }
+
+  return WaitForSystemCommand(&command, params.timeout);
+}
+
+void SystemCommandAsync(
+    const SystemCommandParams& params,
+    const SystemCommandExitFunction& on_exit) {
+  std::shared_ptr<RunningCommand> command(new RunningCommand());
+  if (!StartSystemCommand(params, command.get())) {
+    on_exit(1);
+    return;
+  }
+
+  // Wait on a lightweight dedicated thread so that the caller's thread is
+  // free while the child runs.
+  stdext::optional<std::chrono::milliseconds> timeout = params.timeout;
+  std::thread([command, timeout, on_exit]() {
+    on_exit(WaitForSystemCommand(command.get(), timeout));
+  }).detach();
 }
 
 }  // namespace platform
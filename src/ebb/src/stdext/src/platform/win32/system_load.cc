@@ -0,0 +1,21 @@
+#include "platform/system_load.h"
+
+#include <windows.h>
+
+namespace platform {
+
+SystemLoadSample SampleSystemLoad() {
+  // Windows has no notion of a load average or of memory pressure stall
+  // information, but we can still report available memory.
+  SystemLoadSample sample;
+
+  MEMORYSTATUSEX memory_status;
+  memory_status.dwLength = sizeof(memory_status);
+  if (GlobalMemoryStatusEx(&memory_status)) {
+    sample.available_memory = memory_status.ullAvailPhys;
+  }
+
+  return sample;
+}
+
+}  // namespace platform
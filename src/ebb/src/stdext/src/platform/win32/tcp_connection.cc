@@ -0,0 +1,136 @@
+#include "platform/tcp_connection.h"
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace platform {
+
+namespace {
+bool InitializeWinsock() {
+  static std::once_flag once;
+  static bool initialized = false;
+  std::call_once(once, []() {
+    WSADATA wsa_data;
+    initialized = WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+  });
+  return initialized;
+}
+
+// Connects |socket_handle| to |address|, waiting no longer than |timeout|.
+bool ConnectWithTimeout(SOCKET socket_handle, const struct addrinfo* address,
+                        std::chrono::milliseconds timeout) {
+  u_long non_blocking = 1;
+  if (ioctlsocket(socket_handle, FIONBIO, &non_blocking) != 0) {
+    return false;
+  }
+  if (connect(socket_handle, address->ai_addr,
+              static_cast<int>(address->ai_addrlen)) != 0) {
+    if (WSAGetLastError() != WSAEWOULDBLOCK) {
+      return false;
+    }
+    fd_set write_set;
+    FD_ZERO(&write_set);
+    FD_SET(socket_handle, &write_set);
+    fd_set error_set;
+    FD_ZERO(&error_set);
+    FD_SET(socket_handle, &error_set);
+    TIMEVAL timeout_value;
+    timeout_value.tv_sec = static_cast<long>(timeout.count() / 1000);
+    timeout_value.tv_usec = static_cast<long>((timeout.count() % 1000) * 1000);
+    if (select(0, nullptr, &write_set, &error_set, &timeout_value) != 1 ||
+        !FD_ISSET(socket_handle, &write_set)) {
+      return false;
+    }
+  }
+  u_long blocking = 0;
+  return ioctlsocket(socket_handle, FIONBIO, &blocking) == 0;
+}
+}  // namespace
+
+struct TcpConnection::PlatformData {
+  PlatformData() : socket_handle(INVALID_SOCKET) {}
+  ~PlatformData() {
+    if (socket_handle != INVALID_SOCKET) {
+      closesocket(socket_handle);
+    }
+  }
+
+  SOCKET socket_handle;
+};
+
+TcpConnection::TcpConnection(std::unique_ptr<PlatformData> platform_data)
+    : platform_data_(std::move(platform_data)) {}
+
+TcpConnection::~TcpConnection() {}
+
+// static
+std::unique_ptr<TcpConnection> TcpConnection::Connect(
+    const std::string& host, int port, std::chrono::milliseconds timeout) {
+  if (!InitializeWinsock()) {
+    return nullptr;
+  }
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  struct addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints,
+                  &addresses) != 0) {
+    return nullptr;
+  }
+
+  std::unique_ptr<PlatformData> data(new PlatformData());
+  for (struct addrinfo* address = addresses; address;
+       address = address->ai_next) {
+    SOCKET socket_handle = socket(address->ai_family, address->ai_socktype,
+                                  address->ai_protocol);
+    if (socket_handle == INVALID_SOCKET) {
+      continue;
+    }
+    if (ConnectWithTimeout(socket_handle, address, timeout)) {
+      data->socket_handle = socket_handle;
+      break;
+    }
+    closesocket(socket_handle);
+  }
+  freeaddrinfo(addresses);
+  if (data->socket_handle == INVALID_SOCKET) {
+    return nullptr;
+  }
+
+  DWORD timeout_ms = static_cast<DWORD>(timeout.count());
+  setsockopt(data->socket_handle, SOL_SOCKET, SO_RCVTIMEO,
+             reinterpret_cast<const char*>(&timeout_ms), sizeof(timeout_ms));
+  setsockopt(data->socket_handle, SOL_SOCKET, SO_SNDTIMEO,
+             reinterpret_cast<const char*>(&timeout_ms), sizeof(timeout_ms));
+
+  return std::unique_ptr<TcpConnection>(new TcpConnection(std::move(data)));
+}
+
+bool TcpConnection::Write(const char* data, size_t size) {
+  while (size > 0) {
+    int chunk_size = static_cast<int>(std::min<size_t>(size, 1 << 30));
+    int result = send(platform_data_->socket_handle, data, chunk_size, 0);
+    if (result == SOCKET_ERROR) {
+      return false;
+    }
+    data += result;
+    size -= static_cast<size_t>(result);
+  }
+  return true;
+}
+
+int64_t TcpConnection::Read(char* data, size_t size) {
+  int chunk_size = static_cast<int>(std::min<size_t>(size, 1 << 30));
+  int result = recv(platform_data_->socket_handle, data, chunk_size, 0);
+  return result == SOCKET_ERROR ? -1 : result;
+}
+
+}  // namespace platform
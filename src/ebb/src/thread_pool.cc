@@ -217,6 +217,17 @@ void ThreadPool::WakeContext(ContextList::Node* node_to_wake) {
   event_available_.notify_one();
 }
 
+void ThreadPool::WakeContexts(ContextList* nodes_to_wake) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!nodes_to_wake->empty()) {
+    ContextList::Node* node_to_wake = nodes_to_wake->front();
+    nodes_to_wake->pop_front();
+    resume_queue_.push_back(node_to_wake);
+  }
+
+  event_available_.notify_all();
+}
+
 size_t ThreadPool::GetLocalThreadId() {
   for (size_t i = 0; i < threads_.size(); ++i) {
     if (threads_[i].get_id() == std::this_thread::get_id()) {
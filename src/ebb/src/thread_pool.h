@@ -43,6 +43,8 @@ class ThreadPool {
 
   bool IsCurrentThreadInPool() const;
 
+  size_t num_threads() const { return threads_.size(); }
+
  private:
   typedef LinkedList<platform::Context> ContextList;
   enum RunLoopPolicy {
@@ -75,6 +77,8 @@ class ThreadPool {
                            std::unique_lock<std::mutex>&& lock);
   // Wakes a context that was put to sleep through SleepCurrentContext().
   void WakeContext(ContextList::Node* node_to_wake);
+  // Wakes all of the contexts in |nodes_to_wake| together, leaving it empty.
+  void WakeContexts(ContextList* nodes_to_wake);
 
   // All threads, before quitting, are expected to call this function so that
   // if they ended up switching their contexts with another thread, they are
@@ -1,19 +1,58 @@
 #include "environment.h"
+#include "lib/system_command.h"
 #include "registry_node.h"
 
 namespace respire {
 
 Environment::Environment(const Options& options)
-    : ebb_env_(options.num_threads, 16 * 1024,
+    : ebb_env_(options.num_threads,
+               // Fiber stacks are allocated on the heap, so be generous: an
+               // unoptimized build needs over 24KB for a system command.
+               64 * 1024,
                // Setup the Ebb environment with a LIFO scheduling policy to
                // reduce the average amount of started but not completed
                // build tasks.
                ebb::Environment::SchedulingPolicy::LIFO),
       system_command_function_(options.system_command_function),
+      job_semaphore_(&ebb_env_.env()->thread_pool(), options.max_jobs),
+      build_log_(options.build_log),
+      deps_log_(options.deps_log),
+      action_cache_(options.action_cache),
       activity_log_(
           options.activity_log_level != ActivityLog::Level::None ?
               &std::cout : nullptr,
-          options.activity_log_level) {}
+          options.activity_log_level) {
+  if (options.jobserver) {
+    jobserver_client_.reset(
+        new ebb::lib::JobserverClient(&ebb_env_, options.jobserver));
+  }
+  if (options.launch_limits.max_load_average ||
+      options.launch_limits.min_available_memory) {
+    launch_throttle_.reset(
+        new LaunchThrottle(&ebb_env_, options.launch_limits));
+  }
+  if (options.max_workers_per_tool > 0) {
+    worker_pool_.reset(
+        new WorkerPool(&ebb_env_, options.max_workers_per_tool));
+  }
+  if (options.max_batch_size > 0) {
+    batch_runner_.reset(new BatchRunner(this, options.max_batch_size));
+  }
+  if (options.record_dependents) {
+    dependents_.reset(new Dependents());
+  }
+  if (options.num_stat_threads > 0) {
+    stat_batcher_.reset(new StatBatcher(&ebb_env_, options.num_stat_threads));
+  }
+  if (options.action_cache && options.remote_cache) {
+    remote_cache_.reset(new RemoteCache(&ebb_env_, *options.remote_cache));
+  }
+  if (!system_command_function_) {
+    using namespace std::placeholders;
+    system_command_function_ = std::bind(
+        &ebb::lib::SystemCommand, &ebb_env_, _1);
+  }
+}
 
 Environment::~Environment() {}
 
@@ -3,10 +3,22 @@
 
 #include <ebbpp.h>
 
+#include "action_cache.h"
 #include "activity_log.h"
+#include "batch_runner.h"
+#include "build_log.h"
+#include "dependents.h"
+#include "deps_log.h"
+#include "fiber_semaphore.h"
+#include "launch_throttle.h"
+#include "lib/jobserver_client.h"
+#include "platform/jobserver.h"
 #include "platform/subprocess.h"
+#include "remote_cache.h"
 #include "stdext/file_system.h"
+#include "stat_batcher.h"
 #include "stdext/optional.h"
+#include "worker_pool.h"
 
 namespace respire {
 
@@ -14,20 +26,59 @@ class RegistryNode;
 
 class Environment {
  public:
-  using SystemCommandFunction = std::function<int(
-      const char*,
-      const stdext::optional<stdext::file_system::Path>& stdout_file,
-      const stdext::optional<stdext::file_system::Path>& stderr_file,
-      const stdext::optional<stdext::file_system::Path>& stdin_file)>;
+  using SystemCommandFunction =
+      std::function<platform::SystemCommandResult(
+          const platform::SystemCommandParams&)>;
 
   struct Options {
     Options()
-      : num_threads(1),
-        system_command_function(&platform::SystemCommand),
+      : num_threads(1), max_jobs(1),
+        jobserver(nullptr), max_workers_per_tool(0), max_batch_size(0),
+        build_log(nullptr), deps_log(nullptr),
+        action_cache(nullptr), record_dependents(false), num_stat_threads(0),
         activity_log_level(ActivityLog::Level::None) {}
 
     int num_threads;
+    // The maximum number of system commands that may execute at once.  This
+    // is independent of |num_threads|, since a running command does not
+    // occupy a thread.
+    int max_jobs;
+    // If not set, commands are executed with ebb::lib::SystemCommand().
     SystemCommandFunction system_command_function;
+    // If set, each system command must also hold a token from this jobserver
+    // while it runs.  Must outlive the Environment.
+    platform::Jobserver* jobserver;
+    // Limits on system load beyond which new commands are held back.
+    LaunchThrottle::Limits launch_limits;
+    // The number of persistent workers that may be started for each tool
+    // that supports them.  If 0, such commands are always run as ordinary
+    // processes.
+    int max_workers_per_tool;
+    // The largest number of commands that may be run together in a single
+    // invocation of a tool that supports batching.  If 0, such commands are
+    // always run on their own.
+    int max_batch_size;
+    // If set, commands are also rebuilt when they differ from the command that
+    // last produced their outputs, as recorded in this log.  Must outlive the
+    // Environment.
+    BuildLog* build_log;
+    // If set, the dependencies listed in deps files are recorded here, and
+    // deps files are only read again once they have changed.  Must outlive the
+    // Environment.
+    DepsLog* deps_log;
+    // If set, the outputs of commands are stored here, and restored from here
+    // instead of running commands again with the same inputs.  Must outlive
+    // the Environment.
+    ActionCache* action_cache;
+    // If set, along with |action_cache|, the action cache is shared with
+    // other machines through the server at this location.
+    stdext::optional<RemoteCache::Location> remote_cache;
+    // If set, nodes record which other nodes they depend on as they are
+    // evaluated, so that they can be invalidated when those nodes change.
+    bool record_dependents;
+    // The number of threads dedicated to looking up the modification times of
+    // files on behalf of fibers.  If 0, fibers look them up directly.
+    int num_stat_threads;
     ActivityLog::Level activity_log_level;
   };
 
@@ -40,12 +91,49 @@ class Environment {
     return system_command_function_;
   }
 
+  // Must be acquired by any running system command.
+  ebb::FiberSemaphore* job_semaphore() { return &job_semaphore_; }
+  // Null if no launch limits were specified.
+  LaunchThrottle* launch_throttle() { return launch_throttle_.get(); }
+  // Null if we are not participating in a jobserver.
+  ebb::lib::JobserverClient* jobserver_client() {
+    return jobserver_client_.get();
+  }
+
+  // Null if persistent workers are disabled.
+  WorkerPool* worker_pool() { return worker_pool_.get(); }
+  // Null if batching is disabled.
+  BatchRunner* batch_runner() { return batch_runner_.get(); }
+  // Null if commands aren't being logged.
+  BuildLog* build_log() { return build_log_; }
+  // Null if deps files are always read directly.
+  DepsLog* deps_log() { return deps_log_; }
+  // Null if commands' outputs aren't cached.
+  ActionCache* action_cache() { return action_cache_; }
+  // Null if the action cache isn't shared with other machines.
+  RemoteCache* remote_cache() { return remote_cache_.get(); }
+  // Null if dependents aren't being recorded.
+  Dependents* dependents() { return dependents_.get(); }
+  // Null if files are stat'd directly by the fibers that need them.
+  StatBatcher* stat_batcher() { return stat_batcher_.get(); }
+
   ActivityLog* activity_log() { return &activity_log_; }
 
  private:
   ebb::Environment ebb_env_;
 
   SystemCommandFunction system_command_function_;
+  ebb::FiberSemaphore job_semaphore_;
+  std::unique_ptr<ebb::lib::JobserverClient> jobserver_client_;
+  std::unique_ptr<LaunchThrottle> launch_throttle_;
+  std::unique_ptr<WorkerPool> worker_pool_;
+  std::unique_ptr<BatchRunner> batch_runner_;
+  BuildLog* build_log_;
+  DepsLog* deps_log_;
+  ActionCache* action_cache_;
+  std::unique_ptr<Dependents> dependents_;
+  std::unique_ptr<StatBatcher> stat_batcher_;
+  std::unique_ptr<RemoteCache> remote_cache_;
 
   ActivityLog activity_log_;
 };
@@ -17,20 +17,79 @@ FileExistsNode::FileExistsNode(
 FileInfoNode::FuturePtr FileExistsNode::GetFileInfo(bool dry_run) {
   // Spin to acquire the lock for the cached results.
   while (lock_.test_and_set(std::memory_order_acquire)) {};
+  if (cached_output_) {
+    FileOutput output = *cached_output_;
+    lock_.clear(std::memory_order_release);
+    return FileInfoNode::FuturePtr(new FileInfoNode::Future(std::move(output)));
+  }
+  lock_.clear(std::memory_order_release);
 
-  if (!cached_output_) {
-    cached_output_ = ComputeFileInfo();
+  // The lock isn't held while the file is looked up, since that may suspend
+  // this fiber, and other fibers spinning on the lock could then occupy
+  // every thread.  If several fibers look the file up at once, the first
+  // result is kept.
+  return FileInfoNode::FuturePtr(
+      new FileInfoNode::Future(CacheOutput(ComputeFileInfo())));
+}
+
+// static
+void FileExistsNode::LookUpFiles(Environment* env,
+                                 const std::vector<FileExistsNode*>& nodes) {
+  std::vector<FileExistsNode*> nodes_to_look_up;
+  std::vector<stdext::file_system::Path> paths;
+  for (FileExistsNode* node : nodes) {
+    while (node->lock_.test_and_set(std::memory_order_acquire)) {};
+    bool cached = node->cached_output_.has_value();
+    node->lock_.clear(std::memory_order_release);
+    if (!cached) {
+      nodes_to_look_up.push_back(node);
+      paths.push_back(node->file_path_.AsPath());
+    }
+  }
+  if (nodes_to_look_up.empty()) {
+    return;
   }
 
+  std::vector<const char*> path_strings;
+  path_strings.reserve(paths.size());
+  for (const auto& path : paths) {
+    path_strings.push_back(path.c_str());
+  }
+  std::vector<StatBatcher::Time> times =
+      env->stat_batcher()->GetLastModificationTimes(path_strings);
+  for (size_t i = 0; i < nodes_to_look_up.size(); ++i) {
+    nodes_to_look_up[i]->CacheOutput(
+        nodes_to_look_up[i]->MakeFileOutput(times[i]));
+  }
+}
+
+FileOutput FileExistsNode::CacheOutput(FileOutput&& output) {
+  while (lock_.test_and_set(std::memory_order_acquire)) {};
+  if (!cached_output_) {
+    cached_output_.emplace(std::move(output));
+  }
+  FileOutput result = *cached_output_;
   lock_.clear(std::memory_order_release);
+  return result;
+}
 
-  return FileInfoNode::FuturePtr(new FileInfoNode::Future(*cached_output_));
+void FileExistsNode::Invalidate() {
+  while (lock_.test_and_set(std::memory_order_acquire)) {};
+  cached_output_.reset();
+  lock_.clear(std::memory_order_release);
 }
 
 FileOutput FileExistsNode::ComputeFileInfo() {
-  stdext::optional<std::chrono::system_clock::time_point> last_modified =
-      GetLastModificationTime(file_path_.AsPath());
+  stdext::file_system::Path path = file_path_.AsPath();
+  return MakeFileOutput(
+      env_->stat_batcher() ?
+          env_->stat_batcher()->GetLastModificationTime(path.c_str()) :
+          GetLastModificationTime(path));
+}
 
+FileOutput FileExistsNode::MakeFileOutput(
+    const stdext::optional<std::chrono::system_clock::time_point>&
+        last_modified) {
   if (last_modified.has_value()) {
     return FileOutput(file_path_, *last_modified, false);
   } else {
@@ -2,6 +2,7 @@
 #define __RESPIRE_FILE_EXISTS_NODE_H__
 
 #include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,12 @@ class FileExistsNode : public FileInfoNode {
 
   FileOutput ComputeFileInfo();
 
+  // Looks up the files of those of |nodes| that haven't been looked up yet
+  // all together through |env|'s StatBatcher, caching the results so that
+  // calling GetFileInfo() on the nodes afterwards returns right away.
+  static void LookUpFiles(Environment* env,
+                          const std::vector<FileExistsNode*>& nodes);
+
   void GetOrderedOutputPaths(
         std::vector<ebb::lib::JSONPathStringView>* paths) override {
     // There's only a single output for FIleExistsNodes.
@@ -30,7 +37,19 @@ class FileExistsNode : public FileInfoNode {
     paths->push_back(file_path_);
   }
 
+  void Invalidate() override;
+
+  FileExistsNode* AsFileExistsNode() override { return this; }
+
+  ebb::lib::JSONPathStringView path() const { return file_path_; }
+
  private:
+  FileOutput MakeFileOutput(
+      const stdext::optional<std::chrono::system_clock::time_point>&
+          last_modified);
+  // Caches |output| unless another result was cached first.
+  FileOutput CacheOutput(FileOutput&& output);
+
   Environment* env_;
   ebb::lib::JSONPathStringView file_path_;
 
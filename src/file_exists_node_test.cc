@@ -145,3 +145,46 @@ TEST(FileExistsNodeTest, DirectoryExistingReturnsValidResult) {
   EXPECT_GE(*value5[0].last_modified_time, last_modified_time);
   last_modified_time = *value5[0].last_modified_time;  
 }
+
+TEST(FileExistsNodeTest, FilesLookedUpTogetherMatchThoseLookedUpAlone) {
+  respire::Environment::Options options;
+  options.num_stat_threads = 2;
+  respire::Environment env(options);
+
+  TemporaryDirectory temp_dir;
+  Path existing_file = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::string json_existing_file = ebb::lib::ToJSON(existing_file.str());
+  Path missing_file = Join(temp_dir.path(), PathStrRef("bar.txt"));
+  std::string json_missing_file = ebb::lib::ToJSON(missing_file.str());
+  {
+    std::ofstream out(existing_file.str());
+    out << "foo";
+  }
+
+  respire::FileExistsNode existing_node(
+      &env, JSONPathStringView(json_existing_file));
+  respire::FileExistsNode missing_node(
+      &env, JSONPathStringView(json_missing_file));
+  respire::FileExistsNode::LookUpFiles(&env, {&existing_node, &missing_node});
+
+  // The results were cached, so creating the missing file isn't noticed.
+  {
+    std::ofstream out(missing_file.str());
+    out << "bar";
+  }
+  respire::FileInfoNode::FuturePtr existing_result(
+      existing_node.GetFileInfo());
+  ASSERT_NE(nullptr, existing_result->GetValue()->value());
+  EXPECT_TRUE(stdext::file_system::GetLastModificationTime(existing_file) ==
+              (*existing_result->GetValue()->value())[0].last_modified_time);
+  respire::FileInfoNode::FuturePtr missing_result(missing_node.GetFileInfo());
+  EXPECT_NE(nullptr, missing_result->GetValue()->error());
+
+  // Until the node is invalidated, after which the file is looked up again
+  // through the stat threads.
+  missing_node.Invalidate();
+  respire::FileInfoNode::FuturePtr found_result(missing_node.GetFileInfo());
+  ASSERT_NE(nullptr, found_result->GetValue()->value());
+  EXPECT_TRUE(stdext::file_system::GetLastModificationTime(missing_file) ==
+              (*found_result->GetValue()->value())[0].last_modified_time);
+}
@@ -63,6 +63,8 @@ class FileOutput {
   stdext::variant<Value, Error> data_;
 };
 
+class FileExistsNode;
+
 class FileInfoNode {
   public:
     // TODO: In C++17 this interface can be changed to return by value and then
@@ -82,6 +84,16 @@ class FileInfoNode {
     // structure returned by GetFileInfo().
     virtual void GetOrderedOutputPaths(
         std::vector<ebb::lib::JSONPathStringView>* paths) = 0;
+
+    // Forgets any results cached by previous calls to GetFileInfo(), so that
+    // they are computed again the next time that they're asked for, e.g.
+    // because the files that they depend on have since changed.  Must not be
+    // called while a build is in progress.
+    virtual void Invalidate() = 0;
+
+    // Returns this node as a FileExistsNode if it is one, so that the files
+    // of many such nodes can be looked up together.
+    virtual FileExistsNode* AsFileExistsNode() { return nullptr; }
 };
 
 // Helper structure to enable addressing of a specific output from a specific
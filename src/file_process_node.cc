@@ -2,7 +2,11 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cinttypes>
 
+#include "file_exists_node.h"
+#include "parallel_for.h"
+#include "sha256.h"
 #include "stdext/file_system.h"
 
 using stdext::optional;
@@ -17,10 +21,16 @@ FileProcessNode::FileProcessNode(
     const std::vector<ebb::lib::JSONPathStringView>* soft_output_files,
     const std::function<optional<Error>()>& command,
     GetDepsFunction get_deps_function,
-    ActivityLog::FileProcessNodeLog* activity_log_entry)
-    : activity_log_entry_(activity_log_entry), inputs_(std::move(inputs)),
+    ActivityLog::FileProcessNodeLog* activity_log_entry,
+    optional<uint64_t> command_hash, bool early_cutoff, bool cacheable,
+    FileInfoNode* owner, const ebb::lib::JSONPathStringView* deps_file)
+    : env_(env), owner_(owner ? owner : this),
+      activity_log_entry_(activity_log_entry),
+      inputs_(std::move(inputs)),
       output_files_(output_files), soft_output_files_(soft_output_files),
       command_(command), get_deps_function_(get_deps_function),
+      command_hash_(command_hash), early_cutoff_(early_cutoff),
+      cacheable_(cacheable), deps_file_(deps_file),
       push_pull_node_(
           env->ebb_env(),
           [this](bool dry_run) { return HandleRequest(dry_run); }) {}
@@ -32,13 +42,19 @@ FileProcessNode::FileProcessNode(
     const std::vector<ebb::lib::JSONPathStringView>&& soft_output_files,
     const std::function<optional<Error>()>& command,
     GetDepsFunction get_deps_function,
-    ActivityLog::FileProcessNodeLog* activity_log_entry)
-    : activity_log_entry_(activity_log_entry), inputs_(std::move(inputs)),
+    ActivityLog::FileProcessNodeLog* activity_log_entry,
+    optional<uint64_t> command_hash, bool early_cutoff, bool cacheable,
+    FileInfoNode* owner, const ebb::lib::JSONPathStringView* deps_file)
+    : env_(env), owner_(owner ? owner : this),
+      activity_log_entry_(activity_log_entry),
+      inputs_(std::move(inputs)),
       owned_output_files_(std::move(output_files)),
       output_files_(&owned_output_files_.value()),
       owned_soft_output_files_(std::move(soft_output_files)),
       soft_output_files_(&owned_soft_output_files_.value()),
       command_(command), get_deps_function_(get_deps_function),
+      command_hash_(command_hash), early_cutoff_(early_cutoff),
+      cacheable_(cacheable), deps_file_(deps_file),
       push_pull_node_(
           env->ebb_env(),
           [this](bool dry_run) { return HandleRequest(dry_run); }) {}
@@ -59,17 +75,95 @@ void FileProcessNode::GetOrderedOutputPaths(
   }  
 }
 
+void FileProcessNode::Invalidate() {
+  cached_output_.reset();
+  scan_.reset();
+}
+
 namespace {
+// The minimum number of files that each thread should be given to stat when
+// sweeping over a node's outputs or dependencies.  Smaller sweeps are not
+// worth the overhead of distributing across threads.
+const size_t kStatSweepGrainSize = 16;
+
 std::vector<optional<system_clock::time_point>> GetLastModificationTimes(
-    const std::vector<ebb::lib::JSONPathStringView>& files) {
-  std::vector<optional<system_clock::time_point>> times;
-  times.reserve(files.size());
-  for (const auto& file : files) {
-    times.emplace_back(GetLastModificationTime(file.AsPath()));
+    Environment* env, const std::vector<ebb::lib::JSONPathStringView>& files) {
+  if (StatBatcher* stat_batcher = env->stat_batcher()) {
+    // Submit all of the files together, so that they're looked up in parallel
+    // while this fiber waits just once.
+    std::vector<stdext::file_system::Path> paths;
+    std::vector<const char*> path_strings;
+    paths.reserve(files.size());
+    path_strings.reserve(files.size());
+    for (const auto& file : files) {
+      paths.push_back(file.AsPath());
+      path_strings.push_back(paths.back().c_str());
+    }
+    return stat_batcher->GetLastModificationTimes(path_strings);
   }
+
+  std::vector<optional<system_clock::time_point>> times(files.size());
+  ebb::ParallelFor(
+      env->ebb_env(), stdext::make_span(times.data(), times.size()),
+      kStatSweepGrainSize,
+      [&files](size_t index, optional<system_clock::time_point>& time) {
+    time = GetLastModificationTime(files[index].AsPath());
+  });
   return times;
 }
 
+// If files are looked up through a StatBatcher, looks up the files of those
+// of |nodes| that are FileExistsNodes together, so that asking each of them
+// for its output afterwards doesn't wait on a lookup in turn.
+void LookUpFilesTogether(Environment* env,
+                         const std::vector<FileInfoNodeOutput>& nodes) {
+  if (!env->stat_batcher()) {
+    return;
+  }
+  std::vector<FileExistsNode*> file_exists_nodes;
+  for (const auto& node : nodes) {
+    if (FileExistsNode* file_exists_node = node.node->AsFileExistsNode()) {
+      file_exists_nodes.push_back(file_exists_node);
+    }
+  }
+  FileExistsNode::LookUpFiles(env, file_exists_nodes);
+}
+
+optional<std::string> ContentDigest(Environment* env,
+                                    const std::string& path) {
+  return env->build_log() ? env->build_log()->GetContentDigest(path)
+                          : Sha256::HashFile(path);
+}
+
+std::vector<optional<std::string>> ContentDigests(
+    Environment* env, const std::vector<std::string>& paths) {
+  std::vector<optional<std::string>> digests(paths.size());
+  ebb::ParallelFor(
+      env->ebb_env(), stdext::make_span(digests.data(), digests.size()),
+      kStatSweepGrainSize,
+      [env, &paths](size_t index, optional<std::string>& digest) {
+    digest = ContentDigest(env, paths[index]);
+  });
+  return digests;
+}
+
+// Returns the paths of the files described by |futures|, which are for
+// |nodes|, or nothing if any of them failed.
+optional<std::vector<std::string>> GetPaths(
+    const std::vector<FileInfoNode::FuturePtr>& futures,
+    const std::vector<FileInfoNodeOutput>& nodes) {
+  std::vector<std::string> paths;
+  paths.reserve(futures.size());
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const FileOutput::Value* value = futures[i]->GetValue()->value();
+    if (!value) {
+      return stdext::nullopt;
+    }
+    paths.push_back((*value)[nodes[i].index].filename.AsString());
+  }
+  return paths;
+}
+
 bool AnyInputNewerThanOutputs(
     const std::vector<FileInfoNode::FuturePtr>& input_futures,
     const std::vector<FileInfoNodeOutput>& inputs,
@@ -113,115 +207,265 @@ bool AnyInputNewerThanOutputs(
 
 }  // namespace
 
-FileProcessNode::ComputeFileOutputResult FileProcessNode::ComputeFileOutput(
-    bool dry_run) {
-  if (activity_log_entry_) {
-    activity_log_entry_->SignalStartDependencyScan(dry_run);
+FileOutput FileProcessNode::HandleRequest(bool dry_run) {
+  if (cached_output_) {
+    return *cached_output_;
   }
 
-  // Ensure that the inputs are up-to-date before running the command.
+  if (!scan_) {
+    // Whichever request comes first scans our dependencies.  If that settles
+    // our output, e.g. because we're already up to date, then that's our
+    // result for dry runs and real runs alike.
+    optional<FileOutput> settled_output = ScanDependencies(dry_run);
+    if (settled_output) {
+      cached_output_.emplace(std::move(*settled_output));
+      return *cached_output_;
+    }
+  }
+
+  if (dry_run) {
+    return PendingOutput();
+  }
+
+  cached_output_.emplace(Execute());
+  scan_.reset();
+  return *cached_output_;
+}
+
+std::vector<FileInfoNode::FuturePtr> FileProcessNode::RequestInputs(
+    bool dry_run) {
+  LookUpFilesTogether(env_, inputs_);
   std::vector<FileInfoNode::FuturePtr> input_futures;
   input_futures.reserve(inputs_.size());
   for (const auto& input : inputs_) {
     input_futures.emplace_back(input.node->GetFileInfo(dry_run));
   }
+  return input_futures;
+}
+
+optional<FileOutput> FileProcessNode::ScanDependencies(bool dry_run) {
+  if (activity_log_entry_) {
+    activity_log_entry_->SignalStartDependencyScan(dry_run);
+  }
+
+  if (env_->dependents()) {
+    env_->dependents()->Add(owner_, inputs_);
+  }
+
+  // Ensure that the inputs are up-to-date before running the command.
+  std::vector<FileInfoNode::FuturePtr> input_futures = RequestInputs(dry_run);
 
   // Now that requests have been sent out to the inputs, while we wait for them
   // we will look up the last modified times of our output files.
-  std::vector<optional<system_clock::time_point>> output_times =
-      GetLastModificationTimes(*output_files_);
+  scan_.emplace();
+  scan_->dry_run = dry_run;
+  scan_->output_times = GetLastModificationTimes(env_, *output_files_);
 
   // Now join on all input nodes to ensure they are created.  If there were
   // any errors in the inputs, propagate them.
+  optional<FileOutput> input_error = FindInputError(input_futures);
+  if (input_error) {
+    scan_.reset();
+    LogProcessingComplete(*input_error->error(), dry_run);
+    return input_error;
+  }
+
+  if (!NeedsRebuild(input_futures)) {
+    FileOutput output = UpToDateOutput();
+    scan_.reset();
+    LogProcessingComplete(stdext::nullopt, dry_run);
+    return output;
+  }
+
+  // We're going to be rebuilt, at least as far as we can tell before our
+  // inputs are, which lets the log output viewer learn how many nodes need
+  // building before any of them are.
+  if (activity_log_entry_) {
+    activity_log_entry_->SignalStartRunningCommand(true);
+  }
+  if (dry_run) {
+    LogProcessingComplete(stdext::nullopt, true);
+  }
+  return stdext::nullopt;
+}
+
+optional<FileOutput> FileProcessNode::FindInputError(
+    const std::vector<FileInfoNode::FuturePtr>& input_futures) {
   for (const auto& input_future : input_futures) {
     const FileOutput& input_result = *input_future->GetValue();
     if (input_result.error()) {
-      // Propagate any errors from the input nodes if there are some.
-      LogProcessingComplete(*input_result.error(), dry_run);
-      return ComputeFileOutputResult(input_result);
+      return input_result;
     }
   }
+  return stdext::nullopt;
+}
 
-  bool should_rebuild = AnyInputNewerThanOutputs(
-      input_futures, inputs_, output_times, true);
-  if (!should_rebuild && get_deps_function_) {
-    // Looks like none of the specified inputs were modified, check to see if
-    // our deps function has any additional dependencies for us to check (e.g.
-    // header files referenced by a C++ source file).
-    stdext::optional<std::vector<FileInfoNodeOutput>> extra_deps =
-        get_deps_function_();
-    if (!extra_deps) {
-      // If there was an error reading the extra deps, assume the worst (e.g.
-      // a deps file was deleted) and just rebuild everything.
-      should_rebuild = true;
-    } else {
-      // Read through the additional dependencies and check their modification
-      // dates also.
-      std::vector<FileInfoNode::FuturePtr> deps_futures;
-      deps_futures.reserve(extra_deps->size());
-      for (const auto& dep : *extra_deps) {
-        deps_futures.emplace_back(dep.node->GetFileInfo());
-      }
-      for (const auto& dep_future : deps_futures) {
-        const FileOutput& dep_result = *dep_future->GetValue();
-        if (dep_result.error()) {
-          // If there were any errors reading the deps files, instead of
-          // propagating the error just drop everything and try to rebuild.
-          // This course of action makes sense when, for example, a C source
-          // file's #included header is renamed, in which case the deps file
-          // references a file that no longer exists, but we can and should
-          // still successfully build the source file.
-          should_rebuild = true;
-          break;
-        }
-      }
-      if (!should_rebuild) {
-        should_rebuild = AnyInputNewerThanOutputs(
-                             deps_futures, *extra_deps, output_times, true);
-      }
+bool FileProcessNode::NeedsRebuild(
+    const std::vector<FileInfoNode::FuturePtr>& input_futures) {
+  if (AnyInputNewerThanOutputs(
+          input_futures, inputs_, scan_->output_times, true)) {
+    return true;
+  }
+
+  if (!scan_->command_changed) {
+    scan_->command_changed = CommandChangedSinceLastBuild();
+  }
+  if (*scan_->command_changed) {
+    return true;
+  }
+
+  if (!get_deps_function_) {
+    return false;
+  }
+
+  // Looks like none of the specified inputs were modified, check to see if
+  // our deps function has any additional dependencies for us to check (e.g.
+  // header files referenced by a C++ source file).
+  if (!scan_->read_extra_deps) {
+    scan_->read_extra_deps = true;
+    scan_->extra_deps = get_deps_function_();
+    if (scan_->extra_deps && env_->dependents()) {
+      env_->dependents()->Add(owner_, *scan_->extra_deps);
     }
   }
+  if (!scan_->extra_deps) {
+    // If there was an error reading the extra deps, assume the worst (e.g.
+    // a deps file was deleted) and just rebuild everything.
+    return true;
+  }
+  const std::vector<FileInfoNodeOutput>& extra_deps = *scan_->extra_deps;
+
+  // Read through the additional dependencies and check their modification
+  // dates also.  Most dependencies are FileExistsNodes which stat their file as
+  // soon as they are asked for it, so for nodes with many dependencies (e.g.
+  // C++ files with many headers) we spread the requests across threads,
+  // unless they can all be looked up together instead.
+  LookUpFilesTogether(env_, extra_deps);
+  std::vector<FileInfoNode::FuturePtr> deps_futures(extra_deps.size());
+  ebb::ParallelFor(
+      env_->ebb_env(),
+      stdext::make_span(deps_futures.data(), deps_futures.size()),
+      kStatSweepGrainSize,
+      [&extra_deps](size_t index, FileInfoNode::FuturePtr& dep_future) {
+    dep_future = extra_deps[index].node->GetFileInfo();
+  });
+  if (FindInputError(deps_futures)) {
+    // If there were any errors reading the deps files, instead of propagating
+    // the error just drop everything and try to rebuild.  This course of
+    // action makes sense when, for example, a C source file's #included
+    // header is renamed, in which case the deps file references a file that
+    // no longer exists, but we can and should still successfully build the
+    // source file.
+    return true;
+  }
+  return AnyInputNewerThanOutputs(
+      deps_futures, extra_deps, scan_->output_times, true);
+}
 
-  bool fake_dry_run_result = false;
-  if (should_rebuild) {
+FileOutput FileProcessNode::Execute() {
+  std::vector<FileInfoNode::FuturePtr> input_futures;
+  if (scan_->dry_run) {
+    // Our scan saw only what our inputs would be after a dry run, so now
+    // that they're actually built, check again whether we still need to be,
+    // e.g. in case an input's contents turned out not to change.  Everything
+    // else that the scan learned, such as our output times, still holds.
     if (activity_log_entry_) {
-      activity_log_entry_->SignalStartRunningCommand(dry_run);
+      activity_log_entry_->SignalStartDependencyScan(false);
+    }
+    input_futures = RequestInputs(false);
+    optional<FileOutput> input_error = FindInputError(input_futures);
+    if (input_error) {
+      LogProcessingComplete(*input_error->error(), false);
+      return std::move(*input_error);
     }
+    if (!NeedsRebuild(input_futures)) {
+      FileOutput output = UpToDateOutput();
+      LogProcessingComplete(stdext::nullopt, false);
+      return output;
+    }
+  } else {
+    // The inputs were already built when we were scanned, so this just
+    // fetches their cached results.
+    input_futures = RequestInputs(false);
+  }
 
-    if (!dry_run) {
-      stdext::optional<Error> maybe_error = command_();
+  if (activity_log_entry_) {
+    activity_log_entry_->SignalStartRunningCommand(false);
+  }
 
-      if (maybe_error) {
-        LogProcessingComplete(maybe_error, dry_run);
-        return FileOutput(
-            Error("Error executing command: " + maybe_error->str()));
-      }
+  // If we were run before with the same inputs, then we can restore the
+  // outputs that we produced then instead of running our command again.
+  optional<std::string> action_key = ActionKey(input_futures);
+  bool restored = action_key && RestoreFromActionCache(*action_key);
 
-      // Refresh the output times now that they (may) have each been modified.
-      output_times = GetLastModificationTimes(*output_files_);
-
-      if (AnyInputNewerThanOutputs(
-              input_futures, inputs_, output_times, false)) {
-        // If the condition still holds that input files are newer than output
-        // files, then return an error.
-        std::string error_message(
-            "Not all output files were modified by a FileProcessNode(). "
-            "If this is what you want, specify 'soft output's instead.");
-        Error error(error_message);
-        LogProcessingComplete(error, dry_run);
-        return FileOutput(std::move(error));
-      }
-    } else {
-      fake_dry_run_result = true;
+  auto start_time = std::chrono::steady_clock::now();
+  stdext::optional<Error> maybe_error;
+  if (!restored) {
+    maybe_error = command_();
+  }
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time);
+
+  if (maybe_error) {
+    RecordFailure();
+    LogProcessingComplete(maybe_error, false);
+    return FileOutput(
+        Error("Error executing command: " + maybe_error->str()));
+  }
 
-      // Create fake output modification times.
-      auto now = std::chrono::system_clock::now();
-      for (auto& time : output_times) {
-        time = now;
-      }
+  // Refresh the output times now that they (may) have each been modified.
+  std::vector<optional<system_clock::time_point>> output_times =
+      GetLastModificationTimes(env_, *output_files_);
+
+  if (AnyInputNewerThanOutputs(
+          input_futures, inputs_, output_times, false)) {
+    // If the condition still holds that input files are newer than output
+    // files, then return an error.
+    std::string error_message(
+        "Not all output files were modified by a FileProcessNode(). "
+        "If this is what you want, specify 'soft output's instead.");
+    Error error(error_message);
+    RecordFailure();
+    LogProcessingComplete(error, false);
+    return FileOutput(std::move(error));
+  }
+
+  RecordCommandInBuildLog(&output_times, duration);
+
+  optional<std::vector<FileInfoNodeOutput>> extra_deps;
+  if ((env_->dependents() || env_->deps_log() || action_key) &&
+      get_deps_function_) {
+    // The command may have changed our additional dependencies, e.g. a C++
+    // source file may now include different headers, and if it was built for
+    // the first time then we don't know them at all yet.  Reading them now
+    // also records them in the deps log, so later builds needn't read them.
+    extra_deps = get_deps_function_();
+    if (extra_deps && env_->dependents()) {
+      env_->dependents()->Add(owner_, *extra_deps);
     }
   }
 
+  // Without our additional dependencies, we can't tell when our outputs may
+  // be reused.
+  if (action_key && !restored && (extra_deps || !get_deps_function_)) {
+    StoreInActionCache(
+        *action_key,
+        extra_deps ? *extra_deps : std::vector<FileInfoNodeOutput>());
+  }
+
+  LogProcessingComplete(stdext::nullopt, false);
+  return MakeOutput(output_times);
+}
+
+FileOutput FileProcessNode::UpToDateOutput() {
+  std::vector<optional<system_clock::time_point>> output_times =
+      scan_->output_times;
+  UseLogicalOutputTimes(&output_times);
+  return MakeOutput(output_times);
+}
+
+FileOutput FileProcessNode::MakeOutput(
+    const std::vector<optional<system_clock::time_point>>& output_times) {
   // Zip up the output file names with the output modification times and return
   // the result.
   FileOutput::Value ret;
@@ -232,35 +476,210 @@ FileProcessNode::ComputeFileOutputResult FileProcessNode::ComputeFileOutput(
 
   // Now add in the soft output file modification times, which we will need
   // to now look up.
-  if (!dry_run || !should_rebuild) {
-    for (const auto& soft_output_file : *soft_output_files_) {
-      ret.emplace_back(soft_output_file,
-                       GetLastModificationTime(soft_output_file.AsPath()),
-                       true);
+  std::vector<optional<system_clock::time_point>> soft_output_times =
+      GetLastModificationTimes(env_, *soft_output_files_);
+  for (size_t i = 0; i < soft_output_files_->size(); ++i) {
+    ret.emplace_back((*soft_output_files_)[i], soft_output_times[i], true);
+  }
+  return FileOutput(std::move(ret));
+}
+
+FileOutput FileProcessNode::PendingOutput() {
+  // Report all of our outputs as being brand new, so that everything that
+  // depends on them sees that it needs rebuilding too.
+  auto now = std::chrono::system_clock::now();
+  FileOutput::Value ret;
+  ret.reserve(output_files_->size() + soft_output_files_->size());
+  for (const auto& output_file : *output_files_) {
+    ret.emplace_back(output_file, now, false);
+  }
+  for (const auto& soft_output_file : *soft_output_files_) {
+    ret.emplace_back(soft_output_file, now, true);
+  }
+  return FileOutput(std::move(ret));
+}
+
+bool FileProcessNode::CommandChangedSinceLastBuild() {
+  BuildLog* build_log = env_->build_log();
+  if (!build_log || !command_hash_) {
+    return false;
+  }
+  for (const auto& output_file : *output_files_) {
+    // Outputs that we have no record of may have been built by anything, so
+    // they are rebuilt too.
+    optional<BuildLog::Entry> entry =
+        build_log->Lookup(output_file.AsString());
+    if (!entry || entry->command_hash != *command_hash_) {
+      return true;
     }
-  } else {
-    // Populate soft output results with fake modification times.
-    fake_dry_run_result = true;
+  }
+  return false;
+}
 
-    auto now = std::chrono::system_clock::now();
-    for (const auto& soft_output_file : *soft_output_files_) {
-      ret.emplace_back(soft_output_file, now, true);
+void FileProcessNode::RecordCommandInBuildLog(
+    std::vector<optional<system_clock::time_point>>* output_times,
+    std::chrono::microseconds duration) {
+  BuildLog* build_log = env_->build_log();
+  if (!build_log || !command_hash_) {
+    return;
+  }
+  for (size_t i = 0; i < output_files_->size(); ++i) {
+    std::string output_file = (*output_files_)[i].AsString();
+    BuildLog::Entry entry;
+    entry.command_hash = *command_hash_;
+    entry.mtime = *(*output_times)[i];
+    entry.logical_mtime = entry.mtime;
+    entry.duration = duration;
+    if (early_cutoff_) {
+      // The output was only just written, so it has to be read anyway.
+      entry.content_hash = BuildLog::HashFileContents(output_file);
+      optional<BuildLog::Entry> previous_entry =
+          build_log->Lookup(output_file);
+      if (entry.content_hash && previous_entry &&
+          previous_entry->content_hash == entry.content_hash) {
+        // Nothing that depends on the output could have changed since the
+        // last time that it had these contents.
+        entry.logical_mtime = previous_entry->logical_mtime;
+        (*output_times)[i] = entry.logical_mtime;
+      }
     }
+    build_log->Record(output_file, entry);
   }
+}
 
-  LogProcessingComplete(stdext::nullopt, dry_run);
-  return ComputeFileOutputResult(FileOutput(std::move(ret)),
-                                 fake_dry_run_result);
+void FileProcessNode::UseLogicalOutputTimes(
+    std::vector<optional<system_clock::time_point>>* output_times) {
+  BuildLog* build_log = env_->build_log();
+  if (!build_log || !command_hash_ || !early_cutoff_) {
+    return;
+  }
+  for (size_t i = 0; i < output_files_->size(); ++i) {
+    optional<BuildLog::Entry> entry =
+        build_log->Lookup((*output_files_)[i].AsString());
+    // Once something else has modified the output, the log no longer speaks
+    // for it.
+    if (entry && (*output_times)[i] && entry->mtime == *(*output_times)[i]) {
+      (*output_times)[i] = entry->logical_mtime;
+    }
+  }
 }
 
-FileOutput FileProcessNode::HandleRequest(bool dry_run) {
-  if (!cached_output_ || (!dry_run && cached_output_is_fake_dry_run_)) {
-    ComputeFileOutputResult results = ComputeFileOutput(dry_run);
-    cached_output_.emplace(std::move(results.file_output));
-    cached_output_is_fake_dry_run_ = results.fake_dry_run_result;
+optional<std::string> FileProcessNode::ActionKey(
+    const std::vector<FileInfoNode::FuturePtr>& input_futures) {
+  if (!env_->action_cache() || !command_hash_ || !cacheable_ ||
+      output_files_->empty()) {
+    return stdext::nullopt;
+  }
+  optional<std::vector<std::string>> input_paths =
+      GetPaths(input_futures, inputs_);
+  if (!input_paths) {
+    return stdext::nullopt;
+  }
+  std::vector<optional<std::string>> input_digests =
+      ContentDigests(env_, *input_paths);
+
+  char command_hash[17];
+  std::snprintf(command_hash, sizeof(command_hash), "%016" PRIx64,
+                *command_hash_);
+  std::string description = command_hash;
+  auto append = [&description](const char* name, const std::string& value) {
+    description.push_back('\0');
+    description += name;
+    description += value;
+  };
+  for (const auto& output_file : *output_files_) {
+    append("out=", output_file.AsString());
+  }
+  for (const auto& soft_output_file : *soft_output_files_) {
+    append("soft_out=", soft_output_file.AsString());
+  }
+  if (deps_file_) {
+    append("deps=", deps_file_->AsString());
+  }
+  for (size_t i = 0; i < input_paths->size(); ++i) {
+    append("in=", (*input_paths)[i]);
+    // Directories, e.g. from mkdir actions, have no contents to hash.
+    append("", input_digests[i] ? *input_digests[i] : "-");
   }
+  return Sha256::Hash(description);
+}
 
-  return *cached_output_;
+bool FileProcessNode::RestoreFromActionCache(const std::string& action_key) {
+  ActionCache* action_cache = env_->action_cache();
+  for (const auto& result :
+       action_cache->Lookup(action_key, env_->remote_cache())) {
+    // Only a result whose additional dependencies haven't changed since may
+    // be used, e.g. not one from a branch where a header was different.
+    std::vector<std::string> paths;
+    paths.reserve(result.dependencies.size());
+    for (const auto& dependency : result.dependencies) {
+      paths.push_back(dependency.path);
+    }
+    std::vector<optional<std::string>> digests = ContentDigests(env_, paths);
+    bool dependencies_unchanged = true;
+    for (size_t i = 0; i < digests.size(); ++i) {
+      if (!digests[i] || *digests[i] != result.dependencies[i].digest) {
+        dependencies_unchanged = false;
+        break;
+      }
+    }
+    if (dependencies_unchanged &&
+        action_cache->Restore(result, env_->remote_cache())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FileProcessNode::StoreInActionCache(
+    const std::string& action_key,
+    const std::vector<FileInfoNodeOutput>& extra_deps) {
+  std::vector<FileInfoNode::FuturePtr> deps_futures;
+  deps_futures.reserve(extra_deps.size());
+  for (const auto& extra_dep : extra_deps) {
+    deps_futures.emplace_back(extra_dep.node->GetFileInfo());
+  }
+  optional<std::vector<std::string>> deps_paths =
+      GetPaths(deps_futures, extra_deps);
+  if (!deps_paths) {
+    return;
+  }
+  std::vector<optional<std::string>> deps_digests =
+      ContentDigests(env_, *deps_paths);
+  std::vector<ActionCache::Dependency> dependencies;
+  dependencies.reserve(deps_paths->size());
+  for (size_t i = 0; i < deps_paths->size(); ++i) {
+    if (!deps_digests[i]) {
+      return;
+    }
+    dependencies.push_back({(*deps_paths)[i], *deps_digests[i]});
+  }
+
+  std::vector<std::string> output_paths;
+  for (const auto& output_file : *output_files_) {
+    output_paths.push_back(output_file.AsString());
+  }
+  // The deps file is restored too, or we couldn't tell whether the restored
+  // outputs are up to date and would have to restore them on every build.
+  if (deps_file_ && std::find(output_files_->begin(), output_files_->end(),
+                              *deps_file_) == output_files_->end()) {
+    output_paths.push_back(deps_file_->AsString());
+  }
+  std::vector<optional<system_clock::time_point>> soft_output_times =
+      GetLastModificationTimes(env_, *soft_output_files_);
+  for (size_t i = 0; i < soft_output_files_->size(); ++i) {
+    if (soft_output_times[i]) {
+      output_paths.push_back((*soft_output_files_)[i].AsString());
+    }
+  }
+  env_->action_cache()->Store(action_key, dependencies, output_paths,
+                              env_->remote_cache());
+}
+
+void FileProcessNode::RecordFailure() {
+  if (env_->dependents()) {
+    env_->dependents()->AddFailure(owner_);
+  }
 }
 
 void FileProcessNode::LogProcessingComplete(
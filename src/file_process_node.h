@@ -1,6 +1,9 @@
 #ifndef __RESPIRE_FILE_PROCESS_NODE_H__
 #define __RESPIRE_FILE_PROCESS_NODE_H__
 
+#include <stdint.h>
+
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -17,6 +20,26 @@ namespace respire {
 // file paths, and an arbitrary function.  The function will be called and
 // is expected to use the input file nodes to generate the set of output
 // file paths.
+//
+// If the environment has a build log and a |command_hash| is given, then the
+// outputs are also rebuilt if they were last produced by a command with a
+// different hash, e.g. because its command line has changed since.  If
+// |early_cutoff| is also set, then outputs that the command rewrites with the
+// same contents that they had before keep reporting the modification times
+// that they had before, so that the nodes that depend on them aren't rebuilt.
+//
+// If the environment has an action cache, a |command_hash| is given and
+// |cacheable| is set, then outputs are restored from the cache, where
+// possible, instead of running the command with inputs that it was already
+// run with.
+//
+// If the environment records dependents, then they are recorded on behalf of
+// |owner|, the node that other nodes refer to for our outputs, which is this
+// node itself if it isn't given.
+//
+// |deps_file| names the file, written by the command, that |get_deps_function|
+// reads.  It's cached and restored along with the outputs, since without it
+// our additional dependencies can't be found again.
 class FileProcessNode : public FileInfoNode {
  public:
   // Returns a vector of additional input dependencies.  Returns a null optional
@@ -33,7 +56,11 @@ class FileProcessNode : public FileInfoNode {
       const std::vector<ebb::lib::JSONPathStringView>* soft_output_files,
       const std::function<stdext::optional<Error>()>& command,
       GetDepsFunction get_deps_function = GetDepsFunction(),
-      ActivityLog::FileProcessNodeLog* activity_log_entry = nullptr);
+      ActivityLog::FileProcessNodeLog* activity_log_entry = nullptr,
+      stdext::optional<uint64_t> command_hash = stdext::nullopt,
+      bool early_cutoff = false, bool cacheable = true,
+      FileInfoNode* owner = nullptr,
+      const ebb::lib::JSONPathStringView* deps_file = nullptr);
 
   FileProcessNode(
       Environment* env,
@@ -42,38 +69,100 @@ class FileProcessNode : public FileInfoNode {
       const std::vector<ebb::lib::JSONPathStringView>&& soft_output_files,
       const std::function<stdext::optional<Error>()>& command,
       GetDepsFunction get_deps_function = GetDepsFunction(),
-      ActivityLog::FileProcessNodeLog* activity_log_entry = nullptr);
+      ActivityLog::FileProcessNodeLog* activity_log_entry = nullptr,
+      stdext::optional<uint64_t> command_hash = stdext::nullopt,
+      bool early_cutoff = false, bool cacheable = true,
+      FileInfoNode* owner = nullptr,
+      const ebb::lib::JSONPathStringView* deps_file = nullptr);
 
   FileInfoNode::FuturePtr GetFileInfo(bool dry_run = false) override;
 
   void GetOrderedOutputPaths(
       std::vector<ebb::lib::JSONPathStringView>* paths) override;
 
+  void Invalidate() override;
+
  private:
-  struct ComputeFileOutputResult {
-    ComputeFileOutputResult(const FileOutput& file_output)
-        : file_output(file_output) {}
-    ComputeFileOutputResult(FileOutput&& file_output)
-        : file_output(std::move(file_output)) {}
-    ComputeFileOutputResult(FileOutput&& file_output, bool fake_dry_run_result)
-        : file_output(std::move(file_output)),
-          fake_dry_run_result(fake_dry_run_result) {}
-    // The actual results.
-    FileOutput file_output;
-    // If true, indicates that the result is faked because |dry_run| a dry
-    // run was requested.  This value could be false even if a |dry_run| is
-    // requested if we were able to determine that no file processing was
-    // necessary anyway (and so the result is valid despite the fact that we
-    // requested a dry run.)
-    bool fake_dry_run_result = false;
+  // What we learn about ourselves by scanning our dependencies, which is kept
+  // from the first request for our output until we're executed.  This way the
+  // scan made for a dry run, e.g. to count the nodes that need building, is
+  // reused by the real run that follows it rather than repeated.
+  struct Scan {
+    Scan() : dry_run(false), read_extra_deps(false) {}
+
+    // True if our inputs were only dry run, so that their outputs may yet
+    // change when they're actually built.
+    bool dry_run;
+    // Our outputs' modification times at the time of the scan.  Nothing else
+    // writes to our outputs, so these hold until we run our command.
+    std::vector<stdext::optional<std::chrono::system_clock::time_point>>
+        output_times;
+    // Each of these is filled in the first time that it's needed.
+    stdext::optional<bool> command_changed;
+    bool read_extra_deps;
+    stdext::optional<std::vector<FileInfoNodeOutput>> extra_deps;
   };
-  // This function assumes that no caching is involved and just always computes
-  // the FileOutput result.
-  ComputeFileOutputResult ComputeFileOutput(bool dry_run);
+
   FileOutput HandleRequest(bool dry_run);
+  std::vector<FileInfoNode::FuturePtr> RequestInputs(bool dry_run);
+  // Starts |scan_|, and returns our output if the scan settles it, e.g. if
+  // an input failed or we're already up to date.  Otherwise we're due to be
+  // rebuilt, and |scan_| is kept for Execute().
+  stdext::optional<FileOutput> ScanDependencies(bool dry_run);
+  // Returns the first error output amongst |futures|, if any.
+  stdext::optional<FileOutput> FindInputError(
+      const std::vector<FileInfoNode::FuturePtr>& futures);
+  // Returns true if anything we depend on, as described by |input_futures|
+  // and |scan_|, is newer than our outputs.
+  bool NeedsRebuild(const std::vector<FileInfoNode::FuturePtr>& input_futures);
+  // Builds our outputs, given a scan that found them to be out of date.
+  FileOutput Execute();
+  // Our output when the scan finds us to be up to date.
+  FileOutput UpToDateOutput();
+  FileOutput MakeOutput(
+      const std::vector<
+          stdext::optional<std::chrono::system_clock::time_point>>&
+          output_times);
+  // Our output for dry runs once we're known to need rebuilding.
+  FileOutput PendingOutput();
+
+  // Returns true if the build log doesn't show our outputs as having been
+  // produced by our command.
+  bool CommandChangedSinceLastBuild();
+  // Records our command in the build log as having just produced outputs with
+  // |output_times|, which are then replaced by the times that the outputs
+  // should be reported to have.
+  void RecordCommandInBuildLog(
+      std::vector<stdext::optional<std::chrono::system_clock::time_point>>*
+          output_times,
+      std::chrono::microseconds duration);
+  // Replaces |output_times| with the times that the build log says the
+  // outputs should be reported to have, where it has anything to say.
+  void UseLogicalOutputTimes(
+      std::vector<stdext::optional<std::chrono::system_clock::time_point>>*
+          output_times);
+
+  // Returns the key that identifies our command, given the inputs that
+  // |input_futures| describe, in the action cache, or nothing if there's no
+  // action cache or we can't be cached.
+  stdext::optional<std::string> ActionKey(
+      const std::vector<FileInfoNode::FuturePtr>& input_futures);
+  // Restores our outputs from a result in the action cache whose additional
+  // dependencies are unchanged, returning false if there isn't one.
+  bool RestoreFromActionCache(const std::string& action_key);
+  // Stores our outputs in the action cache, having just run our command with
+  // |extra_deps| as our additional dependencies.
+  void StoreInActionCache(const std::string& action_key,
+                          const std::vector<FileInfoNodeOutput>& extra_deps);
 
   void LogProcessingComplete(const stdext::optional<Error>& error,
                              bool dry_run);
+  // Records that our command failed, so that it's retried if we're being
+  // rebuilt continually.
+  void RecordFailure();
+
+  Environment* env_;
+  FileInfoNode* const owner_;
 
   ActivityLog::FileProcessNodeLog* activity_log_entry_;
 
@@ -87,16 +176,20 @@ class FileProcessNode : public FileInfoNode {
   const std::vector<ebb::lib::JSONPathStringView>* soft_output_files_;
   std::function<stdext::optional<Error>()> command_;
   GetDepsFunction get_deps_function_;
+  const stdext::optional<uint64_t> command_hash_;
+  const bool early_cutoff_;
+  const bool cacheable_;
+  const ebb::lib::JSONPathStringView* deps_file_;
 
+  // Our final output, once known.
   stdext::optional<FileOutput> cached_output_;
+  stdext::optional<Scan> scan_;
 
   // Note that PushPullConsumer by default has a queue size of 1, meaning that
   // if more than one entity are waiting on the results of it, only the first
   // one will not block.  This could be an issue if one wishes to kick off
   // a build on multiple targets that depend on the others.
   ebb::PushPullConsumer<FileOutput(bool)> push_pull_node_;
-
-  bool cached_output_is_fake_dry_run_ = false;
 };
 
 }  // namespace respire
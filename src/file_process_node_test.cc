@@ -1,8 +1,11 @@
 #include <fstream>
 #include <gtest/gtest.h>
 #include <sstream>
+#include <thread>
 
+#include "action_cache.h"
 #include "environment.h"
+#include "file_exists_node.h"
 #include "file_process_node.h"
 #include "stdext/file_system.h"
 
@@ -390,3 +393,286 @@ TEST(FileProcessNodeTest, MultipleInputs) {
   }
   EXPECT_EQ(kInterFileContents2, ReadFileContents(inter_file2));
 }
+
+TEST(FileProcessNodeTest, ChangedCommandHashCausesRebuild) {
+  TemporaryDirectory temp_dir;
+  Path log_file = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  std::unique_ptr<respire::BuildLog> build_log =
+      respire::BuildLog::Open(log_file.str());
+  ASSERT_NE(nullptr, build_log);
+  respire::Environment::Options options;
+  options.build_log = build_log.get();
+  respire::Environment env(options);
+
+  Path temp_file = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::string json_temp_file = ebb::lib::ToJSON(temp_file.str());
+
+  // Each node stands in for a separate build of the same output.
+  int run_count = 0;
+  auto build = [&](optional<uint64_t> command_hash) {
+    respire::FileProcessNode create_file_node(
+        &env, {}, {ebb::lib::JSONPathStringView(json_temp_file)}, {},
+        [&]() {
+          ++run_count;
+          WriteToFile(temp_file, "bar");
+          return optional<Error>();
+        },
+        respire::FileProcessNode::GetDepsFunction(), nullptr, command_hash);
+    respire::FileInfoNode::FuturePtr result(create_file_node.GetFileInfo());
+    ASSERT_NE(nullptr, result->GetValue()->value());
+  };
+
+  build(1);
+  EXPECT_EQ(1, run_count);
+  build(1);
+  EXPECT_EQ(1, run_count);
+
+  build(2);
+  EXPECT_EQ(2, run_count);
+  build(2);
+  EXPECT_EQ(2, run_count);
+
+  // Nodes without a command hash only care about modification times.
+  build(stdext::nullopt);
+  EXPECT_EQ(2, run_count);
+}
+
+TEST(FileProcessNodeTest, EarlyCutoffStopsRebuildsAtUnchangedOutputs) {
+  TemporaryDirectory temp_dir;
+  Path log_file = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  std::unique_ptr<respire::BuildLog> build_log =
+      respire::BuildLog::Open(log_file.str());
+  ASSERT_NE(nullptr, build_log);
+  respire::Environment::Options options;
+  options.build_log = build_log.get();
+  respire::Environment env(options);
+
+  Path inter_file = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::string json_inter_file = ebb::lib::ToJSON(inter_file.str());
+  Path final_file = Join(temp_dir.path(), PathStrRef("bar.txt"));
+  std::string json_final_file = ebb::lib::ToJSON(final_file.str());
+
+  // Each pair of nodes stands in for a separate build, in which a change of
+  // command hash forces the intermediate file to be rewritten.
+  int final_run_count = 0;
+  auto build = [&](uint64_t command_hash, const std::string& contents,
+                   bool early_cutoff) {
+    // Make sure that every write results in a new modification time, even on
+    // file systems with coarse timestamps.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    respire::FileProcessNode create_file_node(
+        &env, {}, {ebb::lib::JSONPathStringView(json_inter_file)}, {},
+        [&]() {
+          WriteToFile(inter_file, contents);
+          return optional<Error>();
+        },
+        respire::FileProcessNode::GetDepsFunction(), nullptr, command_hash,
+        early_cutoff);
+    respire::FileProcessNode final_file_node(
+        &env, {{&create_file_node, 0}},
+        {ebb::lib::JSONPathStringView(json_final_file)}, {},
+        [&]() {
+          ++final_run_count;
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          ConcatenateToFile(inter_file, inter_file, final_file);
+          return optional<Error>();
+        },
+        respire::FileProcessNode::GetDepsFunction(), nullptr, 0);
+    respire::FileInfoNode::FuturePtr result(final_file_node.GetFileInfo());
+    ASSERT_NE(nullptr, result->GetValue()->value());
+  };
+
+  build(1, "foo", true);
+  EXPECT_EQ(1, final_run_count);
+
+  // The intermediate file is rewritten with the same contents, so the final
+  // file doesn't need to be rebuilt, neither now nor in later builds.
+  build(2, "foo", true);
+  EXPECT_EQ(1, final_run_count);
+  build(2, "foo", true);
+  EXPECT_EQ(1, final_run_count);
+
+  // But changed contents still propagate.
+  build(3, "bar", true);
+  EXPECT_EQ(2, final_run_count);
+  EXPECT_EQ("barbar", ReadFileContents(final_file));
+
+  // And without early cutoff, any rewrite does.
+  build(4, "bar", false);
+  EXPECT_EQ(3, final_run_count);
+}
+
+TEST(FileProcessNodeTest, RealRunReusesDryRunScan) {
+  respire::Environment env;
+
+  TemporaryDirectory temp_dir;
+  Path dep_file = Join(temp_dir.path(), PathStrRef("dep.txt"));
+  std::string json_dep_file = ebb::lib::ToJSON(dep_file.str());
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+  std::string json_out_file = ebb::lib::ToJSON(out_file.str());
+  WriteToFile(out_file, "old");
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  WriteToFile(dep_file, "new");
+
+  respire::FileExistsNode dep_node(
+      &env, ebb::lib::JSONPathStringView(json_dep_file));
+  int deps_count = 0;
+  int run_count = 0;
+  respire::FileProcessNode node(
+      &env, {}, {ebb::lib::JSONPathStringView(json_out_file)}, {},
+      [&]() {
+        ++run_count;
+        WriteToFile(out_file, "new");
+        return optional<Error>();
+      },
+      [&]() {
+        ++deps_count;
+        return optional<std::vector<respire::FileInfoNodeOutput>>(
+            std::vector<respire::FileInfoNodeOutput>({{&dep_node, 0}}));
+      });
+
+  // The dry run finds that the dependency is newer than the output, but
+  // doesn't run the command.
+  respire::FileInfoNode::FuturePtr dry_result(node.GetFileInfo(true));
+  ASSERT_NE(nullptr, dry_result->GetValue()->value());
+  EXPECT_EQ(0, run_count);
+  EXPECT_EQ(1, deps_count);
+  EXPECT_EQ("old", ReadFileContents(out_file));
+
+  // The real run acts on that without reading the deps again.
+  respire::FileInfoNode::FuturePtr result(node.GetFileInfo(false));
+  ASSERT_NE(nullptr, result->GetValue()->value());
+  EXPECT_EQ(1, run_count);
+  EXPECT_EQ(1, deps_count);
+  EXPECT_EQ("new", ReadFileContents(out_file));
+  EXPECT_TRUE(GetLastModificationTime(out_file) ==
+              (*result->GetValue()->value())[0].last_modified_time);
+
+  // Both kinds of request now get the real result.
+  respire::FileInfoNode::FuturePtr later_dry_result(node.GetFileInfo(true));
+  ASSERT_NE(nullptr, later_dry_result->GetValue()->value());
+  EXPECT_TRUE(GetLastModificationTime(out_file) ==
+              (*later_dry_result->GetValue()->value())[0].last_modified_time);
+}
+
+TEST(FileProcessNodeTest, DryRunDoesNotForceRebuildsPastEarlyCutoff) {
+  TemporaryDirectory temp_dir;
+  Path log_file = Join(temp_dir.path(), PathStrRef("build_log.txt"));
+  std::unique_ptr<respire::BuildLog> build_log =
+      respire::BuildLog::Open(log_file.str());
+  ASSERT_NE(nullptr, build_log);
+  respire::Environment::Options options;
+  options.build_log = build_log.get();
+  respire::Environment env(options);
+
+  Path inter_file = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  std::string json_inter_file = ebb::lib::ToJSON(inter_file.str());
+  Path final_file = Join(temp_dir.path(), PathStrRef("bar.txt"));
+  std::string json_final_file = ebb::lib::ToJSON(final_file.str());
+
+  int inter_run_count = 0;
+  int final_run_count = 0;
+  auto build = [&](uint64_t command_hash) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    respire::FileProcessNode create_file_node(
+        &env, {}, {ebb::lib::JSONPathStringView(json_inter_file)}, {},
+        [&]() {
+          ++inter_run_count;
+          WriteToFile(inter_file, "foo");
+          return optional<Error>();
+        },
+        respire::FileProcessNode::GetDepsFunction(), nullptr, command_hash,
+        true);
+    respire::FileProcessNode final_file_node(
+        &env, {{&create_file_node, 0}},
+        {ebb::lib::JSONPathStringView(json_final_file)}, {},
+        [&]() {
+          ++final_run_count;
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          ConcatenateToFile(inter_file, inter_file, final_file);
+          return optional<Error>();
+        },
+        respire::FileProcessNode::GetDepsFunction(), nullptr, 0);
+    // As for build targets, a dry run precedes the real run.
+    respire::FileInfoNode::FuturePtr dry_result(
+        final_file_node.GetFileInfo(true));
+    ASSERT_NE(nullptr, dry_result->GetValue()->value());
+    respire::FileInfoNode::FuturePtr result(final_file_node.GetFileInfo());
+    ASSERT_NE(nullptr, result->GetValue()->value());
+  };
+
+  build(1);
+  EXPECT_EQ(1, inter_run_count);
+  EXPECT_EQ(1, final_run_count);
+
+  // The dry run can only tell that the final file will need rebuilding if the
+  // intermediate file changes, which it turns out not to.
+  build(2);
+  EXPECT_EQ(2, inter_run_count);
+  EXPECT_EQ(1, final_run_count);
+}
+
+TEST(FileProcessNodeTest, OutputsAreRestoredFromActionCache) {
+  TemporaryDirectory temp_dir;
+  std::unique_ptr<respire::ActionCache> action_cache =
+      respire::ActionCache::Open(
+          Join(temp_dir.path(), PathStrRef("cache")).str(), 1024 * 1024);
+  ASSERT_NE(nullptr, action_cache);
+  respire::Environment::Options options;
+  options.action_cache = action_cache.get();
+  respire::Environment env(options);
+
+  Path in_file = Join(temp_dir.path(), PathStrRef("in.txt"));
+  std::string json_in_file = ebb::lib::ToJSON(in_file.str());
+  Path dep_file = Join(temp_dir.path(), PathStrRef("dep.txt"));
+  std::string json_dep_file = ebb::lib::ToJSON(dep_file.str());
+  Path out_file = Join(temp_dir.path(), PathStrRef("out.txt"));
+  std::string json_out_file = ebb::lib::ToJSON(out_file.str());
+
+  // Each build writes the input and the dependency that the deps function
+  // discovers, and then brings the output up to date.
+  int run_count = 0;
+  auto build = [&](const std::string& in, const std::string& dep) {
+    // Make sure that every write results in a new modification time, even on
+    // file systems with coarse timestamps.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    WriteToFile(in_file, in);
+    WriteToFile(dep_file, dep);
+    respire::FileExistsNode in_node(
+        &env, ebb::lib::JSONPathStringView(json_in_file));
+    respire::FileExistsNode dep_node(
+        &env, ebb::lib::JSONPathStringView(json_dep_file));
+    respire::FileProcessNode node(
+        &env, {{&in_node, 0}}, {ebb::lib::JSONPathStringView(json_out_file)},
+        {},
+        [&]() {
+          ++run_count;
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          ConcatenateToFile(in_file, dep_file, out_file);
+          return optional<Error>();
+        },
+        [&]() {
+          return optional<std::vector<respire::FileInfoNodeOutput>>(
+              std::vector<respire::FileInfoNodeOutput>({{&dep_node, 0}}));
+        },
+        nullptr, 1);
+    respire::FileInfoNode::FuturePtr result(node.GetFileInfo());
+    ASSERT_NE(nullptr, result->GetValue()->value());
+    EXPECT_EQ(in + dep, ReadFileContents(out_file));
+  };
+
+  build("a", "x");
+  EXPECT_EQ(1, run_count);
+  build("b", "x");
+  EXPECT_EQ(2, run_count);
+
+  // Switching back to an input that was built before restores its output.
+  build("a", "x");
+  EXPECT_EQ(2, run_count);
+
+  // But only if the discovered dependencies are unchanged too.
+  build("a", "y");
+  EXPECT_EQ(3, run_count);
+  build("a", "x");
+  EXPECT_EQ(3, run_count);
+}
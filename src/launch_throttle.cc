@@ -0,0 +1,94 @@
+#include "launch_throttle.h"
+
+namespace respire {
+
+namespace {
+// Even with plenty of memory available, hold back while all tasks have been
+// stalled on memory for more than this percentage of the recent past, since
+// that means the kernel is struggling to find it.
+const double kMaxMemoryPressure = 10.0;
+}  // namespace
+
+LaunchThrottle::LaunchThrottle(
+    ebb::Environment* env, const Limits& limits,
+    const SampleFunction& sample_function,
+    std::chrono::milliseconds sample_interval)
+    : limits_(limits), sample_function_(sample_function),
+      sample_interval_(sample_interval), sample_(sample_function_()),
+      launches_since_sample_(0), num_running_(0), num_waiting_(0),
+      quit_(false), launch_cond_(&env->env()->thread_pool()),
+      sample_thread_(&LaunchThrottle::SampleLoop, this) {}
+
+LaunchThrottle::~LaunchThrottle() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+    sample_cond_.notify_one();
+  }
+  sample_thread_.join();
+}
+
+void LaunchThrottle::Launch() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (num_running_ > 0 && OverLimits()) {
+    ++num_waiting_;
+    launch_cond_.wait(lock);
+    --num_waiting_;
+  }
+  ++num_running_;
+  ++launches_since_sample_;
+}
+
+void LaunchThrottle::Finish() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  --num_running_;
+  if (num_running_ == 0 && num_waiting_ > 0) {
+    // Someone can now always launch, regardless of the limits.
+    launch_cond_.notify_one();
+  }
+}
+
+bool LaunchThrottle::OverLimits() const {
+  if (limits_.max_load_average && sample_.load_average &&
+      *sample_.load_average + launches_since_sample_ >=
+          *limits_.max_load_average) {
+    return true;
+  }
+  if (limits_.min_available_memory) {
+    if (sample_.available_memory &&
+        *sample_.available_memory < *limits_.min_available_memory) {
+      return true;
+    }
+    if (sample_.memory_pressure &&
+        *sample_.memory_pressure > kMaxMemoryPressure) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LaunchThrottle::SampleLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!quit_) {
+    sample_cond_.wait_for(lock, sample_interval_);
+    if (quit_) {
+      break;
+    }
+
+    // Sampling reads from the file system, so don't hold the lock for it.
+    lock.unlock();
+    platform::SystemLoadSample sample = sample_function_();
+    lock.lock();
+
+    sample_ = sample;
+    launches_since_sample_ = 0;
+    if (!OverLimits()) {
+      // Wake everyone up, they'll each recheck the limits as they launch.
+      for (int i = 0; i < num_waiting_; ++i) {
+        launch_cond_.notify_one();
+      }
+    }
+  }
+}
+
+}  // namespace respire
@@ -0,0 +1,93 @@
+#ifndef __RESPIRE_LAUNCH_THROTTLE_H__
+#define __RESPIRE_LAUNCH_THROTTLE_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <ebbpp.h>
+
+#include "fiber_condition_variable.h"
+#include "platform/system_load.h"
+#include "stdext/optional.h"
+
+namespace respire {
+
+// Holds back the launch of new system commands while the machine is
+// overloaded, in the spirit of make's "-l" option.  The system load is sampled
+// periodically on a background thread, and fibers waiting to launch a command
+// are suspended (without blocking their thread) until it falls back within
+// the limits.  At least one command is always allowed to run, so that a build
+// can always make progress.
+class LaunchThrottle {
+ public:
+  struct Limits {
+    // Don't launch new commands while the load average is at least this.
+    stdext::optional<double> max_load_average;
+    // Don't launch new commands while less than this many bytes of memory
+    // are available, or while the system is stalling on memory.
+    stdext::optional<uint64_t> min_available_memory;
+  };
+
+  using SampleFunction = std::function<platform::SystemLoadSample()>;
+
+  LaunchThrottle(
+      ebb::Environment* env, const Limits& limits,
+      const SampleFunction& sample_function = &platform::SampleSystemLoad,
+      std::chrono::milliseconds sample_interval =
+          std::chrono::milliseconds(500));
+  ~LaunchThrottle();
+
+  // Suspends the calling fiber until a new command may be launched.  Each
+  // call must be paired with a call to Finish() when the command completes.
+  void Launch();
+  void Finish();
+
+  // Counts as a running command for the lifetime of the object.  If
+  // |throttle| is null, launches are never held back.
+  class ScopedLaunch {
+   public:
+    ScopedLaunch(LaunchThrottle* throttle) : throttle_(throttle) {
+      if (throttle_) throttle_->Launch();
+    }
+    ~ScopedLaunch() {
+      if (throttle_) throttle_->Finish();
+    }
+
+    ScopedLaunch(const ScopedLaunch&) = delete;
+    ScopedLaunch& operator=(const ScopedLaunch&) = delete;
+
+   private:
+    LaunchThrottle* throttle_;
+  };
+
+ private:
+  bool OverLimits() const;
+  void SampleLoop();
+
+  const Limits limits_;
+  const SampleFunction sample_function_;
+  const std::chrono::milliseconds sample_interval_;
+
+  std::mutex mutex_;
+  platform::SystemLoadSample sample_;
+  // The load average lags far behind reality, so commands launched since the
+  // last sample are counted as extra load.  Otherwise we would launch a burst
+  // of commands every time the load dipped below the limit.
+  int launches_since_sample_;
+  int num_running_;
+  int num_waiting_;
+  bool quit_;
+
+  ebb::FiberConditionVariable launch_cond_;
+  std::condition_variable sample_cond_;
+  std::thread sample_thread_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_LAUNCH_THROTTLE_H__
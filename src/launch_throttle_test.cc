@@ -0,0 +1,158 @@
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+
+#include "launch_throttle.h"
+
+using respire::LaunchThrottle;
+
+namespace {
+const int kDefaultStackSize = 16 * 1024;
+const std::chrono::milliseconds kSampleInterval(5);
+
+// Reports whatever load the test sets.
+class FakeSystemLoad {
+ public:
+  void Set(const platform::SystemLoadSample& sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sample_ = sample;
+  }
+
+  LaunchThrottle::SampleFunction GetSampleFunction() {
+    return [this]() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return sample_;
+    };
+  }
+
+ private:
+  std::mutex mutex_;
+  platform::SystemLoadSample sample_;
+};
+
+platform::SystemLoadSample LoadAverage(double load_average) {
+  platform::SystemLoadSample sample;
+  sample.load_average = load_average;
+  return sample;
+}
+
+platform::SystemLoadSample AvailableMemory(uint64_t available_memory) {
+  platform::SystemLoadSample sample;
+  sample.available_memory = available_memory;
+  return sample;
+}
+
+// Launches from a separate thread, so that the test can observe whether or not
+// the launch is held back.
+class BackgroundLaunch {
+ public:
+  BackgroundLaunch(LaunchThrottle* throttle)
+      : launched_(false), thread_([this, throttle]() {
+          throttle->Launch();
+          launched_ = true;
+        }) {}
+  ~BackgroundLaunch() { thread_.join(); }
+
+  bool launched() const { return launched_; }
+
+  bool WaitForLaunch() {
+    for (int i = 0; i < 1000 && !launched_; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return launched_;
+  }
+
+ private:
+  std::atomic<bool> launched_;
+  std::thread thread_;
+};
+}  // namespace
+
+TEST(LaunchThrottleTest, LaunchesFreelyUnderLimits) {
+  ebb::Environment env(1, kDefaultStackSize);
+  FakeSystemLoad load;
+  load.Set(LoadAverage(1.0));
+
+  LaunchThrottle::Limits limits;
+  limits.max_load_average = 8.0;
+  LaunchThrottle throttle(
+      &env, limits, load.GetSampleFunction(), kSampleInterval);
+
+  // Each launch counts as extra load until the next sample, so a few can go.
+  throttle.Launch();
+  throttle.Launch();
+  throttle.Launch();
+  throttle.Finish();
+  throttle.Finish();
+  throttle.Finish();
+}
+
+TEST(LaunchThrottleTest, OverloadStillAllowsOneCommand) {
+  ebb::Environment env(1, kDefaultStackSize);
+  FakeSystemLoad load;
+  load.Set(LoadAverage(100.0));
+
+  LaunchThrottle::Limits limits;
+  limits.max_load_average = 4.0;
+  LaunchThrottle throttle(
+      &env, limits, load.GetSampleFunction(), kSampleInterval);
+
+  throttle.Launch();
+  {
+    BackgroundLaunch second(&throttle);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(second.launched());
+
+    throttle.Finish();
+    EXPECT_TRUE(second.WaitForLaunch());
+  }
+  throttle.Finish();
+}
+
+TEST(LaunchThrottleTest, ResumesWhenLoadDrops) {
+  ebb::Environment env(1, kDefaultStackSize);
+  FakeSystemLoad load;
+  load.Set(LoadAverage(100.0));
+
+  LaunchThrottle::Limits limits;
+  limits.max_load_average = 4.0;
+  LaunchThrottle throttle(
+      &env, limits, load.GetSampleFunction(), kSampleInterval);
+
+  throttle.Launch();
+  {
+    BackgroundLaunch second(&throttle);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(second.launched());
+
+    load.Set(LoadAverage(0.5));
+    EXPECT_TRUE(second.WaitForLaunch());
+  }
+  throttle.Finish();
+  throttle.Finish();
+}
+
+TEST(LaunchThrottleTest, HoldsBackWhileMemoryIsLow) {
+  ebb::Environment env(1, kDefaultStackSize);
+  FakeSystemLoad load;
+  load.Set(AvailableMemory(100));
+
+  LaunchThrottle::Limits limits;
+  limits.min_available_memory = 1000;
+  LaunchThrottle throttle(
+      &env, limits, load.GetSampleFunction(), kSampleInterval);
+
+  throttle.Launch();
+  {
+    BackgroundLaunch second(&throttle);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(second.launched());
+
+    load.Set(AvailableMemory(2000));
+    EXPECT_TRUE(second.WaitForLaunch());
+  }
+  throttle.Finish();
+  throttle.Finish();
+}
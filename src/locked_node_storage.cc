@@ -1,5 +1,7 @@
 #include "locked_node_storage.h"
 
+#include <algorithm>
+
 #include "file_info_node.h"
 #include "registry_node.h"
 #include "file_exists_node.h"
@@ -16,6 +18,35 @@ RegistryNode* LockedNodeStorage::Access::AddRegistryNode(
   return node_pointer;
 }
 
+bool LockedNodeStorage::Access::DeclarePool(
+    Environment* env, const std::string& name, int depth) {
+  auto found = locked_node_storage_->pools_.find(name);
+  if (found != locked_node_storage_->pools_.end()) {
+    return found->second.depth == depth;
+  }
+
+  Pool& pool = locked_node_storage_->pools_[name];
+  pool.depth = depth;
+  pool.semaphore.reset(new ebb::FiberSemaphore(
+      &env->ebb_env()->env()->thread_pool(), depth));
+  return true;
+}
+
+ebb::FiberSemaphore* LockedNodeStorage::Access::LookupPool(
+    const std::string& name) {
+  auto found = locked_node_storage_->pools_.find(name);
+  return found == locked_node_storage_->pools_.end() ?
+             nullptr : found->second.semaphore.get();
+}
+
+void LockedNodeStorage::Access::AddBuildTarget(FileInfoNode* node) {
+  auto& build_targets = locked_node_storage_->build_targets_;
+  if (std::find(build_targets.begin(), build_targets.end(), node) ==
+          build_targets.end()) {
+    build_targets.push_back(node);
+  }
+}
+
 FileInfoNode* LockedNodeStorage::Access::AddFileInfoNode(
     std::unique_ptr<FileInfoNode> node) {
   FileInfoNode* node_pointer = node.get();
@@ -50,6 +81,8 @@ FileInfoNodeOutput LockedNodeStorage::Access::LookupNodeOrMakeFileExistsNode(
   }
 }
 
+LockedNodeStorage::LockedNodeStorage() : complete_(true) {}
+
 LockedNodeStorage::~LockedNodeStorage() {
   do {
     size_t previous_size;
@@ -60,6 +93,9 @@ LockedNodeStorage::~LockedNodeStorage() {
     previous_size = registry_path_vector_.size();
     futures.reserve(previous_size);
 
+    // This only issues the requests, which are then served concurrently on
+    // the thread pool, so there's nothing to gain from a ParallelFor here.
+
     for (size_t i = 0; i < previous_size; ++i) {
       RegistryNode* node = registry_path_vector_[i].get();
 
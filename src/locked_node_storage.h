@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "environment.h"
+#include "fiber_semaphore.h"
 #include "stdext/file_system.h"
 #include "lib/json_string_view.h"
 
@@ -47,6 +48,11 @@ class LockedNodeStorage {
 
     FileInfoNode* AddFileInfoNode(std::unique_ptr<FileInfoNode> node);
 
+    // All of the nodes added so far, in the order that they were added.
+    const FileInfoNodeVector& file_info_nodes() const {
+      return locked_node_storage_->file_info_node_vector_;
+    }
+
     const FileInfoNodeMap& file_info_node_map() const {
       return locked_node_storage_->file_info_node_map_;
     }
@@ -68,11 +74,32 @@ class LockedNodeStorage {
           locked_node_storage_->path_string_storage_.back());
     }
 
+    // Declares a pool with the given |depth|.  Pools may be declared any
+    // number of times, but always with the same depth, otherwise false is
+    // returned.
+    bool DeclarePool(Environment* env, const std::string& name, int depth);
+    // Returns null if no pool named |name| has been declared.
+    ebb::FiberSemaphore* LookupPool(const std::string& name);
+
+    // Records that |node| was requested by a build directive, if it hasn't
+    // been already.
+    void AddBuildTarget(FileInfoNode* node);
+    const std::vector<FileInfoNode*>& build_targets() const {
+      return locked_node_storage_->build_targets_;
+    }
+
+    // Records that some registry stopped being processed before all of its
+    // directives were, e.g. because of an error, and so the stored nodes may
+    // not describe everything that the registries do.
+    void MarkIncomplete() { locked_node_storage_->complete_ = false; }
+    bool complete() const { return locked_node_storage_->complete_; }
+
    private:
     std::lock_guard<std::mutex> lock_;
     LockedNodeStorage* locked_node_storage_;
   };
 
+  LockedNodeStorage();
   ~LockedNodeStorage();
 
  private:
@@ -95,6 +122,15 @@ class LockedNodeStorage {
   // JSON files, for example from deps files instead.
   std::vector<std::string> path_string_storage_;
 
+  struct Pool {
+    int depth;
+    std::unique_ptr<ebb::FiberSemaphore> semaphore;
+  };
+  std::unordered_map<std::string, Pool> pools_;
+
+  std::vector<FileInfoNode*> build_targets_;
+  bool complete_;
+
   // Scratch space populated when querying FileInfoNodes for their file output
   // indices.  We reuse it to avoid allocations.
   std::vector<ebb::lib::JSONPathStringView> scratch_output_files_;
@@ -1,18 +1,64 @@
 #include "registry_node.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <vector>
 
+#include "action_cache.h"
+#include "build_log.h"
 #include "build_targets.h"
+#include "deps_log.h"
 #include "environment.h"
 #include "error.h"
+#include "platform/jobserver.h"
+#include "platform/subprocess.h"
+#include "remote_cache.h"
 #include "stdext/file_system.h"
+#include "watch.h"
 
 namespace {
 
+// Each persistent worker holds on to a whole tool, e.g. an interpreter, in
+// memory for the duration of the build, so don't keep too many of them around.
+// Commands beyond this many at once for the same tool are run as ordinary
+// processes.
+const int kMaxWorkersPerTool = 4;
+
+// The most commands that are handed to a single invocation of a tool that
+// supports batching.  Beyond this, a bigger batch saves relatively few process
+// starts, while running more commands in sequence that could otherwise have run
+// in parallel.
+const int kMaxBatchSize = 64;
+
+// The number of threads that look up file modification times for the build's
+// fibers.  Lookups mostly wait on the file system rather than using the CPU,
+// so more of them can usefully be in flight than there are cores, especially
+// on network file systems.
+const int kNumStatThreads = 16;
+
+// The size, in megabytes, that the action cache is kept within unless
+// specified otherwise.
+const uint64_t kDefaultActionCacheSizeMB = 4096;
+
+// In watch mode, how long the files must go unchanged before a rebuild starts,
+// so that a burst of changes, e.g. from saving several files at once or a
+// version control checkout, results in only one rebuild.
+const std::chrono::milliseconds kWatchQuietPeriod(100);
+
 void PrintUsage() {
   std::cerr << "Usage: " << std::endl
-            << "  respire [-j N] INITIAL_REGISTRY_FILE" << std::endl;
+            << "  respire [-j N] [-l LOAD] [--memory-headroom MB] "
+            << "[--jobserver=pipe|fifo|none] [--no-spawn-server] "
+            << "[--no-workers] [--no-batching] [--no-stat-threads] "
+            << "[--build-log FILE] [--deps-log FILE] "
+            << "[--action-cache DIR] [--action-cache-size MB] "
+            << "[--remote-cache http://HOST[:PORT][/PREFIX]] [--watch] "
+            << "INITIAL_REGISTRY_FILE"
+            << std::endl;
 }
 
 std::string WithDedupedBackslashes(const std::string input) {
@@ -32,10 +78,35 @@ std::string WithDedupedBackslashes(const std::string input) {
 struct CommandLineParams {
   CommandLineParams(const stdext::file_system::Path& initial_file_path)
       : activity_log_level(respire::ActivityLog::Level::None),
+        jobserver_style(platform::Jobserver::Style::Pipe),
+        use_spawn_server(true),
+        use_workers(true),
+        use_batching(true),
+        use_stat_threads(true),
+        action_cache_size_mb(kDefaultActionCacheSizeMB),
+        watch(false),
         initial_file_path(initial_file_path) {}
 
-  stdext::optional<int> num_threads;
+  stdext::optional<int> max_jobs;
+  respire::LaunchThrottle::Limits launch_limits;
   respire::ActivityLog::Level activity_log_level;
+  // The style of jobserver to export to commands, if we end up serving one.
+  stdext::optional<platform::Jobserver::Style> jobserver_style;
+  bool use_spawn_server;
+  bool use_workers;
+  bool use_batching;
+  bool use_stat_threads;
+  // Where to record the commands that produced each output, if anywhere.
+  stdext::optional<std::string> build_log_path;
+  // Where to record the dependencies read from deps files, if anywhere.
+  stdext::optional<std::string> deps_log_path;
+  // Where to cache the outputs of commands, if anywhere.
+  stdext::optional<std::string> action_cache_path;
+  uint64_t action_cache_size_mb;
+  // The server that the action cache is shared through, if any.
+  stdext::optional<respire::RemoteCache::Location> remote_cache;
+  // Whether to keep rebuilding as files change, rather than building once.
+  bool watch;
 
   stdext::file_system::Path initial_file_path;
 };
@@ -54,19 +125,108 @@ stdext::optional<CommandLineParams> ParseArgs(
       if (argc < i + 3) {
         return stdext::nullopt;
       }
-      params.num_threads = atoi(args[2]);
+      params.max_jobs = atoi(args[i + 1]);
+      ++i;
+    } else if (std::string(args[i]) == "-l") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.launch_limits.max_load_average = atof(args[i + 1]);
+      ++i;
+    } else if (std::string(args[i]) == "--memory-headroom") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.launch_limits.min_available_memory =
+          static_cast<uint64_t>(atof(args[i + 1]) * 1024 * 1024);
+      ++i;
+    } else if (std::string(args[i]) == "--build-log") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.build_log_path = std::string(args[i + 1]);
+      ++i;
+    } else if (std::string(args[i]) == "--deps-log") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.deps_log_path = std::string(args[i + 1]);
+      ++i;
+    } else if (std::string(args[i]) == "--action-cache") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.action_cache_path = std::string(args[i + 1]);
+      ++i;
+    } else if (std::string(args[i]) == "--action-cache-size") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.action_cache_size_mb = std::strtoull(args[i + 1], nullptr, 10);
+      ++i;
+    } else if (std::string(args[i]) == "--remote-cache") {
+      if (argc < i + 3) {
+        return stdext::nullopt;
+      }
+      params.remote_cache = respire::RemoteCache::ParseUrl(args[i + 1]);
+      if (!params.remote_cache) {
+        return stdext::nullopt;
+      }
       ++i;
     } else if (std::string(args[i]) == "-o") {
       params.activity_log_level =
           respire::ActivityLog::Level::ProcessExecutionOnly;
     } else if (std::string(args[i]) == "-oo") {
       params.activity_log_level = respire::ActivityLog::Level::All;
+    } else if (std::string(args[i]) == "--jobserver=pipe") {
+      params.jobserver_style = platform::Jobserver::Style::Pipe;
+    } else if (std::string(args[i]) == "--jobserver=fifo") {
+      params.jobserver_style = platform::Jobserver::Style::Fifo;
+    } else if (std::string(args[i]) == "--jobserver=none") {
+      params.jobserver_style = stdext::nullopt;
+    } else if (std::string(args[i]) == "--no-spawn-server") {
+      params.use_spawn_server = false;
+    } else if (std::string(args[i]) == "--no-workers") {
+      params.use_workers = false;
+    } else if (std::string(args[i]) == "--no-batching") {
+      params.use_batching = false;
+    } else if (std::string(args[i]) == "--no-stat-threads") {
+      params.use_stat_threads = false;
+    } else if (std::string(args[i]) == "--watch") {
+      params.watch = true;
     }
   }
 
   return params;
 }
 
+// Builds, and then rebuilds whenever files that the build depends on change,
+// until we're interrupted.
+int Watch(respire::Environment* env, const CommandLineParams& params) {
+  std::unique_ptr<respire::Watcher> watcher =
+      respire::Watcher::Create(env, params.initial_file_path);
+  if (!watcher) {
+    std::cerr << "Error: watching for changes is not supported on this "
+              << "platform." << std::endl;
+    return 1;
+  }
+
+  while (true) {
+    respire::OptionalError maybe_error(watcher->Build());
+    if (maybe_error) {
+      env->activity_log()->SignalRespireError(*maybe_error);
+      std::cerr << "respire: build failed:" << std::endl
+                << maybe_error->str() << std::endl;
+    } else {
+      std::cerr << "respire: build succeeded." << std::endl;
+    }
+    std::cerr << "respire: watching for changes..." << std::endl;
+
+    watcher->WaitForChanges(kWatchQuietPeriod);
+    std::cerr << "respire: files changed, rebuilding." << std::endl;
+  }
+}
+
 }  // namespace
 
 int main(int argc, const char** args) {
@@ -77,15 +237,114 @@ int main(int argc, const char** args) {
     return 1;
   }
 
+  int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+
+  // If we were launched by make (or anything else acting as a jobserver),
+  // share its job budget.  Otherwise, serve our own so that tools that we run
+  // which understand the protocol, e.g. recursive makes, share ours.
+  std::unique_ptr<platform::Jobserver> jobserver(
+      platform::Jobserver::ConnectFromMakeflags(getenv("MAKEFLAGS")));
+
+  int max_jobs = 1;
+  if (command_line_params->max_jobs) {
+    max_jobs = std::max(*command_line_params->max_jobs, 1);
+  } else if (jobserver) {
+    // The jobserver's tokens do the limiting, so run as many jobs as it might
+    // hand out tokens for.
+    if (jobserver->job_limit()) {
+      max_jobs = *jobserver->job_limit();
+    } else if (num_cores > 0) {
+      max_jobs = num_cores;
+    }
+  }
+
+  if (!jobserver && command_line_params->jobserver_style && max_jobs > 1) {
+    jobserver = platform::Jobserver::Create(
+        max_jobs - 1, *command_line_params->jobserver_style);
+    if (jobserver) {
+      jobserver->ExportToEnvironment();
+    }
+  }
+
+  if (command_line_params->use_spawn_server) {
+    // Spawning children gets more expensive as our address space grows, so
+    // start the spawn server now while we're small.  If it fails to start,
+    // we'll just spawn commands ourselves.  This happens after setting up the
+    // jobserver, so that the spawn server passes it on to its children.
+    platform::StartSpawnServer();
+  }
+
+  std::unique_ptr<respire::BuildLog> build_log;
+  if (command_line_params->build_log_path) {
+    build_log = respire::BuildLog::Open(*command_line_params->build_log_path);
+    if (!build_log) {
+      // Outputs just won't be rebuilt for changed commands.
+      std::cerr << "Warning: could not open build log "
+                << *command_line_params->build_log_path << "." << std::endl;
+    }
+  }
+
+  std::unique_ptr<respire::DepsLog> deps_log;
+  if (command_line_params->deps_log_path) {
+    deps_log = respire::DepsLog::Open(*command_line_params->deps_log_path);
+    if (!deps_log) {
+      // Deps files will just be read every time.
+      std::cerr << "Warning: could not open deps log "
+                << *command_line_params->deps_log_path << "." << std::endl;
+    }
+  }
+
+  std::unique_ptr<respire::ActionCache> action_cache;
+  if (command_line_params->action_cache_path) {
+    action_cache = respire::ActionCache::Open(
+        *command_line_params->action_cache_path,
+        command_line_params->action_cache_size_mb * 1024 * 1024);
+    if (!action_cache) {
+      // Commands will just always be run.
+      std::cerr << "Warning: could not open action cache "
+                << *command_line_params->action_cache_path << "."
+                << std::endl;
+    }
+  }
+  if (command_line_params->remote_cache && !action_cache) {
+    // Remote results are only ever restored through the local cache.
+    std::cerr << "Warning: the remote cache is only used along with an "
+              << "action cache." << std::endl;
+  }
+
   // First parse out the registry from the registry files and build up our
   // graph.
   respire::Environment::Options options;
-  options.num_threads = command_line_params->num_threads ?
-      *command_line_params->num_threads : 1;
+  options.max_jobs = max_jobs;
+  options.jobserver = jobserver.get();
+  options.launch_limits = command_line_params->launch_limits;
+  options.build_log = build_log.get();
+  options.deps_log = deps_log.get();
+  options.action_cache = action_cache.get();
+  options.remote_cache = command_line_params->remote_cache;
+  if (command_line_params->use_workers) {
+    options.max_workers_per_tool = std::min(max_jobs, kMaxWorkersPerTool);
+  }
+  if (command_line_params->use_batching) {
+    options.max_batch_size = kMaxBatchSize;
+  }
+  if (command_line_params->use_stat_threads) {
+    options.num_stat_threads = kNumStatThreads;
+  }
+  // Running commands do not occupy threads, so there is no benefit to having
+  // more threads than cores, even when running many more jobs than that.
+  options.num_threads =
+      num_cores > 0 ? std::min(options.max_jobs, num_cores) : options.max_jobs;
   options.activity_log_level = command_line_params->activity_log_level;
 
+  options.record_dependents = command_line_params->watch;
+
   respire::Environment env(options);
 
+  if (command_line_params->watch) {
+    return Watch(&env, *command_line_params);
+  }
+
   respire::OptionalError maybe_error(respire::BuildTargets(
       &env, command_line_params->initial_file_path));
 
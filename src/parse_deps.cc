@@ -1,13 +1,157 @@
 #include "parse_deps.h"
 
+#include <cassert>
 #include <fstream>
 #include <string>
 
+#include "platform/file_system.h"
+
 namespace respire {
 
+namespace {
+bool IsWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Returns the length of the escaped newline starting at |pos|, or 0 if there
+// isn't one there.
+size_t LineContinuationLength(const char* data, size_t size, size_t pos) {
+  if (data[pos] != '\\' || pos + 1 >= size) {
+    return 0;
+  }
+  if (data[pos + 1] == '\n') {
+    return 2;
+  }
+  if (data[pos + 1] == '\r' && pos + 2 < size && data[pos + 2] == '\n') {
+    return 3;
+  }
+  return 0;
+}
+
+std::vector<stdext::string_view> TokenizeListDeps(std::string* contents) {
+  std::vector<stdext::string_view> paths;
+  const char* data = contents->data();
+  size_t line_start = 0;
+  while (line_start < contents->size()) {
+    size_t line_end = contents->find('\n', line_start);
+    if (line_end == std::string::npos) {
+      line_end = contents->size();
+    }
+    size_t path_end = line_end;
+    if (path_end > line_start && data[path_end - 1] == '\r') {
+      --path_end;
+    }
+    if (path_end > line_start) {
+      paths.emplace_back(data + line_start, path_end - line_start);
+    }
+    line_start = line_end + 1;
+  }
+  return paths;
+}
+
+// Reads the prerequisites out of the rules in a Makefile-format deps file,
+// e.g.:
+//
+//   foo.o foo.d: foo.cc include/foo.h include/file\ with\ spaces.h
+//   include/foo.h:
+//
+// where long lines may also be continued with a trailing backslash.
+//
+// Paths are unescaped in place, by copying each character back over any
+// escape characters that preceded it.
+std::vector<stdext::string_view> TokenizeMakeDeps(std::string* contents) {
+  std::vector<stdext::string_view> prerequisites;
+  char* data = &(*contents)[0];
+  const size_t size = contents->size();
+
+  // Each rule starts out with its list of targets, and then switches to its
+  // prerequisites after the colon.
+  bool in_targets = true;
+  size_t read = 0;
+  while (read < size) {
+    size_t continuation_length = LineContinuationLength(data, size, read);
+    if (continuation_length > 0) {
+      read += continuation_length;
+      continue;
+    }
+    if (data[read] == '\n') {
+      in_targets = true;
+      ++read;
+      continue;
+    }
+    if (IsWhitespace(data[read])) {
+      ++read;
+      continue;
+    }
+
+    const size_t token_start = read;
+    size_t write = read;
+    bool ends_targets = false;
+    while (read < size && !IsWhitespace(data[read]) &&
+           !LineContinuationLength(data, size, read)) {
+      char c = data[read];
+      if (c == '\\' && read + 1 < size &&
+          (data[read + 1] == ' ' || data[read + 1] == '\t' ||
+           data[read + 1] == '#')) {
+        data[write++] = data[read + 1];
+        read += 2;
+      } else if (c == '$' && read + 1 < size && data[read + 1] == '$') {
+        data[write++] = '$';
+        read += 2;
+      } else if (c == ':' && in_targets &&
+                 (read + 1 == size || IsWhitespace(data[read + 1]))) {
+        // The colon has to be followed by whitespace so that it isn't
+        // confused with a Windows drive letter.
+        ends_targets = true;
+        ++read;
+        break;
+      } else {
+        data[write++] = c;
+        ++read;
+      }
+    }
+
+    if (!in_targets && write > token_start) {
+      prerequisites.emplace_back(data + token_start, write - token_start);
+    }
+    if (ends_targets) {
+      in_targets = false;
+    }
+  }
+
+  return prerequisites;
+}
+}  // namespace
+
+std::vector<stdext::string_view> TokenizeDeps(
+    DepsFormat format, std::string* contents) {
+  switch (format) {
+    case DepsFormat::kList: return TokenizeListDeps(contents);
+    case DepsFormat::kMake: return TokenizeMakeDeps(contents);
+  }
+  assert(false);
+  return std::vector<stdext::string_view>();
+}
+
+namespace {
+std::vector<FileInfoNodeOutput> LookupDepNodes(
+    Environment* env, LockedNodeStorage* locked_node_storage,
+    const std::vector<ebb::lib::JSONPathStringView>& dep_paths) {
+  std::vector<FileInfoNodeOutput> ret;
+  ret.reserve(dep_paths.size());
+
+  LockedNodeStorage::Access access(locked_node_storage);
+  for (const auto& dep_path : dep_paths) {
+    ret.emplace_back(access.LookupNodeOrMakeFileExistsNode(env, dep_path));
+  }
+  return ret;
+}
+}  // namespace
+
 stdext::optional<std::vector<FileInfoNodeOutput>> ParseDeps(
     Environment* env, LockedNodeStorage* locked_node_storage,
-    FileInfoNodeOutput deps_node, ebb::lib::JSONPathStringView filename) {
+    FileInfoNodeOutput deps_node, ebb::lib::JSONPathStringView filename,
+    DepsFormat format) {
   FileInfoNode::FuturePtr deps_node_future(deps_node.node->GetFileInfo());
   const FileOutput& deps_node_result = *deps_node_future->GetValue();
 
@@ -15,21 +159,47 @@ stdext::optional<std::vector<FileInfoNodeOutput>> ParseDeps(
     return stdext::nullopt;
   }
 
-  std::ifstream in(filename.AsString());
+  std::string filename_string = filename.AsString();
+
+  // If the deps file hasn't changed since it was last read, then there's no
+  // need to read it again.
+  DepsLog* deps_log = env->deps_log();
+  stdext::optional<platform::FileStatus> status;
+  if (deps_log) {
+    status = platform::GetFileStatus(filename_string.c_str());
+    if (status) {
+      auto dep_paths = deps_log->Lookup(filename_string, *status);
+      if (dep_paths) {
+        return LookupDepNodes(env, locked_node_storage, *dep_paths);
+      }
+    }
+  }
+
+  // Read the whole file in one go, so that it can be tokenized in place.
+  std::ifstream in(filename_string,
+                   std::ios::in | std::ios::binary | std::ios::ate);
   if (!in) {
     return stdext::nullopt;
   }
+  std::string contents(static_cast<size_t>(in.tellg()), '\0');
+  in.seekg(0);
+  if (!contents.empty() && !in.read(&contents[0], contents.size())) {
+    return stdext::nullopt;
+  }
+  in.close();
 
-  std::vector<stdext::file_system::Path> dep_paths;
-  while (true) {
-    std::string line;
-    if (!getline(in, line)) {
-      break;
-    }
+  std::vector<stdext::string_view> dep_paths = TokenizeDeps(format, &contents);
 
-    dep_paths.emplace_back(line);
+  if (status) {
+    std::vector<std::string> dep_path_strings;
+    dep_path_strings.reserve(dep_paths.size());
+    for (const auto& dep_path : dep_paths) {
+      dep_path_strings.emplace_back(dep_path.data(), dep_path.size());
+    }
+    return LookupDepNodes(
+        env, locked_node_storage,
+        deps_log->Record(filename_string, *status, dep_path_strings));
   }
-  in.close();
 
   std::vector<FileInfoNodeOutput> ret;
   ret.reserve(dep_paths.size());
@@ -37,7 +207,8 @@ stdext::optional<std::vector<FileInfoNodeOutput>> ParseDeps(
   LockedNodeStorage::Access access(locked_node_storage);
   for (const auto& dep_path : dep_paths) {
     ret.emplace_back(access.LookupNodeOrMakeFileExistsNode(
-        env, access.AddPathString(dep_path)));
+        env, access.AddPathString(stdext::file_system::Path(
+                 std::string(dep_path.data(), dep_path.size())))));
   }
 
   return ret;
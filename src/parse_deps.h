@@ -1,18 +1,28 @@
 #ifndef __RESPIRE_PARSE_DEPS_H__
 #define __RESPIRE_PARSE_DEPS_H__
 
+#include <string>
 #include <vector>
 
 #include "environment.h"
 #include "file_info_node.h"
 #include "locked_node_storage.h"
 #include "stdext/optional.h"
+#include "stdext/string_view.h"
+#include "system_command_node_params.h"
 
 namespace respire {
 
 stdext::optional<std::vector<FileInfoNodeOutput>> ParseDeps(
     Environment* env, LockedNodeStorage* locked_node_storage,
-    FileInfoNodeOutput deps_node, ebb::lib::JSONPathStringView filename);
+    FileInfoNodeOutput deps_node, ebb::lib::JSONPathStringView filename,
+    DepsFormat format);
+
+// Returns the dependency paths listed in |contents|, the contents of a deps
+// file in the given |format|.  The returned views point into |contents|,
+// which is modified in place to resolve any escape sequences.
+std::vector<stdext::string_view> TokenizeDeps(
+    DepsFormat format, std::string* contents);
 
 }  // namespace respire
 
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "parse_deps.h"
+
+namespace respire {
+
+namespace {
+std::vector<std::string> Tokenize(DepsFormat format, std::string contents) {
+  std::vector<std::string> ret;
+  for (const auto& token : TokenizeDeps(format, &contents)) {
+    ret.emplace_back(token.data(), token.size());
+  }
+  return ret;
+}
+}  // namespace
+
+TEST(ParseDepsTest, ListFormat) {
+  EXPECT_EQ(std::vector<std::string>({"foo.h", "dir with spaces/bar.h"}),
+            Tokenize(DepsFormat::kList, "foo.h\ndir with spaces/bar.h\n"));
+  EXPECT_EQ(std::vector<std::string>({"foo.h", "bar.h"}),
+            Tokenize(DepsFormat::kList, "foo.h\r\n\r\nbar.h"));
+  EXPECT_TRUE(Tokenize(DepsFormat::kList, "").empty());
+}
+
+TEST(ParseDepsTest, MakeFormatSkipsTargets) {
+  EXPECT_EQ(std::vector<std::string>({"foo.cc", "foo.h", "bar.h"}),
+            Tokenize(DepsFormat::kMake,
+                     "foo.o foo.d: foo.cc foo.h \\\n"
+                     "  bar.h\n"));
+}
+
+TEST(ParseDepsTest, MakeFormatHandlesContinuations) {
+  EXPECT_EQ(std::vector<std::string>({"foo.cc", "foo.h", "bar.h"}),
+            Tokenize(DepsFormat::kMake,
+                     "foo.o: \\\r\n foo.cc \\\r\n foo.h\\\r\n bar.h\r\n"));
+  // A continuation may also separate the targets from the colon.
+  EXPECT_EQ(std::vector<std::string>({"foo.cc"}),
+            Tokenize(DepsFormat::kMake, "foo.o \\\n : foo.cc"));
+}
+
+TEST(ParseDepsTest, MakeFormatHandlesEscapes) {
+  EXPECT_EQ(std::vector<std::string>(
+                {"dir with spaces/foo.h", "#bar.h", "$baz.h", "tab\there.h"}),
+            Tokenize(DepsFormat::kMake,
+                     "foo.o: dir\\ with\\ spaces/foo.h \\#bar.h $$baz.h "
+                     "tab\\\there.h\n"));
+}
+
+TEST(ParseDepsTest, MakeFormatHandlesMultipleRules) {
+  // e.g. as written with gcc's "-MP" flag.
+  EXPECT_EQ(std::vector<std::string>({"foo.cc", "foo.h", "bar.h"}),
+            Tokenize(DepsFormat::kMake,
+                     "foo.o: foo.cc foo.h\n"
+                     "foo.h:\n"
+                     "\n"
+                     "baz.o: bar.h\n"));
+}
+
+TEST(ParseDepsTest, MakeFormatHandlesWindowsPaths) {
+  EXPECT_EQ(std::vector<std::string>({"C:\\src\\foo.cc", "C:\\src\\foo.h"}),
+            Tokenize(DepsFormat::kMake,
+                     "C:\\out\\foo.o: C:\\src\\foo.cc \\\n"
+                     "  C:\\src\\foo.h\n"));
+}
+
+}  // namespace respire
@@ -0,0 +1,61 @@
+#include "piped_process_protocol.h"
+
+#include <algorithm>
+
+#include "platform/subprocess.h"
+
+namespace respire {
+
+void AppendUint32(std::string* message, uint32_t value) {
+  message->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(std::string* message, const std::string& value) {
+  AppendUint32(message, static_cast<uint32_t>(value.size()));
+  message->append(value);
+}
+
+void AppendStringList(std::string* message,
+                      const std::vector<std::string>& values) {
+  AppendUint32(message, static_cast<uint32_t>(values.size()));
+  for (const auto& value : values) {
+    AppendString(message, value);
+  }
+}
+
+bool ReadUint32(platform::PipedProcess* process, uint32_t* value) {
+  return process->Read(reinterpret_cast<char*>(value), sizeof(*value));
+}
+
+bool ReadInt32(platform::PipedProcess* process, int32_t* value) {
+  return process->Read(reinterpret_cast<char*>(value), sizeof(*value));
+}
+
+bool ReadOutput(platform::PipedProcess* process, std::string* output) {
+  uint32_t size;
+  if (!ReadUint32(process, &size)) {
+    return false;
+  }
+
+  output->resize(std::min<size_t>(size, platform::kMaxCapturedOutputBytes));
+  if (!output->empty() && !process->Read(&(*output)[0], output->size())) {
+    return false;
+  }
+
+  size_t dropped_bytes = size - output->size();
+  char discard[4096];
+  while (dropped_bytes > 0) {
+    size_t chunk_size = std::min(dropped_bytes, sizeof(discard));
+    if (!process->Read(discard, chunk_size)) {
+      return false;
+    }
+    dropped_bytes -= chunk_size;
+  }
+  if (size > output->size()) {
+    *output += "\n[" + std::to_string(size - output->size()) +
+               " more bytes of output were dropped]\n";
+  }
+  return true;
+}
+
+}  // namespace respire
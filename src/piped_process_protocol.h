@@ -0,0 +1,35 @@
+#ifndef __RESPIRE_PIPED_PROCESS_PROTOCOL_H__
+#define __RESPIRE_PIPED_PROCESS_PROTOCOL_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "platform/piped_process.h"
+
+namespace respire {
+
+// Helpers for the simple binary protocol that respire speaks with the tools
+// that it runs through a platform::PipedProcess, i.e. persistent workers (see
+// WorkerPool) and batch runners (see BatchRunner).  All integers are in native
+// byte order, and strings are encoded as a uint32 length followed by their
+// characters.
+
+void AppendUint32(std::string* message, uint32_t value);
+void AppendString(std::string* message, const std::string& value);
+// Encodes a uint32 count followed by that many strings.
+void AppendStringList(std::string* message,
+                      const std::vector<std::string>& values);
+
+bool ReadUint32(platform::PipedProcess* process, uint32_t* value);
+bool ReadInt32(platform::PipedProcess* process, int32_t* value);
+
+// Reads a string of command output from |process|, keeping at most
+// platform::kMaxCapturedOutputBytes of it, in the same way as output captured
+// from an ordinary process.
+bool ReadOutput(platform::PipedProcess* process, std::string* output);
+
+}  // namespace respire
+
+#endif  // __RESPIRE_PIPED_PROCESS_PROTOCOL_H__
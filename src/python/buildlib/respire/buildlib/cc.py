@@ -27,6 +27,30 @@ class Configuration(object):
     self.compile_for_shared_library = compile_for_shared_library
 
 
+# Command lines longer than this many characters pass their (typically very long)
+# list of input files through a response file instead.  A command run through
+# the shell is a single argument to it, so this keeps well clear of Linux's
+# 128KB limit on the length of a single argument, as well as the 8191 character
+# limit of Windows' cmd.exe.
+RESPONSE_FILE_THRESHOLD = 8000
+
+
+def SystemCommandWithResponseFile(registry, command_prefix, args,
+                                  command_suffix, rspfile, quote_function,
+                                  **kwargs):
+  '''Registers a system command that runs |command_prefix| + |args| +
+  |command_suffix|.  If that command line would be too long, |args| are instead
+  written to |rspfile|, formatted by |quote_function|, and the command is passed
+  "@rspfile" in their place.'''
+  command = command_prefix + args + command_suffix
+  if sum(len(x) + 1 for x in command) <= RESPONSE_FILE_THRESHOLD:
+    registry.SystemCommand(command=command, **kwargs)
+  else:
+    registry.SystemCommand(
+        command=command_prefix + ['@' + rspfile] + command_suffix,
+        rspfile=rspfile, rspfile_content=quote_function(args), **kwargs)
+
+
 class Toolchain(object):
   # Note that 'object_basepath' here refers to a file path for the output file
   # without an extension...  So that specific compilers can choose the
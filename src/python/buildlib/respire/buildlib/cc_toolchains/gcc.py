@@ -1,4 +1,6 @@
+import multiprocessing
 import os
+import re
 import sys
 
 import respire.buildlib.cc as cc
@@ -23,6 +25,28 @@ def DeriveArPathFromGccPath(gcc_path):
   return ar_path
 
 
+# Links can use several gigabytes of memory each, far more than compiles do, so
+# they are run in their own pool to keep too many of them from running at once.
+_LINK_POOL_NAME = 'link'
+_LINK_POOL_MEMORY_PER_JOB = 4 * 1024 * 1024 * 1024
+
+
+def _GetLinkPoolDepth():
+  cpu_count = multiprocessing.cpu_count()
+  try:
+    physical_memory = (
+        os.sysconf('SC_PAGE_SIZE') * os.sysconf('SC_PHYS_PAGES'))
+  except (AttributeError, ValueError, OSError):
+    return cpu_count
+  return max(1, min(cpu_count, physical_memory // _LINK_POOL_MEMORY_PER_JOB))
+
+
+def _QuoteForResponseFile(args):
+  '''Formats |args| as the contents of a response file, which gcc, ld and ar
+  all split on whitespace, with backslashes escaping the next character.'''
+  return ' '.join(re.sub(r'([\s\\\'"])', r'\\\1', x) for x in args)
+
+
 _WARNING_TO_WARNING_SWITCH_MAP = {
   cc.Configuration.WARNING_UNKNOWN_ATTRIBUTE: ['attributes'],
   cc.Configuration.WARNING_IGNORE_MISSING_OVERRIDE: [
@@ -112,23 +136,12 @@ class GccToolchain(cc.Toolchain):
 
     command += ['-c', source_filepath, '-o', object_filepath]
 
-    respire_deps_file = object_basepath + '.dr'
-    deps_convert_script = os.path.join(os.path.dirname(__file__),
-                                       'deps_make_to_respire.py')
-
-    # Setup a command for converting between gcc's makefile-based deps file
-    # to a respire formatted deps file.
-    registry.SystemCommand(
-        inputs=[make_deps_file],
-        outputs=[respire_deps_file],
-        command=[sys.executable, deps_convert_script, '-i', make_deps_file,
-                 '-o', respire_deps_file])
-
-    # Setup the actual compile command.
+    # Respire reads gcc's Makefile-formatted deps file directly.
     registry.SystemCommand(
         inputs=[source_filepath] + extra_dependencies,
         outputs=[object_filepath],
-        deps=respire_deps_file,
+        deps=make_deps_file,
+        deps_format='make',
         command=command)
 
     return object_filepath
@@ -136,53 +149,57 @@ class GccToolchain(cc.Toolchain):
   def ArchiveToStaticLibrary(self, registry, configuration, object_filepaths,
                              static_library_basepath):
     static_library_filepath = static_library_basepath + '.a'
-    command = ([sys.executable, self.ar_wrapper_script_path,
-                self.ar_executable_path, 'rcs', static_library_filepath] +
-                object_filepaths)
+    command = [sys.executable, self.ar_wrapper_script_path,
+               self.ar_executable_path, 'rcs', static_library_filepath]
 
-    registry.SystemCommand(
+    cc.SystemCommandWithResponseFile(
+        registry, command, object_filepaths, [],
+        static_library_filepath + '.rsp', _QuoteForResponseFile,
         inputs=object_filepaths,
-        outputs=[static_library_filepath],
-        command=command)
+        outputs=[static_library_filepath])
 
     return static_library_filepath
 
   def _Link(self, registry, configuration, object_filepaths,
                        static_library_filepaths, system_libraries,
                        output_path, extra_flags=[]):
-    command = ([self.gpp_executable_path] +
-               extra_flags +
-               ['-o', output_path] +
-               object_filepaths)
+    command_prefix = ([self.gpp_executable_path] +
+                      extra_flags +
+                      ['-o', output_path])
 
+    command_suffix = []
     if configuration.optimize:
-      command += ['-Wl,--gc-sections']
+      command_suffix += ['-Wl,--gc-sections']
 
-    command += ['-Wl,--exclude-libs,ALL']
+    command_suffix += ['-Wl,--exclude-libs,ALL']
 
     if hasattr(self, 'additional_linker_flags'):
-      command += self.additional_linker_flags
+      command_suffix += self.additional_linker_flags
 
-    command += list(set(
+    command_suffix += list(set(
         ['-L' + os.path.dirname(x) for x in static_library_filepaths]))
 
-    command += ['-l:' + os.path.split(x)[1] for x in static_library_filepaths]
+    command_suffix += [
+        '-l:' + os.path.split(x)[1] for x in static_library_filepaths]
 
-    command += ['-L' + x for x in (
+    command_suffix += ['-L' + x for x in (
         self.toolchain_library_directories + configuration.library_directories)
     ]
 
-    command += ['-Wl,-rpath-link,' + x for x in (
-                self.toolchain_library_directories)]
+    command_suffix += ['-Wl,-rpath-link,' + x for x in (
+                       self.toolchain_library_directories)]
 
-    command += ['-l' + x for x in system_libraries]
+    command_suffix += ['-l' + x for x in system_libraries]
 
-    command += ['-std=c++11', '-lpthread']
+    command_suffix += ['-std=c++11', '-lpthread']
 
-    registry.SystemCommand(
+    registry.Pool(_LINK_POOL_NAME, _GetLinkPoolDepth())
+    cc.SystemCommandWithResponseFile(
+        registry, command_prefix, object_filepaths, command_suffix,
+        output_path + '.rsp', _QuoteForResponseFile,
         inputs=object_filepaths + static_library_filepaths,
         outputs=[output_path],
-        command=command)
+        pool=_LINK_POOL_NAME)
 
     return output_path
 
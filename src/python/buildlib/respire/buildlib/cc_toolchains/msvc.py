@@ -1,4 +1,5 @@
 import os
+import subprocess
 import sys
 
 import respire.buildlib.cc as cc
@@ -135,6 +136,12 @@ _WARNING_TO_WARNING_NUMBER_MAP = {
   cc.Configuration.WARNING_FORCING_VALUE_TO_BOOL : ['4800'],
 }
 
+def _QuoteForResponseFile(args):
+  '''Formats |args| as the contents of a response file, which the MSVC tools
+  parse in the same way as their command lines.'''
+  return subprocess.list2cmdline(args)
+
+
 class MSVCToolchain(cc.Toolchain):
   def __init__(self, cl_executable_path, system_include_directories=[],
                system_library_directories=[], link_executable_path=None,
@@ -285,15 +292,12 @@ class MSVCToolchain(cc.Toolchain):
       '/ignore:4221',
     ]
 
-    command += object_filepaths
-
-    command += ['/OUT:' + static_library_filepath]
-
-
-    registry.SystemCommand(
+    cc.SystemCommandWithResponseFile(
+        registry, command, object_filepaths,
+        ['/OUT:' + static_library_filepath],
+        static_library_filepath + '.rsp', _QuoteForResponseFile,
         inputs=object_filepaths,
-        outputs=[static_library_filepath],
-        command=command)
+        outputs=[static_library_filepath])
 
     return static_library_filepath
 
@@ -327,11 +331,8 @@ class MSVCToolchain(cc.Toolchain):
     # likely a better place to set this up, but I wasn't sure where just yet.
     command += ['shell32.lib'] + extra_input_files
 
-    command += object_filepaths
-    command += static_library_filepaths
-    command += [x + '.lib' for x in system_libraries]
-
-    command += ['/OUT:' + output_filepath]
+    command_suffix = [x + '.lib' for x in system_libraries]
+    command_suffix += ['/OUT:' + output_filepath]
 
     outputs = [output_filepath]
     soft_outputs = []
@@ -342,11 +343,12 @@ class MSVCToolchain(cc.Toolchain):
     if pdb_filepath:
       soft_outputs += [pdb_filepath]
 
-    registry.SystemCommand(
+    cc.SystemCommandWithResponseFile(
+        registry, command, object_filepaths + static_library_filepaths,
+        command_suffix, output_filepath + '.rsp', _QuoteForResponseFile,
         inputs=object_filepaths + static_library_filepaths,
         outputs=outputs,
-        soft_outputs=soft_outputs,
-        command=command)
+        soft_outputs=soft_outputs)
 
 
     return outputs + soft_outputs
@@ -1,9 +1,6 @@
 import collections
-import platform
 import os
-import shutil
 
-import respire.buildlib.touch as touch
 import respire.buildlib.utils as utils
 
 
@@ -57,9 +54,9 @@ def _DoCopyFiles(registry, inputs, output_dir, stamp_file, filter):
 
   # Now that we have the list of source files to copy, and their relative
   # destination within the output folder, setup the actual single-file copies.
+  # Respire creates the output directories as it copies into them.
   for rel_dir, input_files in source_files_by_out_directory.items():
     output_sub_dir = os.path.join(output_dir, rel_dir)
-    _CreateDirectory(output_sub_dir)
     for input_file in input_files:
       output_file = os.path.abspath(
           os.path.join(output_sub_dir, os.path.basename(input_file)))
@@ -67,36 +64,8 @@ def _DoCopyFiles(registry, inputs, output_dir, stamp_file, filter):
       all_output_files.append(output_file)
 
   if stamp_file:
-    registry.PythonFunction(
-        inputs=all_output_files, outputs=[stamp_file], function=touch.Touch)
-
-
-if platform.system() == 'Windows':
-  WINDOWS_COPY_COMMAND = (
-      os.path.join(os.path.dirname(__file__), 'windows_utils', 'copy.cmd'))
+    registry.Stamp(inputs=all_output_files, outputs=[stamp_file])
 
 
 def SingleFileCopy(registry, input_file, output_file):
-  if platform.system() == 'Windows':
-    registry.SystemCommand(
-        inputs=[input_file],
-        outputs=[output_file],
-        command=[WINDOWS_COPY_COMMAND, input_file, output_file])
-  else:
-    registry.SystemCommand(
-        inputs=[input_file],
-        outputs=[output_file],
-        command=['cp', input_file, output_file])
-
-
-def _CreateDirectory(directory):
-  if not os.path.exists(directory):
-    os.makedirs(directory)
-  else:
-    if not os.path.isdir(directory):
-      raise Exception('A non-directory file already exists where we were '
-                      'requested to make a directory.')
-
-def _DoCopy(inputs, outputs):
-  shutil.copyfile(inputs[0], outputs[0])
-  return 0
\ No newline at end of file
+  registry.Copy(inputs=[input_file], outputs=[output_file])
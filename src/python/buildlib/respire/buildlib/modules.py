@@ -6,7 +6,6 @@ import sys
 import respire.buildlib.cc as cc
 import respire.buildlib.copy_files as copy_files
 import respire.buildlib.utils as utils
-import respire.buildlib.touch as touch
 
 
 class Module(object):
@@ -88,10 +87,7 @@ class Module(object):
 
       sub_stamps.append(directories_stamp_file)
 
-    registry.PythonFunction(
-      inputs=sub_stamps,
-      outputs=[copy_stamp_file],
-      function=touch.Touch)
+    registry.Stamp(inputs=sub_stamps, outputs=[copy_stamp_file])
     
     return copy_stamp_file
 
@@ -0,0 +1,40 @@
+'''Python script that stands in for a C compiler run with "-MD".
+
+It writes the contents of a source file followed by the contents of the file
+named on the source file's first line, much as a C compiler would #include it,
+and writes a Makefile-style deps file listing both.
+
+An extra 'count' parameter is expected, indicating a "count" file that will
+be incremented when the function is called.
+'''
+
+import sys
+import test_utils
+
+
+def main():
+  if len(sys.argv) != 5:
+    print('Usage: shell_include.py source output deps count')
+    return 1
+
+  source_filepath, output_filepath, deps_filepath, count_file = sys.argv[1:]
+  with open(source_filepath, 'r') as f:
+    source = f.read()
+  include_filepath = source.splitlines()[0]
+  with open(include_filepath, 'r') as f:
+    include = f.read()
+
+  with open(output_filepath, 'w') as f:
+    f.write(source + include)
+  with open(deps_filepath, 'w') as f:
+    f.write('%s: %s \\\n  %s\n' %
+            (output_filepath, source_filepath, include_filepath))
+
+  if count_file != 'None':
+    test_utils.AddCount(count_file)
+
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -1,15 +1,17 @@
 import os
+import shutil
 import unittest
 import test_utils
 
 class TestSingleFunction(unittest.TestCase):
-  def RunRespire(self, script_filepath, target_filepath):
+  def RunRespire(self, script_filepath, target_filepath, **run_kwargs):
     return test_utils.RunRespire(
       script_filepath=script_filepath,
       function='TestBuild',
       params={'out_dir' : self.temp_dirs.out_dir},
       out_dir=self.temp_dirs.respire_out_dir,
-      targets=[target_filepath])
+      targets=[target_filepath],
+      **run_kwargs)
 
   def setUp(self):
     self.temp_dirs = test_utils.TemporaryTestDirectories('test_single_function')
@@ -64,6 +66,197 @@ class TestSingleFunction(unittest.TestCase):
     self.assertEqual(2, test_utils.GetCount(os.path.join(
         self.temp_dirs.out_dir, 'single_function.count')))
 
+  def test_NativeActions(self):
+    stamp_filepath = os.path.join(self.temp_dirs.out_dir, 'copied.stamp')
+    copied_foo_filepath = os.path.join(
+        self.temp_dirs.out_dir, 'copied', 'foo.txt')
+    script_filepath = os.path.join(self.temp_dirs.source_dir,
+                                   'native_actions.respire.py')
+    foo_path = os.path.join(self.temp_dirs.source_dir, 'foo.txt')
+
+    result = self.RunRespire(script_filepath, stamp_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(copied_foo_filepath),
+                     'foo')
+    self.assertEqual(test_utils.ContentsForFilePath(stamp_filepath), '')
+
+    # Modified sources are copied again.
+    with open(foo_path, 'w') as f:
+      f.write('fooey')
+    result = self.RunRespire(script_filepath, stamp_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(copied_foo_filepath),
+                     'fooey')
+
+    directory = os.path.join(self.temp_dirs.out_dir, 'a', 'b')
+    result = self.RunRespire(script_filepath, directory)
+    self.assertTrue(result)
+    self.assertTrue(os.path.isdir(directory))
+
+  def test_ResponseFile(self):
+    output_filepath = os.path.join(self.temp_dirs.out_dir, 'from_rsp.txt')
+    script_filepath = os.path.join(self.temp_dirs.source_dir,
+                                   'response_file.respire.py')
+
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath),
+                     'foo "bar baz"')
+    # The response file only exists while the command runs.
+    self.assertFalse(
+        os.path.exists(os.path.join(self.temp_dirs.out_dir, 'cat.rsp')))
+
+  def test_ChangedCommandIsRebuilt(self):
+    output_filepath = os.path.join(self.temp_dirs.out_dir, 'changed.txt')
+    script_filepath = os.path.join(self.temp_dirs.source_dir,
+                                   'changed_command.respire.py')
+    content_filepath = os.path.join(self.temp_dirs.out_dir, 'content.txt')
+
+    with open(content_filepath, 'w') as f:
+      f.write('foo')
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath), 'foo')
+    self.assertEqual(1, test_utils.GetCount(os.path.join(
+        self.temp_dirs.out_dir, 'changed.count')))
+    self.assertEqual(1, test_utils.GetCount(os.path.join(
+        self.temp_dirs.out_dir, 'unchanged.count')))
+
+    # The registry changes, but only the command that changed with it is run
+    # again.
+    with open(content_filepath, 'w') as f:
+      f.write('bar')
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath), 'bar')
+    self.assertEqual(2, test_utils.GetCount(os.path.join(
+        self.temp_dirs.out_dir, 'changed.count')))
+    self.assertEqual(1, test_utils.GetCount(os.path.join(
+        self.temp_dirs.out_dir, 'unchanged.count')))
+
+  def test_EarlyCutoffSkipsDependentsOfUnchangedOutputs(self):
+    output_filepath = os.path.join(self.temp_dirs.out_dir, 'final.txt')
+    script_filepath = os.path.join(self.temp_dirs.source_dir,
+                                   'early_cutoff.respire.py')
+    input_filepath = os.path.join(self.temp_dirs.out_dir, 'input.txt')
+    first_line_count = os.path.join(self.temp_dirs.out_dir, 'first_line.count')
+    final_count = os.path.join(self.temp_dirs.out_dir, 'final.count')
+
+    with open(input_filepath, 'w') as f:
+      f.write('foo\n1')
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath), 'foo\n')
+    self.assertEqual(1, test_utils.GetCount(first_line_count))
+    self.assertEqual(1, test_utils.GetCount(final_count))
+
+    # The first line is rewritten, but with the same contents, so the final
+    # output isn't rebuilt.
+    with open(input_filepath, 'w') as f:
+      f.write('foo\n2')
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(2, test_utils.GetCount(first_line_count))
+    self.assertEqual(1, test_utils.GetCount(final_count))
+
+    # And it stays that way.
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(2, test_utils.GetCount(first_line_count))
+    self.assertEqual(1, test_utils.GetCount(final_count))
+
+    with open(input_filepath, 'w') as f:
+      f.write('bar\n2')
+    result = self.RunRespire(script_filepath, output_filepath)
+    self.assertTrue(result)
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath), 'bar\n')
+    self.assertEqual(3, test_utils.GetCount(first_line_count))
+    self.assertEqual(2, test_utils.GetCount(final_count))
+
+  def test_RemoteCacheSharesOutputs(self):
+    output_filepath = os.path.join(self.temp_dirs.out_dir, 'foofoobarbar.txt')
+    script_filepath = os.path.join(self.temp_dirs.source_dir,
+                                   'single_function.respire.py')
+    bar_bar_count = os.path.join(self.temp_dirs.out_dir, 'bar_bar.count')
+
+    server, url = test_utils.StartRemoteCacheServer(
+        os.path.join(self.temp_dirs.temp_dir, 'remote_cache'))
+    try:
+      result = self.RunRespire(
+          script_filepath, output_filepath,
+          action_cache=os.path.join(self.temp_dirs.temp_dir, 'cache1'),
+          remote_cache=url)
+      self.assertTrue(result)
+      self.assertEqual(1, test_utils.GetCount(bar_bar_count))
+
+      # As if on another machine, with the same paths but nothing built and
+      # an empty local cache, every output comes from the remote cache.
+      for name in os.listdir(self.temp_dirs.out_dir):
+        if name.endswith('.txt'):
+          os.remove(os.path.join(self.temp_dirs.out_dir, name))
+      shutil.rmtree(self.temp_dirs.respire_out_dir)
+      os.mkdir(self.temp_dirs.respire_out_dir)
+      result = self.RunRespire(
+          script_filepath, output_filepath,
+          action_cache=os.path.join(self.temp_dirs.temp_dir, 'cache2'),
+          remote_cache=url)
+      self.assertTrue(result)
+      self.assertEqual(test_utils.ContentsForFilePath(output_filepath),
+                       'foofoobarbar')
+      self.assertEqual(1, test_utils.GetCount(bar_bar_count))
+    finally:
+      server.shutdown()
+      server.server_close()
+
+  def test_ActionCacheRestoresDepsFile(self):
+    output_filepath = os.path.join(self.temp_dirs.out_dir, 'included.txt')
+    script_filepath = os.path.join(self.temp_dirs.source_dir,
+                                   'deps_file.respire.py')
+    source_filepath = os.path.join(self.temp_dirs.out_dir, 'source.txt')
+    header_filepath = os.path.join(self.temp_dirs.out_dir, 'header.txt')
+    deps_filepath = os.path.join(self.temp_dirs.out_dir, 'included.d')
+    included_count = os.path.join(self.temp_dirs.out_dir, 'included.count')
+    action_cache = os.path.join(self.temp_dirs.temp_dir, 'cache')
+
+    with open(source_filepath, 'w') as f:
+      f.write(header_filepath + '\n')
+    with open(header_filepath, 'w') as f:
+      f.write('foo')
+    result = self.RunRespire(script_filepath, output_filepath,
+                             action_cache=action_cache)
+    self.assertTrue(result)
+    self.assertEqual(1, test_utils.GetCount(included_count))
+
+    # As if switching branches and back, the output and its deps file are
+    # restored from the cache.
+    os.remove(output_filepath)
+    os.remove(deps_filepath)
+    result = self.RunRespire(script_filepath, output_filepath,
+                             action_cache=action_cache)
+    self.assertTrue(result)
+    self.assertEqual(1, test_utils.GetCount(included_count))
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath),
+                     header_filepath + '\nfoo')
+    self.assertTrue(os.path.exists(deps_filepath))
+
+    # With its deps file back, the output is known to be up to date, so it
+    # isn't restored again.
+    restored_mtime = os.path.getmtime(output_filepath)
+    result = self.RunRespire(script_filepath, output_filepath,
+                             action_cache=action_cache)
+    self.assertTrue(result)
+    self.assertEqual(restored_mtime, os.path.getmtime(output_filepath))
+
+    # And a change to the header it lists is still noticed.
+    with open(header_filepath, 'w') as f:
+      f.write('bar')
+    result = self.RunRespire(script_filepath, output_filepath,
+                             action_cache=action_cache)
+    self.assertTrue(result)
+    self.assertEqual(2, test_utils.GetCount(included_count))
+    self.assertEqual(test_utils.ContentsForFilePath(output_filepath),
+                     header_filepath + '\nbar')
+
   def test_StdOutErrInFunction(self):
       output_filepath = os.path.join(self.temp_dirs.out_dir, 'final.txt')
       script_filepath = os.path.join(self.temp_dirs.source_dir,
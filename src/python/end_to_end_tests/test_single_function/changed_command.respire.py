@@ -0,0 +1,30 @@
+import os
+import registry
+import end_to_end_tests.test_utils as utils
+
+
+def TestBuild(registry, out_dir):
+  content_file = os.path.join(out_dir, 'content.txt')
+
+  registry.RegisterSelfDependency(content_file)
+
+  with open(content_file, 'r') as f:
+    content = f.read()
+
+  # Only the first command depends on the content, so only it should rerun when
+  # the content, and so the registry, changes.
+  registry.PythonFunction(
+      inputs=[], outputs=[os.path.join(out_dir, 'changed.txt')],
+      function=WriteContent, content=content,
+      count_file=os.path.join(out_dir, 'changed.count'))
+  registry.PythonFunction(
+      inputs=[], outputs=[os.path.join(out_dir, 'unchanged.txt')],
+      function=WriteContent, content='unchanged',
+      count_file=os.path.join(out_dir, 'unchanged.count'))
+  registry.Build(os.path.join(out_dir, 'unchanged.txt'))
+
+
+def WriteContent(outputs, content, count_file):
+  with open(outputs[0], 'w') as f:
+    f.write(content)
+  utils.AddCount(count_file)
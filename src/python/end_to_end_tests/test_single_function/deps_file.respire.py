@@ -0,0 +1,17 @@
+import os
+import registry
+import end_to_end_tests.test_utils as utils
+
+def TestBuild(registry, out_dir):
+  source_path = os.path.join(out_dir, 'source.txt')
+  output_path = os.path.join(out_dir, 'included.txt')
+  deps_path = os.path.join(out_dir, 'included.d')
+
+  registry.SystemCommand(
+      inputs=[source_path],
+      outputs=[output_path],
+      deps=deps_path,
+      deps_format='make',
+      command=utils.IncludeCommand(
+          source_path, output_path, deps_path,
+          os.path.join(out_dir, 'included.count')))
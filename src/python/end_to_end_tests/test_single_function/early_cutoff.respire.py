@@ -0,0 +1,36 @@
+import os
+import registry
+import end_to_end_tests.test_utils as utils
+
+
+def TestBuild(registry, out_dir):
+  input_file = os.path.join(out_dir, 'input.txt')
+  first_line_file = os.path.join(out_dir, 'first_line.txt')
+  final_file = os.path.join(out_dir, 'final.txt')
+
+  # The first line only changes along with some of the input's changes, and
+  # the final output shouldn't be rebuilt for the others.
+  registry.PythonFunction(
+      inputs=[input_file], outputs=[first_line_file],
+      function=WriteFirstLine, early_cutoff=True,
+      count_file=os.path.join(out_dir, 'first_line.count'))
+  registry.PythonFunction(
+      inputs=[first_line_file], outputs=[final_file],
+      function=CopyFile, count_file=os.path.join(out_dir, 'final.count'))
+  registry.Build(final_file)
+
+
+def WriteFirstLine(inputs, outputs, count_file):
+  with open(inputs[0], 'r') as f:
+    first_line = f.readline()
+  with open(outputs[0], 'w') as f:
+    f.write(first_line)
+  utils.AddCount(count_file)
+
+
+def CopyFile(inputs, outputs, count_file):
+  with open(inputs[0], 'r') as f:
+    content = f.read()
+  with open(outputs[0], 'w') as f:
+    f.write(content)
+  utils.AddCount(count_file)
@@ -0,0 +1,15 @@
+import os
+import registry
+import respire.buildlib.copy_files as copy_files
+
+SCRIPT_DIR = os.path.dirname(os.path.realpath(__file__))
+
+def TestBuild(registry, out_dir):
+  copy_files.CopyFiles(
+      registry,
+      inputs=[os.path.join(SCRIPT_DIR, 'foo.txt'),
+              os.path.join(SCRIPT_DIR, 'bar.txt')],
+      output_dir=os.path.join(out_dir, 'copied'),
+      stamp_file=os.path.join(out_dir, 'copied.stamp'))
+
+  registry.Mkdir(outputs=[os.path.join(out_dir, 'a', 'b')])
@@ -0,0 +1,14 @@
+import os
+import registry
+import end_to_end_tests.test_utils as utils
+
+def TestBuild(registry, out_dir):
+  rsp_path = os.path.join(out_dir, 'cat.rsp')
+  output_path = os.path.join(out_dir, 'from_rsp.txt')
+
+  registry.SystemCommand(
+      inputs=[],
+      outputs=[output_path],
+      command=utils.CatCommand([rsp_path], output_path),
+      rspfile=rsp_path,
+      rspfile_content='foo "bar baz"')
@@ -11,6 +11,8 @@ import uuid
 
 RESPIRE_SCRIPT_PATH = os.path.join(os.path.dirname(__file__),
                                    os.pardir, 'respire.py')
+REMOTE_CACHE_SERVER_SCRIPT_PATH = os.path.join(
+    os.path.dirname(__file__), os.pardir, 'remote_cache_server.py')
 
 
 class TemporaryTestDirectories(object):
@@ -60,7 +62,8 @@ def DriverStep(registry, forward_params, build_file, function, targets):
     registry.Build(target)
 
 
-def RunRespire(script_filepath, function, params, out_dir, targets):
+def RunRespire(script_filepath, function, params, out_dir, targets,
+               **run_kwargs):
   driver_params = {
     'forward_params': params,
     'build_file': script_filepath,
@@ -76,7 +79,15 @@ def RunRespire(script_filepath, function, params, out_dir, targets):
   respire_module = imp.load_source('respire_module', RESPIRE_SCRIPT_PATH)
   return respire_module.Run(
       out_dir, inspect.getsourcefile(sys.modules[__name__]), 'DriverStep',
-      driver_params)
+      driver_params, **run_kwargs)
+
+
+def StartRemoteCacheServer(directory):
+  '''Starts a local remote cache server, returning it and its URL.'''
+  server_module = imp.load_source('remote_cache_server_module',
+                                  REMOTE_CACHE_SERVER_SCRIPT_PATH)
+  server = server_module.StartServer(directory)
+  return server, 'http://%s:%d' % server.server_address
 
 
 def GetCount(count_filepath):
@@ -121,3 +132,16 @@ def EchoCommand(input, output, count_file=None):
   count_file_string = count_file if count_file else 'None'
 
   return [sys.executable, shell_echo_path, input, output, count_file_string]
+
+
+def IncludeCommand(source, output, deps, count_file=None):
+  '''Returns a cross-platform command string list that, like a C compiler run
+  with "-MD", writes |output| from |source| and the file that it includes, and
+  writes a Makefile-style |deps| file listing both.'''
+  shell_include_path = os.path.join(os.path.dirname(__file__),
+                                    'shell_include.py')
+
+  count_file_string = count_file if count_file else 'None'
+
+  return [sys.executable, shell_include_path, source, output, deps,
+          count_file_string]
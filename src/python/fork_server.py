@@ -0,0 +1,297 @@
+'''Runs respire's own Python scripts, optionally from a pre-warmed interpreter.
+
+Every Registry.PythonFunction call, every SubRespire and every output flattening
+is a command that runs one of the Python scripts next to this one, and starting
+an interpreter and importing respire's modules often costs more than the script
+itself.  These commands therefore run their script through this one:
+
+  fork_server.py SCRIPT [ARGS...]
+
+which runs SCRIPT's main() as if SCRIPT had been run with ARGS.  That alone
+saves nothing, but respire may also start this script as a persistent worker
+(with the single argument "--persistent_worker") or as a batch runner (with the
+single argument "--batch"), in which case each request is one such command
+line.  The server then imports respire's scripts and the standard build library
+up front, and forks a child for each request, so that every request starts from
+the same warm state and can't leave anything behind for the next one.  Where
+fork() isn't available, requests run in-process instead, and the interpreter's
+state is restored after each one.
+
+Since the standard build library is already imported when a request starts, it
+is listed among the dependencies of every script run this way.
+'''
+
+
+import os
+import struct
+import sys
+import tempfile
+import traceback
+
+import respire_python_wrapper_helpers
+
+
+_PERSISTENT_WORKER_FLAG = '--persistent_worker'
+_BATCH_FLAG = '--batch'
+
+# The scripts that are expected to be run through the server, and so are
+# imported before the first request arrives.
+_PREWARMED_SCRIPTS = ['python_function_main', 'sub_respire', 'flatten_output']
+
+_SCRIPT_DIR = os.path.dirname(os.path.realpath(__file__))
+
+
+def _GetScriptModule(script_filepath):
+  script_dir = os.path.dirname(os.path.realpath(script_filepath))
+  if script_dir != _SCRIPT_DIR:
+    raise Exception(
+        'Only respire\'s own scripts can be run through the fork server, '
+        'not: ' + script_filepath)
+  name = os.path.splitext(os.path.basename(script_filepath))[0]
+  return __import__(name)
+
+
+def _RunScript(command_line_args):
+  '''Runs the script named by the first argument as if it were __main__.'''
+  sys.argv = list(command_line_args)
+  return _GetScriptModule(sys.argv[0]).main()
+
+
+def _ExitCodeFor(result):
+  '''Converts a script's return value to an exit code, as sys.exit() would.'''
+  if result is None:
+    return 0
+  if isinstance(result, bool):
+    return int(result)
+  if isinstance(result, int):
+    return result
+  sys.stderr.write(str(result) + '\n')
+  return 1
+
+
+def _RunScriptForExitCode(command_line_args):
+  try:
+    return _ExitCodeFor(_RunScript(command_line_args))
+  except SystemExit as e:
+    return _ExitCodeFor(e.code)
+  except Exception:
+    traceback.print_exc()
+    return 1
+
+
+def _Prewarm():
+  sys.path.insert(0, os.path.join(_SCRIPT_DIR, 'buildlib'))
+  for name in _PREWARMED_SCRIPTS:
+    __import__(name)
+  import respire.buildlib.modules
+
+
+class _CapturedOutput(object):
+  '''Redirects a file descriptor to a temporary file while in scope, so that
+the output of subprocesses is captured along with our own.'''
+
+  def __init__(self, fd):
+    self._fd = fd
+    self._file = tempfile.TemporaryFile()
+
+  def __enter__(self):
+    sys.stdout.flush()
+    sys.stderr.flush()
+    self._saved_fd = os.dup(self._fd)
+    os.dup2(self._file.fileno(), self._fd)
+    return self
+
+  def __exit__(self, *args):
+    sys.stdout.flush()
+    sys.stderr.flush()
+    os.dup2(self._saved_fd, self._fd)
+    os.close(self._saved_fd)
+
+  def Read(self):
+    self._file.seek(0)
+    output = self._file.read()
+    self._file.close()
+    return output
+
+
+def _RunRequestInChild(command_line_args, protocol_fds):
+  stdout = tempfile.TemporaryFile()
+  stderr = tempfile.TemporaryFile()
+  sys.stdout.flush()
+  sys.stderr.flush()
+
+  pid = os.fork()
+  if pid == 0:
+    exit_code = 1
+    try:
+      # Anything that the script leaves running shouldn't be able to hold on
+      # to our connection with respire.
+      for fd in protocol_fds:
+        os.close(fd)
+      os.dup2(stdout.fileno(), 1)
+      os.dup2(stderr.fileno(), 2)
+      exit_code = _RunScriptForExitCode(command_line_args)
+      sys.stdout.flush()
+      sys.stderr.flush()
+    finally:
+      # Never return into the server's loop from the child.
+      os._exit(exit_code if 0 <= exit_code < 256 else 1)
+
+  (_, status) = os.waitpid(pid, 0)
+  if os.WIFEXITED(status):
+    exit_code = os.WEXITSTATUS(status)
+  else:
+    exit_code = 1
+    stderr.write(('Python script terminated by signal %d.\n' %
+                  os.WTERMSIG(status)).encode('utf-8'))
+
+  outputs = []
+  for f in (stdout, stderr):
+    f.seek(0)
+    outputs.append(f.read())
+    f.close()
+  return (exit_code, outputs[0], outputs[1])
+
+
+def _RunRequestInProcess(command_line_args):
+  saved_argv = list(sys.argv)
+  saved_path = list(sys.path)
+  saved_modules = dict(sys.modules)
+  saved_cwd = os.getcwd()
+  saved_environ = dict(os.environ)
+
+  stdout = _CapturedOutput(1)
+  stderr = _CapturedOutput(2)
+  with stdout, stderr:
+    exit_code = _RunScriptForExitCode(command_line_args)
+
+  # Each request starts from the same state as the previous one did, so that
+  # modules that changed since the last request are reloaded, and so that the
+  # deps file only lists the modules that this request imported.
+  sys.argv[:] = saved_argv
+  sys.path[:] = saved_path
+  for name in list(sys.modules.keys()):
+    if name not in saved_modules:
+      del sys.modules[name]
+  sys.modules.update(saved_modules)
+  os.chdir(saved_cwd)
+  os.environ.clear()
+  os.environ.update(saved_environ)
+
+  return (exit_code, stdout.Read(), stderr.Read())
+
+
+def _RunRequest(command_line_args, protocol_fds):
+  if hasattr(os, 'fork'):
+    return _RunRequestInChild(command_line_args, protocol_fds)
+  return _RunRequestInProcess(command_line_args)
+
+
+def _ReadExactly(fd, size):
+  data = b''
+  while len(data) < size:
+    chunk = os.read(fd, size - len(data))
+    if not chunk:
+      return None
+    data += chunk
+  return data
+
+
+def _ReadUint32(fd):
+  data = _ReadExactly(fd, 4)
+  if data is None:
+    return None
+  return struct.unpack('=I', data)[0]
+
+
+def _ReadStrings(fd):
+  '''Returns a list of strings read from |fd|, or None if it was closed
+first.'''
+  count = _ReadUint32(fd)
+  if count is None:
+    return None
+  strings = []
+  for _ in range(count):
+    size = _ReadUint32(fd)
+    if size is None:
+      return None
+    string = _ReadExactly(fd, size)
+    if string is None:
+      return None
+    strings.append(string.decode('utf-8'))
+  return strings
+
+
+def _Write(fd, data):
+  while data:
+    data = data[os.write(fd, data):]
+
+
+def _WriteResponse(fd, exit_code, stdout, stderr):
+  _Write(fd, struct.pack('=iI', exit_code, len(stdout)) + stdout +
+             struct.pack('=I', len(stderr)) + stderr)
+
+
+def _TakeOverStdio():
+  '''Returns file descriptors for our original stdin and stdout, and moves
+them out of the way of anything that the scripts we run might read or print.'''
+  request_fd = os.dup(0)
+  response_fd = os.dup(1)
+  if sys.platform == 'win32':
+    import msvcrt
+    msvcrt.setmode(request_fd, os.O_BINARY)
+    msvcrt.setmode(response_fd, os.O_BINARY)
+  null_fd = os.open(os.devnull, os.O_RDWR)
+  os.dup2(null_fd, 0)
+  os.dup2(null_fd, 1)
+  os.close(null_fd)
+  return (request_fd, response_fd)
+
+
+def _RunPersistentWorker():
+  (request_fd, response_fd) = _TakeOverStdio()
+  _Prewarm()
+
+  while True:
+    # Each request is the command line for one script, and we're done once
+    # respire has closed our stdin.
+    args = _ReadStrings(request_fd)
+    if args is None:
+      return 0
+    (exit_code, stdout, stderr) = _RunRequest(args, [request_fd, response_fd])
+    _WriteResponse(response_fd, exit_code, stdout, stderr)
+
+
+def _RunBatch():
+  (manifest_fd, results_fd) = _TakeOverStdio()
+
+  # Each item of the manifest lists its inputs and outputs, which we don't
+  # need, followed by the command line for one script.
+  item_count = _ReadUint32(manifest_fd)
+  if item_count is None:
+    return 1
+  items = []
+  for _ in range(item_count):
+    item = [_ReadStrings(manifest_fd) for _ in range(3)]
+    if None in item:
+      return 1
+    items.append(item[2])
+
+  _Prewarm()
+  for (index, args) in enumerate(items):
+    (exit_code, stdout, stderr) = _RunRequest(args, [manifest_fd, results_fd])
+    _Write(results_fd, struct.pack('=I', index))
+    _WriteResponse(results_fd, exit_code, stdout, stderr)
+  return 0
+
+
+def main():
+  if sys.argv[1:] == [_PERSISTENT_WORKER_FLAG]:
+    return _RunPersistentWorker()
+  if sys.argv[1:] == [_BATCH_FLAG]:
+    return _RunBatch()
+  return _RunScript(sys.argv[1:])
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -12,14 +12,24 @@ def _SplitCommand(command):
   return shlex.split(str(command), posix=not is_windows)
 
 
+def _RespireScriptInCommand(cmd_split):
+  '''Returns the respire Python script that a command runs through
+fork_server.py, or None if it doesn't run one.'''
+  if (len(cmd_split) > 3 and cmd_split[1] == '-B' and
+      'fork_server.py' in cmd_split[2]):
+    return cmd_split[3]
+  return None
+
+
 def SummaryStringForEvent(start_event):
   # Some commands that are implicitly generated by the respire python
   # infrastructure have long hashes in them and are hard to understand, so
   # we look for those and replace them with something that is easier to read
   # and more informative.
   cmd_split = _SplitCommand(start_event['command'])
+  script = _RespireScriptInCommand(cmd_split)
 
-  if len(cmd_split) > 2 and 'sub_respire.py' in cmd_split[2]:
+  if script and 'sub_respire.py' in script:
     try:
       b_index = cmd_split.index('-b')
       python_file = cmd_split[b_index + 1]
@@ -41,10 +51,12 @@ def ShouldPubliclyLogEvent(start_event):
 
   cmd_split = _SplitCommand(start_event['command'])
 
-  if cmd_split[0] == sys.executable:
-    if len(cmd_split) > 1 and 'flatten_output.py' in cmd_split[1]:
+  script = _RespireScriptInCommand(cmd_split)
+
+  if cmd_split[0] == sys.executable and script:
+    if 'flatten_output.py' in script:
       return False
-    if len(cmd_split) > 2 and 'sub_respire.py' in cmd_split[2]:
+    if 'sub_respire.py' in script:
       f_index = cmd_split.index('-f')
       function = cmd_split[f_index + 1]
       if function == '_ResolveFutures':
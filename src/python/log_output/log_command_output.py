@@ -9,6 +9,8 @@ import sys
 
 def ShouldPrintCommandOutput(start_event, event, respire_details_dir):
   return ('error' in event or
+          'stdout_output' in event or
+          'stderr_output' in event or
           _ShouldPrintRedirect('stderr', start_event, respire_details_dir) or
           _ShouldPrintRedirect('stdout', start_event, respire_details_dir))
 
@@ -28,8 +30,8 @@ def LogCommandOutput(start_event, event, respire_details_dir):
           sys.stdout.write(o)
           sys.stdout.write('\n')
       sys.stdout.write('\n')
-      _PrintRedirectIfExists('stdout', start_event, respire_details_dir)
-      _PrintRedirectIfExists('stderr', start_event, respire_details_dir)
+      _PrintCommandOutput('stdout', start_event, event, respire_details_dir)
+      _PrintCommandOutput('stderr', start_event, event, respire_details_dir)
       sys.stdout.write('\n')
     elif start_event['type'] == 'CreateRegistryNode':
       _OutputErrorIfExists(event)
@@ -69,6 +71,21 @@ def _ShouldPrintRedirect(redirect_name, start_event, respire_details_dir):
           _PathInDir(redirect_file, respire_details_dir))
 
 
+def _PrintCommandOutput(stream_name, start_event, event, respire_details_dir):
+  # Output that respire captured through a pipe arrives with the event itself,
+  # otherwise fall back to reading the file that the stream was redirected to.
+  output = event.get(stream_name + '_output')
+  if output is None:
+    _PrintRedirectIfExists(stream_name, start_event, respire_details_dir)
+    return
+
+  sys.stdout.write('(')
+  sys.stdout.write(stream_name)
+  sys.stdout.write(')\n')
+  sys.stdout.write(output)
+  sys.stdout.write('\n')
+
+
 def _PrintRedirectIfExists(redirect_name, start_event, respire_details_dir):
   if not _ShouldPrintRedirect(redirect_name, start_event, respire_details_dir):
     return
@@ -12,27 +12,37 @@ from log_output.output_to_raw import OutputToRaw
 from log_output.output_to_splitter import OutputToSplitter
 from log_output.output_to_terminal_with_escape_codes import \
     OutputToTerminalWithEscapeCodes
+from log_output.resource_usage_summary import ResourceUsageSummary
 import log_output.event_filtering as event_filtering
 
 
 def LoopOnConsoleRefresh(log_byte_stream, respire_details_dir, verbose=False,
-                         raw_logs=False, graph_view=False):
+                         raw_logs=False, graph_view=False, heaviest_actions=0):
   '''Parses input bytes into events to update the console output with.
 
 This function is meant to be a blocking function that takes over console
 output, updating it with events that arrive from |log_byte_stream|.  The
 parameter |respire_details_dir| specifies a directory that, when stdout/stderr
 redirection is detected to go go in to those directories, it is printed to
-the console's stdout as well.'''
+the console's stdout as well.  If |heaviest_actions| is non-zero, a report of
+that many of the most resource hungry commands is printed once the log ends.'''
 
   if not log_byte_stream:
     return
 
+  resource_usage_summary = ResourceUsageSummary() if heaviest_actions else None
+
   with _EventProcessor(respire_details_dir, verbose=verbose, raw_logs=raw_logs,
-                       graph_view=graph_view) as ep:
+                       graph_view=graph_view,
+                       resource_usage_summary=resource_usage_summary) as ep:
     for event in _ParseLog(log_byte_stream):
       ep.ProcessEvent(event)
 
+  if resource_usage_summary:
+    report = resource_usage_summary.FormatHeaviestActions(heaviest_actions)
+    if report:
+      print(report)
+
 
 def _ParseLog(log):
   while True:
@@ -42,7 +52,8 @@ def _ParseLog(log):
 
     line_as_str = line
     if not isinstance(line, str):
-      line_as_str = line.decode('utf-8')
+      # Captured command output isn't necessarily valid UTF-8.
+      line_as_str = line.decode('utf-8', errors='replace')
 
     line_as_str = line_as_str.strip()
     if not line_as_str:
@@ -53,7 +64,7 @@ def _ParseLog(log):
 
 class _EventProcessor(object):
   def __init__(self, respire_details_dir, verbose=False, raw_logs=False,
-               graph_view=False):
+               graph_view=False, resource_usage_summary=None):
     # "Start events" are special because they contain all of the construction
     # parameters for the event, essentially defining the object represented
     # by the event ID.
@@ -62,6 +73,7 @@ class _EventProcessor(object):
     self._events_processed = set()
     self._events_being_processed = set()
     self._verbose = verbose
+    self._resource_usage_summary = resource_usage_summary
 
     if raw_logs:
       self._output_to = OutputToRaw()
@@ -124,6 +136,9 @@ class _EventProcessor(object):
       self._events_being_processed.remove(event['id'])
       self._events_processed.add(event['id'])
 
+    if self._resource_usage_summary:
+      self._resource_usage_summary.AddEvent(start_event, event)
+
     if self._verbose or event_filtering.ShouldPubliclyLogEvent(start_event):
       self._output_to.OnTaskEnded(
           start_event, event,
@@ -0,0 +1,91 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import log_output.event_filtering as event_filtering
+
+
+# The resource usage fields that respire attaches to a command's
+# ProcessingComplete event.
+_USAGE_FIELDS = [
+    'wall_time_us',
+    'user_time_us',
+    'system_time_us',
+    'max_rss_bytes',
+    'block_input_ops',
+    'block_output_ops',
+]
+
+
+def _FormatMicroseconds(microseconds):
+  return '%.3fs' % (microseconds / 1000000.0)
+
+
+def _FormatBytes(num_bytes):
+  return '%.1fMB' % (num_bytes / (1024.0 * 1024.0))
+
+
+class _Action(object):
+  def __init__(self, start_event, event):
+    self.summary = event_filtering.SummaryStringForEvent(start_event)
+    self.usage = {}
+    for field in _USAGE_FIELDS:
+      if field in event:
+        self.usage[field] = int(event[field])
+
+  def CpuTime(self):
+    return (self.usage.get('user_time_us', 0) +
+            self.usage.get('system_time_us', 0))
+
+  def Format(self):
+    parts = []
+    if 'wall_time_us' in self.usage:
+      parts.append('wall ' + _FormatMicroseconds(self.usage['wall_time_us']))
+    if 'user_time_us' in self.usage or 'system_time_us' in self.usage:
+      parts.append('cpu ' + _FormatMicroseconds(self.CpuTime()))
+    if 'max_rss_bytes' in self.usage:
+      parts.append('rss ' + _FormatBytes(self.usage['max_rss_bytes']))
+    if 'block_input_ops' in self.usage or 'block_output_ops' in self.usage:
+      parts.append('io %d/%d' % (self.usage.get('block_input_ops', 0),
+                                 self.usage.get('block_output_ops', 0)))
+    return '%s  (%s)' % (self.summary, ', '.join(parts))
+
+
+class ResourceUsageSummary(object):
+  '''Collects the resources used by each executed command.
+
+Commands are added as their ProcessingComplete events arrive, and a report of
+the heaviest commands can be produced at the end of the build.'''
+
+  def __init__(self):
+    self._actions = []
+
+  def AddEvent(self, start_event, event):
+    if start_event['type'] != 'CreateSystemCommandNode':
+      return
+    if 'wall_time_us' not in event:
+      # The command was not actually executed.
+      return
+    self._actions.append(_Action(start_event, event))
+
+  def FormatHeaviestActions(self, num_actions):
+    '''Returns a report of the |num_actions| heaviest commands by wall time,
+by CPU time and by peak memory usage.'''
+    if not self._actions or num_actions <= 0:
+      return ''
+
+    rankings = [
+        ('wall time', lambda a: a.usage.get('wall_time_us', 0)),
+        ('CPU time', lambda a: a.CpuTime()),
+        ('max RSS', lambda a: a.usage.get('max_rss_bytes', 0)),
+    ]
+
+    lines = []
+    for title, key in rankings:
+      heaviest = sorted(self._actions, key=key, reverse=True)[:num_actions]
+      if key(heaviest[0]) == 0:
+        continue
+      lines.append('Heaviest actions by %s:' % title)
+      for action in heaviest:
+        lines.append('  ' + action.Format())
+    return '\n'.join(lines)
@@ -2,6 +2,9 @@
 
 This function wraps all Python functions executed via Registry.PythonFunction.
 Its tasks mostly involve resolving filenames and deserializing parameters.
+
+It is run through fork_server.py, which lets respire keep a warm interpreter
+around to run many function calls.
 '''
 
 
@@ -13,16 +16,16 @@ import json_utils
 
 
 class _ParsedPythonFunctionRunnerCommandLineParameters(object):
-  def __init__(self):
-    assert(len(sys.argv) == 5)
-    self.module_filepath = sys.argv[1]
-    self.function_name = sys.argv[2]
-    self.params_filepath = sys.argv[3]
-    self.deps_filepath = sys.argv[4]
+  def __init__(self, args):
+    assert(len(args) == 4)
+    self.module_filepath = args[0]
+    self.function_name = args[1]
+    self.params_filepath = args[2]
+    self.deps_filepath = args[3]
 
 
-def main():
-  args = _ParsedPythonFunctionRunnerCommandLineParameters()
+def _RunPythonFunction(command_line_args):
+  args = _ParsedPythonFunctionRunnerCommandLineParameters(command_line_args)
 
   # Make sure that the path has the target script's directory in it first thing.
   sys.path.insert(0, path.dirname(args.module_filepath))
@@ -61,5 +64,9 @@ def main():
   return exit_code
 
 
+def main():
+  return _RunPythonFunction(sys.argv[1:])
+
+
 if __name__ == "__main__":
   sys.exit(main())
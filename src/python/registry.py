@@ -35,18 +35,69 @@ class Registry(object):
     self.deps.append(dep)
 
   def SystemCommand(self, inputs, outputs, command, soft_outputs=None,
-                    deps=None, stdout=None, stderr=None, stdin=None):
+                    deps=None, stdout=None, stderr=None, stdin=None,
+                    pool=None, timeout=None, stamp_outputs=None,
+                    deps_format=None, rspfile=None, rspfile_content=None,
+                    batch=None, early_cutoff=False, cacheable=True):
+    '''Runs |command| to produce |outputs|.  Any |stamp_outputs|, which must
+    also be listed in |outputs|, are written as empty files once the command
+    succeeds, e.g. to record that a test passed.  The |deps| file lists one
+    path per line, unless |deps_format| is 'make', in which case it is read
+    as a Makefile rule, as written by e.g. "gcc -MD".  If |rspfile| is given,
+    |rspfile_content| is written to it just before the command runs, so that
+    the command can refer to it as e.g. "@" + rspfile instead of passing very
+    long argument lists on its command line.  If |batch| is given, it must be a
+    prefix of |command| naming a tool that can run many commands in one
+    invocation (see batch_runner.h), which respire may then do with this
+    command and others for the same tool that are ready at the same time.  If
+    |early_cutoff| is True, outputs that the command rewrites with exactly the
+    same contents as before don't cause the commands that depend on them to be
+    rerun (this requires respire's build log, and costs a hash of each output
+    every time the command runs).  Unless |cacheable| is False, e.g. because
+    the command writes files that aren't among its outputs, its outputs may be
+    restored from an action cache instead of running it.'''
     CheckListOfStrings(inputs)
     inputs = [ResolveFilepathRelativeToCallerScript(x) for x in inputs]
-    (stderr, stdout) = registry_helpers.FillStdErrAndStdOutForLoggingIfEmpty(
+    (stderr_log, stdout_log) = registry_helpers.LogFilesForUncapturedOutput(
         self.out_dir, command, stderr, stdout)
 
     self.builder.AddSystemCommand(
-        inputs + [self.respire_filepaths.registry_filepath],
-        outputs, command, soft_outputs, deps, stdout, stderr, stdin)
+        inputs, outputs, command, soft_outputs, deps, stdout, stderr, stdin, pool,
+        timeout, stdout_log, stderr_log, stamp_outputs=stamp_outputs,
+        deps_format=deps_format, rspfile=rspfile,
+        rspfile_content=rspfile_content, batch=batch,
+        early_cutoff=early_cutoff, cacheable=cacheable)
+
+  def Copy(self, inputs, outputs):
+    '''Copies each of |inputs| to the path at the same index in |outputs|,
+    within respire itself rather than by running a command.'''
+    CheckListOfStrings(inputs)
+    inputs = [ResolveFilepathRelativeToCallerScript(x) for x in inputs]
+    self.builder.AddNativeAction('copy', inputs, outputs)
+
+  def Touch(self, outputs, inputs=[]):
+    '''Updates the modification time of each of |outputs|, creating them if
+    they don't exist, whenever any of |inputs| change.'''
+    self._AddNativeActionWithDependencies('touch', inputs, outputs)
+
+  def Mkdir(self, outputs, inputs=[]):
+    '''Creates each of |outputs| as a directory.'''
+    self._AddNativeActionWithDependencies('mkdir', inputs, outputs)
+
+  def Stamp(self, outputs, inputs=[]):
+    '''Writes each of |outputs| as an empty file whenever any of |inputs|
+    change.'''
+    self._AddNativeActionWithDependencies('stamp', inputs, outputs)
+
+  def Pool(self, name, depth):
+    '''Declares a pool named |name| that allows at most |depth| of the system
+    commands that reference it to run at once.  A pool may be declared multiple
+    times, but always with the same depth.'''
+    self.builder.AddPool(name, depth)
 
   def PythonFunction(self, inputs, outputs, function, soft_outputs=None,
-                     stdout=None, stderr=None, stdin=None, **kwargs):
+                     stdout=None, stderr=None, stdin=None, early_cutoff=False,
+                     **kwargs):
     CheckListOfStrings(inputs)
 
     # If the function's keyword arguments contain any of the input parameters
@@ -64,16 +115,17 @@ class Registry(object):
       if 'soft_outputs' in function_args:
         params['soft_outputs'] = outputs
 
-    (command, deps_file) = (
+    (command, deps_file, runner) = (
         self._MakeSystemCommandForPythonFunctionCall(function, params))
 
-    (stderr, stdout) = registry_helpers.FillStdErrAndStdOutForLoggingIfEmpty(
+    (stderr_log, stdout_log) = registry_helpers.LogFilesForUncapturedOutput(
         self.out_dir, command, stderr, stdout)
 
     self.builder.AddSystemCommand(
-        inputs + [self.respire_filepaths.registry_filepath],
-        outputs, command, soft_outputs=soft_outputs, deps=deps_file,
-        stdout=stdout, stderr=stderr, stdin=stdin)
+        inputs, outputs, command, soft_outputs=soft_outputs, deps=deps_file,
+        stdout=stdout, stderr=stderr, stdin=stdin, stdout_log=stdout_log,
+        stderr_log=stderr_log,
+        worker=runner, batch=runner, early_cutoff=early_cutoff)
 
   def SubRespire(self, function, additional_deps=[], **kwargs):
     AssertIsValidRespireFunction(function)
@@ -121,6 +173,11 @@ class Registry(object):
 
     self.builder.AddBuild(target_filepath)
 
+  def _AddNativeActionWithDependencies(self, action, inputs, outputs):
+    CheckListOfStrings(inputs)
+    inputs = [ResolveFilepathRelativeToCallerScript(x) for x in inputs]
+    self.builder.AddNativeAction(action, inputs, outputs)
+
   def _SubRespireExternalPrivate(
       self, build_filepath, build_function_name, params, additional_deps=[]):
     sub_respire_filepaths = registry_helpers.EnsureGenRegistryInputFilesExist(
@@ -152,13 +209,15 @@ class Registry(object):
     # Setup a function call that calls our "python function runner" Python
     # script, which would in turn deserialize the parameters and call the
     # desired function with them.
-    # The '-B' option is used to avoid making ".pyc" files, which were found
-    # to result in timing issues resulting in occasionally failing tests.
-    command = [sys.executable, '-B',
-               inspect.getsourcefile(python_function_main), module_filepath,
-               function.__name__, filepaths.params, filepaths.deps]
-
-    return (command, filepaths.deps)
+    # The runner can also serve as a persistent worker or as a batch runner, in
+    # which case the interpreter is started once and then runs many function
+    # calls.
+    runner = registry_helpers.GetForkServerCommand()
+    command = runner + [inspect.getsourcefile(python_function_main),
+                        module_filepath, function.__name__, filepaths.params,
+                        filepaths.deps]
+
+    return (command, filepaths.deps, runner)
 
   def CompileToString(self):
     return self.builder.CompileToString()
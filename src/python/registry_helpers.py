@@ -17,24 +17,33 @@ def _GetSubRespirePyPath():
       os.path.join(os.path.dirname(__file__), 'sub_respire.py'))
 
 
+def GetForkServerCommand():
+  '''Returns the command line prefix for running one of respire's own Python
+scripts through fork_server.py, which respire can also keep running as a warm
+persistent worker or batch runner for such commands.'''
+  # The '-B' option is used to avoid making ".pyc" files, which were found
+  # to result in timing issues resulting in occasionally failing tests.
+  return [sys.executable, '-B', os.path.abspath(
+      os.path.join(os.path.dirname(__file__), 'fork_server.py'))]
+
+
 RESPIRE_MAIN_FUNCTION_NAME = 'RespireBuild'
 
 
-def FillStdErrAndStdOutForLoggingIfEmpty(out_dir, command, stderr, stdout):
+def LogFilesForUncapturedOutput(out_dir, command, stderr, stdout):
+  '''Returns the (stderr_log, stdout_log) files that respire should write a
+command's captured output to, for each of the streams that the command doesn't
+already redirect.  Respire only writes these files if there is output to log.'''
   log_dir = GetCommandLogDirectory(out_dir)
-  
-  ret_stderr = stderr
-  ret_stdout = stdout
+  command_hash = hashlib.sha256(' '.join(command).encode('utf-8')).hexdigest()
 
+  stderr_log = None
+  stdout_log = None
   if not stderr:
-    ret_stderr = os.path.join(log_dir,
-        hashlib.sha256(' '.join(command).encode('utf-8')).hexdigest() +
-                       '_stderr.txt')
+    stderr_log = os.path.join(log_dir, command_hash + '_stderr.txt')
   if not stdout:
-    ret_stdout = os.path.join(log_dir,
-        hashlib.sha256(' '.join(command).encode('utf-8')).hexdigest() +
-                       '_stdout.txt')
-  return (ret_stderr, ret_stdout)
+    stdout_log = os.path.join(log_dir, command_hash + '_stdout.txt')
+  return (stderr_log, stdout_log)
 
 
 def _MakeGenRegistryContents(
@@ -43,11 +52,12 @@ def _MakeGenRegistryContents(
   respire_builder = RespireBuilder()
   for future in future_deps:
     respire_builder.AddInclude(future.IncludeFilepath())
-  command = [sys.executable, '-B', _GetSubRespirePyPath(), '-b',
-             build_filepath, '-p', sub_respire_filepaths.params_filepath, '-o',
-             out_dir, '-f', build_function_name, '-t',
-             sub_respire_filepaths.timestamp_filepath]
-  (stderr, stdout) = FillStdErrAndStdOutForLoggingIfEmpty(
+  fork_server = GetForkServerCommand()
+  command = fork_server + [
+      _GetSubRespirePyPath(), '-b', build_filepath, '-p',
+      sub_respire_filepaths.params_filepath, '-o', out_dir, '-f',
+      build_function_name, '-t', sub_respire_filepaths.timestamp_filepath]
+  (stderr_log, stdout_log) = LogFilesForUncapturedOutput(
       out_dir, command, None, None)
 
   respire_builder.AddSystemCommand(
@@ -58,8 +68,14 @@ def _MakeGenRegistryContents(
                     sub_respire_filepaths.output_filepath],
       command=command,
       deps=sub_respire_filepaths.deps_filepath,
-      stderr=stderr,
-      stdout=stdout)
+      stderr_log=stderr_log,
+      stdout_log=stdout_log,
+      worker=fork_server,
+      batch=fork_server,
+      # The build function also writes the files of any sub-respires that it
+      # calls, which aren't among its outputs, so it can't be restored from
+      # the action cache.
+      cacheable=False)
   respire_builder.AddInclude(sub_respire_filepaths.registry_filepath)
   return respire_builder.CompileToString()
 
@@ -179,6 +195,18 @@ def GetCommandLogDirectory(out_dir):
   return os.path.join(out_dir, 'logs')
 
 
+def GetBuildLogFilepath(out_dir):
+  '''Returns the file that respire records the command that produced each
+output in, so that outputs can be rebuilt when their command changes.'''
+  return os.path.join(out_dir, 'build_log.txt')
+
+
+def GetDepsLogFilepath(out_dir):
+  '''Returns the file that respire records the dependencies listed in each
+deps file in, so that unchanged deps files needn't be read again.'''
+  return os.path.join(out_dir, 'deps_log.bin')
+
+
 def _EnsureUniqueFileWithContentsExists(filepath, contents):
   '''Assuming |filepath| can only contain |contents|, atomically creates it.
   '''
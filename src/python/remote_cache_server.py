@@ -0,0 +1,178 @@
+'''A minimal HTTP server for sharing respire's action cache between builds.
+
+It serves the same layout as bazel-remote, which should be preferred for
+anything more than testing or a small team:
+
+  GET/PUT /ac/KEY:  The results of an action.
+  GET/PUT/HEAD /cas/DIGEST:  The file whose SHA-256 digest is DIGEST.
+
+Everything is kept in a directory, and nothing is ever evicted.  Uploads to
+/cas/ are checked against their digest, so that a bad upload can't corrupt
+other builds.  Run it with:
+
+  remote_cache_server.py --port PORT DIRECTORY
+
+and pass --remote_cache http://HOST:PORT to respire.py.
+'''
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import argparse
+import hashlib
+import os
+import re
+import sys
+import tempfile
+import threading
+
+try:
+  from http.server import BaseHTTPRequestHandler, HTTPServer
+  from socketserver import ThreadingMixIn
+except ImportError:
+  from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+  from SocketServer import ThreadingMixIn
+
+
+# The paths that may be requested, e.g. "/cas/" followed by a digest.  Any
+# prefix that clients are configured with is ignored.
+_PATH_PATTERN = re.compile(r'^(?:/[^?#]*)?/(ac|cas)/([0-9a-f]{64})$')
+
+_CHUNK_SIZE = 64 * 1024
+
+
+def _Replace(source, destination):
+  if hasattr(os, 'replace'):
+    os.replace(source, destination)
+  else:
+    # Python 2, where rename already replaces on the platforms that matter.
+    os.rename(source, destination)
+
+
+class _ThreadingHTTPServer(ThreadingMixIn, HTTPServer):
+  daemon_threads = True
+
+
+class _RequestHandler(BaseHTTPRequestHandler):
+  # Set on the subclass made for each server.
+  directory = None
+
+  def _FilePath(self):
+    '''Returns the kind and local path of the file requested, if valid.'''
+    match = _PATH_PATTERN.match(self.path)
+    if not match:
+      self.send_error(400)
+      return None, None
+    kind, name = match.groups()
+    return kind, os.path.join(self.directory, kind, name[:2], name)
+
+  def _SendFile(self, send_body):
+    _, path = self._FilePath()
+    if not path:
+      return
+    if not os.path.isfile(path):
+      self.send_error(404)
+      return
+    self.send_response(200)
+    self.send_header('Content-Type', 'application/octet-stream')
+    self.send_header('Content-Length', str(os.path.getsize(path)))
+    self.end_headers()
+    if send_body:
+      with open(path, 'rb') as f:
+        while True:
+          chunk = f.read(_CHUNK_SIZE)
+          if not chunk:
+            break
+          self.wfile.write(chunk)
+
+  def do_GET(self):
+    self._SendFile(send_body=True)
+
+  def do_HEAD(self):
+    self._SendFile(send_body=False)
+
+  def do_PUT(self):
+    kind, path = self._FilePath()
+    if not path:
+      return
+    remaining = int(self.headers.get('Content-Length', 0))
+
+    parent_dir = os.path.dirname(path)
+    if not os.path.isdir(parent_dir):
+      try:
+        os.makedirs(parent_dir)
+      except OSError:
+        # Another request may have just created it.
+        pass
+    # Write to a temporary file first, so that nobody is ever served a
+    # partial upload.
+    fd, temp_path = tempfile.mkstemp(dir=parent_dir)
+    sha256 = hashlib.sha256()
+    with os.fdopen(fd, 'wb') as f:
+      while remaining > 0:
+        chunk = self.rfile.read(min(remaining, _CHUNK_SIZE))
+        if not chunk:
+          break
+        sha256.update(chunk)
+        f.write(chunk)
+        remaining -= len(chunk)
+
+    if remaining > 0 or (kind == 'cas' and
+                         sha256.hexdigest() != os.path.basename(path)):
+      os.remove(temp_path)
+      self.send_error(400)
+      return
+    _Replace(temp_path, path)
+    self.send_response(200)
+    self.send_header('Content-Length', '0')
+    self.end_headers()
+
+  def log_message(self, format, *args):
+    # Requests are too frequent to be worth logging.
+    pass
+
+
+def _MakeServer(directory, port, host):
+  handler = type('RequestHandler', (_RequestHandler,),
+                 {'directory': os.path.abspath(directory)})
+  return _ThreadingHTTPServer((host, port), handler)
+
+
+def StartServer(directory, port=0, host='127.0.0.1'):
+  '''Starts serving |directory| on a background thread.
+
+  Returns the server, whose server_address gives the port that it listens on
+  (which is chosen by the system if |port| is 0), and whose shutdown() method
+  stops it.
+  '''
+  server = _MakeServer(directory, port, host)
+  thread = threading.Thread(target=server.serve_forever)
+  thread.daemon = True
+  thread.start()
+  return server
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description='Serves an action cache for respire builds to share.')
+  parser.add_argument('directory', type=str,
+                      help='The directory in which to keep the cache.')
+  parser.add_argument('--port', type=int, default=8080,
+                      help='The port to listen on.')
+  parser.add_argument('--host', type=str, default='127.0.0.1',
+                      help='The address to listen on, e.g. 0.0.0.0 to serve '
+                           'other machines.')
+  args = parser.parse_args()
+
+  server = _MakeServer(args.directory, args.port, args.host)
+  print('Serving %s on http://%s:%d' % (args.directory, args.host, args.port))
+  try:
+    server.serve_forever()
+  except KeyboardInterrupt:
+    pass
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -21,6 +21,27 @@ def GetStandardArgumentsParser(default_out_dir):
                            'be placed.')
   parser.add_argument('-j', '--jobs', type=int, default=multiprocessing.cpu_count(),
                       help='Maximum number of jobs to run in parallel.')
+  parser.add_argument('-l', '--load_average', type=float, default=None,
+                      help='Do not start new jobs while the load average is '
+                           'at least this.')
+  parser.add_argument('--memory_headroom', type=int, default=None,
+                      help='Do not start new jobs while less than this many '
+                           'megabytes of memory are available.')
+  parser.add_argument('--heaviest_actions', type=int, default=0,
+                      help='After the build, list this many of the commands '
+                           'that used the most time and memory.')
+  parser.add_argument('--action_cache', type=str, default=None,
+                      help='A directory in which to cache the outputs of '
+                           'commands, so that they can be restored rather '
+                           'than rebuilt when the same inputs come back.')
+  parser.add_argument('--action_cache_size', type=int, default=None,
+                      help='The number of megabytes beyond which the least '
+                           'recently used files in the action cache are '
+                           'removed.')
+  parser.add_argument('--remote_cache', type=str, default=None,
+                      help='The URL, e.g. http://host:port, of an HTTP '
+                           'server through which the action cache is shared '
+                           'with other machines.')
   parser.add_argument('-v', '--verbose', action='store_true')
   parser.add_argument('-g', '--graph_view', action='store_true')
   parser.add_argument('-r', '--raw_logs', action='store_true',
@@ -39,12 +60,18 @@ def EntryPoint(build_filepath, build_function_name, args, params=None):
   return Run(
       out_dir_respire, build_filepath, build_function_name, params_with_out_dir,
       max_jobs=args.jobs, verbose=args.verbose, raw_logs=args.raw_logs,
-      graph_view=args.graph_view)
+      graph_view=args.graph_view, load_average=args.load_average,
+      memory_headroom=args.memory_headroom,
+      heaviest_actions=args.heaviest_actions, action_cache=args.action_cache,
+      action_cache_size=args.action_cache_size,
+      remote_cache=args.remote_cache)
 
 
 def Run(out_dir, build_filepath, build_function_name, params,
         max_jobs=multiprocessing.cpu_count(), verbose=False, raw_logs=False,
-        graph_view=False):
+        graph_view=False, load_average=None, memory_headroom=None,
+        heaviest_actions=0, action_cache=None, action_cache_size=None,
+        remote_cache=None):
   # respire was freshly called from the system (and not recursively).
   if not os.path.exists(out_dir):
     # Create the initial registry file.
@@ -59,11 +86,14 @@ def Run(out_dir, build_filepath, build_function_name, params,
 
   return LaunchRespireCore(
       sub_respire_filepaths.gen_registry_filepath, max_jobs, out_dir,
-      verbose, raw_logs, graph_view) == 0
+      verbose, raw_logs, graph_view, load_average, memory_headroom,
+      heaviest_actions, action_cache, action_cache_size, remote_cache) == 0
 
 
 def LaunchRespireCore(root_respire_file, max_jobs, out_dir, verbose, raw_logs,
-                      graph_view):
+                      graph_view, load_average=None, memory_headroom=None,
+                      heaviest_actions=0, action_cache=None,
+                      action_cache_size=None, remote_cache=None):
   start_time = time.time()
 
   if 'linux' in sys.platform:
@@ -79,8 +109,19 @@ def LaunchRespireCore(root_respire_file, max_jobs, out_dir, verbose, raw_logs,
 
   respire_command_line = [
       respire_command_path, '-j', str(max_jobs),
-      output_level_flag,
-      root_respire_file]
+      '--build-log', registry_helpers.GetBuildLogFilepath(out_dir),
+      '--deps-log', registry_helpers.GetDepsLogFilepath(out_dir)]
+  if load_average is not None:
+    respire_command_line += ['-l', str(load_average)]
+  if memory_headroom is not None:
+    respire_command_line += ['--memory-headroom', str(memory_headroom)]
+  if action_cache is not None:
+    respire_command_line += ['--action-cache', os.path.abspath(action_cache)]
+  if action_cache_size is not None:
+    respire_command_line += ['--action-cache-size', str(action_cache_size)]
+  if remote_cache is not None:
+    respire_command_line += ['--remote-cache', remote_cache]
+  respire_command_line += [output_level_flag, root_respire_file]
 
   if verbose:
     print('Respire core command line:\n%s\n' % (
@@ -92,7 +133,8 @@ def LaunchRespireCore(root_respire_file, max_jobs, out_dir, verbose, raw_logs,
   log_processor.LoopOnConsoleRefresh(
       respire_process.stdout,
       out_dir,
-      verbose=verbose, raw_logs=raw_logs, graph_view=graph_view)
+      verbose=verbose, raw_logs=raw_logs, graph_view=graph_view,
+      heaviest_actions=heaviest_actions)
 
   print('Time elapsed: %.3f' % (time.time() - start_time))
 
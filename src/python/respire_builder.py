@@ -36,22 +36,93 @@ def _ConvertToShellCommandString(command):
   return ' '.join([_AddQuotesIfStringContainsSpaces(x) for x in command])
 
 
+# Characters which, if they appear in any command token, may cause the shell to
+# interpret the command differently than if its tokens were passed directly to
+# the program as arguments.
+_SHELL_SPECIAL_CHARACTERS = frozenset('|&;<>()$`\\"\'*?[]#~{}!\n\t')
+
+
+def _CommandNeedsShell(command):
+  '''Returns True if the command depends on being interpreted by a shell.
+
+  Tokens containing spaces are safe, since _ConvertToShellCommandString() quotes
+  them and so the shell would have passed them through as a single argument
+  anyway.
+  '''
+  if not command or '=' in command[0]:
+    # A leading "NAME=value" token is an environment variable assignment.
+    return True
+  if not all(command):
+    # The shell would drop empty tokens entirely.
+    return True
+  return any(
+      c in _SHELL_SPECIAL_CHARACTERS for token in command for c in token)
+
+
+# The formats that a deps file can be written in: either one path per line, or
+# a Makefile rule as written by e.g. "gcc -MD".
+_DEPS_FORMATS = frozenset(['list', 'make'])
+
+
 class _SystemCommand(object):
   def __init__(self, inputs, outputs, command, soft_outputs, deps, stdout,
-               stderr, stdin):
+               stderr, stdin, pool=None, timeout=None, stdout_log=None,
+               stderr_log=None, worker=None, stamp_outputs=None,
+               deps_format=None, rspfile=None, rspfile_content=None,
+               batch=None, early_cutoff=False, cacheable=True):
     CheckListOfStrings(inputs)
     CheckListOfStrings(outputs)
+    if stamp_outputs:
+      CheckListOfStrings(stamp_outputs)
+      if not set(stamp_outputs).issubset(outputs):
+        raise Exception('Stamp outputs must also be listed as outputs.')
     if soft_outputs:
       CheckListOfStrings(soft_outputs)
     if deps:
       CheckString(deps)
+    if deps_format:
+      if not deps:
+        raise Exception('A deps format was given without a deps file.')
+      if deps_format not in _DEPS_FORMATS:
+        raise Exception('Unknown deps format: ' + str(deps_format))
     if stdout:
       CheckString(stdout)
     if stderr:
       CheckString(stderr)
     if stdin:
       CheckString(stdin)
+    if stdout_log:
+      CheckString(stdout_log)
+    if stderr_log:
+      CheckString(stderr_log)
+    if pool:
+      CheckString(pool)
+    if timeout is not None:
+      if not isinstance(timeout, (int, float)) or timeout <= 0:
+        raise Exception('Timeout must be a positive number of seconds.')
+    if (rspfile is None) != (rspfile_content is None):
+      raise Exception(
+          'A response file and its contents must be given together.')
+    if rspfile is not None:
+      CheckString(rspfile)
+      CheckString(rspfile_content)
     CheckListOfStrings(command)
+    if worker:
+      CheckListOfStrings(worker)
+      if command[:len(worker)] != worker:
+        raise Exception(
+            'A worker command line must be a prefix of the command that it '
+            'runs.')
+    if batch:
+      CheckListOfStrings(batch)
+      if command[:len(batch)] != batch:
+        raise Exception(
+            'A batch runner command line must be a prefix of the command that '
+            'it runs.')
+    if not isinstance(early_cutoff, bool):
+      raise Exception('Early cutoff must be either True or False.')
+    if not isinstance(cacheable, bool):
+      raise Exception('Cacheable must be either True or False.')
 
     self.inputs = inputs
     self.outputs = outputs
@@ -61,6 +132,44 @@ class _SystemCommand(object):
     self.stdout = stdout
     self.stderr = stderr
     self.stdin = stdin
+    self.pool = pool
+    self.timeout = timeout
+    self.stdout_log = stdout_log
+    self.stderr_log = stderr_log
+    self.worker = worker
+    self.stamp_outputs = stamp_outputs
+    self.deps_format = deps_format
+    self.rspfile = rspfile
+    self.rspfile_content = rspfile_content
+    self.batch = batch
+    self.early_cutoff = early_cutoff
+    self.cacheable = cacheable
+
+
+# File operations that respire performs itself rather than by running a command.
+_NATIVE_ACTIONS = frozenset(['copy', 'touch', 'mkdir', 'stamp'])
+
+
+class _NativeAction(object):
+  def __init__(self, action, inputs, outputs):
+    if action not in _NATIVE_ACTIONS:
+      raise Exception('Unknown native action: ' + str(action))
+    CheckListOfStrings(inputs)
+    CheckListOfStrings(outputs)
+    if action == 'copy' and len(inputs) != len(outputs):
+      raise Exception('A copy must have exactly one input per output.')
+    self.action = action
+    self.inputs = inputs
+    self.outputs = outputs
+
+
+class _Pool(object):
+  def __init__(self, name, depth):
+    CheckString(name)
+    if not isinstance(depth, int) or depth < 1:
+      raise Exception('Pool depth must be a positive integer.')
+    self.name = name
+    self.depth = depth
 
 
 class _Include(object):
@@ -76,11 +185,31 @@ class _Build(object):
 class RespireBuilder(object):
   def __init__(self):
     self.pending_entries = []
+    self.declared_pools = {}
 
   def AddSystemCommand(self, inputs, outputs, command, soft_outputs=None,
-                       deps=None, stdout=None, stderr=None, stdin=None):
+                       deps=None, stdout=None, stderr=None, stdin=None,
+                       pool=None, timeout=None, stdout_log=None,
+                       stderr_log=None, worker=None, stamp_outputs=None,
+                       deps_format=None, rspfile=None, rspfile_content=None,
+                       batch=None, early_cutoff=False, cacheable=True):
     self.pending_entries.append(_SystemCommand(
-        inputs, outputs, command, soft_outputs, deps, stdout, stderr, stdin))
+        inputs, outputs, command, soft_outputs, deps, stdout, stderr, stdin,
+        pool, timeout, stdout_log, stderr_log, worker, stamp_outputs,
+        deps_format, rspfile, rspfile_content, batch, early_cutoff,
+        cacheable))
+
+  def AddNativeAction(self, action, inputs, outputs):
+    self.pending_entries.append(_NativeAction(action, inputs, outputs))
+
+  def AddPool(self, name, depth):
+    if name in self.declared_pools:
+      if self.declared_pools[name] != depth:
+        raise Exception(
+            'Pool "%s" was already declared with a different depth.' % name)
+      return
+    self.declared_pools[name] = depth
+    self.pending_entries.append(_Pool(name, depth))
 
   def AddInclude(self, include_file_path):
     self.pending_entries.append(_Include(include_file_path))
@@ -99,47 +228,88 @@ class RespireBuilder(object):
         if not self._current_typed_entry_list:
           return
 
-        if self._current_type.__name__ == '_SystemCommand':
-          type_key = 'sc'
-        elif self._current_type.__name__ == '_Include':
-          type_key = 'inc'
-        elif self._current_type.__name__ == '_Build':
-          type_key = 'build'
-
-        self.root_list.append({type_key: self._current_typed_entry_list})
+        self.root_list.append(
+            {self._current_type: self._current_typed_entry_list})
         self._current_typed_entry_list = None
         self._current_type = None
 
       def AppendEntry(self, entry):
-        entry_type = type(entry)
-        if entry_type != self._current_type:
+        entry_type = type(entry).__name__
+        if entry_type == '_SystemCommand':
+          type_key = 'sc'
+        elif entry_type == '_NativeAction':
+          # Each action is a directive of its own.
+          type_key = entry.action
+        elif entry_type == '_Include':
+          type_key = 'inc'
+        elif entry_type == '_Build':
+          type_key = 'build'
+        elif entry_type == '_Pool':
+          type_key = 'pool'
+
+        if type_key != self._current_type:
           self.AppendCurrentEntryList()
           self._current_typed_entry_list = []
-          self._current_type = entry_type
+          self._current_type = type_key
 
-        if entry_type.__name__ == '_SystemCommand':
+        if entry_type == '_SystemCommand':
           system_command_entry = {
             'in': entry.inputs,
             'out': entry.outputs,
             'cmd': _ConvertToShellCommandString(entry.command),
           }
+          if not _CommandNeedsShell(entry.command):
+            # Let respire skip the shell and execute the command directly.
+            system_command_entry['argv'] = entry.command
+            # Workers and batch runners are handed the rest of argv, so they
+            # require it.
+            if entry.worker:
+              system_command_entry['worker'] = entry.worker
+            if entry.batch:
+              system_command_entry['batch'] = entry.batch
           if entry.soft_outputs:
             system_command_entry['soft_out'] = entry.soft_outputs
           if entry.deps:
             system_command_entry['deps'] = entry.deps
+          if entry.deps_format:
+            system_command_entry['deps_format'] = entry.deps_format
           if entry.stdout:
             system_command_entry['stdout'] = entry.stdout
           if entry.stderr:
             system_command_entry['stderr'] = entry.stderr
           if entry.stdin:
             system_command_entry['stdin'] = entry.stdin
-
+          if entry.stdout_log:
+            system_command_entry['stdout_log'] = entry.stdout_log
+          if entry.stderr_log:
+            system_command_entry['stderr_log'] = entry.stderr_log
+          if entry.pool:
+            system_command_entry['pool'] = entry.pool
+          if entry.timeout is not None:
+            # Respire's JSON parser only deals in strings.
+            system_command_entry['timeout'] = str(entry.timeout)
+          if entry.stamp_outputs:
+            system_command_entry['stamp_out'] = entry.stamp_outputs
+          if entry.rspfile is not None:
+            system_command_entry['rspfile'] = entry.rspfile
+            system_command_entry['rspfile_content'] = entry.rspfile_content
+          if entry.early_cutoff:
+            system_command_entry['early_cutoff'] = 'true'
+          if not entry.cacheable:
+            system_command_entry['cacheable'] = 'false'
 
           self._current_typed_entry_list.append(system_command_entry)
-        elif entry_type.__name__ == '_Include':
+        elif entry_type == '_NativeAction':
+          self._current_typed_entry_list.append(
+              {'in': entry.inputs, 'out': entry.outputs})
+        elif entry_type == '_Include':
           self._current_typed_entry_list.append(entry.path)
-        elif entry_type.__name__ == '_Build':
+        elif entry_type == '_Build':
           self._current_typed_entry_list.append(entry.path)
+        elif entry_type == '_Pool':
+          # The registry parser only understands string values.
+          self._current_typed_entry_list.append(
+              {'name': entry.name, 'depth': str(entry.depth)})
 
 
     entry_list = TypedEntryList()
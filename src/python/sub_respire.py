@@ -20,8 +20,8 @@ def _CopyCommand(output_filepath, flattened_output_filepath):
 
 
 def _FlattenCommand(output_filepath, flattened_output_filepath):
-  return [sys.executable, _GetFlattenScriptPath(), output_filepath,
-          flattened_output_filepath]
+  return registry_helpers.GetForkServerCommand() + [
+      _GetFlattenScriptPath(), output_filepath, flattened_output_filepath]
 
 
 def _GetFlattenScriptPath():
@@ -41,7 +41,8 @@ def _GenerateSystemCommandForFlattenedOutput(
   registry.SystemCommand(
       inputs=([x.ValueFilepath() for x in out_futures] + [output_filepath]),
       outputs=[flattened_output_filepath],
-      command=command)
+      command=command,
+      batch=registry_helpers.GetForkServerCommand())
 
 
 def _IsFunctionParameter(param_name, function):
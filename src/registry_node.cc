@@ -53,6 +53,10 @@ OptionalError RegistryNode::HandleRequest(RegistryNode* parent) {
 
   activity_log_entry_.SignalStartDependencyScan();
 
+  if (env_->dependents()) {
+    env_->dependents()->AddRegistryInput(input_file_info_node_.node);
+  }
+
   // Otherwise, ensure our input file is available and then setup our parsing
   // pipeline to parse it.
   FileInfoNode::FuturePtr input_future =
@@ -60,6 +64,7 @@ OptionalError RegistryNode::HandleRequest(RegistryNode* parent) {
   FileOutput* input_file_infos = input_future->GetValue();
 
   if (input_file_infos->error()) {
+    LockedNodeStorage::Access(locked_node_storage_).MarkIncomplete();
     results_.emplace(input_file_infos->error()->str());
     activity_log_entry_.SignalProcessingComplete(*input_file_infos->error());
     return results_;
@@ -124,6 +129,9 @@ OptionalError RegistryNode::HandleRequest(RegistryNode* parent) {
   // Now that our pipeline is setup, pull the result out from it.
   ebb::Pull<OptionalError> pull(&output_queue);
   results_ = *pull.data();
+  if (!registry_processor.consumed_all_directives()) {
+    LockedNodeStorage::Access(locked_node_storage_).MarkIncomplete();
+  }
 
   activity_log_entry_.SignalProcessingComplete(stdext::nullopt);
 
@@ -1,5 +1,9 @@
 #include "registry_parser.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 
 using ebb::lib::JSONTokenizer;
@@ -137,6 +141,16 @@ bool RegistryParser::ParseDirectiveObject() {
       result = ParseSystemCommandDirective();
     } else if (directive_type == kDirectiveTypeBuild) {
       result = ParseBuildDirective();
+    } else if (directive_type == kDirectiveTypePool) {
+      result = ParsePoolDirective();
+    } else if (directive_type == kDirectiveTypeCopy) {
+      result = ParseNativeActionDirective(NativeAction::kCopy);
+    } else if (directive_type == kDirectiveTypeTouch) {
+      result = ParseNativeActionDirective(NativeAction::kTouch);
+    } else if (directive_type == kDirectiveTypeMkdir) {
+      result = ParseNativeActionDirective(NativeAction::kMkdir);
+    } else if (directive_type == kDirectiveTypeStamp) {
+      result = ParseNativeActionDirective(NativeAction::kStamp);
     }
 
     if (result == kParseDirectiveResultError) {
@@ -182,6 +196,16 @@ RegistryParser::DirectiveType RegistryParser::ConvertDirectiveTypeString(
     return kDirectiveTypeSystemCommand;
   } else if (name.IsEqual("build")) {
     return kDirectiveTypeBuild;
+  } else if (name.IsEqual("pool")) {
+    return kDirectiveTypePool;
+  } else if (name.IsEqual("copy")) {
+    return kDirectiveTypeCopy;
+  } else if (name.IsEqual("touch")) {
+    return kDirectiveTypeTouch;
+  } else if (name.IsEqual("mkdir")) {
+    return kDirectiveTypeMkdir;
+  } else if (name.IsEqual("stamp")) {
+    return kDirectiveTypeStamp;
   } else {
     return kDirectiveTypeInvalid;
   }
@@ -207,6 +231,16 @@ RegistryParser::ParseDirectiveResult RegistryParser::ParseIncludeDirective() {
   return kParseDirectiveResultSuccess;
 }
 
+namespace {
+// Returns true if |tool| is a non-empty prefix of |argv|.
+bool IsToolPrefix(
+    const std::vector<ebb::lib::JSONStringView>& tool,
+    const stdext::optional<std::vector<ebb::lib::JSONStringView>>& argv) {
+  return !tool.empty() && argv && tool.size() <= argv->size() &&
+         std::equal(tool.begin(), tool.end(), argv->begin());
+}
+}  // namespace
+
 RegistryParser::ParseDirectiveResult
 RegistryParser::ParseSystemCommandDirective() {
   OptionalToken token = GetNextToken();
@@ -233,7 +267,20 @@ RegistryParser::ParseSystemCommandDirective() {
   stdext::optional<ebb::lib::JSONPathStringView> stdout_param;
   stdext::optional<ebb::lib::JSONPathStringView> stderr_param;
   stdext::optional<ebb::lib::JSONPathStringView> stdin_param;
-
+  stdext::optional<std::vector<ebb::lib::JSONStringView>> argv_param;
+  stdext::optional<ebb::lib::JSONStringView> pool_param;
+  stdext::optional<std::chrono::milliseconds> timeout_param;
+  stdext::optional<ebb::lib::JSONPathStringView> stdout_log_param;
+  stdext::optional<ebb::lib::JSONPathStringView> stderr_log_param;
+  stdext::optional<std::vector<ebb::lib::JSONStringView>> worker_param;
+  stdext::optional<std::vector<ebb::lib::JSONPathStringView>>
+      stamp_outputs_param;
+  stdext::optional<DepsFormat> deps_format_param;
+  stdext::optional<ebb::lib::JSONPathStringView> rspfile_param;
+  stdext::optional<ebb::lib::JSONStringView> rspfile_content_param;
+  stdext::optional<std::vector<ebb::lib::JSONStringView>> batch_param;
+  stdext::optional<bool> early_cutoff_param;
+  stdext::optional<bool> cacheable_param;
 
   do {
     OptionalToken param_type_token = GetNextToken();
@@ -246,11 +293,63 @@ RegistryParser::ParseSystemCommandDirective() {
         SetError(kErrorDidNotFindAllExpectedKeys);
         return kParseDirectiveResultError;
       }
-      ProduceSystemCommand(SystemCommandParams(
-          *command_param, std::move(*inputs_param), std::move(*outputs_param),
-          soft_outputs_param ? std::move(*soft_outputs_param)
-                             : std::vector<ebb::lib::JSONPathStringView>(),
-          deps_param, stdout_param, stderr_param, stdin_param));
+      // The worker's and batch runner's command lines must be prefixes of the
+      // command's, so that the rest of it can be sent to them as a request.
+      if ((worker_param && !IsToolPrefix(*worker_param, argv_param)) ||
+          (batch_param && !IsToolPrefix(*batch_param, argv_param))) {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+      if (deps_format_param && !deps_param) {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+      // A response file is useless without its contents, and vice versa.
+      if (!rspfile_param != !rspfile_content_param) {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+      // Stamp files must also be declared as outputs.
+      if (stamp_outputs_param) {
+        for (const auto& stamp_output : *stamp_outputs_param) {
+          if (std::find(outputs_param->begin(), outputs_param->end(),
+                        stamp_output) == outputs_param->end()) {
+            SetError(kErrorInvalidValue);
+            return kParseDirectiveResultError;
+          }
+        }
+      }
+      SystemCommandParams params(*command_param, std::move(*inputs_param),
+                                 std::move(*outputs_param));
+      if (soft_outputs_param) {
+        params.soft_outputs = std::move(*soft_outputs_param);
+      }
+      params.deps_file = deps_param;
+      params.stdout_file = stdout_param;
+      params.stderr_file = stderr_param;
+      params.stdin_file = stdin_param;
+      params.argv = std::move(argv_param);
+      params.pool = pool_param;
+      params.timeout = timeout_param;
+      params.stdout_log_file = stdout_log_param;
+      params.stderr_log_file = stderr_log_param;
+      params.worker = std::move(worker_param);
+      if (stamp_outputs_param) {
+        params.stamp_outputs = std::move(*stamp_outputs_param);
+      }
+      if (deps_format_param) {
+        params.deps_format = *deps_format_param;
+      }
+      params.rspfile = rspfile_param;
+      params.rspfile_content = rspfile_content_param;
+      params.batch = std::move(batch_param);
+      if (early_cutoff_param) {
+        params.early_cutoff = *early_cutoff_param;
+      }
+      if (cacheable_param) {
+        params.cacheable = *cacheable_param;
+      }
+      ProduceSystemCommand(std::move(params));
       return kParseDirectiveResultSuccess;
     } else if (
         !stdext::holds_alternative<JSONTokenizer::JSONStringViewToken>(
@@ -362,6 +461,307 @@ RegistryParser::ParseSystemCommandDirective() {
       stdin_param.emplace(
           stdext::get<JSONTokenizer::JSONStringViewToken>(*stdin_token)
               .string_view);
+    } else if (param_type.IsEqual("argv")) {
+      if (argv_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      argv_param = ParseStringList<ebb::lib::JSONStringView>();
+      if (!argv_param) {
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("pool")) {
+      if (pool_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken pool_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!pool_token) {
+        return kParseDirectiveResultError;
+      }
+      pool_param.emplace(
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*pool_token)
+              .string_view);
+    } else if (param_type.IsEqual("timeout")) {
+      if (timeout_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      // The timeout is given in seconds, as a string since the tokenizer
+      // doesn't deal in numbers.  Fractions of a second are allowed.
+      OptionalToken timeout_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!timeout_token) {
+        return kParseDirectiveResultError;
+      }
+      std::string timeout_string =
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*timeout_token)
+              .string_view.AsString();
+      char* timeout_end = nullptr;
+      double timeout_seconds = strtod(timeout_string.c_str(), &timeout_end);
+      // Anything too large to count in milliseconds, e.g. "inf" or "1e300",
+      // is rejected rather than overflowing the conversion below.
+      if (timeout_string.empty() || *timeout_end != '\0' ||
+          !std::isfinite(timeout_seconds) || !(timeout_seconds > 0) ||
+          timeout_seconds * 1000 >= static_cast<double>(
+              std::chrono::milliseconds::max().count())) {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+      timeout_param = std::chrono::milliseconds(
+          std::max<int64_t>(1, static_cast<int64_t>(timeout_seconds * 1000)));
+    } else if (param_type.IsEqual("stdout_log")) {
+      if (stdout_log_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken stdout_log_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!stdout_log_token) {
+        return kParseDirectiveResultError;
+      }
+      stdout_log_param.emplace(
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*stdout_log_token)
+              .string_view);
+    } else if (param_type.IsEqual("stderr_log")) {
+      if (stderr_log_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken stderr_log_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!stderr_log_token) {
+        return kParseDirectiveResultError;
+      }
+      stderr_log_param.emplace(
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*stderr_log_token)
+              .string_view);
+    } else if (param_type.IsEqual("worker")) {
+      if (worker_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      worker_param = ParseStringList<ebb::lib::JSONStringView>();
+      if (!worker_param) {
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("stamp_out")) {
+      if (stamp_outputs_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      stamp_outputs_param = ParsePathList();
+      if (!stamp_outputs_param) {
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("deps_format")) {
+      if (deps_format_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken deps_format_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!deps_format_token) {
+        return kParseDirectiveResultError;
+      }
+      const ebb::lib::JSONStringView& deps_format =
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*deps_format_token)
+              .string_view;
+      if (deps_format.IsEqual("list")) {
+        deps_format_param = DepsFormat::kList;
+      } else if (deps_format.IsEqual("make")) {
+        deps_format_param = DepsFormat::kMake;
+      } else {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("batch")) {
+      if (batch_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      batch_param = ParseStringList<ebb::lib::JSONStringView>();
+      if (!batch_param) {
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("rspfile")) {
+      if (rspfile_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken rspfile_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!rspfile_token) {
+        return kParseDirectiveResultError;
+      }
+      rspfile_param.emplace(
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*rspfile_token)
+              .string_view);
+    } else if (param_type.IsEqual("rspfile_content")) {
+      if (rspfile_content_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken rspfile_content_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!rspfile_content_token) {
+        return kParseDirectiveResultError;
+      }
+      rspfile_content_param.emplace(
+          stdext::get<JSONTokenizer::JSONStringViewToken>(
+              *rspfile_content_token).string_view);
+    } else if (param_type.IsEqual("early_cutoff")) {
+      if (early_cutoff_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken early_cutoff_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!early_cutoff_token) {
+        return kParseDirectiveResultError;
+      }
+      const ebb::lib::JSONStringView& value =
+          stdext::get<JSONTokenizer::JSONStringViewToken>(
+              *early_cutoff_token).string_view;
+      if (value.IsEqual("true")) {
+        early_cutoff_param = true;
+      } else if (value.IsEqual("false")) {
+        early_cutoff_param = false;
+      } else {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("cacheable")) {
+      if (cacheable_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken cacheable_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!cacheable_token) {
+        return kParseDirectiveResultError;
+      }
+      const ebb::lib::JSONStringView& value =
+          stdext::get<JSONTokenizer::JSONStringViewToken>(
+              *cacheable_token).string_view;
+      if (value.IsEqual("true")) {
+        cacheable_param = true;
+      } else if (value.IsEqual("false")) {
+        cacheable_param = false;
+      } else {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+    }
+  } while(true);
+}
+
+namespace {
+const char* NativeActionName(NativeAction action) {
+  switch (action) {
+    case NativeAction::kCopy: return "copy";
+    case NativeAction::kTouch: return "touch";
+    case NativeAction::kMkdir: return "mkdir";
+    case NativeAction::kStamp: return "stamp";
+  }
+  assert(false);
+  return "";
+}
+}  // namespace
+
+RegistryParser::ParseDirectiveResult
+RegistryParser::ParseNativeActionDirective(NativeAction action) {
+  OptionalToken token = GetNextToken();
+  if (!token) {
+    return kParseDirectiveResultError;
+  }
+  if (stdext::holds_alternative<JSONTokenizer::EndListToken>(*token)) {
+    return kParseDirectiveResultListEnd;
+  }
+  if (!stdext::holds_alternative<JSONTokenizer::StartObjectToken>(
+           *token)) {
+    SetError(kErrorUnexpectedToken);
+    return kParseDirectiveResultError;
+  }
+
+  stdext::optional<std::vector<ebb::lib::JSONPathStringView>>
+      inputs_param;
+  stdext::optional<std::vector<ebb::lib::JSONPathStringView>>
+      outputs_param;
+
+  do {
+    OptionalToken param_type_token = GetNextToken();
+    if (!param_type_token) {
+      return kParseDirectiveResultError;
+    }
+    if (stdext::holds_alternative<JSONTokenizer::EndObjectToken>(
+            *param_type_token)) {
+      if (!outputs_param || (action == NativeAction::kCopy && !inputs_param)) {
+        SetError(kErrorDidNotFindAllExpectedKeys);
+        return kParseDirectiveResultError;
+      }
+      // Copies pair up each input with the output at the same index.  For
+      // the other actions, the inputs are just dependencies.
+      if (action == NativeAction::kCopy &&
+          inputs_param->size() != outputs_param->size()) {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+      SystemCommandParams params(
+          NativeActionName(action),
+          inputs_param ? std::move(*inputs_param)
+                       : std::vector<ebb::lib::JSONPathStringView>(),
+          std::move(*outputs_param));
+      params.native_action = action;
+      ProduceSystemCommand(std::move(params));
+      return kParseDirectiveResultSuccess;
+    } else if (
+        !stdext::holds_alternative<JSONTokenizer::JSONStringViewToken>(
+             *param_type_token)) {
+      SetError(kErrorUnexpectedToken);
+      return kParseDirectiveResultError;
+    }
+
+    const ebb::lib::JSONStringView& param_type =
+        stdext::get<JSONTokenizer::JSONStringViewToken>(*param_type_token)
+            .string_view;
+    if (param_type.IsEqual("in")) {
+      if (inputs_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      inputs_param = ParsePathList();
+      if (!inputs_param) {
+        return kParseDirectiveResultError;
+      }
+    } else if (param_type.IsEqual("out")) {
+      if (outputs_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      outputs_param = ParsePathList();
+      if (!outputs_param) {
+        return kParseDirectiveResultError;
+      }
+    } else {
+      SetError(kErrorUnexpectedToken);
+      return kParseDirectiveResultError;
     }
   } while(true);
 }
@@ -386,21 +786,102 @@ RegistryParser::ParseDirectiveResult RegistryParser::ParseBuildDirective() {
   return kParseDirectiveResultSuccess;
 }
 
-stdext::optional<std::vector<ebb::lib::JSONPathStringView>>
-RegistryParser::ParsePathList() {
+RegistryParser::ParseDirectiveResult RegistryParser::ParsePoolDirective() {
+  OptionalToken token = GetNextToken();
+  if (!token) {
+    return kParseDirectiveResultError;
+  }
+  if (stdext::holds_alternative<JSONTokenizer::EndListToken>(*token)) {
+    return kParseDirectiveResultListEnd;
+  }
+  if (!stdext::holds_alternative<JSONTokenizer::StartObjectToken>(
+           *token)) {
+    SetError(kErrorUnexpectedToken);
+    return kParseDirectiveResultError;
+  }
+
+  stdext::optional<ebb::lib::JSONStringView> name_param;
+  stdext::optional<int> depth_param;
+
+  do {
+    OptionalToken param_type_token = GetNextToken();
+    if (!param_type_token) {
+      return kParseDirectiveResultError;
+    }
+    if (stdext::holds_alternative<JSONTokenizer::EndObjectToken>(
+            *param_type_token)) {
+      if (!name_param || !depth_param) {
+        SetError(kErrorDidNotFindAllExpectedKeys);
+        return kParseDirectiveResultError;
+      }
+      ProducePool(PoolParams(*name_param, *depth_param));
+      return kParseDirectiveResultSuccess;
+    } else if (
+        !stdext::holds_alternative<JSONTokenizer::JSONStringViewToken>(
+             *param_type_token)) {
+      SetError(kErrorUnexpectedToken);
+      return kParseDirectiveResultError;
+    }
+
+    const ebb::lib::JSONStringView& param_type =
+        stdext::get<JSONTokenizer::JSONStringViewToken>(*param_type_token)
+            .string_view;
+    if (param_type.IsEqual("name")) {
+      if (name_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      OptionalToken name_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!name_token) {
+        return kParseDirectiveResultError;
+      }
+      name_param.emplace(
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*name_token)
+              .string_view);
+    } else if (param_type.IsEqual("depth")) {
+      if (depth_param) {
+        SetError(kErrorMultiplyDefinedKey);
+        return kParseDirectiveResultError;
+      }
+
+      // The tokenizer only deals in strings, so the depth is given as a
+      // string containing a positive integer.
+      OptionalToken depth_token =
+          GetNextTokenType<JSONTokenizer::JSONStringViewToken>();
+      if (!depth_token) {
+        return kParseDirectiveResultError;
+      }
+      std::string depth_string =
+          stdext::get<JSONTokenizer::JSONStringViewToken>(*depth_token)
+              .string_view.AsString();
+      char* depth_end = nullptr;
+      long depth = strtol(depth_string.c_str(), &depth_end, 10);
+      if (depth_string.empty() || *depth_end != '\0' || depth < 1) {
+        SetError(kErrorInvalidValue);
+        return kParseDirectiveResultError;
+      }
+      depth_param = static_cast<int>(depth);
+    }
+  } while(true);
+}
+
+template <typename StringViewType>
+stdext::optional<std::vector<StringViewType>>
+RegistryParser::ParseStringList() {
   if (!GetNextTokenType<JSONTokenizer::StartListToken>()) {
     return stdext::nullopt;
   }
 
-  std::vector<ebb::lib::JSONPathStringView> result;
+  std::vector<StringViewType> result;
   do {
     OptionalToken token = GetNextToken();
     if (!token) {
       return stdext::nullopt;
     }
     if (stdext::holds_alternative<JSONTokenizer::EndListToken>(*token)) {
-      return stdext::optional<std::vector<ebb::lib::JSONPathStringView>>(
-          std::move(result));
+      return stdext::optional<std::vector<StringViewType>>(std::move(result));
     } else if (
         stdext::holds_alternative<JSONTokenizer::JSONStringViewToken>(
             *token)) {
@@ -414,6 +895,11 @@ RegistryParser::ParsePathList() {
   } while(true);
 }
 
+stdext::optional<std::vector<ebb::lib::JSONPathStringView>>
+RegistryParser::ParsePathList() {
+  return ParseStringList<ebb::lib::JSONPathStringView>();
+}
+
 void RegistryParser::ProduceIncludePath(ebb::lib::JSONPathStringView path) {
   ebb::Push<ErrorOrDirective>(
       output_queue_, Directive(IncludeParams(path)));
@@ -430,4 +916,9 @@ void RegistryParser::ProduceBuildPath(ebb::lib::JSONPathStringView path) {
       output_queue_, Directive(BuildParams(path)));
 }
 
+void RegistryParser::ProducePool(PoolParams&& pool_params) {
+  ebb::Push<ErrorOrDirective>(
+      output_queue_, Directive(std::move(pool_params)));
+}
+
 }  // namespace respire
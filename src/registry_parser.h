@@ -22,6 +22,7 @@ class RegistryParser {
     kErrorInvalidDirectiveName,
     kErrorMultiplyDefinedKey,
     kErrorDidNotFindAllExpectedKeys,
+    kErrorInvalidValue,
   };
 
   struct IncludeParams {
@@ -44,8 +45,21 @@ class RegistryParser {
     ebb::lib::JSONPathStringView path;
   };
 
+  // Declares a named pool that limits how many of the system commands which
+  // reference it may run at once.
+  struct PoolParams {
+    PoolParams(ebb::lib::JSONStringView name, int depth)
+        : name(name), depth(depth) {}
+    bool operator==(const PoolParams& rhs) const {
+      return name == rhs.name && depth == rhs.depth;
+    }
+    ebb::lib::JSONStringView name;
+    int depth;
+  };
+
   using Directive =
-      stdext::variant<IncludeParams, SystemCommandParams, BuildParams>;
+      stdext::variant<IncludeParams, SystemCommandParams, BuildParams,
+                      PoolParams>;
   using ErrorOrDirective = stdext::variant<Error, Directive>;
 
   RegistryParser(
@@ -61,6 +75,11 @@ class RegistryParser {
     kDirectiveTypeInclude,
     kDirectiveTypeSystemCommand,
     kDirectiveTypeBuild,
+    kDirectiveTypePool,
+    kDirectiveTypeCopy,
+    kDirectiveTypeTouch,
+    kDirectiveTypeMkdir,
+    kDirectiveTypeStamp,
     kDirectiveTypeInvalid,
   };
 
@@ -85,13 +104,18 @@ class RegistryParser {
   ParseDirectiveResult ParseIncludeDirective();
   ParseDirectiveResult ParseSystemCommandDirective();
   ParseDirectiveResult ParseBuildDirective();
+  ParseDirectiveResult ParsePoolDirective();
+  ParseDirectiveResult ParseNativeActionDirective(NativeAction action);
 
+  template <typename StringViewType>
+  stdext::optional<std::vector<StringViewType>> ParseStringList();
   stdext::optional<std::vector<ebb::lib::JSONPathStringView>>
       ParsePathList();
 
   void ProduceIncludePath(ebb::lib::JSONPathStringView path);
   void ProduceSystemCommand(SystemCommandParams&& system_command_params);
   void ProduceBuildPath(ebb::lib::JSONPathStringView path);
+  void ProducePool(PoolParams&& pool_params);
 
   ebb::lib::BatchedQueue<ebb::lib::JSONTokenizer::ErrorOrTokens>* input_queue_;
   ebb::Queue<ErrorOrDirective>* output_queue_;
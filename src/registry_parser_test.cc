@@ -17,7 +17,8 @@ const int kDefaultOutputBufferSize = 1000;
 
 void TestExpectedTokenSequence(
     const std::vector<JSONTokenizer::Token>& input_tokens,
-    const std::vector<RegistryParser::Directive>& expected_directive_sequence) {
+    const std::vector<RegistryParser::Directive>& expected_directive_sequence,
+    RegistryParser::Error expected_error = RegistryParser::kErrorSuccess) {
   ebb::Environment env(kDefaultThreadCount, kDefaultStackSize);
 
   ebb::QueueWithMemory<RegistryParser::ErrorOrDirective,
@@ -46,10 +47,9 @@ void TestExpectedTokenSequence(
     RegistryParser::ErrorOrDirective& value = *pull.data();
 
     if (stdext::holds_alternative<RegistryParser::Error>(value)) {
-      // Ensure that if we get a error value, it is a success message, and
+      // Ensure that if we get a error value, it is the one expected, and
       // also that we have processed all expected directives.
-      EXPECT_EQ(RegistryParser::kErrorSuccess,
-                stdext::get<RegistryParser::Error>(value));
+      EXPECT_EQ(expected_error, stdext::get<RegistryParser::Error>(value));
       ASSERT_EQ(expected_directive_sequence.size(), cur_directive);
       break;
     } else {
@@ -247,6 +247,12 @@ TEST(RegistryParserTest, SingleSystemCommandEntryWithDepsFile) {
   const char* kTestOutputPath = "test/output/path";
   const char* kTestDepsFilePath = "test/depsfile/path";
 
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine),
+      {MakeStringView(kTestInputPath1), MakeStringView(kTestInputPath2)},
+      {MakeStringView(kTestOutputPath)});
+  expected_params.deps_file = MakePathStringView(kTestDepsFilePath);
+
   TestExpectedTokenSequence(
     {
       JSONTokenizer::StartListToken(),
@@ -273,11 +279,7 @@ TEST(RegistryParserTest, SingleSystemCommandEntryWithDepsFile) {
       JSONTokenizer::EndListToken()
     },
     {
-      RegistryParser::SystemCommandParams(
-          MakeStringView(kTestCommandLine),
-          {MakeStringView(kTestInputPath1), MakeStringView(kTestInputPath2)},
-          {MakeStringView(kTestOutputPath)},
-          {}, MakePathStringView(kTestDepsFilePath))
+      expected_params
     });
 }
 
@@ -288,6 +290,13 @@ TEST(RegistryParserTest, SystemCommandEntryWithSoftOutputs) {
   const char* kTestSoftOutputPath1 = "test/softoutput/path/1";
   const char* kTestSoftOutputPath2 = "test/softoutput/path/2";
 
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {MakeStringView(kTestInputPath)},
+      {MakeStringView(kTestOutputPath)});
+  expected_params.soft_outputs = std::vector<ebb::lib::JSONPathStringView>{
+      MakeStringView(kTestSoftOutputPath1),
+      MakeStringView(kTestSoftOutputPath2)};
+
   TestExpectedTokenSequence(
     {
       JSONTokenizer::StartListToken(),
@@ -316,12 +325,7 @@ TEST(RegistryParserTest, SystemCommandEntryWithSoftOutputs) {
       JSONTokenizer::EndListToken()
     },
     {
-      RegistryParser::SystemCommandParams(
-          MakeStringView(kTestCommandLine),
-          {MakeStringView(kTestInputPath)},
-          {MakeStringView(kTestOutputPath)},
-          {MakeStringView(kTestSoftOutputPath1),
-           MakeStringView(kTestSoftOutputPath2)})
+      expected_params
     });
 }
 
@@ -440,6 +444,13 @@ TEST(RegistryParserTest, SimpleStdRedirectSystemCommandEntry) {
   const char* kTestStdErrPath = "test/output/stderr";
   const char* kTestStdInPath = "test/input/stdin";
 
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {MakeStringView(kTestInputPath)},
+      {MakeStringView(kTestOutputPath)});
+  expected_params.stdout_file = MakePathStringView(kTestStdOutPath);
+  expected_params.stderr_file = MakePathStringView(kTestStdErrPath);
+  expected_params.stdin_file = MakePathStringView(kTestStdInPath);
+
   TestExpectedTokenSequence(
     {
       JSONTokenizer::StartListToken(),
@@ -469,12 +480,542 @@ TEST(RegistryParserTest, SimpleStdRedirectSystemCommandEntry) {
       JSONTokenizer::EndListToken()
     },
     {
-      RegistryParser::SystemCommandParams(
-          MakeStringView(kTestCommandLine), {MakeStringView(kTestInputPath)},
-          {MakeStringView(kTestOutputPath)}, {}, stdext::nullopt,
-          MakePathStringView(kTestStdOutPath),
-          MakePathStringView(kTestStdErrPath),
-          MakePathStringView(kTestStdInPath))
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithArgv) {
+  const char* kTestCommandLine = "test \"command line\"";
+  const char* kTestArg1 = "test";
+  const char* kTestArg2 = "command line";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.argv = std::vector<ebb::lib::JSONStringView>{
+      MakeStringView(kTestArg1), MakeStringView(kTestArg2)};
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("argv"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestArg1),
+      MakeStringViewToken(kTestArg2),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, PoolEntryAndSystemCommandInPool) {
+  const char* kTestPoolName = "link";
+  const char* kTestCommandLine = "test command line";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.pool = MakeStringView(kTestPoolName);
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("pool"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("name"),
+      MakeStringViewToken(kTestPoolName),
+      MakeStringViewToken("depth"),
+      MakeStringViewToken("2"),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("pool"),
+      MakeStringViewToken(kTestPoolName),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      RegistryParser::PoolParams(MakeStringView(kTestPoolName), 2),
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithTimeout) {
+  const char* kTestCommandLine = "test command line";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.timeout = std::chrono::milliseconds(1500);
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("timeout"),
+      MakeStringViewToken("1.5"),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithOutOfRangeTimeout) {
+  for (const char* timeout : {"inf", "1e300", "0", "-1"}) {
+    TestExpectedTokenSequence(
+      {
+        JSONTokenizer::StartListToken(),
+        JSONTokenizer::StartObjectToken(),
+        MakeStringViewToken("sc"),
+        JSONTokenizer::StartListToken(),
+        JSONTokenizer::StartObjectToken(),
+        MakeStringViewToken("cmd"),
+        MakeStringViewToken("test command line"),
+        MakeStringViewToken("timeout"),
+        MakeStringViewToken(timeout),
+        JSONTokenizer::EndObjectToken(),
+        JSONTokenizer::EndListToken(),
+        JSONTokenizer::EndObjectToken(),
+        JSONTokenizer::EndListToken()
+      },
+      {}, RegistryParser::kErrorInvalidValue);
+  }
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithOutputLogs) {
+  const char* kTestCommandLine = "test command line";
+  const char* kTestOutputPath = "test/output/path";
+  const char* kTestStdoutLogPath = "test/stdout/log";
+  const char* kTestStderrLogPath = "test/stderr/log";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.stdout_log_file = MakePathStringView(kTestStdoutLogPath);
+  expected_params.stderr_log_file = MakePathStringView(kTestStderrLogPath);
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("stdout_log"),
+      MakeStringViewToken(kTestStdoutLogPath),
+      MakeStringViewToken("stderr_log"),
+      MakeStringViewToken(kTestStderrLogPath),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithWorker) {
+  const char* kTestCommandLine = "tool --flag input";
+  const char* kTestTool = "tool";
+  const char* kTestFlag = "--flag";
+  const char* kTestInput = "input";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.argv = std::vector<ebb::lib::JSONStringView>{
+      MakeStringView(kTestTool), MakeStringView(kTestFlag),
+      MakeStringView(kTestInput)};
+  expected_params.worker = std::vector<ebb::lib::JSONStringView>{
+      MakeStringView(kTestTool), MakeStringView(kTestFlag)};
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("argv"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestTool),
+      MakeStringViewToken(kTestFlag),
+      MakeStringViewToken(kTestInput),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("worker"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestTool),
+      MakeStringViewToken(kTestFlag),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithStampOutputs) {
+  const char* kTestCommandLine = "run_tests";
+  const char* kTestOutputPath = "test/output/path";
+  const char* kTestStampPath = "test/output/stamp";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {},
+      {MakeStringView(kTestOutputPath), MakeStringView(kTestStampPath)});
+  expected_params.stamp_outputs =
+      std::vector<ebb::lib::JSONPathStringView>{MakeStringView(kTestStampPath)};
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      MakeStringViewToken(kTestStampPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("stamp_out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestStampPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, NativeActionEntries) {
+  const char* kTestInputPath = "test/input/path";
+  const char* kTestCopyPath = "test/output/copy";
+  const char* kTestStampPath = "test/output/stamp";
+
+  RegistryParser::SystemCommandParams expected_copy_params(
+      MakeStringView("copy"), {MakeStringView(kTestInputPath)},
+      {MakeStringView(kTestCopyPath)});
+  expected_copy_params.native_action = NativeAction::kCopy;
+  RegistryParser::SystemCommandParams expected_stamp_params(
+      MakeStringView("stamp"), {}, {MakeStringView(kTestStampPath)});
+  expected_stamp_params.native_action = NativeAction::kStamp;
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("copy"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestInputPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestCopyPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("stamp"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestStampPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_copy_params,
+      expected_stamp_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithMakeFormatDeps) {
+  const char* kTestCommandLine = "cc -MD -MF test/output/path.d";
+  const char* kTestOutputPath = "test/output/path";
+  const char* kTestDepsPath = "test/output/path.d";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.deps_file = MakePathStringView(kTestDepsPath);
+  expected_params.deps_format = DepsFormat::kMake;
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("deps"),
+      MakeStringViewToken(kTestDepsPath),
+      MakeStringViewToken("deps_format"),
+      MakeStringViewToken("make"),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithResponseFile) {
+  const char* kTestCommandLine = "ld -o test/output/path @test/output/path.rsp";
+  const char* kTestOutputPath = "test/output/path";
+  const char* kTestResponseFilePath = "test/output/path.rsp";
+  const char* kTestResponseFileContent = "a.o b.o c.o";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.rspfile = MakePathStringView(kTestResponseFilePath);
+  expected_params.rspfile_content = MakeStringView(kTestResponseFileContent);
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("rspfile"),
+      MakeStringViewToken(kTestResponseFilePath),
+      MakeStringViewToken("rspfile_content"),
+      MakeStringViewToken(kTestResponseFileContent),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithBatch) {
+  const char* kTestCommandLine = "codegen input";
+  const char* kTestTool = "codegen";
+  const char* kTestInput = "input";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.argv = std::vector<ebb::lib::JSONStringView>{
+      MakeStringView(kTestTool), MakeStringView(kTestInput)};
+  expected_params.batch =
+      std::vector<ebb::lib::JSONStringView>{MakeStringView(kTestTool)};
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("argv"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestTool),
+      MakeStringViewToken(kTestInput),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("batch"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestTool),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryWithEarlyCutoff) {
+  const char* kTestCommandLine = "codegen input";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.early_cutoff = true;
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("early_cutoff"),
+      MakeStringViewToken("true"),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
+    });
+}
+
+TEST(RegistryParserTest, SystemCommandEntryThatIsNotCacheable) {
+  const char* kTestCommandLine = "codegen input";
+  const char* kTestOutputPath = "test/output/path";
+
+  RegistryParser::SystemCommandParams expected_params(
+      MakeStringView(kTestCommandLine), {}, {MakeStringView(kTestOutputPath)});
+  expected_params.cacheable = false;
+
+  TestExpectedTokenSequence(
+    {
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("sc"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::StartObjectToken(),
+      MakeStringViewToken("cmd"),
+      MakeStringViewToken(kTestCommandLine),
+      MakeStringViewToken("cacheable"),
+      MakeStringViewToken("false"),
+      MakeStringViewToken("in"),
+      JSONTokenizer::StartListToken(),
+      JSONTokenizer::EndListToken(),
+      MakeStringViewToken("out"),
+      JSONTokenizer::StartListToken(),
+      MakeStringViewToken(kTestOutputPath),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken(),
+      JSONTokenizer::EndObjectToken(),
+      JSONTokenizer::EndListToken()
+    },
+    {
+      expected_params
     });
 }
 
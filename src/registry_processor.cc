@@ -19,6 +19,7 @@ RegistryProcessor::RegistryProcessor(
       parent_registry_node_(parent_registry_node),
       output_queue_(output_queue),
       result_pushed_(false),
+      consumed_all_directives_(false),
       locked_node_storage_(locked_node_storage),
       consumer_(
           env->ebb_env(), input_queue,
@@ -44,6 +45,7 @@ void RegistryProcessor::Consume(RegistryParser::ErrorOrDirective&& input) {
     RegistryParser::Error error =
         stdext::get<RegistryParser::Error>(input);
     if (error == RegistryParser::kErrorSuccess) {
+      consumed_all_directives_ = true;
       if (WaitForPendingIncludeDirectives() &&
           BuildPendingBuildTargets()) {
         // There should not have been any errors pushed up until now.
@@ -75,6 +77,10 @@ void RegistryProcessor::Consume(RegistryParser::ErrorOrDirective&& input) {
                  *directive)) {
     ConsumeBuildParams(
         &stdext::get<RegistryParser::BuildParams>(*directive));
+  } else if (stdext::holds_alternative<RegistryParser::PoolParams>(
+                 *directive)) {
+    ConsumePoolParams(
+        &stdext::get<RegistryParser::PoolParams>(*directive));
   } else {
     assert(false);
   }
@@ -202,20 +208,33 @@ void RegistryProcessor::ConsumeSystemCommandParams(
     inputs.push_back(stdin_node);
   }
 
+  ebb::FiberSemaphore* pool = nullptr;
+  if (system_command_params->pool) {
+    pool = access.LookupPool(system_command_params->pool->AsString());
+    if (!pool) {
+      std::ostringstream oss;
+      oss << "System command references a pool that has not been declared:"
+          << std::endl << system_command_params->pool->AsString() << std::endl;
+      PushError(oss.str());
+      return;
+    }
+  }
+
   FileProcessNode::GetDepsFunction get_deps_function;
   if (system_command_params->deps_file) {
     FileInfoNodeOutput deps_node = access.LookupNodeOrMakeFileExistsNode(
         env_, *system_command_params->deps_file);
     get_deps_function =
         std::bind(&ParseDeps, env_, locked_node_storage_, deps_node,
-                  *system_command_params->deps_file);
+                  *system_command_params->deps_file,
+                  system_command_params->deps_format);
   }
 
   // Construct the system command node.
   auto node = std::unique_ptr<SystemCommandNode>(
       new SystemCommandNode(
           env_, std::move(inputs), std::move(*system_command_params),
-          get_deps_function));
+          get_deps_function, pool));
 
   // Add the new system command node to the registry, with a key for each of the
   // outputs that it produces.
@@ -246,12 +265,27 @@ void RegistryProcessor::ConsumeBuildParams(
     target_output = found->second;
   }
 
-  // Start a dry run on our build targets to induce log output that can be
-  // used to determine the number of nodes we will be building.  In this
-  // RegistryProcessor's destructor, we will initiate the actual fetches and
-  // wait for them to resolve.
+  // Start a dry run on our build targets, which scans their dependencies to
+  // find the nodes that need building, inducing log output that can be used
+  // to count them.  Once all directives are consumed,
+  // BuildPendingBuildTargets() initiates the actual fetches, which build the
+  // nodes found by the scan without repeating it.
   pending_builds_.emplace_back(target_output.node->GetFileInfo(true));
   pending_targets_.emplace_back(target_output.node);
+  LockedNodeStorage::Access(locked_node_storage_).AddBuildTarget(
+      target_output.node);
+}
+
+void RegistryProcessor::ConsumePoolParams(
+    RegistryParser::PoolParams* pool_params) {
+  LockedNodeStorage::Access access(locked_node_storage_);
+  if (!access.DeclarePool(
+          env_, pool_params->name.AsString(), pool_params->depth)) {
+    std::ostringstream oss;
+    oss << "Pool declared more than once with different depths:" << std::endl;
+    oss << pool_params->name.AsString() << std::endl;
+    PushError(oss.str());
+  }
 }
 
 bool RegistryProcessor::VerifyValidSystemCommandOutputOrPushError(
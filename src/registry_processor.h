@@ -31,6 +31,12 @@ class RegistryProcessor {
 
   ~RegistryProcessor();
 
+  // True once every directive in the registry has been processed, even if
+  // building its targets then failed.  Once the result has been pulled from
+  // the output queue, this is false only if processing stopped early because
+  // of an error.
+  bool consumed_all_directives() const { return consumed_all_directives_; }
+
  private:
 
   void PushError(Error error);
@@ -40,6 +46,7 @@ class RegistryProcessor {
   void ConsumeSystemCommandParams(
       RegistryParser::SystemCommandParams* system_command_params);
   void ConsumeBuildParams(RegistryParser::BuildParams* build_params);
+  void ConsumePoolParams(RegistryParser::PoolParams* pool_params);
 
   bool VerifyValidSystemCommandOutputOrPushError(
       LockedNodeStorage::Access* access,
@@ -55,6 +62,7 @@ class RegistryProcessor {
   ebb::Queue<OptionalError>* output_queue_;
 
   bool result_pushed_;
+  bool consumed_all_directives_;
 
   std::vector<FuturePtr> pending_include_fetches_;
 
@@ -0,0 +1,452 @@
+#include "remote_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#include "platform/file_system.h"
+#include "platform/tcp_connection.h"
+#include "sha256.h"
+
+namespace respire {
+
+namespace {
+// Each request is made over its own connection, so a few are kept in flight
+// at once to hide the latency of setting them up.
+const int kNumConnections = 8;
+
+// How long to wait on the server before giving up on it.
+const std::chrono::milliseconds kTimeout(10000);
+
+// Guards against a server that never finishes sending its headers.
+const size_t kMaxResponseHeadSize = 64 * 1024;
+
+const size_t kBufferSize = 64 * 1024;
+
+const int kDefaultPort = 80;
+
+// Receives the body of a response as it arrives, returning false to give up.
+using BodySink = std::function<bool(const char* data, size_t size)>;
+
+bool StartsWithNoCase(const std::string& str, const char* prefix) {
+  size_t i = 0;
+  for (; prefix[i] != '\0'; ++i) {
+    if (i >= str.size() || std::tolower(str[i]) != std::tolower(prefix[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the status line and headers of a response, leaving whatever was read
+// of the body along with them in |body_start|.
+bool ReadResponseHead(platform::TcpConnection* connection, int* status,
+                      stdext::optional<uint64_t>* content_length,
+                      std::string* body_start) {
+  std::string head;
+  std::vector<char> buffer(kBufferSize);
+  size_t head_end;
+  while ((head_end = head.find("\r\n\r\n")) == std::string::npos) {
+    if (head.size() > kMaxResponseHeadSize) {
+      return false;
+    }
+    int64_t size = connection->Read(buffer.data(), buffer.size());
+    if (size <= 0) {
+      return false;
+    }
+    head.append(buffer.data(), static_cast<size_t>(size));
+  }
+  *body_start = head.substr(head_end + 4);
+  head.resize(head_end + 2);
+
+  // e.g. "HTTP/1.1 200 OK".
+  size_t line_end = head.find("\r\n");
+  std::string status_line = head.substr(0, line_end);
+  size_t space = status_line.find(' ');
+  if (!StartsWithNoCase(status_line, "HTTP/") || space == std::string::npos) {
+    return false;
+  }
+  *status = std::atoi(status_line.c_str() + space + 1);
+
+  for (size_t line_start = line_end + 2; line_start < head.size();
+       line_start = line_end + 2) {
+    line_end = head.find("\r\n", line_start);
+    std::string line = head.substr(line_start, line_end - line_start);
+    if (StartsWithNoCase(line, "content-length:")) {
+      *content_length = std::strtoull(
+          line.c_str() + sizeof("content-length:") - 1, nullptr, 10);
+    }
+  }
+  return true;
+}
+
+// Makes a |method| request for |path| of the server at |location|, sending
+// |body_size| bytes from |body|, if given, and passing the response's body to
+// |sink|.  Returns false if the exchange didn't complete, either because the
+// server couldn't be reached or because |sink| gave up.
+bool Exchange(const RemoteCache::Location& location, const char* method,
+              const std::string& path, std::istream* body, uint64_t body_size,
+              const BodySink& sink, int* status) {
+  std::unique_ptr<platform::TcpConnection> connection =
+      platform::TcpConnection::Connect(location.host, location.port,
+                                       kTimeout);
+  if (!connection) {
+    return false;
+  }
+
+  // HTTP/1.0, so that the response isn't chunked, and its end is marked by
+  // the server closing the connection.
+  std::ostringstream head;
+  head << method << " " << location.path_prefix << "/" << path
+       << " HTTP/1.0\r\n"
+       << "Host: " << location.host << ":" << location.port << "\r\n";
+  if (body) {
+    head << "Content-Length: " << body_size << "\r\n";
+  }
+  head << "\r\n";
+  std::string head_str = head.str();
+  if (!connection->Write(head_str.data(), head_str.size())) {
+    return false;
+  }
+
+  std::vector<char> buffer(kBufferSize);
+  if (body) {
+    uint64_t remaining = body_size;
+    while (remaining > 0) {
+      body->read(buffer.data(), static_cast<std::streamsize>(
+          std::min<uint64_t>(remaining, buffer.size())));
+      size_t size = static_cast<size_t>(body->gcount());
+      if (size == 0 || !connection->Write(buffer.data(), size)) {
+        return false;
+      }
+      remaining -= size;
+    }
+  }
+
+  stdext::optional<uint64_t> content_length;
+  std::string body_start;
+  if (!ReadResponseHead(connection.get(), status, &content_length,
+                        &body_start)) {
+    return false;
+  }
+  // A HEAD response describes a body that isn't sent.
+  if (std::string(method) == "HEAD") {
+    return true;
+  }
+
+  uint64_t received = body_start.size();
+  if (!sink(body_start.data(), body_start.size())) {
+    return false;
+  }
+  while (!content_length || received < *content_length) {
+    int64_t size = connection->Read(buffer.data(), buffer.size());
+    if (size < 0) {
+      return false;
+    } else if (size == 0) {
+      break;
+    }
+    received += static_cast<uint64_t>(size);
+    if (!sink(buffer.data(), static_cast<size_t>(size))) {
+      return false;
+    }
+  }
+  // Otherwise the connection was lost part way through.
+  return !content_length || received == *content_length;
+}
+}  // namespace
+
+struct RemoteCache::Request {
+  enum class Kind {
+    GetActionResult,
+    GetBlob,
+    PutActionResult,
+  };
+
+  Request(ebb::ThreadPool* thread_pool, Kind kind, const std::string& name)
+      : kind(kind), name(name), done(false), done_cond(thread_pool),
+        succeeded(false) {}
+
+  const Kind kind;
+  // The path of the request, relative to the server's prefix, e.g.
+  // "ac/[key]".
+  const std::string name;
+  // The digest of a blob to download to |file_path|.
+  std::string digest;
+  std::string file_path;
+  // The results of an action, to be uploaded or as downloaded.
+  std::string contents;
+  // The outputs to upload before an action's results.
+  std::vector<Blob> blobs;
+
+  // Guarded by RemoteCache::mutex_.
+  bool done;
+  ebb::FiberConditionVariable done_cond;
+
+  // Only safe to read once |done| is set.
+  bool succeeded;
+};
+
+// static
+stdext::optional<RemoteCache::Location> RemoteCache::ParseUrl(
+    const std::string& url) {
+  const std::string scheme = "http://";
+  if (url.compare(0, scheme.size(), scheme) != 0) {
+    return stdext::nullopt;
+  }
+  size_t host_start = scheme.size();
+  size_t host_end = url.find_first_of(":/", host_start);
+  if (host_end == std::string::npos) {
+    host_end = url.size();
+  }
+
+  Location location;
+  location.host = url.substr(host_start, host_end - host_start);
+  location.port = kDefaultPort;
+  if (location.host.empty()) {
+    return stdext::nullopt;
+  }
+
+  size_t path_start = url.find('/', host_end);
+  if (path_start == std::string::npos) {
+    path_start = url.size();
+  }
+  if (host_end < url.size() && url[host_end] == ':') {
+    std::string port = url.substr(host_end + 1, path_start - host_end - 1);
+    char* end;
+    long value = std::strtol(port.c_str(), &end, 10);
+    if (port.empty() || *end != '\0' || value <= 0 || value > 65535) {
+      return stdext::nullopt;
+    }
+    location.port = static_cast<int>(value);
+  }
+
+  location.path_prefix = url.substr(path_start);
+  while (!location.path_prefix.empty() &&
+         location.path_prefix.back() == '/') {
+    location.path_prefix.pop_back();
+  }
+  return location;
+}
+
+RemoteCache::RemoteCache(ebb::Environment* ebb_env, const Location& location)
+    : thread_pool_(&ebb_env->env()->thread_pool()), location_(location),
+      disabled_(false), upload_rejected_(false), quit_(false) {
+  for (int i = 0; i < kNumConnections; ++i) {
+    threads_.emplace_back(&RemoteCache::WorkerLoop, this);
+  }
+}
+
+RemoteCache::~RemoteCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  worker_cond_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+stdext::optional<std::string> RemoteCache::GetActionResult(
+    const std::string& key) {
+  if (disabled_) {
+    return stdext::nullopt;
+  }
+  std::shared_ptr<Request> request = std::make_shared<Request>(
+      thread_pool_, Request::Kind::GetActionResult, "ac/" + key);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  downloads_.push_back(request);
+  worker_cond_.notify_one();
+  while (!request->done) {
+    request->done_cond.wait(lock);
+  }
+  lock.unlock();
+
+  if (!request->succeeded) {
+    return stdext::nullopt;
+  }
+  return std::move(request->contents);
+}
+
+bool RemoteCache::GetBlob(const std::string& digest, const std::string& path) {
+  if (disabled_) {
+    return false;
+  }
+  std::shared_ptr<Request> request = std::make_shared<Request>(
+      thread_pool_, Request::Kind::GetBlob, "cas/" + digest);
+  request->digest = digest;
+  request->file_path = path;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  downloads_.push_back(request);
+  worker_cond_.notify_one();
+  while (!request->done) {
+    request->done_cond.wait(lock);
+  }
+  return request->succeeded;
+}
+
+void RemoteCache::PutActionResult(const std::string& key,
+                                  const std::string& contents,
+                                  const std::vector<Blob>& outputs) {
+  if (disabled_) {
+    return;
+  }
+  std::shared_ptr<Request> request = std::make_shared<Request>(
+      thread_pool_, Request::Kind::PutActionResult, "ac/" + key);
+  request->contents = contents;
+  request->blobs = outputs;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  uploads_.push_back(request);
+  worker_cond_.notify_one();
+}
+
+void RemoteCache::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    std::shared_ptr<Request> request;
+    if (!downloads_.empty()) {
+      request = std::move(downloads_.front());
+      downloads_.pop_front();
+    } else if (!uploads_.empty()) {
+      request = std::move(uploads_.front());
+      uploads_.pop_front();
+    } else if (quit_) {
+      // Only once every upload has been made.
+      return;
+    } else {
+      worker_cond_.wait(lock);
+      continue;
+    }
+
+    lock.unlock();
+    if (!disabled_) {
+      Perform(request.get());
+    }
+    lock.lock();
+
+    request->done = true;
+    request->done_cond.notify_all();
+  }
+}
+
+void RemoteCache::Perform(Request* request) {
+  int status = 0;
+  BodySink discard = [](const char*, size_t) { return true; };
+
+  switch (request->kind) {
+    case Request::Kind::GetActionResult: {
+      std::string contents;
+      if (!Exchange(location_, "GET", request->name, nullptr, 0,
+                    [&contents](const char* data, size_t size) {
+                      contents.append(data, size);
+                      return true;
+                    }, &status)) {
+        Disable();
+        return;
+      }
+      request->succeeded = status == 200;
+      request->contents = std::move(contents);
+    } break;
+
+    case Request::Kind::GetBlob: {
+      std::ofstream out(request->file_path.c_str(),
+                        std::ios::out | std::ios::binary);
+      Sha256 sha256;
+      bool written = static_cast<bool>(out);
+      if (!Exchange(location_, "GET", request->name, nullptr, 0,
+                    [&out, &sha256, &written](const char* data, size_t size) {
+                      sha256.Update(data, size);
+                      written = written && out.write(data, size);
+                      return true;
+                    }, &status)) {
+        Disable();
+        written = false;
+      }
+      written = written && out.flush();
+      out.close();
+      // Never let a corrupted download into the local cache.
+      request->succeeded =
+          written && status == 200 && sha256.HexDigest() == request->digest;
+      if (!request->succeeded) {
+        std::remove(request->file_path.c_str());
+      }
+    } break;
+
+    case Request::Kind::PutActionResult: {
+      for (const auto& blob : request->blobs) {
+        if (!PutBlob(blob, &status)) {
+          Disable();
+          return;
+        }
+        if (status != 200) {
+          break;
+        }
+      }
+      if (status == 200 || request->blobs.empty()) {
+        std::istringstream body(request->contents);
+        if (!Exchange(location_, "PUT", request->name, &body,
+                      request->contents.size(), discard, &status)) {
+          Disable();
+          return;
+        }
+      }
+      request->succeeded = status >= 200 && status < 300;
+      // A status of 0 means that an output was evicted from the local cache
+      // before it could be uploaded, which is no fault of the server's.
+      if (!request->succeeded && status != 0 &&
+          !upload_rejected_.exchange(true)) {
+        std::cerr << "Warning: remote cache at " << location_.host << ":"
+                  << location_.port << " rejected an upload with status "
+                  << status << "." << std::endl;
+      }
+    } break;
+  }
+}
+
+bool RemoteCache::PutBlob(const Blob& blob, int* status) {
+  std::string name = "cas/" + blob.digest;
+  BodySink discard = [](const char*, size_t) { return true; };
+  if (!Exchange(location_, "HEAD", name, nullptr, 0, discard, status)) {
+    return false;
+  }
+  if (*status == 200) {
+    // Another build already uploaded it.
+    return true;
+  }
+
+  stdext::optional<platform::FileStatus> file_status =
+      platform::GetFileStatus(blob.path.c_str());
+  std::ifstream body(blob.path.c_str(), std::ios::in | std::ios::binary);
+  if (!file_status || !body) {
+    *status = 0;
+    return true;
+  }
+  if (!Exchange(location_, "PUT", name, &body, file_status->size, discard,
+                status)) {
+    return false;
+  }
+  // Normalize any success, so that the caller needn't care how the server
+  // reports it.
+  if (*status >= 200 && *status < 300) {
+    *status = 200;
+  }
+  return true;
+}
+
+void RemoteCache::Disable() {
+  if (!disabled_.exchange(true)) {
+    std::cerr << "Warning: could not reach remote cache at "
+              << location_.host << ":" << location_.port
+              << ", continuing without it." << std::endl;
+  }
+}
+
+}  // namespace respire
@@ -0,0 +1,102 @@
+#ifndef __RESPIRE_REMOTE_CACHE_H__
+#define __RESPIRE_REMOTE_CACHE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ebbpp.h>
+
+#include "stdext/optional.h"
+
+namespace respire {
+
+// A client for an action cache shared over HTTP, e.g. by bazel-remote, which
+// backs the local ActionCache so that outputs built on one machine can be
+// restored on others.  The server is expected to serve:
+//
+//   GET/PUT [prefix]/ac/[key]:  An action's results, in ActionCache's format.
+//   GET/PUT/HEAD [prefix]/cas/[digest]:  The file with that SHA-256 digest.
+//
+// Requests are made on threads dedicated to them, so that a fiber waiting on
+// a download doesn't hold up its thread pool thread, which goes on running
+// other commands in the meantime.  Downloads are made before any uploads that
+// are waiting, since builds wait on downloads but not on uploads.
+//
+// The cache only ever speeds builds up, so if the server can't be reached,
+// a warning is printed and the cache is no longer used for the rest of the
+// build.
+class RemoteCache {
+ public:
+  struct Location {
+    std::string host;
+    int port;
+    // Prepended to the path of every request, e.g. "/team".
+    std::string path_prefix;
+  };
+
+  // A local file to be uploaded, with the SHA-256 digest that names it.
+  struct Blob {
+    std::string digest;
+    std::string path;
+  };
+
+  // Parses a URL of the form "http://host[:port][/prefix]", returning nothing
+  // if it isn't one.
+  static stdext::optional<Location> ParseUrl(const std::string& url);
+
+  // |ebb_env| must outlive the cache.
+  RemoteCache(ebb::Environment* ebb_env, const Location& location);
+  // Waits for any uploads that are still in progress.
+  ~RemoteCache();
+
+  // Returns the results recorded for the action with |key|, if there are any.
+  // Only the calling fiber is suspended while they are downloaded.
+  stdext::optional<std::string> GetActionResult(const std::string& key);
+  // Downloads the file with |digest| to |path|, returning false if it isn't
+  // cached.  Only the calling fiber is suspended while it's downloaded.
+  bool GetBlob(const std::string& digest, const std::string& path);
+
+  // Uploads the files at each of |outputs|' paths, unless the server already
+  // has them, followed by |contents| as the results of the action with |key|,
+  // so that nobody finds the results before the outputs.  Returns
+  // immediately, and the upload happens later, so the files must not change
+  // in the meantime.
+  void PutActionResult(const std::string& key, const std::string& contents,
+                       const std::vector<Blob>& outputs);
+
+ private:
+  struct Request;
+
+  void WorkerLoop();
+  // Makes |request| of the server, setting its result.
+  void Perform(Request* request);
+  // Uploads |blob| unless the server already has it, setting |status| to 200
+  // if it has it now, or 0 if the file is gone.  Returns false if the server
+  // couldn't be reached.
+  bool PutBlob(const Blob& blob, int* status);
+  // Called when the server couldn't be reached, to stop using it.
+  void Disable();
+
+  ebb::ThreadPool* thread_pool_;
+  const Location location_;
+  std::atomic<bool> disabled_;
+  std::atomic<bool> upload_rejected_;
+
+  std::mutex mutex_;
+  std::condition_variable worker_cond_;
+  bool quit_;
+  std::deque<std::shared_ptr<Request>> downloads_;
+  std::deque<std::shared_ptr<Request>> uploads_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_REMOTE_CACHE_H__
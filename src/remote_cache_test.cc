@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "remote_cache.h"
+#include "stdext/file_system.h"
+
+using respire::RemoteCache;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+namespace {
+const size_t kFiberStackSize = 64 * 1024;
+}  // namespace
+
+TEST(RemoteCacheTest, ParsesUrls) {
+  stdext::optional<RemoteCache::Location> location =
+      RemoteCache::ParseUrl("http://cache.example.com:9090/team/");
+  ASSERT_TRUE(location.has_value());
+  EXPECT_EQ("cache.example.com", location->host);
+  EXPECT_EQ(9090, location->port);
+  EXPECT_EQ("/team", location->path_prefix);
+
+  location = RemoteCache::ParseUrl("http://127.0.0.1");
+  ASSERT_TRUE(location.has_value());
+  EXPECT_EQ("127.0.0.1", location->host);
+  EXPECT_EQ(80, location->port);
+  EXPECT_EQ("", location->path_prefix);
+
+  EXPECT_FALSE(RemoteCache::ParseUrl("https://cache.example.com"));
+  EXPECT_FALSE(RemoteCache::ParseUrl("cache.example.com:9090"));
+  EXPECT_FALSE(RemoteCache::ParseUrl("http://:9090"));
+  EXPECT_FALSE(RemoteCache::ParseUrl("http://cache.example.com:"));
+  EXPECT_FALSE(RemoteCache::ParseUrl("http://cache.example.com:99999"));
+  EXPECT_FALSE(RemoteCache::ParseUrl("http://cache.example.com:90x/"));
+}
+
+TEST(RemoteCacheTest, UnreachableServerIsTreatedAsEmpty) {
+  ebb::Environment env(1, kFiberStackSize);
+  TemporaryDirectory temp_dir;
+  Path blob = Join(temp_dir.path(), PathStrRef("blob"));
+
+  // Nothing listens on port 1 here.
+  RemoteCache remote_cache(&env, *RemoteCache::ParseUrl("http://127.0.0.1:1"));
+  EXPECT_FALSE(remote_cache.GetActionResult(std::string(64, '0')));
+  remote_cache.PutActionResult(std::string(64, '0'), "contents", {});
+  EXPECT_FALSE(remote_cache.GetBlob(std::string(64, '0'), blob.str()));
+}
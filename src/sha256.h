@@ -0,0 +1,40 @@
+#ifndef __RESPIRE_SHA256_H__
+#define __RESPIRE_SHA256_H__
+
+#include <stdint.h>
+
+#include <string>
+
+#include "stdext/optional.h"
+
+namespace respire {
+
+// Computes SHA-256 digests, which name the blobs in the action cache.  Unlike
+// the 64-bit hashes in the build log, these are meant to be shared between
+// machines, so collisions must be out of the question.
+class Sha256 {
+ public:
+  Sha256();
+
+  void Update(const void* data, size_t size);
+  // Returns the digest of everything passed to Update(), as 64 lowercase hex
+  // digits.  The digest may only be taken once.
+  std::string HexDigest();
+
+  static std::string Hash(const std::string& data);
+  // Returns the digest of the contents of the file at |path|, or a disengaged
+  // optional if it couldn't be read.
+  static stdext::optional<std::string> HashFile(const std::string& path);
+
+ private:
+  void ProcessBlock(const uint8_t* block);
+
+  uint32_t state_[8];
+  uint8_t buffer_[64];
+  size_t buffer_size_;
+  uint64_t total_size_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_SHA256_H__
@@ -0,0 +1,54 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "sha256.h"
+#include "stdext/file_system.h"
+
+using respire::Sha256;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+TEST(Sha256Test, MatchesKnownDigests) {
+  EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            Sha256::Hash(""));
+  EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            Sha256::Hash("abc"));
+  // Long enough that the padding spills over into another block.
+  EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            Sha256::Hash(
+                "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+}
+
+TEST(Sha256Test, DigestDoesNotDependOnHowDataIsSplit) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    data += std::to_string(i);
+  }
+  std::string expected = Sha256::Hash(data);
+
+  for (size_t chunk_size : {1, 7, 63, 64, 65, 1000}) {
+    Sha256 sha256;
+    for (size_t i = 0; i < data.size(); i += chunk_size) {
+      sha256.Update(data.data() + i, std::min(chunk_size, data.size() - i));
+    }
+    EXPECT_EQ(expected, sha256.HexDigest()) << chunk_size;
+  }
+}
+
+TEST(Sha256Test, HashesFileContents) {
+  TemporaryDirectory temp_dir;
+  Path path = Join(temp_dir.path(), PathStrRef("foo.txt"));
+  {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << "abc";
+  }
+
+  stdext::optional<std::string> digest = Sha256::HashFile(path.str());
+  ASSERT_TRUE(digest.has_value());
+  EXPECT_EQ(Sha256::Hash("abc"), *digest);
+  EXPECT_FALSE(Sha256::HashFile(
+      Join(temp_dir.path(), PathStrRef("bar.txt")).str()).has_value());
+}
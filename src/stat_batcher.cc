@@ -0,0 +1,190 @@
+#include "stat_batcher.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "fiber_condition_variable.h"
+#include "platform/file_system.h"
+
+namespace respire {
+
+namespace {
+// Bounds on the number of paths that a thread looks up at once.  Small
+// batches are still spread over a few threads, while large ones are split
+// finely enough that a slow directory doesn't hold up the rest for long.
+const size_t kMinChunkSize = 8;
+const size_t kMaxChunkSize = 64;
+
+size_t DirectoryLength(const char* path) {
+  const char* separator = strrchr(path, '/');
+  return separator ? separator - path : 0;
+}
+}  // namespace
+
+struct StatBatcher::Batch {
+  Batch(ebb::ThreadPool* thread_pool)
+      : chunk_size(0), num_chunks(0), next_chunk(0), num_chunks_done(0),
+        done(false), done_cond(thread_pool) {}
+
+  // Guarded by StatBatcher::mutex_ while the batch is pending, after which
+  // they no longer change.
+  std::vector<const char*> paths;
+
+  // Set when the batch is planned.  The chunks cover consecutive elements of
+  // |order|, which indexes into |paths|.
+  std::vector<size_t> order;
+  size_t chunk_size;
+  size_t num_chunks;
+
+  // Guarded by StatBatcher::mutex_.
+  size_t next_chunk;
+  size_t num_chunks_done;
+  bool done;
+  ebb::FiberConditionVariable done_cond;
+
+  // Each chunk fills in the elements for its own paths, so these are only
+  // safe to read once |done| is set.
+  std::vector<Time> times;
+};
+
+StatBatcher::StatBatcher(ebb::Environment* ebb_env, int num_threads)
+    : thread_pool_(&ebb_env->env()->thread_pool()),
+      num_threads_(static_cast<size_t>(num_threads)), quit_(false) {
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&StatBatcher::WorkerLoop, this);
+  }
+}
+
+StatBatcher::~StatBatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  worker_cond_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::vector<StatBatcher::Time> StatBatcher::GetLastModificationTimes(
+    const std::vector<const char*>& paths) {
+  if (paths.empty()) {
+    return std::vector<Time>();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!pending_) {
+    pending_ = std::make_shared<Batch>(thread_pool_);
+    // If every thread is busy, then the batch grows until one is free.
+    worker_cond_.notify_one();
+  }
+  std::shared_ptr<Batch> batch = pending_;
+  size_t offset = batch->paths.size();
+  batch->paths.insert(batch->paths.end(), paths.begin(), paths.end());
+
+  while (!batch->done) {
+    batch->done_cond.wait(lock);
+  }
+  lock.unlock();
+
+  return std::vector<Time>(batch->times.begin() + offset,
+                           batch->times.begin() + offset + paths.size());
+}
+
+StatBatcher::Time StatBatcher::GetLastModificationTime(const char* path) {
+  return GetLastModificationTimes(std::vector<const char*>(1, path))[0];
+}
+
+void StatBatcher::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (!ready_.empty()) {
+      std::shared_ptr<Batch> batch = ready_.front();
+      size_t chunk = batch->next_chunk++;
+      if (batch->next_chunk == batch->num_chunks) {
+        ready_.pop_front();
+      }
+
+      lock.unlock();
+      StatChunk(batch.get(), chunk);
+      lock.lock();
+
+      if (++batch->num_chunks_done == batch->num_chunks) {
+        batch->done = true;
+        batch->done_cond.notify_all();
+      }
+    } else if (pending_) {
+      // Stop the batch from taking on more paths, and plan it without
+      // holding up the fibers that start the next one.
+      std::shared_ptr<Batch> batch = std::move(pending_);
+      pending_.reset();
+
+      lock.unlock();
+      PlanBatch(batch.get());
+      lock.lock();
+
+      ready_.push_back(batch);
+      if (batch->num_chunks > 1) {
+        worker_cond_.notify_all();
+      }
+    } else if (quit_) {
+      return;
+    } else {
+      worker_cond_.wait(lock);
+    }
+  }
+}
+
+void StatBatcher::PlanBatch(Batch* batch) {
+  const std::vector<const char*>& paths = batch->paths;
+  std::vector<size_t> directory_lengths(paths.size());
+  batch->order.resize(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    directory_lengths[i] = DirectoryLength(paths[i]);
+    batch->order[i] = i;
+  }
+
+  // Order by directory first, and then by the full path, so that the paths
+  // of each directory are adjacent.
+  std::sort(batch->order.begin(), batch->order.end(),
+            [&paths, &directory_lengths](size_t a, size_t b) {
+    size_t length_a = directory_lengths[a];
+    size_t length_b = directory_lengths[b];
+    int result = memcmp(paths[a], paths[b], std::min(length_a, length_b));
+    if (result != 0) {
+      return result < 0;
+    }
+    if (length_a != length_b) {
+      return length_a < length_b;
+    }
+    return strcmp(paths[a], paths[b]) < 0;
+  });
+
+  batch->chunk_size = std::min(
+      kMaxChunkSize,
+      std::max(kMinChunkSize,
+               (paths.size() + num_threads_ - 1) / num_threads_));
+  batch->num_chunks =
+      (paths.size() + batch->chunk_size - 1) / batch->chunk_size;
+  batch->times.resize(paths.size());
+}
+
+void StatBatcher::StatChunk(Batch* batch, size_t chunk) {
+  size_t begin = chunk * batch->chunk_size;
+  size_t end = std::min(begin + batch->chunk_size, batch->order.size());
+
+  std::vector<const char*> paths;
+  paths.reserve(end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    paths.push_back(batch->paths[batch->order[i]]);
+  }
+  std::vector<Time> times(paths.size());
+  platform::GetLastModificationTimes(paths.data(), paths.size(), times.data());
+
+  for (size_t i = begin; i < end; ++i) {
+    batch->times[batch->order[i]] = times[i - begin];
+  }
+}
+
+}  // namespace respire
@@ -0,0 +1,70 @@
+#ifndef __RESPIRE_STAT_BATCHER_H__
+#define __RESPIRE_STAT_BATCHER_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ebbpp.h>
+
+#include "stdext/optional.h"
+
+namespace respire {
+
+// Looks up the modification times of files on behalf of fibers, on a set of
+// threads dedicated to it, so that a fiber waiting on the file system doesn't
+// hold up its thread pool thread, and so that many lookups can be in flight at
+// once, e.g. when checking a large tree of dependencies on a network file
+// system.
+//
+// Requests made while the threads are busy are collected into a single batch,
+// which is taken up as soon as a thread becomes free.  The batch's paths are
+// ordered so that paths in the same directory are adjacent, and then split
+// into chunks that the threads work through in parallel, looking up the files
+// of each directory relative to it.  Once the last chunk is done, all of the
+// fibers waiting on the batch are woken together.
+class StatBatcher {
+ public:
+  using Time = stdext::optional<std::chrono::system_clock::time_point>;
+
+  // |ebb_env| must outlive the batcher.
+  StatBatcher(ebb::Environment* ebb_env, int num_threads);
+  ~StatBatcher();
+
+  // Returns the last modification time of each of |paths|, or nothing for
+  // those that don't exist.  Only the calling fiber is suspended while the
+  // lookups are made.
+  std::vector<Time> GetLastModificationTimes(
+      const std::vector<const char*>& paths);
+  Time GetLastModificationTime(const char* path);
+
+ private:
+  struct Batch;
+
+  void WorkerLoop();
+  // Orders |batch|'s paths and splits them into chunks.
+  void PlanBatch(Batch* batch);
+  // Looks up the paths in the |chunk|th chunk of |batch|.
+  void StatChunk(Batch* batch, size_t chunk);
+
+  ebb::ThreadPool* thread_pool_;
+  const size_t num_threads_;
+
+  std::mutex mutex_;
+  std::condition_variable worker_cond_;
+  bool quit_;
+  // The batch that new requests join, or null if there are none waiting.
+  std::shared_ptr<Batch> pending_;
+  // Planned batches with chunks that no thread has claimed yet.
+  std::deque<std::shared_ptr<Batch>> ready_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_STAT_BATCHER_H__
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel_for.h"
+#include "platform/file_system.h"
+#include "stat_batcher.h"
+#include "stdext/file_system.h"
+
+using respire::StatBatcher;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+namespace {
+const size_t kFiberStackSize = 64 * 1024;
+
+// Creates |num_files| files spread over a few directories within |temp_dir|,
+// and returns their paths, along with paths of files that don't exist.
+std::vector<std::string> MakeFiles(const TemporaryDirectory& temp_dir,
+                                   size_t num_files) {
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < num_files; ++i) {
+    std::string directory_name = "dir" + std::to_string(i % 3);
+    Path directory =
+        Join(temp_dir.path(), PathStrRef(directory_name.c_str()));
+    platform::MakeDirectories(directory.c_str());
+    Path file =
+        Join(directory, PathStrRef(("file" + std::to_string(i)).c_str()));
+    if (i % 4 != 0) {
+      std::ofstream out(file.c_str());
+      out << i;
+    }
+    paths.push_back(file.str());
+  }
+  return paths;
+}
+}  // namespace
+
+TEST(StatBatcherTest, ReportsModificationTimes) {
+  ebb::Environment env(1, kFiberStackSize);
+  StatBatcher stat_batcher(&env, 4);
+
+  TemporaryDirectory temp_dir;
+  std::vector<std::string> paths = MakeFiles(temp_dir, 100);
+  std::vector<const char*> path_strings;
+  for (const auto& path : paths) {
+    path_strings.push_back(path.c_str());
+  }
+
+  std::vector<StatBatcher::Time> times =
+      stat_batcher.GetLastModificationTimes(path_strings);
+  ASSERT_EQ(paths.size(), times.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    EXPECT_TRUE(platform::GetLastModificationTime(paths[i].c_str()) == times[i])
+        << paths[i];
+    EXPECT_EQ(i % 4 != 0, times[i].has_value());
+  }
+
+  EXPECT_TRUE(stat_batcher.GetLastModificationTimes({}).empty());
+  EXPECT_TRUE(stat_batcher.GetLastModificationTime(temp_dir.path().c_str()));
+}
+
+TEST(StatBatcherTest, AnswersConcurrentRequestsFromFibersAndThreads) {
+  ebb::Environment env(4, kFiberStackSize);
+  StatBatcher stat_batcher(&env, 2);
+
+  TemporaryDirectory temp_dir;
+  std::vector<std::string> paths = MakeFiles(temp_dir, 200);
+
+  // Requests from fibers, each of which is suspended while waiting, are
+  // interleaved with requests from threads outside of the thread pool.
+  std::vector<StatBatcher::Time> fiber_times(paths.size());
+  std::vector<StatBatcher::Time> thread_times(paths.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&stat_batcher, &paths, &thread_times, i]() {
+      for (size_t j = i; j < paths.size(); j += 4) {
+        thread_times[j] =
+            stat_batcher.GetLastModificationTime(paths[j].c_str());
+      }
+    });
+  }
+  ebb::ParallelFor(
+      &env, stdext::make_span(fiber_times.data(), fiber_times.size()), 1,
+      [&stat_batcher, &paths](size_t index, StatBatcher::Time& time) {
+    time = stat_batcher.GetLastModificationTime(paths[index].c_str());
+  });
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    StatBatcher::Time expected =
+        platform::GetLastModificationTime(paths[i].c_str());
+    EXPECT_TRUE(expected == fiber_times[i]) << paths[i];
+    EXPECT_TRUE(expected == thread_times[i]) << paths[i];
+  }
+}
@@ -1,48 +1,334 @@
 #include "system_command_node.h"
 
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <sstream>
 
+#include "platform/file_system.h"
 #include "platform/subprocess.h"
 
 namespace respire {
 
 namespace {
+// Writes captured output to its log file, but only if there is something
+// worth looking at, so that the common case of a quiet, successful command
+// doesn't create any files.  Otherwise any log left over from a previous run
+// is removed so that it isn't mistaken for this run's output.
+void WriteOutputLog(const ebb::lib::JSONPathStringView& log_file,
+                    const std::string& output, bool failed) {
+  std::string path = log_file.AsString();
+  if (output.empty() && !failed) {
+    std::remove(path.c_str());
+    return;
+  }
+  std::ofstream out(path.c_str(), std::ios::out | std::ios::binary);
+  out.write(output.data(), output.size());
+}
+
+// A worker's output always comes back to us in its response, so send it
+// wherever the command's output would have gone had it been run as an ordinary
+// process.
+void RedirectWorkerOutput(
+    const stdext::optional<ebb::lib::JSONPathStringView>& redirect_file,
+    bool captured, std::string* output) {
+  if (redirect_file) {
+    std::ofstream out(redirect_file->AsString().c_str(),
+                      std::ios::out | std::ios::binary);
+    out.write(output->data(), output->size());
+    output->clear();
+  } else if (!captured) {
+    output->clear();
+  }
+}
+
+// Tries to run the command as a request to a persistent worker, returning a
+// disengaged optional if it should be run as an ordinary process instead.
+// Workers are fed requests through their stdin, so commands that read from
+// stdin can't be run in one, and neither can commands with a timeout, since a
+// worker can't be interrupted without losing it.
+stdext::optional<platform::SystemCommandResult> ExecuteInWorker(
+    Environment* env, const SystemCommandNodeParams& params,
+    const platform::SystemCommandParams& command_params) {
+  if (!params.worker || !env->worker_pool() || params.stdin_file ||
+      params.timeout) {
+    return stdext::nullopt;
+  }
+
+  // The registry parser guarantees that the worker is a prefix of argv.
+  const std::vector<std::string>& argv = *command_params.argv;
+  auto worker_end = argv.begin() + params.worker->size();
+  stdext::optional<platform::SystemCommandResult> result =
+      env->worker_pool()->Execute(
+          std::vector<std::string>(argv.begin(), worker_end),
+          std::vector<std::string>(worker_end, argv.end()));
+  if (!result) {
+    return stdext::nullopt;
+  }
+
+  RedirectWorkerOutput(params.stdout_file, command_params.capture_stdout,
+                       &result->stdout_output);
+  RedirectWorkerOutput(params.stderr_file, command_params.capture_stderr,
+                       &result->stderr_output);
+  return result;
+}
+
+// Tries to run the command as part of a batch, returning a disengaged optional
+// if it should be run on its own instead.  The same restrictions apply as for
+// workers, and commands that can use a worker do so instead, since that saves
+// starting a process at all.
+stdext::optional<platform::SystemCommandResult> ExecuteInBatch(
+    Environment* env, const SystemCommandNodeParams& params,
+    const platform::SystemCommandParams& command_params) {
+  if (!params.batch || !env->batch_runner() || params.stdin_file ||
+      params.timeout || (params.worker && env->worker_pool())) {
+    return stdext::nullopt;
+  }
+
+  std::vector<std::string> inputs;
+  inputs.reserve(params.inputs.size());
+  for (const auto& input : params.inputs) {
+    inputs.push_back(input.AsString());
+  }
+  std::vector<std::string> outputs;
+  outputs.reserve(params.outputs.size());
+  for (const auto& output : params.outputs) {
+    outputs.push_back(output.AsString());
+  }
+
+  // The registry parser guarantees that the batch runner is a prefix of argv.
+  const std::vector<std::string>& argv = *command_params.argv;
+  auto batch_end = argv.begin() + params.batch->size();
+  stdext::optional<platform::SystemCommandResult> result =
+      env->batch_runner()->Execute(
+          std::vector<std::string>(argv.begin(), batch_end), inputs, outputs,
+          std::vector<std::string>(batch_end, argv.end()));
+  if (!result) {
+    return stdext::nullopt;
+  }
+
+  RedirectWorkerOutput(params.stdout_file, command_params.capture_stdout,
+                       &result->stdout_output);
+  RedirectWorkerOutput(params.stderr_file, command_params.capture_stderr,
+                       &result->stderr_output);
+  return result;
+}
+
+bool WriteStampFile(const ebb::lib::JSONPathStringView& path) {
+  FILE* file = std::fopen(path.AsString().c_str(), "wb");
+  return file && std::fclose(file) == 0;
+}
+
+bool MakeParentDirectories(const std::string& path) {
+  size_t last_separator = path.rfind(platform::kPathSeparator);
+  if (last_separator == std::string::npos || last_separator == 0) {
+    return true;
+  }
+  return platform::MakeDirectories(path.substr(0, last_separator).c_str());
+}
+
+bool WriteResponseFile(const SystemCommandNodeParams& params) {
+  std::string path = params.rspfile->AsString();
+  if (!MakeParentDirectories(path)) {
+    return false;
+  }
+  std::string content = params.rspfile_content->AsString();
+  std::ofstream out(path.c_str(), std::ios::out | std::ios::binary);
+  out.write(content.data(), content.size());
+  out.close();
+  return !out.fail();
+}
+
+// Performs the action for the node directly, on the calling fiber.  These
+// are all cheap enough that it's not worth holding a job slot for them.
+bool PerformNativeAction(const SystemCommandNodeParams& params, size_t index) {
+  std::string output = params.outputs[index].AsString();
+  switch (*params.native_action) {
+    case NativeAction::kCopy:
+      return MakeParentDirectories(output) &&
+             platform::CopyRegularFile(
+                 params.inputs[index].AsString().c_str(), output.c_str());
+    case NativeAction::kTouch:
+      return MakeParentDirectories(output) &&
+             platform::TouchFile(output.c_str());
+    case NativeAction::kMkdir:
+      // Touch the directory too, since it may already exist and still needs
+      // to appear up to date.
+      return platform::MakeDirectories(output.c_str()) &&
+             platform::TouchFile(output.c_str());
+    case NativeAction::kStamp:
+      return MakeParentDirectories(output) &&
+             WriteStampFile(params.outputs[index]);
+  }
+  assert(false);
+  return false;
+}
+
+stdext::optional<Error> ExecuteNativeAction(
+    ActivityLog::FileProcessNodeLog* activity_log_entry) {
+  const SystemCommandNodeParams& params = activity_log_entry->params();
+  for (size_t i = 0; i < params.outputs.size(); ++i) {
+    if (!PerformNativeAction(params, i)) {
+      return Error("Could not " + params.command.AsString() + " " +
+                   params.outputs[i].AsString() + ".\n");
+    }
+  }
+  return stdext::nullopt;
+}
+
 stdext::optional<Error> ExecuteSystemCommand(
-    Environment* env, const ebb::lib::JSONStringView* command,
-    const stdext::optional<ebb::lib::JSONPathStringView>* stdout_file,
-    const stdext::optional<ebb::lib::JSONPathStringView>* stderr_file,
-    const stdext::optional<ebb::lib::JSONPathStringView>* stdin_file) {
-  int error_code = env->system_command_function()(
-      command->AsString().c_str(),
-      *stdout_file ? (*stdout_file)->AsPath() :
-          stdext::optional<stdext::file_system::Path>(),
-      *stderr_file ? (*stderr_file)->AsPath() :
-          stdext::optional<stdext::file_system::Path>(),
-      *stdin_file ? (*stdin_file)->AsPath() :
-          stdext::optional<stdext::file_system::Path>());
-  if (error_code != 0) {
+    Environment* env, ebb::FiberSemaphore* pool,
+    ActivityLog::FileProcessNodeLog* activity_log_entry) {
+  const SystemCommandNodeParams* params = &activity_log_entry->params();
+  platform::SystemCommandParams command_params(params->command.AsString());
+  if (params->argv) {
+    command_params.argv.emplace();
+    command_params.argv->reserve(params->argv->size());
+    for (const auto& arg : *params->argv) {
+      command_params.argv->push_back(arg.AsString());
+    }
+  }
+  if (params->stdout_file) {
+    command_params.stdout_file = params->stdout_file->AsPath();
+  }
+  if (params->stderr_file) {
+    command_params.stderr_file = params->stderr_file->AsPath();
+  }
+  if (params->stdin_file) {
+    command_params.stdin_file = params->stdin_file->AsPath();
+  }
+  command_params.capture_stdout =
+      !params->stdout_file && params->stdout_log_file;
+  command_params.capture_stderr =
+      !params->stderr_file && params->stderr_log_file;
+  command_params.timeout = params->timeout;
+
+  // Wait for our pool before taking a job slot, so that commands queued up on
+  // a busy pool don't hold back commands in other pools.
+  ebb::FiberSemaphore::ScopedAcquire pool_slot(pool);
+  if (params->rspfile && !WriteResponseFile(*params)) {
+    return Error("Could not write response file " +
+                 params->rspfile->AsString() + ".\n");
+  }
+  // Batched commands join their batch before taking a job slot, since the
+  // whole batch shares a single one.
+  auto start_time = std::chrono::steady_clock::now();
+  stdext::optional<platform::SystemCommandResult> batch_result =
+      ExecuteInBatch(env, *params, command_params);
+  platform::SystemCommandResult result;
+  if (batch_result) {
+    result = std::move(*batch_result);
+  } else {
+    ebb::FiberSemaphore::ScopedAcquire job_slot(env->job_semaphore());
+    ebb::lib::JobserverClient::ScopedToken jobserver_token(
+        env->jobserver_client());
+    LaunchThrottle::ScopedLaunch launch(env->launch_throttle());
+    start_time = std::chrono::steady_clock::now();
+    stdext::optional<platform::SystemCommandResult> worker_result =
+        ExecuteInWorker(env, *params, command_params);
+    result = worker_result ? std::move(*worker_result)
+                           : env->system_command_function()(command_params);
+  }
+  activity_log_entry->RecordResourceUsage(
+      result.resource_usage,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_time));
+
+  bool failed = result.timed_out || result.exit_code != 0;
+  if (params->rspfile && !failed) {
+    std::remove(params->rspfile->AsString().c_str());
+  }
+  if (command_params.capture_stdout) {
+    WriteOutputLog(*params->stdout_log_file, result.stdout_output, failed);
+  }
+  if (command_params.capture_stderr) {
+    WriteOutputLog(*params->stderr_log_file, result.stderr_output, failed);
+  }
+  activity_log_entry->RecordCommandOutput(
+      std::move(result.stdout_output), std::move(result.stderr_output));
+  if (result.timed_out) {
     std::ostringstream error_message;
-    error_message << "Exit code " << error_code << "." << std::endl;
+    error_message << "Timed out after "
+                  << std::chrono::duration<double>(*params->timeout).count()
+                  << " seconds." << std::endl;
     return Error(error_message.str());
-  } else {
-    return stdext::nullopt;
+  } else if (result.exit_code != 0) {
+    std::ostringstream error_message;
+    error_message << "Exit code " << result.exit_code << "." << std::endl;
+    return Error(error_message.str());
+  }
+
+  for (const auto& stamp_output : params->stamp_outputs) {
+    if (!WriteStampFile(stamp_output)) {
+      return Error("Could not write stamp file " + stamp_output.AsString() +
+                   ".\n");
+    }
+  }
+  return stdext::nullopt;
+}
+
+// Hashes everything about the command, other than the contents of its inputs,
+// that determines what it writes to its outputs.
+uint64_t CommandHash(const SystemCommandNodeParams& params) {
+  std::string description = params.command.AsString();
+  auto append = [&description](const char* name, const std::string& value) {
+    description.push_back('\0');
+    description += name;
+    description += value;
+  };
+  if (params.argv) {
+    for (const auto& arg : *params.argv) {
+      append("argv=", arg.AsString());
+    }
+  }
+  if (params.stdout_file) {
+    append("stdout=", params.stdout_file->AsString());
+  }
+  if (params.stderr_file) {
+    append("stderr=", params.stderr_file->AsString());
+  }
+  if (params.stdin_file) {
+    append("stdin=", params.stdin_file->AsString());
+  }
+  if (params.rspfile_content) {
+    append("rspfile_content=", params.rspfile_content->AsString());
+  }
+  if (params.native_action) {
+    // Native actions don't name their inputs in their command.
+    for (const auto& input : params.inputs) {
+      append("in=", input.AsString());
+    }
+  }
+  return BuildLog::HashCommand(description);
+}
+
+std::function<stdext::optional<Error>()> MakeCommand(
+    Environment* env, ebb::FiberSemaphore* pool,
+    ActivityLog::FileProcessNodeLog* activity_log_entry) {
+  if (activity_log_entry->params().native_action) {
+    return std::bind(&ExecuteNativeAction, activity_log_entry);
   }
+  return std::bind(&ExecuteSystemCommand, env, pool, activity_log_entry);
 }
 }  // namespace
 
 SystemCommandNode::SystemCommandNode(
     Environment* env, std::vector<FileInfoNodeOutput>&& inputs,
     SystemCommandNodeParams&& params,
-    FileProcessNode::GetDepsFunction get_deps_function)
+    FileProcessNode::GetDepsFunction get_deps_function,
+    ebb::FiberSemaphore* pool)
     : activity_log_entry_(env->activity_log(), std::move(params)),
       file_process_node_(
           env, std::move(inputs), &activity_log_entry_.params().outputs,
           &activity_log_entry_.params().soft_outputs,
-          std::bind(&ExecuteSystemCommand, env,
-              &activity_log_entry_.params().command,
-              &activity_log_entry_.params().stdout_file,
-              &activity_log_entry_.params().stderr_file,
-              &activity_log_entry_.params().stdin_file),
-          get_deps_function, &activity_log_entry_) {}
+          MakeCommand(env, pool, &activity_log_entry_),
+          get_deps_function, &activity_log_entry_,
+          CommandHash(activity_log_entry_.params()),
+          activity_log_entry_.params().early_cutoff,
+          activity_log_entry_.params().cacheable, this,
+          activity_log_entry_.params().deps_file
+              ? &*activity_log_entry_.params().deps_file
+              : nullptr) {}
 
 }  // respire
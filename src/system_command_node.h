@@ -22,7 +22,8 @@ class SystemCommandNode : public FileInfoNode {
       Environment* env, std::vector<FileInfoNodeOutput>&& inputs,
       SystemCommandNodeParams&& params,
       FileProcessNode::GetDepsFunction get_deps_function =
-          FileProcessNode::GetDepsFunction());
+          FileProcessNode::GetDepsFunction(),
+      ebb::FiberSemaphore* pool = nullptr);
 
   FileInfoNode::FuturePtr GetFileInfo(bool dry_run = false) override {
     return file_process_node_.GetFileInfo(dry_run);
@@ -33,6 +34,8 @@ class SystemCommandNode : public FileInfoNode {
     file_process_node_.GetOrderedOutputPaths(paths);
   }
 
+  void Invalidate() override { file_process_node_.Invalidate(); }
+
   const SystemCommandNodeParams& params() const {
     return activity_log_entry_.params();
   }
@@ -1,6 +1,7 @@
 #ifndef __RESPIRE_SYSTEM_COMMAND_NODE_PARAMS_H__
 #define __RESPIRE_SYSTEM_COMMAND_NODE_PARAMS_H__
 
+#include <chrono>
 #include <vector>
 
 #include "lib/json_string_view.h"
@@ -11,29 +12,39 @@ namespace respire {
 // This is defined in a separate header file from SystemCommandNode in order
 // to get around a cyclic dependency problem.
 
+// File operations that are simple enough for respire to perform itself,
+// in-process, rather than spawning a command for them.
+enum class NativeAction {
+  // Copies each input to the output at the same index.
+  kCopy,
+  // Updates the modification time of each output, creating it if necessary.
+  kTouch,
+  // Creates each output as a directory, along with any missing parents.
+  kMkdir,
+  // Writes each output as an empty file.
+  kStamp,
+};
+
+// The format of a system command's deps file.
+enum class DepsFormat {
+  // One path per line.
+  kList,
+  // A Makefile rule, as written by e.g. "gcc -MD".  Only the prerequisites
+  // are read, the targets are ignored.
+  kMake,
+};
+
+// Only the fields that every command needs are passed to the constructor.
+// The rest are optional, and are set by name after construction.
 struct SystemCommandNodeParams {
   SystemCommandNodeParams(SystemCommandNodeParams&& rhs) = default;
   SystemCommandNodeParams(const SystemCommandNodeParams& rhs) = default;
   SystemCommandNodeParams(
       ebb::lib::JSONStringView command,
       std::vector<ebb::lib::JSONPathStringView>&& inputs,
-      std::vector<ebb::lib::JSONPathStringView>&& outputs,
-      std::vector<ebb::lib::JSONPathStringView>&& soft_outputs =
-          std::vector<ebb::lib::JSONPathStringView>(),
-      stdext::optional<ebb::lib::JSONPathStringView> deps_file
-          = stdext::nullopt,
-      stdext::optional<ebb::lib::JSONPathStringView> stdout_file
-          = stdext::nullopt,
-      stdext::optional<ebb::lib::JSONPathStringView> stderr_file
-          = stdext::nullopt,
-      stdext::optional<ebb::lib::JSONPathStringView> stdin_file
-          = stdext::nullopt)
+      std::vector<ebb::lib::JSONPathStringView>&& outputs)
       : command(command), inputs(std::move(inputs)),
-        outputs(std::move(outputs)), soft_outputs(std::move(soft_outputs)),
-        deps_file(deps_file),
-        stdout_file(stdout_file),
-        stderr_file(stderr_file),
-        stdin_file(stdin_file)  {}
+        outputs(std::move(outputs)) {}
   bool operator==(const SystemCommandNodeParams& rhs) const {
     return command == rhs.command &&
            inputs == rhs.inputs &&
@@ -42,7 +53,21 @@ struct SystemCommandNodeParams {
            deps_file == rhs.deps_file &&
            stdout_file == rhs.stdout_file &&
            stderr_file == rhs.stderr_file &&
-           stdin_file == rhs.stdin_file;
+           stdin_file == rhs.stdin_file &&
+           argv == rhs.argv &&
+           pool == rhs.pool &&
+           timeout == rhs.timeout &&
+           stdout_log_file == rhs.stdout_log_file &&
+           stderr_log_file == rhs.stderr_log_file &&
+           worker == rhs.worker &&
+           stamp_outputs == rhs.stamp_outputs &&
+           native_action == rhs.native_action &&
+           deps_format == rhs.deps_format &&
+           rspfile == rhs.rspfile &&
+           rspfile_content == rhs.rspfile_content &&
+           batch == rhs.batch &&
+           early_cutoff == rhs.early_cutoff &&
+           cacheable == rhs.cacheable;
   }
 
   ebb::lib::JSONStringView command;
@@ -53,6 +78,57 @@ struct SystemCommandNodeParams {
   stdext::optional<ebb::lib::JSONPathStringView> stdout_file;
   stdext::optional<ebb::lib::JSONPathStringView> stderr_file;
   stdext::optional<ebb::lib::JSONPathStringView> stdin_file;
+  // If present, the command is executed directly with these arguments instead
+  // of passing |command| through the shell.
+  stdext::optional<std::vector<ebb::lib::JSONStringView>> argv;
+  // If present, the name of the pool that the command must acquire a slot
+  // from before running.
+  stdext::optional<ebb::lib::JSONStringView> pool;
+  // If present, the command is killed and treated as having failed if it
+  // runs for longer than this.
+  stdext::optional<std::chrono::milliseconds> timeout;
+  // If present (and the corresponding |stdout_file| or |stderr_file| is not),
+  // the stream is captured in memory and only written to this file if it is
+  // non-empty or if the command fails.  Otherwise, any existing file is
+  // removed.
+  stdext::optional<ebb::lib::JSONPathStringView> stdout_log_file;
+  stdext::optional<ebb::lib::JSONPathStringView> stderr_log_file;
+  // If present, the command line of a tool that can run this command as a
+  // persistent worker (see WorkerPool).  It is always a prefix of |argv|, and
+  // the rest of |argv| is sent to the worker as the request.  The command is
+  // still run as an ordinary process if no worker is available.
+  stdext::optional<std::vector<ebb::lib::JSONStringView>> worker;
+  // Outputs, also listed in |outputs|, that are written as empty files once
+  // the command succeeds.  This is for commands that don't produce any output
+  // of their own, e.g. tests, so that they aren't rerun until their inputs
+  // change.
+  std::vector<ebb::lib::JSONPathStringView> stamp_outputs;
+  // If present, respire performs this action itself instead of running
+  // |command|, which is then just the action's name.
+  stdext::optional<NativeAction> native_action;
+  // How to read |deps_file|.
+  DepsFormat deps_format = DepsFormat::kList;
+  // If present, |rspfile_content| is written to this file just before the
+  // command runs, and the file is removed again once the command succeeds.
+  // This lets commands with very long argument lists (e.g. links) pass them
+  // to the tool as "@rspfile" instead of on the command line.  The file is
+  // left behind if the command fails, to help with debugging it.
+  stdext::optional<ebb::lib::JSONPathStringView> rspfile;
+  stdext::optional<ebb::lib::JSONStringView> rspfile_content;
+  // If present, the command line of a tool that can run this command as part
+  // of a batch of commands (see BatchRunner).  Like |worker|, it is always a
+  // prefix of |argv|, and the rest of |argv| is the command's entry in the
+  // batch.  The command is still run as an ordinary process if it can't be
+  // batched.
+  stdext::optional<std::vector<ebb::lib::JSONStringView>> batch;
+  // If set, and the command's outputs are byte-for-byte the same as the last
+  // time it ran, they are reported to dependents as not having changed, so
+  // that they aren't rebuilt (see FileProcessNode).
+  bool early_cutoff = false;
+  // If not set, the command's outputs are never stored in or restored from
+  // the action cache, e.g. because it also writes files that it doesn't list
+  // as outputs.
+  bool cacheable = true;
 };
 
 }  // namespace respire
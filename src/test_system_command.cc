@@ -219,12 +219,14 @@ void WaitForFilesystemTimeResolution() {
   std::this_thread::sleep_for(std::chrono::milliseconds(20));
 }
 
-int TestSystemCommand(
-    const char* command,
-    const stdext::optional<stdext::file_system::Path>& stdout_file,
-    const stdext::optional<stdext::file_system::Path>& stderr_file,
-    const stdext::optional<stdext::file_system::Path>& stdin_file) {
-  StringVector tokens(Split(command));
+int TestSystemCommand(const platform::SystemCommandParams& params) {
+  const stdext::optional<stdext::file_system::Path>& stdout_file =
+      params.stdout_file;
+  const stdext::optional<stdext::file_system::Path>& stderr_file =
+      params.stderr_file;
+  const stdext::optional<stdext::file_system::Path>& stdin_file =
+      params.stdin_file;
+  StringVector tokens(Split(params.command));
 
   int ret = 1;
 
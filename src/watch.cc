@@ -0,0 +1,179 @@
+#include "watch.h"
+
+#include "locked_node_storage.h"
+#include "registry_node.h"
+
+namespace respire {
+
+struct Watcher::Graph {
+  Graph(Environment* env, ebb::lib::JSONPathStringView initial_registry_path)
+      : initial_file_exists_node(env, initial_registry_path),
+        initial_registry_node(
+            env, FileInfoNodeOutput(&initial_file_exists_node, 0),
+            initial_registry_path, &locked_node_storage) {}
+
+  // As in BuildTargets(), the order of these matters for their destruction.
+  FileExistsNode initial_file_exists_node;
+  LockedNodeStorage locked_node_storage;
+  RegistryNode initial_registry_node;
+};
+
+// static
+std::unique_ptr<Watcher> Watcher::Create(
+    Environment* env,
+    stdext::file_system::PathStrRef initial_registry_path) {
+  assert(env->dependents());
+  std::unique_ptr<platform::FileWatcher> file_watcher =
+      platform::FileWatcher::Create();
+  if (!file_watcher) {
+    return nullptr;
+  }
+  return std::unique_ptr<Watcher>(new Watcher(
+      env, initial_registry_path, std::move(file_watcher)));
+}
+
+Watcher::Watcher(Environment* env,
+                 stdext::file_system::PathStrRef initial_registry_path,
+                 std::unique_ptr<platform::FileWatcher> file_watcher)
+    : env_(env),
+      initial_registry_path_(
+          ebb::lib::ToJSON(initial_registry_path.c_str())),
+      file_watcher_(std::move(file_watcher)), needs_reload_(true),
+      num_nodes_watched_(0) {}
+
+Watcher::~Watcher() {}
+
+OptionalError Watcher::Build() {
+  OptionalError result = needs_reload_ ? LoadAndBuild() : RebuildTargets();
+  WatchNewFiles();
+  return result;
+}
+
+OptionalError Watcher::LoadAndBuild() {
+  // Nothing may refer to the old graph's nodes once it's gone.
+  watched_files_.clear();
+  num_nodes_watched_ = 0;
+  env_->dependents()->Clear();
+  graph_.reset();
+
+  graph_.reset(new Graph(
+      env_, ebb::lib::JSONPathStringView(ebb::lib::JSONStringView(
+                initial_registry_path_.data(),
+                initial_registry_path_.size()))));
+  Watch(&graph_->initial_file_exists_node);
+
+  OptionalError result =
+      *graph_->initial_registry_node.PopulateLockedNodeStorage(nullptr)
+          ->GetValue();
+  // If some registry's processing was cut short, e.g. because an included
+  // registry failed to build, then the graph is missing whatever came after,
+  // so it's loaded again next time.  Failures that leave it whole are retried
+  // by rebuilding its targets instead.
+  needs_reload_ =
+      !LockedNodeStorage::Access(&graph_->locked_node_storage).complete();
+  return result;
+}
+
+OptionalError Watcher::RebuildTargets() {
+  std::vector<FileInfoNode*> targets;
+  {
+    LockedNodeStorage::Access access(&graph_->locked_node_storage);
+    targets = access.build_targets();
+  }
+
+  // Only the nodes that were invalidated since the last build compute their
+  // results again; the rest return the results that they have cached.
+  std::vector<FileInfoNode::FuturePtr> futures;
+  futures.reserve(targets.size());
+  for (FileInfoNode* target : targets) {
+    futures.emplace_back(target->GetFileInfo());
+  }
+
+  OptionalError result;
+  for (auto& future : futures) {
+    const FileOutput* output = future->GetValue();
+    if (output->error() && !result) {
+      result.emplace(*output->error());
+    }
+  }
+  return result;
+}
+
+void Watcher::WatchNewFiles() {
+  LockedNodeStorage::Access access(&graph_->locked_node_storage);
+  const FileInfoNodeVector& nodes = access.file_info_nodes();
+  for (; num_nodes_watched_ < nodes.size(); ++num_nodes_watched_) {
+    FileInfoNode* node = nodes[num_nodes_watched_].get();
+    if (access.IsFileExistsNode(node)) {
+      Watch(static_cast<FileExistsNode*>(node));
+    }
+  }
+}
+
+void Watcher::Watch(FileExistsNode* node) {
+  std::string path = node->path().AsString();
+  size_t separator = path.rfind('/');
+  std::string directory;
+  std::string name = path;
+  if (separator != std::string::npos) {
+    // Keep the separator for files in the root directory.
+    directory = path.substr(0, separator == 0 ? 1 : separator);
+    name = path.substr(separator + 1);
+  }
+
+  if (watched_directories_.insert(directory).second) {
+    // Files in directories that can't be watched, e.g. because they don't
+    // exist yet, are still recorded in case the directory is watched through
+    // some other path later.
+    file_watcher_->AddDirectory(directory);
+  }
+
+  // This must match how the file watcher reports paths.
+  std::string watched_path =
+      directory.empty() ? name : directory + "/" + name;
+  watched_files_[watched_path].push_back(node);
+}
+
+void Watcher::WaitForChanges(std::chrono::milliseconds quiet_period) {
+  Dependents* dependents = env_->dependents();
+  while (true) {
+    platform::FileWatcher::Changes changes =
+        file_watcher_->WaitForChanges(quiet_period);
+    if (changes.overflowed) {
+      // Anything may have changed, so start over.
+      needs_reload_ = true;
+      return;
+    }
+
+    std::vector<FileInfoNode*> changed_nodes;
+    for (const auto& path : changes.paths) {
+      auto found = watched_files_.find(path);
+      if (found != watched_files_.end()) {
+        changed_nodes.insert(
+            changed_nodes.end(), found->second.begin(), found->second.end());
+      }
+    }
+    if (changed_nodes.empty()) {
+      // E.g. outputs being written, or files that the build doesn't read.
+      continue;
+    }
+
+    Dependents::Invalidation invalidation =
+        dependents->Invalidate(changed_nodes);
+    if (invalidation.needs_reload || needs_reload_) {
+      needs_reload_ = true;
+      return;
+    }
+    if (invalidation.num_dependents > 0) {
+      // Give anything that failed last time another chance too, since the
+      // failure may have been due to something that we can't watch.
+      dependents->InvalidateFailures();
+      return;
+    }
+    // Otherwise the files changed aren't read by any node that we've built,
+    // e.g. they're deps files that are only read once their node's outputs
+    // exist.
+  }
+}
+
+}  // namespace respire
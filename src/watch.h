@@ -0,0 +1,83 @@
+#ifndef __RESPIRE_WATCH_H__
+#define __RESPIRE_WATCH_H__
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "environment.h"
+#include "error.h"
+#include "file_exists_node.h"
+#include "platform/file_watcher.h"
+#include "stdext/file_system.h"
+
+namespace respire {
+
+// Builds the targets of a registry over and over again, keeping the graph of
+// nodes loaded in between builds and watching the directories of the files
+// that it reads.  When some of those files change, only the nodes that depend
+// on them are invalidated, so that the next build visits just those, rather
+// than parsing the registries and checking every file again.  If a registry
+// itself is affected, then the graph is discarded and loaded from scratch.
+//
+// Outputs that are modified or removed by something other than the build are
+// not noticed until one of their inputs changes, and neither are files in
+// directories that didn't exist when the files were first referenced.
+class Watcher {
+ public:
+  // |env| must have been created with Options::record_dependents set.
+  // Returns null if changes to files can't be watched on this platform.
+  static std::unique_ptr<Watcher> Create(
+      Environment* env,
+      stdext::file_system::PathStrRef initial_registry_path);
+  ~Watcher();
+
+  // Brings the registry's targets up to date, loading the graph first if
+  // this is the first build or if it has since become out of date.
+  OptionalError Build();
+
+  // Blocks until some files that the last build read have changed in a way
+  // that affects its targets, and invalidates the nodes affected, ready for
+  // the next call to Build().  Changes are collected until none have been seen
+  // for |quiet_period|.
+  void WaitForChanges(std::chrono::milliseconds quiet_period);
+
+ private:
+  struct Graph;
+
+  Watcher(Environment* env,
+          stdext::file_system::PathStrRef initial_registry_path,
+          std::unique_ptr<platform::FileWatcher> file_watcher);
+
+  OptionalError LoadAndBuild();
+  OptionalError RebuildTargets();
+  // Starts watching the files of FileExistsNodes created since this was last
+  // called.
+  void WatchNewFiles();
+  void Watch(FileExistsNode* node);
+
+  Environment* env_;
+  // The initial registry path in the JSON format that the nodes expect.
+  const std::string initial_registry_path_;
+  std::unique_ptr<platform::FileWatcher> file_watcher_;
+
+  std::unique_ptr<Graph> graph_;
+  // True if |graph_| no longer describes the registries, and so must be
+  // loaded again.
+  bool needs_reload_;
+
+  // The number of the graph's nodes that have been checked for files to
+  // watch so far.
+  size_t num_nodes_watched_;
+  // The nodes for each file being watched, keyed by the path that the file
+  // watcher reports changes to it under.
+  std::unordered_map<std::string, std::vector<FileExistsNode*>> watched_files_;
+  std::unordered_set<std::string> watched_directories_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_WATCH_H__
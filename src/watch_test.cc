@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "environment.h"
+#include "stdext/file_system.h"
+#include "test_system_command.h"
+#include "watch.h"
+
+using respire::Environment;
+using respire::TestSystemCommand;
+using respire::WaitForFilesystemTimeResolution;
+using respire::Watcher;
+using stdext::file_system::Join;
+using stdext::file_system::Path;
+using stdext::file_system::PathStrRef;
+using stdext::file_system::TemporaryDirectory;
+
+namespace {
+const std::chrono::milliseconds kQuietPeriod(50);
+
+void WriteToFile(const Path& path, const std::string& contents) {
+  std::ofstream out(path.c_str());
+  out << contents;
+  out.close();
+  WaitForFilesystemTimeResolution();
+}
+
+std::string ReadFile(const Path& path) {
+  std::ifstream in(path.c_str());
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+// Returns a system command directive, as it would appear in a registry.
+std::string SystemCommand(const std::string& command,
+                          const std::vector<Path>& inputs, const Path& output,
+                          const Path* deps_file = nullptr) {
+  std::ostringstream oss;
+  oss << "{\"sc\": [{\"cmd\": \"" << command << "\", \"in\": [";
+  for (const auto& input : inputs) {
+    oss << "\"" << input.str() << "\",";
+  }
+  oss << "], \"out\": [\"" << output.str() << "\"],";
+  if (deps_file) {
+    oss << "\"deps\": \"" << deps_file->str() << "\",";
+  }
+  oss << "}]}";
+  return oss.str();
+}
+
+std::string BuildDirective(const std::vector<Path>& targets) {
+  std::ostringstream oss;
+  oss << "{\"build\": [";
+  for (const auto& target : targets) {
+    oss << "\"" << target.str() << "\",";
+  }
+  oss << "]}";
+  return oss.str();
+}
+
+class WatcherTest : public ::testing::Test {
+ protected:
+  WatcherTest()
+      : registry_file_(Join(temp_dir_.path(), PathStrRef("initial.respire"))),
+        env_(MakeOptions(&commands_)) {}
+
+  static Environment::Options MakeOptions(std::vector<std::string>* commands) {
+    Environment::Options options;
+    options.record_dependents = true;
+    options.system_command_function =
+        [commands](const platform::SystemCommandParams& params) {
+      commands->push_back(params.command);
+      return TestSystemCommand(params);
+    };
+    return options;
+  }
+
+  Path PathTo(const char* name) const {
+    return Join(temp_dir_.path(), PathStrRef(name));
+  }
+
+  std::vector<std::string> TakeCommands() {
+    std::vector<std::string> commands;
+    commands.swap(commands_);
+    return commands;
+  }
+
+  TemporaryDirectory temp_dir_;
+  Path registry_file_;
+  std::vector<std::string> commands_;
+  Environment env_;
+};
+}  // namespace
+
+TEST_F(WatcherTest, OnlyDependentsOfChangedFilesAreRebuilt) {
+  Path in1 = PathTo("in1.txt");
+  Path in2 = PathTo("in2.txt");
+  Path out1 = PathTo("out1.txt");
+  Path out2 = PathTo("out2.txt");
+  std::string command1 = "cat " + out1.str() + "," + in1.str();
+  std::string command2 = "cat " + out2.str() + "," + in2.str();
+  WriteToFile(in1, "a");
+  WriteToFile(in2, "b");
+  WriteToFile(registry_file_,
+              "[" + SystemCommand(command1, {in1}, out1) + "," +
+                  SystemCommand(command2, {in2}, out2) + "," +
+                  BuildDirective({out1, out2}) + "]");
+
+  std::unique_ptr<Watcher> watcher = Watcher::Create(&env_, registry_file_);
+  if (!watcher) {
+    GTEST_SKIP() << "Files can't be watched on this platform.";
+  }
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(2, TakeCommands().size());
+
+  WriteToFile(in1, "c");
+  watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(std::vector<std::string>({command1}), TakeCommands());
+  EXPECT_EQ("c", ReadFile(out1));
+  EXPECT_EQ("b", ReadFile(out2));
+}
+
+TEST_F(WatcherTest, ChangesToFilesThatAreNotReadAreIgnored) {
+  Path in = PathTo("in.txt");
+  Path out = PathTo("out.txt");
+  std::string command = "cat " + out.str() + "," + in.str();
+  WriteToFile(in, "a");
+  WriteToFile(registry_file_,
+              "[" + SystemCommand(command, {in}, out) + "," +
+                  BuildDirective({out}) + "]");
+
+  std::unique_ptr<Watcher> watcher = Watcher::Create(&env_, registry_file_);
+  if (!watcher) {
+    GTEST_SKIP() << "Files can't be watched on this platform.";
+  }
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(1, TakeCommands().size());
+
+  // The first change is ignored, so waiting only finishes after the second.
+  std::thread writer([this, &in]() {
+    WriteToFile(PathTo("unrelated.txt"), "foo");
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    WriteToFile(in, "b");
+  });
+  watcher->WaitForChanges(kQuietPeriod);
+  writer.join();
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(std::vector<std::string>({command}), TakeCommands());
+  EXPECT_EQ("b", ReadFile(out));
+}
+
+TEST_F(WatcherTest, DependenciesFromDepsFilesAreWatched) {
+  Path static1 = PathTo("static1.txt");
+  Path static2 = PathTo("static2.txt");
+  Path deps_file = PathTo("deps.txt");
+  Path out = PathTo("out.txt");
+  std::string command = "cat_file_list " + out.str() + "," + deps_file.str();
+  WriteToFile(static1, "foo");
+  WriteToFile(static2, "bar");
+  WriteToFile(deps_file, static1.str() + "\n" + static2.str() + "\n");
+  WriteToFile(registry_file_,
+              "[" + SystemCommand(command, {}, out, &deps_file) + "," +
+                  BuildDirective({out}) + "]");
+
+  std::unique_ptr<Watcher> watcher = Watcher::Create(&env_, registry_file_);
+  if (!watcher) {
+    GTEST_SKIP() << "Files can't be watched on this platform.";
+  }
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(1, TakeCommands().size());
+  EXPECT_EQ("foobar", ReadFile(out));
+
+  WriteToFile(static2, "baz");
+  watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(std::vector<std::string>({command}), TakeCommands());
+  EXPECT_EQ("foobaz", ReadFile(out));
+}
+
+TEST_F(WatcherTest, RegistryChangesReloadTheGraph) {
+  Path out1 = PathTo("out1.txt");
+  Path out2 = PathTo("out2.txt");
+  std::string command1 = "echo " + out1.str() + ",a";
+  std::string command2 = "echo " + out2.str() + ",b";
+  WriteToFile(registry_file_,
+              "[" + SystemCommand(command1, {}, out1) + "," +
+                  BuildDirective({out1}) + "]");
+
+  std::unique_ptr<Watcher> watcher = Watcher::Create(&env_, registry_file_);
+  if (!watcher) {
+    GTEST_SKIP() << "Files can't be watched on this platform.";
+  }
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(std::vector<std::string>({command1}), TakeCommands());
+
+  WriteToFile(registry_file_,
+              "[" + SystemCommand(command1, {}, out1) + "," +
+                  SystemCommand(command2, {}, out2) + "," +
+                  BuildDirective({out1, out2}) + "]");
+  watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(std::vector<std::string>({command2}), TakeCommands());
+  EXPECT_EQ("b", ReadFile(out2));
+}
+
+TEST_F(WatcherTest, FixingARegistryRecoversFromErrors) {
+  Path out = PathTo("out.txt");
+  std::string command = "echo " + out.str() + ",a";
+  WriteToFile(registry_file_, "[{\"build\": [\"" + out.str() + "\"]}]");
+
+  std::unique_ptr<Watcher> watcher = Watcher::Create(&env_, registry_file_);
+  if (!watcher) {
+    GTEST_SKIP() << "Files can't be watched on this platform.";
+  }
+  // The target isn't defined.
+  EXPECT_TRUE(watcher->Build().has_value());
+
+  WriteToFile(registry_file_,
+              "[" + SystemCommand(command, {}, out) + "," +
+                  BuildDirective({out}) + "]");
+  watcher->WaitForChanges(kQuietPeriod);
+  EXPECT_FALSE(watcher->Build().has_value());
+  EXPECT_EQ(std::vector<std::string>({command}), TakeCommands());
+  EXPECT_EQ("a", ReadFile(out));
+}
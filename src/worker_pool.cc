@@ -0,0 +1,119 @@
+#include "worker_pool.h"
+
+#include <stdint.h>
+
+#include <thread>
+
+#include "fiber_condition_variable.h"
+#include "piped_process_protocol.h"
+
+namespace respire {
+
+namespace {
+const char kPersistentWorkerFlag[] = "--persistent_worker";
+
+stdext::optional<platform::SystemCommandResult> SendRequest(
+    platform::PipedProcess* worker,
+    const std::vector<std::string>& arguments) {
+  std::string request;
+  AppendStringList(&request, arguments);
+  if (!worker->Write(request.data(), request.size())) {
+    return stdext::nullopt;
+  }
+
+  int32_t exit_code;
+  platform::SystemCommandResult result;
+  if (!ReadInt32(worker, &exit_code) ||
+      !ReadOutput(worker, &result.stdout_output) ||
+      !ReadOutput(worker, &result.stderr_output)) {
+    return stdext::nullopt;
+  }
+  result.exit_code = exit_code;
+  return result;
+}
+
+struct PendingRequest {
+  PendingRequest(ebb::ThreadPool* thread_pool)
+      : done(false), done_cond(thread_pool) {}
+
+  std::mutex mutex;
+  bool done;
+  stdext::optional<platform::SystemCommandResult> result;
+  ebb::FiberConditionVariable done_cond;
+};
+}  // namespace
+
+WorkerPool::WorkerPool(ebb::Environment* env, int max_workers_per_tool)
+    : env_(env), max_workers_per_tool_(max_workers_per_tool) {}
+
+WorkerPool::~WorkerPool() {}
+
+stdext::optional<platform::SystemCommandResult> WorkerPool::Execute(
+    const std::vector<std::string>& worker_argv,
+    const std::vector<std::string>& arguments) {
+  std::unique_ptr<platform::PipedProcess> worker;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tool* tool = &tools_[worker_argv];
+    if (tool->broken) {
+      return stdext::nullopt;
+    }
+    if (!tool->idle_workers.empty()) {
+      worker = std::move(tool->idle_workers.back());
+      tool->idle_workers.pop_back();
+    } else if (tool->num_workers < max_workers_per_tool_) {
+      // Reserve a spot for the worker that we're about to start.
+      ++tool->num_workers;
+    } else {
+      return stdext::nullopt;
+    }
+  }
+  bool fresh_worker = !worker;
+
+  // Starting and talking to the worker blocks, so it's done on a separate
+  // thread in order to leave this one free to run other fibers.
+  PendingRequest pending(&env_->env()->thread_pool());
+  std::thread request_thread([&pending, &worker, &worker_argv, &arguments]() {
+    if (!worker) {
+      std::vector<std::string> start_argv(worker_argv);
+      start_argv.push_back(kPersistentWorkerFlag);
+      worker = platform::PipedProcess::Start(start_argv);
+    }
+    stdext::optional<platform::SystemCommandResult> result;
+    if (worker) {
+      result = SendRequest(worker.get(), arguments);
+    }
+
+    std::lock_guard<std::mutex> lock(pending.mutex);
+    pending.done = true;
+    pending.result = std::move(result);
+    pending.done_cond.notify_one();
+  });
+  {
+    std::unique_lock<std::mutex> lock(pending.mutex);
+    while (!pending.done) {
+      pending.done_cond.wait(lock);
+    }
+  }
+  request_thread.join();
+
+  if (!pending.result) {
+    // The worker is in an unknown state, so get rid of it.  Do that outside
+    // of the lock, since it may take a moment for the worker to exit.
+    worker.reset();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Tool* tool = &tools_[worker_argv];
+  if (pending.result) {
+    tool->idle_workers.push_back(std::move(worker));
+  } else {
+    --tool->num_workers;
+    if (fresh_worker) {
+      tool->broken = true;
+    }
+  }
+  return std::move(pending.result);
+}
+
+}  // namespace respire
@@ -0,0 +1,69 @@
+#ifndef __RESPIRE_WORKER_POOL_H__
+#define __RESPIRE_WORKER_POOL_H__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <ebbpp.h>
+
+#include "platform/piped_process.h"
+#include "platform/subprocess.h"
+#include "stdext/optional.h"
+
+namespace respire {
+
+// Keeps long-lived worker processes around for tools that are invoked over
+// and over again, in the spirit of Bazel's persistent workers, so that a tool
+// with an expensive startup (e.g. an interpreter) only pays for it once per
+// worker rather than once per command.
+//
+// A worker is started by appending "--persistent_worker" to its command line,
+// and then services one request at a time over its stdin and stdout until its
+// stdin is closed.  All integers are in native byte order, and strings are
+// encoded as a uint32 length followed by their characters:
+//
+//   Requests:  [uint32 argc][argument strings]
+//   Responses: [int32 exit code][stdout output][stderr output]
+//
+// Workers are started on demand, up to a maximum number per tool, and are
+// reused for as long as the pool lives.
+class WorkerPool {
+ public:
+  WorkerPool(ebb::Environment* env, int max_workers_per_tool);
+  ~WorkerPool();
+
+  // Sends |arguments| as a request to a worker started with |worker_argv|.
+  // Only the calling fiber is suspended while the worker runs.  Returns a
+  // disengaged optional if no worker could handle the request, e.g. because
+  // all of the tool's workers are busy or the tool doesn't speak the worker
+  // protocol, in which case the command should be run as an ordinary process
+  // instead.
+  stdext::optional<platform::SystemCommandResult> Execute(
+      const std::vector<std::string>& worker_argv,
+      const std::vector<std::string>& arguments);
+
+ private:
+  struct Tool {
+    Tool() : num_workers(0), broken(false) {}
+
+    std::vector<std::unique_ptr<platform::PipedProcess>> idle_workers;
+    // Includes both idle and busy workers.
+    int num_workers;
+    // Set if a freshly started worker failed its first request, in which case
+    // we stop trying to start new ones.
+    bool broken;
+  };
+
+  ebb::Environment* env_;
+  const int max_workers_per_tool_;
+
+  std::mutex mutex_;
+  std::map<std::vector<std::string>, Tool> tools_;
+};
+
+}  // namespace respire
+
+#endif  // __RESPIRE_WORKER_POOL_H__
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "worker_pool.h"
+
+using respire::WorkerPool;
+
+namespace {
+const int kDefaultStackSize = 16 * 1024;
+
+#if !defined(_WIN32)
+// A worker that replies to each request by echoing its arguments to stdout,
+// reporting its pid on stderr, and exiting with the number of arguments.
+const char* kEchoWorkerScript = R"(
+import os, struct, sys
+if sys.argv[-1] != '--persistent_worker':
+  sys.exit(2)
+def Read(size):
+  data = b''
+  while len(data) < size:
+    chunk = sys.stdin.buffer.read(size - len(data))
+    if not chunk:
+      sys.exit(0)
+    data += chunk
+  return data
+while True:
+  (argc,) = struct.unpack('=I', Read(4))
+  args = [Read(struct.unpack('=I', Read(4))[0]).decode() for _ in range(argc)]
+  stdout = ' '.join(args).encode()
+  stderr = str(os.getpid()).encode()
+  sys.stdout.buffer.write(
+      struct.pack('=iI', argc, len(stdout)) + stdout +
+      struct.pack('=I', len(stderr)) + stderr)
+  sys.stdout.buffer.flush()
+)";
+
+std::vector<std::string> EchoWorker() {
+  return {"python3", "-c", kEchoWorkerScript};
+}
+#endif
+}  // namespace
+
+#if !defined(_WIN32)
+TEST(WorkerPoolTest, WorkerIsReusedAcrossRequests) {
+  ebb::Environment env(1, kDefaultStackSize);
+  WorkerPool pool(&env, 1);
+
+  auto first = pool.Execute(EchoWorker(), {"a", "b c"});
+  ASSERT_TRUE(first);
+  EXPECT_EQ(2, first->exit_code);
+  EXPECT_EQ("a b c", first->stdout_output);
+
+  auto second = pool.Execute(EchoWorker(), {});
+  ASSERT_TRUE(second);
+  EXPECT_EQ(0, second->exit_code);
+  EXPECT_EQ("", second->stdout_output);
+
+  // Both requests were handled by the same process.
+  EXPECT_FALSE(first->stderr_output.empty());
+  EXPECT_EQ(first->stderr_output, second->stderr_output);
+}
+
+TEST(WorkerPoolTest, ToolsThatAreNotWorkersAreGivenUpOn) {
+  ebb::Environment env(1, kDefaultStackSize);
+  WorkerPool pool(&env, 1);
+
+  std::vector<std::string> not_a_worker = {"sh", "-c", "exit 0"};
+  EXPECT_FALSE(pool.Execute(not_a_worker, {"a"}));
+  EXPECT_FALSE(pool.Execute(not_a_worker, {"a"}));
+
+  EXPECT_FALSE(pool.Execute({"/this/program/does/not/exist"}, {"a"}));
+
+  // Other tools are unaffected.
+  EXPECT_TRUE(pool.Execute(EchoWorker(), {"a"}));
+}
+#endif